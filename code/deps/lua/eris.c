@@ -1,5 +1,5 @@
 /*
-Eris - Heavy-duty persistence for Lua 5.2.4 - Based on Pluto
+Eris - Heavy-duty persistence for Lua 5.4.0 - Based on Pluto
 Copyright (c) 2013-2015 by Florian Nuecke.
 
 Permission is hereby granted, free of charge, to any person obtaining a copy
@@ -23,7 +23,9 @@ THE SOFTWARE.
 
 /* Standard library headers. */
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -45,9 +47,12 @@ typedef int bool;
 #include "lualib.h"
 
 /* Internal Lua headers. */
+#include "lapi.h"
 #include "ldebug.h"
 #include "ldo.h"
 #include "lfunc.h"
+#include "lgc.h"
+#include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
 #include "lstring.h"
@@ -106,35 +111,41 @@ static const lua_Unsigned kMaxComplexity = 10000;
 /* I'm quite sure we won't ever want to do this, because Eris needs a slightly
  * patched Lua version to be able to persist some of the library functions,
  * anyway: it needs to put the continuation C functions in the perms table. */
-/* ldebug.h */
-#define eris_ci_func ci_func
+/* lapi.h */
+#define eris_incr_top api_incr_top
 /* ldo.h */
-#define eris_incr_top incr_top
 #define eris_savestack savestack
 #define eris_restorestack restorestack
 #define eris_reallocstack luaD_reallocstack
 /* lfunc.h */
 #define eris_newproto luaF_newproto
 #define eris_newLclosure luaF_newLclosure
-#define eris_newupval luaF_newupval
 #define eris_findupval luaF_findupval
+#define eris_upisopen upisopen
+#define eris_uplevel uplevel
 /* lgc.h */
-#define eris_barrierproto luaC_barrierproto
+#define eris_newobj luaC_newobj
+#define eris_barrier luaC_barrier
+#define eris_objbarrier luaC_objbarrier
 /* lmem.h */
-#define eris_reallocvector luaM_reallocvector
+#define eris_newvector luaM_newvectorchecked
+#define eris_newci(L) luaM_new(L, CallInfo)
 /* lobject.h */
-#define eris_ttypenv ttypenv
+#define eris_s2v s2v
+#define eris_ttypetag ttypetag
+#define eris_ttisLclosure ttisLclosure
+#define eris_ttisfunction ttisfunction
+#define eris_uvalue uvalue
 #define eris_clLvalue clLvalue
+#define eris_clCvalue clCvalue
 #define eris_setnilvalue setnilvalue
-#define eris_setclLvalue setclLvalue
+#define eris_setclLvalue2s setclLvalue2s
 #define eris_setobj setobj
-#define eris_setsvalue2n setsvalue2n
+#define eris_setobj2s setobj2s
+#define eris_setsvalue2s setsvalue2s
 /* lstate.h */
 #define eris_isLua isLua
-#define eris_gch gch
-#define eris_gco2uv gco2uv
-#define eris_obj2gco obj2gco
-#define eris_extendCI luaE_extendCI
+#define eris_gco2upv gco2upv
 /* lstring. h */
 #define eris_newlstr luaS_newlstr
 /* lzio.h */
@@ -151,6 +162,11 @@ static const lua_Unsigned kMaxComplexity = 10000;
 #define eris_savestackidx(L, p) ((p) - (L)->stack)
 #define eris_restorestackidx(L, n) ((L)->stack + (n))
 
+/* Continuation functions of the standard libraries, which are not reachable
+ * from any of their tables. See lbaselib.c and lcorolib.c. */
+LUAI_FUNC void eris_permbaselib(lua_State *L, int forUnpersist);
+LUAI_FUNC void eris_permcorolib(lua_State *L, int forUnpersist);
+
 /*
 ** ============================================================================
 ** Language strings for errors.
@@ -170,13 +186,18 @@ static const lua_Unsigned kMaxComplexity = 10000;
 #define ERIS_ERR_SPER_UPERM "bad permanent value (%s expected, got %s)"
 #define ERIS_ERR_SPER_UPERMNIL "bad permanent value (no value)"
 #define ERIS_ERR_STACKBOUNDS "stack index out of bounds"
+#define ERIS_ERR_STACKSIZE "invalid stack size"
 #define ERIS_ERR_TABLE "bad table value, got a nil value"
 #define ERIS_ERR_THREAD "cannot persist currently running thread"
 #define ERIS_ERR_THREADCI "invalid callinfo"
 #define ERIS_ERR_THREADCTX "bad C continuation function"
 #define ERIS_ERR_THREADERRF "invalid errfunc"
+#define ERIS_ERR_THREADHOOK "cannot persist thread suspended in a hook or finalizer"
 #define ERIS_ERR_THREADPC "saved program counter out of bounds"
+#define ERIS_ERR_THREADSTATUS "invalid thread status"
+#define ERIS_ERR_THREADTBC "cannot persist thread with pending to-be-closed variables"
 #define ERIS_ERR_TRUNC_INT "int value would get truncated"
+#define ERIS_ERR_TRUNC_INTEGER "integer value would get truncated"
 #define ERIS_ERR_TRUNC_SIZE "size_t value would get truncated"
 #define ERIS_ERR_TYPE_FLOAT "unsupported lua_Number type"
 #define ERIS_ERR_TYPE_INT "unsupported int type"
@@ -185,6 +206,7 @@ static const lua_Unsigned kMaxComplexity = 10000;
 #define ERIS_ERR_TYPEU "trying to unpersist unknown type %d"
 #define ERIS_ERR_UCFUNC "bad C closure (C function expected, got %s)"
 #define ERIS_ERR_UCFUNCNULL "bad C closure (C function expected, got null)"
+#define ERIS_ERR_UPVALUES "bad closure (upvalue count mismatch)"
 #define ERIS_ERR_USERDATA "attempt to literally persist userdata"
 #define ERIS_ERR_WRITE "could not write data"
 #define ERIS_ERR_REF "invalid reference #%d. this usually means a special "\
@@ -200,8 +222,8 @@ static const lua_Unsigned kMaxComplexity = 10000;
 /* The "type" we write when we persist a value via a replacement from the
  * permanents table. This is just an arbitrary number, but it must we lower
  * than the reference offset (below) and outside the range Lua uses for its
- * types (> LUA_TOTALTAGS). */
-#define ERIS_PERMANENT (LUA_TOTALTAGS + 1)
+ * types (> LUA_TOTALTYPES). */
+#define ERIS_PERMANENT (LUA_TOTALTYPES + 1)
 
 /* This is essentially the first reference we'll use. We do this to save one
  * field in our persisted data: if the value is smaller than this, the object
@@ -257,8 +279,7 @@ typedef struct Info {
 /* Type names, used for error messages. */
 static const char *const kTypenames[] = {
   "nil", "boolean", "lightuserdata", "number", "string",
-  "table", "function", "userdata", "thread", "proto", "upval",
-  "deadkey", "permanent"
+  "table", "function", "userdata", "thread", "upval", "proto"
 };
 
 /* Setting names as used in eris.settings / eris_g|set_setting. Also, the
@@ -270,8 +291,9 @@ static const char *const kSettingGeneratePath = "path";
 static const char *const kSettingWriteDebugInfo = "debug";
 static const char *const kSettingMaxComplexity = "maxrec";
 
-/* Header we prefix to persisted data for a quick check when unpersisting. */
-static char const kHeader[] = { 'E', 'R', 'I', 'S' };
+/* Header we prefix to persisted data for a quick check when unpersisting. The
+ * last byte is bumped whenever the format changes. */
+static char const kHeader[] = { 'E', 'R', 'I', 'S', 5, 4 };
 #define HEADER_LENGTH sizeof(kHeader)
 
 /* Floating point number used to check compatibility of loaded data. */
@@ -297,6 +319,16 @@ static const lua_Number kHeaderNumber = (lua_Number)-1.234567890;
 ** ============================================================================
 */
 
+/* Returns the name of a type for error messages, including our internal ones.
+ * Types read from persisted data may be garbage, so this is bounds checked. */
+static const char*
+typename(int type) {
+  if (type < 0 || type >= (int)(sizeof(kTypenames) / sizeof(kTypenames[0]))) {
+    return "?";
+  }
+  return kTypenames[type];
+}
+
 /* Pushes an object into the reference table when unpersisting. This creates an
  * entry pointing from the id the object is referenced by to the object. */
 static int
@@ -314,7 +346,7 @@ registerobject(Info *info) {                          /* perms reftbl ... obj */
 static void
 pushtstring(lua_State* L, TString *ts) {                               /* ... */
   if (ts) {
-    eris_setsvalue2n(L, L->top, ts);
+    eris_setsvalue2s(L, L->top, ts);
     eris_incr_top(L);                                              /* ... str */
   }
   else {
@@ -323,11 +355,16 @@ pushtstring(lua_State* L, TString *ts) {                               /* ... */
 }
 
 /* Creates a copy of the string on top of the stack and sets it as the value
- * of the specified TString**. */
+ * of the specified TString**. Nil clears it, for stripped debug info. */
 static void
 copytstring(lua_State* L, TString **ts) {
   size_t length;
-  const char *value = lua_tolstring(L, -1, &length);
+  const char *value;
+  if (lua_isnil(L, -1)) {
+    *ts = NULL;
+    return;
+  }
+  value = lua_tolstring(L, -1, &length);
   *ts = eris_newlstr(L, value, length);
 }
 
@@ -348,7 +385,7 @@ pushpath(Info *info, const char* fmt, ...) {     /* perms reftbl var path ... */
     va_end(argp);
     lua_rawseti(info->L, PATHIDX, luaL_len(info->L, PATHIDX) + 1);
   }                                              /* perms reftbl var path ... */
-}  
+}
 
 /* Pops the last added segment from the current path if we're generating one. */
 static void
@@ -437,6 +474,15 @@ checkboolean(lua_State *L, int narg) {                       /* ... bool? ... */
   return lua_toboolean(L, narg);
 }
 
+/* Adds the continuation functions of the standard libraries to the perms
+ * table on top of the stack. These are needed to persist coroutines that
+ * yielded from inside a pcall or a coroutine.wrap'ed function. */
+static void
+populateperms(lua_State *L, bool forUnpersist) {                 /* ... perms */
+  eris_permbaselib(L, forUnpersist);
+  eris_permcorolib(L, forUnpersist);
+}
+
 /* }======================================================================== */
 
 /*
@@ -573,7 +619,22 @@ write_size_t(Info *info, size_t value) {
 
 static void
 write_lua_Number(Info *info, lua_Number value) {
-  write_int32_t(info, value.bits());
+  if (sizeof(lua_Number) == sizeof(float)) {
+    write_float32(info, (float)value);
+  }
+  else if (sizeof(lua_Number) == sizeof(double)) {
+    write_float64(info, (double)value);
+  }
+  else {
+    eris_error(info, ERIS_ERR_TYPE_FLOAT);
+  }
+}
+
+/* Integers are always written with 64 bits, so that data can be exchanged
+ * between builds using different integer types. */
+static void
+write_lua_Integer(Info *info, lua_Integer value) {
+  write_int64_t(info, (int64_t)value);
 }
 
 /* Note that Lua only ever uses 32 bits of the Instruction type, so we can
@@ -733,7 +794,26 @@ read_size_t(Info *info) {
 
 static lua_Number
 read_lua_Number(Info *info) {
-  return lua_Number::frombits(read_int32_t(info));
+  if (sizeof(lua_Number) == sizeof(float)) {
+    return (lua_Number)read_float32(info);
+  }
+  else if (sizeof(lua_Number) == sizeof(double)) {
+    return (lua_Number)read_float64(info);
+  }
+  else {
+    eris_error(info, ERIS_ERR_TYPE_FLOAT);
+    return 0; /* not reached */
+  }
+}
+
+static lua_Integer
+read_lua_Integer(Info *info) {
+  int64_t pvalue = read_int64_t(info);
+  lua_Integer value = (lua_Integer)pvalue;
+  if ((int64_t)value != pvalue) {
+    eris_error(info, ERIS_ERR_TRUNC_INTEGER);
+  }
+  return value;
 }
 
 static Instruction
@@ -784,15 +864,29 @@ u_pointer(Info *info) {                                                /* ... */
 
 /** ======================================================================== */
 
+/* Integers and floats share a type, but have to come back as what they were,
+ * so the subtype is written first. */
 static void
 p_number(Info *info) {                                             /* ... num */
-  WRITE_VALUE(lua_tonumber(info->L, -1), lua_Number);
+  if (lua_isinteger(info->L, -1)) {
+    WRITE_VALUE(true, uint8_t);
+    WRITE_VALUE(lua_tointeger(info->L, -1), lua_Integer);
+  }
+  else {
+    WRITE_VALUE(false, uint8_t);
+    WRITE_VALUE(lua_tonumber(info->L, -1), lua_Number);
+  }
 }
 
 static void
 u_number(Info *info) {                                                 /* ... */
   eris_checkstack(info->L, 1);
-  lua_pushnumber(info->L, READ_VALUE(lua_Number));                 /* ... num */
+  if (READ_VALUE(uint8_t)) {
+    lua_pushinteger(info->L, READ_VALUE(lua_Integer));             /* ... num */
+  }
+  else {
+    lua_pushnumber(info->L, READ_VALUE(lua_Number));               /* ... num */
+  }
 
   eris_assert(lua_type(info->L, -1) == LUA_TNUMBER);
 }
@@ -813,7 +907,7 @@ u_string(Info *info) {                                                 /* ... */
   {
     /* TODO Can we avoid this copy somehow? (Without it getting too nasty) */
     const size_t length = READ_VALUE(size_t);
-    char *value = (char*)lua_newuserdata(info->L, length * sizeof(char)); /* ... tmp */
+    char *value = (char*)lua_newuserdatauv(info->L, length * sizeof(char), 0); /* ... tmp */
     READ_RAW(value, length);
     lua_pushlstring(info->L, value, length);                   /* ... tmp str */
     lua_replace(info->L, -2);                                      /* ... str */
@@ -946,22 +1040,54 @@ u_literaltable(Info *info) {                                           /* ... */
 
 static void
 p_literaluserdata(Info *info) {                                  /* ... udata */
+  int i;
   const size_t size = lua_rawlen(info->L, -1);
   const void *value = lua_touserdata(info->L, -1);
+  const int nuvalue = eris_uvalue(eris_s2v(info->L->top - 1))->nuvalue;
+  WRITE_VALUE(nuvalue, int);
   WRITE_VALUE(size, size_t);
   WRITE_RAW(value, size);
+
+  /* Write user values. */
+  eris_checkstack(info->L, 1);
+  pushpath(info, "@uservalues");
+  for (i = 1; i <= nuvalue; ++i) {
+    pushpath(info, "[%d]", i);
+    lua_getiuservalue(info->L, -1, i);                       /* ... udata obj */
+    persist(info);                                           /* ... udata obj */
+    lua_pop(info->L, 1);                                         /* ... udata */
+    poppath(info);
+  }
+  poppath(info);
+
   p_metatable(info);                                             /* ... udata */
 }
 
 static void
 u_literaluserdata(Info *info) {                                        /* ... */
-  eris_checkstack(info->L, 1);
+  int i;
+  const int nuvalue = READ_VALUE(int);
+  if (nuvalue < 0 || nuvalue > USHRT_MAX) {
+    eris_error(info, ERIS_ERR_READ);
+  }
+  eris_checkstack(info->L, 2);
   {
     size_t size = READ_VALUE(size_t);
-    void *value = lua_newuserdata(info->L, size);                /* ... udata */
+    void *value = lua_newuserdatauv(info->L, size, nuvalue);     /* ... udata */
     READ_RAW(value, size);                                       /* ... udata */
   }
   registerobject(info);
+
+  /* Read user values. */
+  pushpath(info, "@uservalues");
+  for (i = 1; i <= nuvalue; ++i) {
+    pushpath(info, "[%d]", i);
+    unpersist(info);                                         /* ... udata obj */
+    lua_setiuservalue(info->L, -2, i);                           /* ... udata */
+    poppath(info);
+  }
+  poppath(info);
+
   u_metatable(info);
 }
 
@@ -1059,14 +1185,14 @@ u_special(Info *info, int type, Callback literal) {                    /* ... */
     }
 
     if (lua_type(info->L, -1) != type) {                            /* ... :( */
-      const char *want = kTypenames[type];
-      const char *have = kTypenames[lua_type(info->L, -1)];
+      const char *want = typename(type);
+      const char *have = typename(lua_type(info->L, -1));
       eris_error(info, ERIS_ERR_SPER_LOAD, want, have);
     }                                                              /* ... obj */
 
     /* Update the reftable entry. */
     lua_pushvalue(info->L, -1);                                /* ... obj obj */
-    lua_rawseti(info->L, 2, reference);                            /* ... obj */
+    lua_rawseti(info->L, REFTIDX, reference);                      /* ... obj */
   }
   else {
     literal(info);                                                 /* ... obj */
@@ -1135,7 +1261,8 @@ p_proto(Info *info) {                                            /* ... proto */
   pushpath(info, ".constants");
   for (i = 0; i < p->sizek; ++i) {
     pushpath(info, "[%d]", i);
-    eris_setobj(info->L, info->L->top++, &p->k[i]);      /* ... lcl proto obj */
+    eris_setobj2s(info->L, info->L->top, &p->k[i]);
+    eris_incr_top(info->L);                              /* ... lcl proto obj */
     persist(info);                                       /* ... lcl proto obj */
     lua_pop(info->L, 1);                                     /* ... lcl proto */
     poppath(info);
@@ -1160,6 +1287,7 @@ p_proto(Info *info) {                                            /* ... proto */
   for (i = 0; i < p->sizeupvalues; ++i) {
     WRITE_VALUE(p->upvalues[i].instack, uint8_t);
     WRITE_VALUE(p->upvalues[i].idx, uint8_t);
+    WRITE_VALUE(p->upvalues[i].kind, uint8_t);
   }
 
   /* If we don't have to persist debug information skip the rest. */
@@ -1175,7 +1303,14 @@ p_proto(Info *info) {                                            /* ... proto */
 
   /* Write line information. */
   WRITE_VALUE(p->sizelineinfo, int);
-  WRITE(p->lineinfo, p->sizelineinfo, int);
+  for (i = 0; i < p->sizelineinfo; ++i) {
+    WRITE_VALUE((uint8_t)p->lineinfo[i], uint8_t);
+  }
+  WRITE_VALUE(p->sizeabslineinfo, int);
+  for (i = 0; i < p->sizeabslineinfo; ++i) {
+    WRITE_VALUE(p->abslineinfo[i].pc, int);
+    WRITE_VALUE(p->abslineinfo[i].line, int);
+  }
 
   /* Write locals info. */
   WRITE_VALUE(p->sizelocvars, int);
@@ -1203,6 +1338,17 @@ p_proto(Info *info) {                                            /* ... proto */
   poppath(info);
 }
 
+/* Reads an array size, making sure a broken input can't make us allocate
+ * nonsense. */
+static int
+read_count(Info *info) {
+  const int n = READ_VALUE(int);
+  if (n < 0) {
+    eris_error(info, ERIS_ERR_READ);
+  }
+  return n;
+}
+
 static void
 u_proto(Info *info) {                                            /* ... proto */
   int i, n;
@@ -1222,44 +1368,53 @@ u_proto(Info *info) {                                            /* ... proto */
   p->is_vararg = READ_VALUE(uint8_t);
   p->maxstacksize = READ_VALUE(uint8_t);
 
-  /* Read byte code. */
-  p->sizecode = READ_VALUE(int);
-  eris_reallocvector(info->L, p->code, 0, p->sizecode, Instruction);
-  READ(p->code, p->sizecode, Instruction);
+  /* Read byte code. Sizes are only set once the arrays exist, so that the
+   * GC frees the right amount if we bail out halfway through. */
+  n = read_count(info);
+  p->code = eris_newvector(info->L, n, Instruction);
+  p->sizecode = n;
+  READ(p->code, n, Instruction);
 
   /* Read constants. */
-  p->sizek = READ_VALUE(int);
-  eris_reallocvector(info->L, p->k, 0, p->sizek, TValue);
+  n = read_count(info);
+  p->k = eris_newvector(info->L, n, TValue);
+  p->sizek = n;
   /* Set all values to nil to avoid confusing the GC. */
-  for (i = 0, n = p->sizek; i < n; ++i) {
+  for (i = 0; i < n; ++i) {
     eris_setnilvalue(&p->k[i]);
   }
   pushpath(info, ".constants");
-  for (i = 0, n = p->sizek; i < n; ++i) {
+  for (i = 0; i < n; ++i) {
     pushpath(info, "[%d]", i);
     unpersist(info);                                         /* ... proto obj */
-    eris_setobj(info->L, &p->k[i], info->L->top - 1);
+    eris_setobj(info->L, &p->k[i], eris_s2v(info->L->top - 1));
+    eris_barrier(info->L, p, eris_s2v(info->L->top - 1));
     lua_pop(info->L, 1);                                         /* ... proto */
     poppath(info);
   }
   poppath(info);
 
   /* Read child protos. */
-  p->sizep = READ_VALUE(int);
-  eris_reallocvector(info->L, p->p, 0, p->sizep, Proto*);
+  n = read_count(info);
+  p->p = eris_newvector(info->L, n, Proto*);
+  p->sizep = n;
   /* Null all entries to avoid confusing the GC. */
-  memset(p->p, 0, p->sizep * sizeof(Proto*));
+  for (i = 0; i < n; ++i) {
+    p->p[i] = NULL;
+  }
   pushpath(info, ".protos");
-  for (i = 0, n = p->sizep; i < n; ++i) {
+  for (i = 0; i < n; ++i) {
     Proto *cp;
     pushpath(info, "[%d]", i);
     p->p[i] = eris_newproto(info->L);
-    lua_pushlightuserdata(info->L, (void*)p->p[i]);              /* ... proto nproto */
+    eris_objbarrier(info->L, p, p->p[i]);
+    lua_pushlightuserdata(info->L, (void*)p->p[i]);      /* ... proto nproto */
     unpersist(info);                        /* ... proto nproto nproto/oproto */
     cp = (Proto*)lua_touserdata(info->L, -1);
     if (cp != p->p[i]) {                           /* ... proto nproto oproto */
       /* Just overwrite it, GC will clean this up. */
       p->p[i] = cp;
+      eris_objbarrier(info->L, p, cp);
     }
     lua_pop(info->L, 2);                                         /* ... proto */
     poppath(info);
@@ -1267,12 +1422,14 @@ u_proto(Info *info) {                                            /* ... proto */
   poppath(info);
 
   /* Read upvalues. */
-  p->sizeupvalues = READ_VALUE(int);
-  eris_reallocvector(info->L, p->upvalues, 0, p->sizeupvalues, Upvaldesc);
-  for (i = 0, n = p->sizeupvalues; i < n; ++i) {
+  n = read_count(info);
+  p->upvalues = eris_newvector(info->L, n, Upvaldesc);
+  p->sizeupvalues = n;
+  for (i = 0; i < n; ++i) {
     p->upvalues[i].name = NULL;
     p->upvalues[i].instack = READ_VALUE(uint8_t);
     p->upvalues[i].idx = READ_VALUE(uint8_t);
+    p->upvalues[i].kind = READ_VALUE(uint8_t);
   }
 
   /* Read debug information if any is present. */
@@ -1285,27 +1442,44 @@ u_proto(Info *info) {                                            /* ... proto */
   /* Read function source code. */
   unpersist(info);                                           /* ... proto str */
   copytstring(info->L, &p->source);
+  if (p->source) {
+    eris_objbarrier(info->L, p, p->source);
+  }
   lua_pop(info->L, 1);                                           /* ... proto */
 
   /* Read line information. */
-  p->sizelineinfo = READ_VALUE(int);
-  eris_reallocvector(info->L, p->lineinfo, 0, p->sizelineinfo, int);
-  READ(p->lineinfo, p->sizelineinfo, int);
+  n = read_count(info);
+  p->lineinfo = eris_newvector(info->L, n, ls_byte);
+  p->sizelineinfo = n;
+  for (i = 0; i < n; ++i) {
+    p->lineinfo[i] = (ls_byte)READ_VALUE(uint8_t);
+  }
+  n = read_count(info);
+  p->abslineinfo = eris_newvector(info->L, n, AbsLineInfo);
+  p->sizeabslineinfo = n;
+  for (i = 0; i < n; ++i) {
+    p->abslineinfo[i].pc = READ_VALUE(int);
+    p->abslineinfo[i].line = READ_VALUE(int);
+  }
 
   /* Read locals info. */
-  p->sizelocvars = READ_VALUE(int);
-  eris_reallocvector(info->L, p->locvars, 0, p->sizelocvars, LocVar);
+  n = read_count(info);
+  p->locvars = eris_newvector(info->L, n, LocVar);
+  p->sizelocvars = n;
   /* Null the variable names to avoid confusing the GC. */
-  for (i = 0, n = p->sizelocvars; i < n; ++i) {
+  for (i = 0; i < n; ++i) {
     p->locvars[i].varname = NULL;
   }
   pushpath(info, ".locvars");
-  for (i = 0, n = p->sizelocvars; i < n; ++i) {
+  for (i = 0; i < n; ++i) {
     pushpath(info, "[%d]", i);
     p->locvars[i].startpc = READ_VALUE(int);
     p->locvars[i].endpc = READ_VALUE(int);
     unpersist(info);                                         /* ... proto str */
     copytstring(info->L, &p->locvars[i].varname);
+    if (p->locvars[i].varname) {
+      eris_objbarrier(info->L, p, p->locvars[i].varname);
+    }
     lua_pop(info->L, 1);                                         /* ... proto */
     poppath(info);
   }
@@ -1317,6 +1491,9 @@ u_proto(Info *info) {                                            /* ... proto */
     pushpath(info, "[%d]", i);
     unpersist(info);                                         /* ... proto str */
     copytstring(info->L, &p->upvalues[i].name);
+    if (p->upvalues[i].name) {
+      eris_objbarrier(info->L, p, p->upvalues[i].name);
+    }
     lua_pop(info->L, 1);                                         /* ... proto */
     poppath(info);
   }
@@ -1351,6 +1528,18 @@ u_upval(Info *info) {                                                  /* ... */
 
 /** ======================================================================== */
 
+/* Creates a new closed upvalue holding nil. In 5.4 upvalues are collectable
+ * objects of their own, so this must be stored in a closure right away. */
+static UpVal*
+newupval(lua_State *L) {
+  GCObject *o = eris_newobj(L, LUA_VUPVAL, sizeof(UpVal));
+  UpVal *uv = eris_gco2upv(o);
+  uv->tbc = 0;
+  uv->v = &uv->u.value;
+  eris_setnilvalue(uv->v);
+  return uv;
+}
+
 /* For Lua closures we write the upvalue ID, which is usually the memory
  * address at which it is stored. This is used to tell which upvalues are
  * identical when unpersisting. */
@@ -1364,13 +1553,13 @@ static void
 p_closure(Info *info) {                              /* perms reftbl ... func */
   int nup;
   eris_checkstack(info->L, 2);
-  switch (ttype(info->L->top - 1)) {
-    case LUA_TLCF: /* light C function */
+  switch (eris_ttypetag(eris_s2v(info->L->top - 1))) {
+    case LUA_VLCF: /* light C function */
       /* We cannot persist these, they have to be handled via the permtable. */
       eris_error(info, ERIS_ERR_CFUNC, lua_tocfunction(info->L, -1));
       return; /* not reached */
-    case LUA_TCCL: /* C closure */ {                  /* perms reftbl ... ccl */
-      CClosure *cl = clCvalue(info->L->top - 1);
+    case LUA_VCCL: /* C closure */ {                  /* perms reftbl ... ccl */
+      CClosure *cl = eris_clCvalue(eris_s2v(info->L->top - 1));
       /* Mark it as a C closure. */
       WRITE_VALUE(true, uint8_t);
       /* Write the upvalue count first, since we have to know it when creating
@@ -1398,8 +1587,8 @@ p_closure(Info *info) {                              /* perms reftbl ... func */
       poppath(info);
       break;
     }
-    case LUA_TLCL: /* Lua function */ {               /* perms reftbl ... lcl */
-      LClosure *cl = eris_clLvalue(info->L->top - 1);
+    case LUA_VLCL: /* Lua function */ {               /* perms reftbl ... lcl */
+      LClosure *cl = eris_clLvalue(eris_s2v(info->L->top - 1));
       /* Mark it as a Lua closure. */
       WRITE_VALUE(false, uint8_t);
       /* Write the upvalue count first, since we have to know it when creating
@@ -1456,7 +1645,7 @@ u_closure(Info *info) {                                                /* ... */
     /* Read the C function from the permanents table. */
     unpersist(info);                                             /* ... cfunc */
     if (!lua_iscfunction(info->L, -1)) {
-      eris_error(info, ERIS_ERR_UCFUNC, kTypenames[lua_type(info->L, -1)]);
+      eris_error(info, ERIS_ERR_UCFUNC, typename(lua_type(info->L, -1)));
     }
     f = lua_tocfunction(info->L, -1);
     if (!f) {
@@ -1487,14 +1676,14 @@ u_closure(Info *info) {                                                /* ... */
     poppath(info);
   }
   else {
-    Closure *cl;
+    LClosure *cl;
     Proto *p;
 
     eris_checkstack(info->L, 4);
 
     /* Create closure and anchor it on the stack (avoid collection via GC). */
     cl = eris_newLclosure(info->L, nups);
-    eris_setclLvalue(info->L, info->L->top, cl);                   /* ... lcl */
+    eris_setclLvalue2s(info->L, info->L->top, cl);                 /* ... lcl */
     eris_incr_top(info->L);
 
     /* Preregister closure for handling of cycles (upvalues). */
@@ -1505,27 +1694,31 @@ u_closure(Info *info) {                                                /* ... */
      * unpersist function. This way the instance is safely hooked up to an
      * object, so we don't have to worry about it getting GCed. */
     pushpath(info, ".proto");
-    cl->l.p = eris_newproto(info->L);
+    cl->p = eris_newproto(info->L);
+    eris_objbarrier(info->L, cl, cl->p);
     /* Push the proto into which to unpersist as a parameter to u_proto. */
-    lua_pushlightuserdata(info->L, cl->l.p);                /* ... lcl nproto */
+    lua_pushlightuserdata(info->L, cl->p);                  /* ... lcl nproto */
     unpersist(info);                          /* ... lcl nproto nproto/oproto */
     eris_assert(lua_type(info->L, -1) == LUA_TLIGHTUSERDATA);
     /* The proto we have now may differ, if we already unpersisted it before.
      * In that case we now have a reference to the originally unpersisted
      * proto so we'll use that. */
     p = (Proto*)lua_touserdata(info->L, -1);
-    if (p != cl->l.p) {                              /* ... lcl nproto oproto */
+    if (p != cl->p) {                                /* ... lcl nproto oproto */
       /* Just overwrite the old one, GC will clean this up. */
-      cl->l.p = p;
+      cl->p = p;
+      eris_objbarrier(info->L, cl, p);
     }
     lua_pop(info->L, 2);                                           /* ... lcl */
-    eris_assert(cl->l.p->sizeupvalues == nups);
+    if (p->sizeupvalues != nups) {
+      eris_error(info, ERIS_ERR_UPVALUES);
+    }
     poppath(info);
 
     /* Unpersist all upvalues. */
     pushpath(info, ".upvalues");
     for (nup = 1; nup <= nups; ++nup) {
-      UpVal **uv = &cl->l.upvals[nup - 1];
+      UpVal **uv = &cl->upvals[nup - 1];
       /* Get the actual name of the upvalue, if possible. */
       if (p->upvalues[nup - 1].name) {
         pushpath(info, "[%s]", getstr(p->upvalues[nup - 1].name));
@@ -1535,46 +1728,58 @@ u_closure(Info *info) {                                                /* ... */
       }
       unpersist(info);                                         /* ... lcl tbl */
       eris_assert(lua_type(info->L, -1) == LUA_TTABLE);
-      lua_rawgeti(info->L, -1, UVTOCL);               /* ... lcl tbl olcl/nil */
+      lua_rawgeti(info->L, -1, UVTOCL);        /* ... lcl tbl olcl/thread/nil */
       if (lua_isnil(info->L, -1)) {                        /* ... lcl tbl nil */
         lua_pop(info->L, 1);                                   /* ... lcl tbl */
         lua_pushvalue(info->L, -2);                        /* ... lcl tbl lcl */
         lua_rawseti(info->L, -2, UVTOCL);                      /* ... lcl tbl */
         lua_pushinteger(info->L, nup);                     /* ... lcl tbl nup */
         lua_rawseti(info->L, -2, UVTONU);                      /* ... lcl tbl */
-        *uv = eris_newupval(info->L);
+        *uv = newupval(info->L);
+      }
+      else if (lua_isthread(info->L, -1)) {             /* ... lcl tbl thread */
+        /* The upvalue was already opened by the thread owning it, see
+         * u_thread. Look it up again to share the open one. */
+        lua_State *thread = lua_tothread(info->L, -1);
+        size_t level;
+        lua_pop(info->L, 1);                                   /* ... lcl tbl */
+        lua_rawgeti(info->L, -1, UVTONU);               /* ... lcl tbl level */
+        level = (size_t)lua_tointeger(info->L, -1);
+        lua_pop(info->L, 1);                                   /* ... lcl tbl */
+        *uv = eris_findupval(thread, eris_restorestackidx(thread, level));
       }
       else {                                              /* ... lcl tbl olcl */
         LClosure *ocl;
         int onup;
         eris_assert(lua_type(info->L, -1) == LUA_TFUNCTION);
-        ocl = eris_clLvalue(info->L->top - 1);
+        ocl = eris_clLvalue(eris_s2v(info->L->top - 1));
         lua_pop(info->L, 1);                                   /* ... lcl tbl */
         lua_rawgeti(info->L, -1, UVTONU);                 /* ... lcl tbl onup */
         eris_assert(lua_type(info->L, -1) == LUA_TNUMBER);
-        onup = lua_tointeger(info->L, -1);
+        onup = (int)lua_tointeger(info->L, -1);
         lua_pop(info->L, 1);                                   /* ... lcl tbl */
         *uv = ocl->upvals[onup - 1];
       }
-      luaC_objbarrier(info->L, cl, *uv);
+      eris_objbarrier(info->L, cl, *uv);
 
       /* Set the upvalue's actual value and add our reference to the upvalue to
        * the list, for reference patching if we have to open the upvalue in
        * u_thread. Either is only necessary if the upvalue is still closed. */
-      if ((*uv)->v == &(*uv)->u.value) {
+      if (!eris_upisopen(*uv)) {
         int i;
         /* Always update the value of the upvalue's value for closed upvalues,
          * even if we re-used one - if we had a cycle, it might have been
          * incorrectly initialized to nil before (or rather, not yet set). */
         lua_rawgeti(info->L, -1, UVTVAL);                  /* ... lcl tbl obj */
-        eris_setobj(info->L, &(*uv)->u.value, info->L->top - 1);
+        eris_setobj(info->L, (*uv)->v, eris_s2v(info->L->top - 1));
+        eris_barrier(info->L, *uv, eris_s2v(info->L->top - 1));
         lua_pop(info->L, 1);                                   /* ... lcl tbl */
 
         lua_pushinteger(info->L, nup);                     /* ... lcl tbl nup */
         lua_pushvalue(info->L, -3);                    /* ... lcl tbl nup lcl */
         if (luaL_len(info->L, -3) >= UVTVAL) {
           /* Got a valid sequence (value already set), insert at the end. */
-          i = luaL_len(info->L, -3);
+          i = (int)luaL_len(info->L, -3);
           lua_rawseti(info->L, -3, i + 1);                 /* ... lcl tbl nup */
           lua_rawseti(info->L, -2, i + 2);                     /* ... lcl tbl */
         }
@@ -1602,9 +1807,6 @@ u_closure(Info *info) {                                                /* ... */
       poppath(info);
     }
     poppath(info);
-
-    eris_barrierproto(info->L, p, cl);
-    p->cache = cl; /* save it in cache for reuse, see lvm.c:416 */
   }
 
   eris_assert(lua_type(info->L, -1) == LUA_TFUNCTION);
@@ -1612,21 +1814,35 @@ u_closure(Info *info) {                                                /* ... */
 
 /** ======================================================================== */
 
+/* Only coroutines that are suspended (or not started yet) and dead ones can be
+ * persisted. For dead coroutines the call stack is meaningless, so only the
+ * base level is written for them. */
+static CallInfo*
+lastci(lua_State *thread) {
+  if (thread->status != LUA_OK && thread->status != LUA_YIELD) {
+    return &thread->base_ci;
+  }
+  return thread->ci;
+}
+
 static void
 p_thread(Info *info) {                                          /* ... thread */
   lua_State* thread = lua_tothread(info->L, -1);
   size_t level = 0, total = thread->top - thread->stack;
-  CallInfo *ci;
-  GCObject *uvi;
+  CallInfo *ci, *last;
+  UpVal *uv;
 
   eris_checkstack(info->L, 2);
 
   /* We cannot persist any running threads, because by definition we *are* that
-   * running thread. And we use the stack. So yeah, really not a good idea. */
-  if (thread == info->L) {
+   * running thread. And we use the stack. So yeah, really not a good idea. The
+   * same goes for coroutines that are currently resuming another one. */
+  if (thread == info->L ||
+      (thread->status == LUA_OK && thread->ci != &thread->base_ci)) {
     eris_error(info, ERIS_ERR_THREAD);
     return; /* not reached */
   }
+  last = lastci(thread);
 
   /* Persist the stack. Save the total size and used space first. */
   WRITE_VALUE(thread->stacksize, int);
@@ -1645,29 +1861,23 @@ p_thread(Info *info) {                                          /* ... thread */
    */
   for (; level < total; ++level) {
     pushpath(info, "[%d]", level);
-    eris_setobj(info->L, info->L->top - 1, thread->stack + level);
-                                                            /* ... thread obj */
+    eris_setobj(info->L, eris_s2v(info->L->top - 1),
+                eris_s2v(thread->stack + level));           /* ... thread obj */
     persist(info);                                          /* ... thread obj */
     poppath(info);
   }
   lua_pop(info->L, 1);                                          /* ... thread */
   poppath(info);
 
-  /* If the thread isn't running this must be the default value, which is 1. */
-  eris_assert(thread->nny == 1);
-
   /* Error jump info should only be set while thread is running. */
   eris_assert(thread->errorJmp == NULL);
 
-  /* thread->oldpc always seems to be uninitialized, at least gdb always shows
-   * it as 0xbaadf00d when I set a breakpoint here. */
-
   /* Write general information. */
   WRITE_VALUE(thread->status, uint8_t);
   WRITE_VALUE(eris_savestackidx(thread,
     eris_restorestack(thread, thread->errfunc)), size_t);
   /* These are only used while a thread is being executed or can be deduced:
-  WRITE_VALUE(thread->nCcalls, uint16_t);
+  WRITE_VALUE(thread->nCcalls, uint32_t);
   WRITE_VALUE(thread->allowhook, uint8_t); */
 
   /* Hooks are not supported, bloody can of worms, those.
@@ -1675,11 +1885,7 @@ p_thread(Info *info) {                                          /* ... thread */
   WRITE_VALUE(thread->basehookcount, int);
   WRITE_VALUE(thread->hookcount, int); */
 
-  if (thread->hook) {
-    /* TODO Warn that hooks are not persisted? */
-  }
-
-  /* Write call information (stack frames). In 5.2 CallInfo is stored in a
+  /* Write call information (stack frames). In 5.4 CallInfo is stored in a
    * linked list that originates in thead.base_ci. Upon initialization the
    * thread.ci is set to thread.base_ci. During thread calls this is extended
    * and always represents the tail of the callstack, though not necessarily of
@@ -1687,83 +1893,67 @@ p_thread(Info *info) {                                          /* ... thread */
    * but shrunk due to returns). */
   pushpath(info, ".callinfo");
   level = 0;
-  eris_assert(&thread->base_ci != thread->ci->next);
-  for (ci = &thread->base_ci; ci != thread->ci->next; ci = ci->next) {
+  for (ci = &thread->base_ci; ci != last->next; ci = ci->next) {
     pushpath(info, "[%d]", level++);
+    if (ci->callstatus & (CIST_HOOKED | CIST_FIN)) {
+      eris_error(info, ERIS_ERR_THREADHOOK);
+    }
     WRITE_VALUE(eris_savestackidx(thread, ci->func), size_t);
     WRITE_VALUE(eris_savestackidx(thread, ci->top), size_t);
-    /* CallInfo.nresults is only set for actual functions */
-    WRITE_VALUE(ttisfunction(ci->func) ? ci->nresults : 0, int16_t);
-    WRITE_VALUE(ci->callstatus, uint8_t);
-    /* CallInfo.extra is used in two contexts: if L->status == LUA_YIELD and
-     * CallInfo is the one stored as L->ci, in which case ci->extra refers to
-     * the original value of L->ci->func, and when we have a yieldable pcall
-     * (ci->callstatus & CIST_YPCALL) where ci->extra holds the stack level
-     * of the function being called (see lua_pcallk). We save the ci->extra
-     * for L->ci after the loop, because we won't know which one it is when
-     * unpersisting. */
-    if (ci->callstatus & CIST_YPCALL) {
-      WRITE_VALUE(eris_savestackidx(thread,
-        eris_restorestack(thread, ci->extra)), size_t);
-    }
-
-    eris_assert(eris_isLua(ci) || (ci->callstatus & CIST_TAIL) == 0);
+    WRITE_VALUE(ci->nresults, int16_t);
+    WRITE_VALUE(ci->callstatus, uint16_t);
 
     if (eris_isLua(ci)) {
-      StkId func = ci->func;
-      if (ci->callstatus & CIST_HOOKYIELD) {
-        /* Yielded from hook, mimic what resume does. */
-        ci->func = restorestack(thread, ci->extra);
-        /* Also, store ci->func for unpersisting,
-         * as ci->extra won't be restored yet. */
-        WRITE_VALUE(eris_savestackidx(thread, ci->func), size_t);
-      }
-      const LClosure *lcl = eris_ci_func(ci); /* Uses ci->func */
-      ci->func = func;
-      WRITE_VALUE(eris_savestackidx(thread, ci->u.l.base), size_t);
+      const LClosure *lcl = eris_clLvalue(eris_s2v(ci->func));
       WRITE_VALUE(ci->u.l.savedpc - lcl->p->code, size_t);
+      WRITE_VALUE(ci->u.l.nextraargs, int);
     }
     else {
-      WRITE_VALUE((ci->callstatus & (CIST_STAT | CIST_YIELDED))
-                   ? ci->u.c.status : 0, uint8_t);
-
-      /* These are only used while a thread is being executed:
-      WRITE_VALUE(ci->u.c.old_errfunc, ptrdiff_t);
-      WRITE_VALUE(ci->u.c.old_allowhook, uint8_t); */
-
-      /* TODO Is this really right? Hooks may be a problem? */
-      if (ci->callstatus & (CIST_YPCALL | CIST_YIELDED)) {
-        WRITE_VALUE(ci->u.c.ctx, int);
-        eris_assert(ci->u.c.k);
-        lua_pushcfunction(info->L, ci->u.c.k);             /* ... thread func */
-        persist(info);                                 /* ... thread func/nil */
+      /* A yieldable pcall remembers the error handler to restore and where
+       * the called function sits, see lua_pcallk. */
+      if (ci->callstatus & CIST_YPCALL) {
+        WRITE_VALUE(eris_savestackidx(thread,
+          eris_restorestack(thread, ci->u.c.old_errfunc)), size_t);
+        WRITE_VALUE(eris_savestackidx(thread,
+          eris_restorestack(thread, ci->u2.funcidx)), size_t);
+      }
+
+      /* The continuation is only meaningful above the base level, that one
+       * never gets resumed. */
+      if (ci != &thread->base_ci && ci->u.c.k) {
+        WRITE_VALUE(true, uint8_t);
+        WRITE_VALUE((int64_t)ci->u.c.ctx, int64_t);
+        lua_pushcfunction(info->L, (lua_CFunction)(void (*)(void))ci->u.c.k);
+        persist(info);                                     /* ... thread func */
         lua_pop(info->L, 1);                                    /* ... thread */
       }
+      else {
+        WRITE_VALUE(false, uint8_t);
+      }
     }
 
     /* Write whether there's more to come. */
-    WRITE_VALUE(ci->next == thread->ci->next, uint8_t);
+    WRITE_VALUE(ci == last, uint8_t);
 
     poppath(info);
   }
-  /** See comment on ci->extra in loop. */
+  /* The number of values the coroutine yielded, needed by lua_resume. */
   if (thread->status == LUA_YIELD) {
-    WRITE_VALUE(eris_savestackidx(thread,
-        eris_restorestack(thread, thread->ci->extra)), size_t);
+    WRITE_VALUE(thread->ci->u2.nyield, int);
   }
   poppath(info);
 
   pushpath(info, ".openupval");
   lua_pushnil(info->L);                                     /* ... thread nil */
   level = 0;
-  for (uvi = thread->openupval;
-       uvi != NULL;
-       uvi = eris_gch(uvi)->next)
-  {
-    UpVal *uv = eris_gco2uv(uvi);
+  for (uv = thread->openupval; uv != NULL; uv = uv->u.open.next) {
     pushpath(info, "[%d]", level++);
-    WRITE_VALUE(eris_savestackidx(thread, uv->v) + 1, size_t);
-    eris_setobj(info->L, info->L->top - 1, uv->v);          /* ... thread obj */
+    if (uv->tbc) {
+      eris_error(info, ERIS_ERR_THREADTBC);
+    }
+    WRITE_VALUE(eris_savestackidx(thread, eris_uplevel(uv)) + 1, size_t);
+    eris_setobj(info->L, eris_s2v(info->L->top - 1), uv->v);
+                                                            /* ... thread obj */
     lua_pushlightuserdata(info->L, uv);                  /* ... thread obj id */
     persist_keyed(info, LUA_TUPVAL);                        /* ... thread obj */
     poppath(info);
@@ -1784,7 +1974,7 @@ p_thread(Info *info) {                                          /* ... thread */
  * it. Otherwise it may try to shrink its stack. We do this by setting its
  * stack field to null for every call that may trigger a GC run, since that
  * field is what's used to determine whether threads should be shrunk. See
- * lgc.c:699. Some of the locks could probably be joined (since nothing
+ * lgc.c:568. Some of the locks could probably be joined (since nothing
  * inbetween requires the stack field to be valid), but I prefer to keep the
  * "invalid" blocks as small as possible to make it clearer. Also, locking and
  * unlocking are really just variable assignments, so they're really cheap. */
@@ -1796,14 +1986,21 @@ u_thread(Info *info) {                                                 /* ... */
   lua_State* thread;
   size_t level;
   StkId stack, o;
+  int stacksize;
 
   eris_checkstack(info->L, 3);
 
   thread = lua_newthread(info->L);                              /* ... thread */
   registerobject(info);
 
-  /* Unpersist the stack. Read size first and adjust accordingly. */
-  eris_reallocstack(thread, READ_VALUE(int));
+  /* Unpersist the stack. Read size first and adjust accordingly. The new
+   * stack is allocated through the running thread so that failures surface
+   * as regular errors instead of panics in the unprotected new thread. */
+  stacksize = READ_VALUE(int);
+  if (stacksize <= EXTRA_STACK || stacksize > LUAI_MAXSTACK ||
+      !eris_reallocstack(thread, stacksize, 0)) {
+    eris_error(info, ERIS_ERR_STACKSIZE);
+  }
   stack = thread->stack; /* After the realloc in case the address changes. */
   thread->top = thread->stack + READ_VALUE(size_t);
   validate(thread->top, thread->stack_last);
@@ -1818,7 +2015,7 @@ u_thread(Info *info) {                                                 /* ... */
     pushpath(info, "[%d]", level++);
     unpersist(info);                                        /* ... thread obj */
     UNLOCK(thread);
-    eris_setobj(thread, o, info->L->top - 1);
+    eris_setobj2s(thread, o, eris_s2v(info->L->top - 1));
     lua_pop(info->L, 1);                                        /* ... thread */
     LOCK(thread);
     poppath(info);
@@ -1829,26 +2026,26 @@ u_thread(Info *info) {                                                 /* ... */
   UNLOCK(thread);
 
   /* As in p_thread, just to make sure. */
-  eris_assert(thread->nny == 1);
   eris_assert(thread->errorJmp == NULL);
-  eris_assert(thread->hook == NULL);
 
   /* See comment in persist. */
   thread->oldpc = NULL;
 
   /* Read general information. */
   thread->status = READ_VALUE(uint8_t);
-  thread->errfunc = eris_savestack(thread,
-    eris_restorestackidx(thread, READ_VALUE(size_t)));
-  if (thread->errfunc) {
-    o = eris_restorestack(thread, thread->errfunc);
-    validate(o, thread->top);
-    if (eris_ttypenv(o) != LUA_TFUNCTION) {
-      eris_error(info, ERIS_ERR_THREADERRF);
-    }
+  if (thread->status > LUA_ERRERR) {
+    thread->status = LUA_OK;
+    eris_error(info, ERIS_ERR_THREADSTATUS);
+  }
+  o = eris_restorestackidx(thread, READ_VALUE(size_t));
+  validate(o, thread->top);
+  thread->errfunc = eris_savestack(thread, o);
+  if (thread->errfunc && !eris_ttisfunction(eris_s2v(o))) {
+    thread->errfunc = 0;
+    eris_error(info, ERIS_ERR_THREADERRF);
   }
   /* These are only used while a thread is being executed or can be deduced:
-  thread->nCcalls = READ_VALUE(uint16_t);
+  thread->nCcalls = READ_VALUE(uint32_t);
   thread->allowhook = READ_VALUE(uint8_t); */
   eris_assert(thread->allowhook == 1);
 
@@ -1864,71 +2061,68 @@ u_thread(Info *info) {                                                 /* ... */
   thread->ci = &thread->base_ci;
   level = 0;
   for (;;) {
+    CallInfo *ci = thread->ci;
     LOCK(thread);
     pushpath(info, "[%d]", level++);
     UNLOCK(thread);
-    thread->ci->func = eris_restorestackidx(thread, READ_VALUE(size_t));
-    validate(thread->ci->func, thread->top - 1);
-    thread->ci->top = eris_restorestackidx(thread, READ_VALUE(size_t));
-    validate(thread->ci->top, thread->stack_last);
-    thread->ci->nresults = READ_VALUE(int16_t);
-    thread->ci->callstatus = READ_VALUE(uint8_t);
-    /** See comment in p_thread. */
-    if (thread->ci->callstatus & CIST_YPCALL) {
-      thread->ci->extra = eris_savestack(thread,
-        eris_restorestackidx(thread, READ_VALUE(size_t)));
-      o = eris_restorestack(thread, thread->ci->extra);
-      validate(o, thread->top);
-      if (eris_ttypenv(o) != LUA_TFUNCTION) {
-        eris_error(info, ERIS_ERR_THREADCI);
-      }
+    ci->func = eris_restorestackidx(thread, READ_VALUE(size_t));
+    validate(ci->func, thread->top - 1);
+    ci->top = eris_restorestackidx(thread, READ_VALUE(size_t));
+    validate(ci->top, thread->stack_last);
+    ci->nresults = READ_VALUE(int16_t);
+    ci->callstatus = READ_VALUE(uint16_t);
+    if (ci->callstatus & (CIST_HOOKED | CIST_FIN)) {
+      ci->callstatus = CIST_C;
+      eris_error(info, ERIS_ERR_THREADHOOK);
     }
 
-    if (eris_isLua(thread->ci)) {
-      StkId func = thread->ci->func;
-      if (thread->ci->callstatus & CIST_HOOKYIELD) {
-        /* See corresponding persist code */
-        thread->ci->func = eris_restorestackidx(thread, READ_VALUE(size_t));
+    if (eris_isLua(ci)) {
+      LClosure *lcl;
+      size_t pc;
+      if (!eris_ttisLclosure(eris_s2v(ci->func))) {
+        ci->callstatus = CIST_C;
+        eris_error(info, ERIS_ERR_THREADCI);
       }
-      LClosure *lcl = eris_ci_func(thread->ci); /* Uses ci->func */
-      thread->ci->func = func;
-      thread->ci->u.l.base = eris_restorestackidx(thread, READ_VALUE(size_t));
-      validate(thread->ci->u.l.base, thread->top);
-      thread->ci->u.l.savedpc = lcl->p->code + READ_VALUE(size_t);
-      if (thread->ci->u.l.savedpc < lcl->p->code ||
-          thread->ci->u.l.savedpc > lcl->p->code + lcl->p->sizecode)
-      {
-        thread->ci->u.l.savedpc = lcl->p->code; /* Just to be safe. */
+      lcl = eris_clLvalue(eris_s2v(ci->func));
+      pc = READ_VALUE(size_t);
+      if (pc > (size_t)lcl->p->sizecode) {
+        ci->callstatus = CIST_C;
         eris_error(info, ERIS_ERR_THREADPC);
       }
+      ci->u.l.savedpc = lcl->p->code + pc;
+      ci->u.l.nextraargs = READ_VALUE(int);
+      ci->u.l.trap = 0;
     }
     else {
-      thread->ci->u.c.status = READ_VALUE(uint8_t);
-
-      /* These are only used while a thread is being executed:
-      thread->ci->u.c.old_errfunc = READ_VALUE(ptrdiff_t);
-      thread->ci->u.c.old_allowhook = READ_VALUE(uint8_t); */
-      thread->ci->u.c.old_errfunc = 0;
-      thread->ci->u.c.old_allowhook = 0;
+      ci->u.c.old_errfunc = 0;
+      ci->u2.funcidx = 0;
+      if (ci->callstatus & CIST_YPCALL) {
+        o = eris_restorestackidx(thread, READ_VALUE(size_t));
+        validate(o, thread->top);
+        ci->u.c.old_errfunc = eris_savestack(thread, o);
+        o = eris_restorestackidx(thread, READ_VALUE(size_t));
+        validate(o, thread->top);
+        ci->u2.funcidx = (int)eris_savestack(thread, o);
+      }
 
-      /* TODO Is this really right? */
-      if (thread->ci->callstatus & (CIST_YPCALL | CIST_YIELDED)) {
-        thread->ci->u.c.ctx = READ_VALUE(int);
+      if (READ_VALUE(uint8_t)) {
+        ci->u.c.ctx = (lua_KContext)READ_VALUE(int64_t);
         LOCK(thread);
         unpersist(info);                                  /* ... thread func? */
         UNLOCK(thread);
         if (lua_iscfunction(info->L, -1)) {                /* ... thread func */
-          thread->ci->u.c.k = lua_tocfunction(info->L, -1);
+          ci->u.c.k = (lua_KFunction)(void (*)(void))lua_tocfunction(info->L, -1);
         }
         else {
+          ci->u.c.k = NULL;
           eris_error(info, ERIS_ERR_THREADCTX);
           return; /* not reached */
         }
         lua_pop(info->L, 1);                                    /* ... thread */
       }
       else {
-        thread->ci->u.c.ctx = 0;
-        thread->ci->u.c.k = NULL;
+        ci->u.c.ctx = 0;
+        ci->u.c.k = NULL;
       }
     }
     LOCK(thread);
@@ -1940,25 +2134,30 @@ u_thread(Info *info) {                                                 /* ... */
       break;
     }
     else {
-      thread->ci = eris_extendCI(thread);
+      /* Allocated through the running thread for the same reason as the
+       * stack. luaE_freeCI takes care of these once they're unused. */
+      CallInfo *next = eris_newci(info->L);
+      next->previous = ci;
+      next->next = NULL;
+      next->callstatus = CIST_C;
+      next->u.c.k = NULL;
+      next->func = ci->func;
+      next->top = ci->top;
+      ci->next = next;
+      thread->nci++;
+      thread->ci = next;
     }
   }
   if (thread->status == LUA_YIELD) {
-    thread->ci->extra = eris_savestack(thread,
-      eris_restorestackidx(thread, READ_VALUE(size_t)));
-    o = eris_restorestack(thread, thread->ci->extra);
-    validate(o, thread->top);
-    if (eris_ttypenv(o) != LUA_TFUNCTION) {
-      eris_error(info, ERIS_ERR_THREADCI);
-    }
+    /* The yielded values themselves are usually gone already, taken off
+     * the stack by whoever resumed the coroutine, so this can't be checked
+     * against the stack. */
+    thread->ci->u2.nyield = READ_VALUE(int);
   }
   LOCK(thread);
   poppath(info);
   UNLOCK(thread);
 
-  /* Get from context: only zero for dead threads, otherwise one. */
-  thread->nCcalls = thread->status != LUA_OK || lua_gettop(thread) != 0;
-
   /* Proceed to open upvalues. These upvalues will already exist due to the
    * functions using them having been unpersisted (they'll usually be in the
    * stack of the thread). For this reason we store all previous references to
@@ -1978,7 +2177,7 @@ u_thread(Info *info) {                                                 /* ... */
       break;
     }
     LOCK(thread);
-    pushpath(info, "[%d]", level);
+    pushpath(info, "[%d]", level++);
     UNLOCK(thread);
     stk = eris_restorestackidx(thread, offset - 1);
     validate(stk, thread->top - 1);
@@ -2001,18 +2200,18 @@ u_thread(Info *info) {                                                 /* ... */
        * references to the already existing one, which we added to the table in
        * u_closure. */
       lua_pop(info->L, 1);                                  /* ... thread tbl */
-      for (i = UVTREF, n = luaL_len(info->L, -1); i <= n; i += 2) {
+      for (i = UVTREF, n = (int)luaL_len(info->L, -1); i <= n; i += 2) {
         LClosure *cl;
         int nup;
         lua_rawgeti(info->L, -1, i);                    /* ... thread tbl lcl */
-        cl = eris_clLvalue(info->L->top - 1);
+        cl = eris_clLvalue(eris_s2v(info->L->top - 1));
         lua_pop(info->L, 1);                                /* ... thread tbl */
         lua_rawgeti(info->L, -1, i + 1);                /* ... thread tbl nup */
-        nup = lua_tointeger(info->L, -1);
+        nup = (int)lua_tointeger(info->L, -1);
         lua_pop(info->L, 1);                                /* ... thread tbl */
         /* Open the upvalue by pointing to the stack and register in GC. */
         cl->upvals[nup - 1] = nuv;
-        luaC_objbarrier(info->L, cl, nuv);
+        eris_objbarrier(info->L, cl, nuv);
       }
     }
     else {                                              /* ... thread tbl nil */
@@ -2020,7 +2219,13 @@ u_thread(Info *info) {                                                 /* ... */
       lua_pop(info->L, 1);                                  /* ... thread tbl */
     }
 
-    /* Store open upvalue in table for future references. */
+    /* Store open upvalue in table for future references, closures read after
+     * this point look it up through the thread, see u_closure. */
+    lua_pushvalue(info->L, -2);                      /* ... thread tbl thread */
+    lua_rawseti(info->L, -2, UVTOCL);                       /* ... thread tbl */
+    lua_pushinteger(info->L, (lua_Integer)(offset - 1));
+                                                      /* ... thread tbl level */
+    lua_rawseti(info->L, -2, UVTONU);                       /* ... thread tbl */
     LOCK(thread);
     lua_pop(info->L, 1);                                        /* ... thread */
     poppath(info);
@@ -2103,7 +2308,7 @@ persist_keyed(Info *info, int type) {          /* perms reftbl ... obj refkey */
   /* If the object has already been written, write a reference to it. */
   lua_rawget(info->L, REFTIDX);           /* perms reftbl ... obj refkey ref? */
   if (!lua_isnil(info->L, -1)) {           /* perms reftbl ... obj refkey ref */
-    const int reference = lua_tointeger(info->L, -1);
+    const int reference = (int)lua_tointeger(info->L, -1);
     WRITE_VALUE(reference + ERIS_REFERENCE_OFFSET, int);
     lua_pop(info->L, 2);                              /* perms reftbl ... obj */
     return;
@@ -2185,8 +2390,8 @@ u_permanent(Info *info) {                                 /* perms reftbl ... */
   else if (lua_type(info->L, -1) != type) {            /* perms reftbl ... :( */
     /* For the same reason that we cannot allow nil we must also require the
      * unpersisted value to be of the correct type. */
-    const char *want = kTypenames[type];
-    const char *have = kTypenames[lua_type(info->L, -1)];
+    const char *want = typename(type);
+    const char *have = typename(lua_type(info->L, -1));
     eris_error(info, ERIS_ERR_SPER_UPERM, want, have);
   }                                                   /* perms reftbl ... obj */
   /* Create the entry in the reftable. */
@@ -2293,9 +2498,11 @@ writer(lua_State *L, const void *p, size_t sz, void *ud) {
     } else {
       char *newbuff;
       eris_checkstack(L, 1);
-      newbuff = (char*)lua_newuserdata(L, newcapacity * sizeof(char));
+      newbuff = (char*)lua_newuserdatauv(L, newcapacity * sizeof(char), 0);
                                          /* perms reftbl buff path? ... nbuff */
-      memcpy(newbuff, eris_buffer(buff), eris_bufflen(buff));
+      if (eris_bufflen(buff) > 0) {
+        memcpy(newbuff, eris_buffer(buff), eris_bufflen(buff));
+      }
       lua_replace(L, BUFFIDX);                /* perms reftbl nbuff path? ... */
       eris_buffer(buff) = newbuff;
       eris_sizebuffer(buff) = newcapacity;
@@ -2349,18 +2556,10 @@ u_header(Info *info) {
   char header[HEADER_LENGTH];
   uint8_t number_size;
   READ_RAW(header, HEADER_LENGTH);
-  if (strncmp(kHeader, header, HEADER_LENGTH)) {
+  if (memcmp(kHeader, header, HEADER_LENGTH)) {
     luaL_error(info->L, "invalid data");
   }
   number_size = READ_VALUE(uint8_t);
-  if (number_size == 0) {
-    /* Old 64-bit versions of eris wrote '\0' and then three random bytes. */
-    /* We skip them here for backwards compatibility. */
-    char throw_away[3];
-    READ_RAW(throw_away, 3);
-
-    number_size = READ_VALUE(uint8_t);
-  }
   if (number_size != sizeof(lua_Number)) {
     luaL_error(info->L, "incompatible floating point type");
   }
@@ -2390,7 +2589,7 @@ unchecked_persist(lua_State *L, lua_Writer writer, void *ud) {
 
   if (get_setting(L, (void*)&kSettingMaxComplexity)) {
                                                   /* perms buff rootobj value */
-    info.maxComplexity = lua_tounsigned(L, -1);
+    info.maxComplexity = (lua_Unsigned)lua_tointeger(L, -1);
     lua_pop(L, 1);                                      /* perms buff rootobj */
   }
   if (get_setting(L, (void*)&kSettingGeneratePath)) {
@@ -2450,7 +2649,7 @@ unchecked_unpersist(lua_State *L, lua_Reader reader, void *ud) {/* perms str? */
 
   if (get_setting(L, (void*)&kSettingMaxComplexity)) {
                                                   /* perms buff rootobj value */
-    info.maxComplexity = lua_tounsigned(L, -1);
+    info.maxComplexity = (lua_Unsigned)lua_tointeger(L, -1);
     lua_pop(L, 1);                                      /* perms buff rootobj */
   }
   if (get_setting(L, (void*)&kSettingGeneratePath)) {
@@ -2584,7 +2783,7 @@ l_settings(lua_State *L) {                                /* name value? ...? */
     }
     else if (IS(kSettingMaxComplexity)) {
       if (!get_setting(L, (void*)&kSettingMaxComplexity)) {
-        lua_pushunsigned(L, kMaxComplexity);
+        lua_pushinteger(L, (lua_Integer)kMaxComplexity);
       }
     }
     else {
@@ -2612,7 +2811,7 @@ l_settings(lua_State *L) {                                /* name value? ...? */
       set_setting(L, (void*)&kSettingGeneratePath);
     }
     else if (IS(kSettingMaxComplexity)) {
-      luaL_optunsigned(L, 2, 0);
+      luaL_optinteger(L, 2, 0);
       set_setting(L, (void*)&kSettingMaxComplexity);
     }
     else {
@@ -2711,4 +2910,3 @@ eris_set_setting(lua_State *L, const char *name, int value) {          /* ... */
 }
 
 /* }======================================================================== */
-
@@ -525,3 +525,29 @@ LUAMOD_API int luaopen_base (lua_State *L) {
   return 1;
 }
 
+
+/*
+** Continuations are not reachable from the library table, so Eris needs
+** them registered by name to persist coroutines suspended inside them.
+** 'forUnpersist' selects the direction of the mapping in the table on top.
+*/
+static void permfunc (lua_State *L, lua_CFunction f, const char *name,
+                      int forUnpersist) {
+  if (forUnpersist) {
+    lua_pushstring(L, name);
+    lua_pushcfunction(L, f);
+  }
+  else {
+    lua_pushcfunction(L, f);
+    lua_pushstring(L, name);
+  }
+  lua_rawset(L, -3);
+}
+
+
+LUAI_FUNC void eris_permbaselib (lua_State *L, int forUnpersist) {
+  luaL_checkstack(L, 2, NULL);
+  permfunc(L, (lua_CFunction)(void (*)(void))finishpcall, "__eris.baselib_finishpcall", forUnpersist);
+  permfunc(L, (lua_CFunction)(void (*)(void))dofilecont, "__eris.baselib_dofilecont", forUnpersist);
+}
+
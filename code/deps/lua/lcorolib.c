@@ -204,3 +204,18 @@ LUAMOD_API int luaopen_coroutine (lua_State *L) {
   return 1;
 }
 
+
+/* See eris_permbaselib in lbaselib.c. */
+LUAI_FUNC void eris_permcorolib (lua_State *L, int forUnpersist) {
+  luaL_checkstack(L, 2, NULL);
+  if (forUnpersist) {
+    lua_pushstring(L, "__eris.corolib_auxwrap");
+    lua_pushcfunction(L, luaB_auxwrap);
+  }
+  else {
+    lua_pushcfunction(L, luaB_auxwrap);
+    lua_pushstring(L, "__eris.corolib_auxwrap");
+  }
+  lua_rawset(L, -3);
+}
+
@@ -0,0 +1,269 @@
+#include "StdAfx.h"
+
+#include "CallbackMonitor.h"
+
+#include <lua/lua.hpp>
+
+#include <algorithm>
+
+/* Upper bounds of the histogram buckets in ms, the last one takes the rest */
+static const float sBucketLimits[CALLBACK_NUM_BUCKETS - 1] = {0.5F, 1.0F, 2.0F, 4.0F, 8.0F, 16.0F, 33.0F};
+
+/* The hook is a plain function, there is only ever one VM to watch */
+static CCallbackMonitor* sMonitor = nullptr;
+
+CCallbackMonitor::CCallbackMonitor()
+{
+    mBudget = 0.0F;
+    mAbortTime = 0.0F;
+    mMaxInstructions = 0;
+}
+
+void CCallbackMonitor::Release()
+{
+    if (sMonitor == this)
+    {
+        sMonitor = nullptr;
+    }
+
+    mStats.clear();
+    mActive.clear();
+}
+
+void CCallbackMonitor::SetBudget(lua_State* L, float ms, float abortMs, UINT64 instructions)
+{
+    mBudget = fmaxf(ms, 0.0F);
+    mAbortTime = fmaxf(abortMs, 0.0F);
+    mMaxInstructions = instructions;
+    InstallHook(L);
+}
+
+/*
+ * Threads inherit the hook of the state they were created from, so it's set
+ * once per state rather than around each call. A restarted VM is a new state
+ * and needs it again.
+ */
+void CCallbackMonitor::InstallHook(lua_State* L) const
+{
+    if (L == nullptr)
+    {
+        return;
+    }
+
+    if (IsLimited())
+    {
+        sMonitor = const_cast<CCallbackMonitor*>(this);
+        lua_sethook(L, &CCallbackMonitor::Hook, LUA_MASKCOUNT, CALLBACK_HOOK_INTERVAL);
+    }
+    else if (lua_gethook(L) == &CCallbackMonitor::Hook)
+    {
+        lua_sethook(L, nullptr, 0, 0);
+    }
+}
+
+auto CCallbackMonitor::FindStats(LPCSTR name) -> unsigned int
+{
+    // only a handful of entry points exist, a linear search beats hashing
+    for (unsigned int i = 0; i < mStats.size(); i++)
+    {
+        if (mStats[i].name == name)
+        {
+            return i;
+        }
+    }
+
+    mStats.emplace_back();
+    auto& stats = mStats.back();
+    stats.name = name;
+    stats.next = 0;
+    stats.numSamples = 0;
+    stats.calls = 0;
+    stats.overruns = 0;
+    stats.maxTime = 0.0F;
+    return static_cast<unsigned int>(mStats.size() - 1);
+}
+
+void CCallbackMonitor::Begin(LPCSTR name, bool budgeted)
+{
+    ACTIVECALL call;
+    call.stats = FindStats(name);
+    call.start = std::chrono::steady_clock::now();
+    call.instructions = 0;
+    call.budgeted = budgeted && mActive.empty();
+    call.overran = FALSE;
+    mActive.push_back(call);
+}
+
+void CCallbackMonitor::End()
+{
+    if (mActive.empty())
+    {
+        return;
+    }
+
+    const auto call = mActive.back();
+    mActive.pop_back();
+
+    const auto ms = Elapsed(call);
+    auto& stats = mStats[call.stats];
+
+    stats.samples[stats.next] = ms;
+    stats.next = (stats.next + 1) % CALLBACK_HISTORY;
+    stats.numSamples = std::min(stats.numSamples + 1, static_cast<unsigned int>(CALLBACK_HISTORY));
+    stats.calls++;
+    stats.maxTime = std::max(stats.maxTime, ms);
+
+    if (!call.budgeted || mBudget <= 0.0F || ms <= mBudget)
+    {
+        return;
+    }
+
+    // time spent in native code never reaches the hook
+    if (!call.overran)
+    {
+        stats.traceback = "(no Lua code was running when the budget ran out)";
+    }
+
+    stats.overruns++;
+    Report(stats, ms);
+}
+
+void CCallbackMonitor::Report(CALLBACKSTATS& stats, float ms)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    if (stats.overruns > 1 && std::chrono::duration<float>(now - stats.lastReport).count() < CALLBACK_REPORT_INTERVAL)
+    {
+        return;
+    }
+
+    stats.lastReport = now;
+    PushLog(CString::Format("%s took %.2f ms, over its %.2f ms budget (%u overruns)\n%s\n", stats.name.c_str(), ms, mBudget,
+                            stats.overruns, stats.traceback.c_str()).Str());
+}
+
+/* Records stay in place, calls still running refer to them */
+void CCallbackMonitor::ResetStats()
+{
+    for (auto& stats : mStats)
+    {
+        stats.next = 0;
+        stats.numSamples = 0;
+        stats.calls = 0;
+        stats.overruns = 0;
+        stats.maxTime = 0.0F;
+        stats.traceback.clear();
+    }
+}
+
+/*
+ * Pushes { [name] = { calls, last, avg, max, p50, p95, overruns, traceback,
+ * histogram } }, with times in ms over the rolling window. The histogram
+ * counts the calls of the window below 0.5, 1, 2, 4, 8, 16, 33 ms and above.
+ */
+void CCallbackMonitor::PushStats(lua_State* L) const
+{
+    lua_createtable(L, 0, static_cast<int>(mStats.size()));
+
+    for (const auto& stats : mStats)
+    {
+        std::vector<float> sorted(stats.samples, stats.samples + stats.numSamples);
+        std::sort(sorted.begin(), sorted.end());
+
+        auto total = 0.0F;
+        unsigned int buckets[CALLBACK_NUM_BUCKETS] = {};
+
+        for (const auto ms : sorted)
+        {
+            total += ms;
+            buckets[std::upper_bound(sBucketLimits, sBucketLimits + CALLBACK_NUM_BUCKETS - 1, ms) - sBucketLimits]++;
+        }
+
+        const auto percentile = [&sorted](float p) -> float
+        {
+            return sorted.empty() ? 0.0F : sorted[static_cast<size_t>(p * static_cast<float>(sorted.size() - 1))];
+        };
+
+        lua_createtable(L, 0, 9);
+        lua_pushinteger(L, static_cast<lua_Integer>(stats.calls));
+        lua_setfield(L, -2, "calls");
+        lua_pushnumber(L, stats.numSamples ? stats.samples[(stats.next + CALLBACK_HISTORY - 1) % CALLBACK_HISTORY] : 0.0F);
+        lua_setfield(L, -2, "last");
+        lua_pushnumber(L, sorted.empty() ? 0.0F : total / static_cast<float>(sorted.size()));
+        lua_setfield(L, -2, "avg");
+        lua_pushnumber(L, stats.maxTime);
+        lua_setfield(L, -2, "max");
+        lua_pushnumber(L, percentile(0.5F));
+        lua_setfield(L, -2, "p50");
+        lua_pushnumber(L, percentile(0.95F));
+        lua_setfield(L, -2, "p95");
+        lua_pushinteger(L, stats.overruns);
+        lua_setfield(L, -2, "overruns");
+
+        if (!stats.traceback.empty())
+        {
+            lua_pushlstring(L, stats.traceback.data(), stats.traceback.size());
+            lua_setfield(L, -2, "traceback");
+        }
+
+        lua_createtable(L, CALLBACK_NUM_BUCKETS, 0);
+
+        for (auto i = 0; i < CALLBACK_NUM_BUCKETS; i++)
+        {
+            lua_pushinteger(L, buckets[i]);
+            lua_rawseti(L, -2, i + 1);
+        }
+
+        lua_setfield(L, -2, "histogram");
+        lua_setfield(L, -2, stats.name.c_str());
+    }
+}
+
+auto CCallbackMonitor::Elapsed(const ACTIVECALL& call) -> float
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - call.start).count();
+}
+
+void CCallbackMonitor::Hook(lua_State* L, lua_Debug* /*ar*/)
+{
+    auto* const monitor = sMonitor;
+
+    if (monitor == nullptr || monitor->mActive.empty() || !monitor->mActive.front().budgeted)
+    {
+        return;
+    }
+
+    auto& call = monitor->mActive.front();
+    auto& stats = monitor->mStats[call.stats];
+    const auto ms = Elapsed(call);
+
+    call.instructions += CALLBACK_HOOK_INTERVAL;
+
+    if (!call.overran && monitor->mBudget > 0.0F && ms > monitor->mBudget)
+    {
+        call.overran = TRUE;
+        luaL_traceback(L, L, nullptr, 0);
+        stats.traceback = lua_tostring(L, -1);
+        lua_pop(L, 1);
+    }
+
+    const auto outOfTime = monitor->mAbortTime > 0.0F && ms > monitor->mAbortTime;
+    const auto outOfInstructions = monitor->mMaxInstructions > 0 && call.instructions > monitor->mMaxInstructions;
+
+    if (!outOfTime && !outOfInstructions)
+    {
+        return;
+    }
+
+    if (outOfTime)
+    {
+        lua_pushfstring(L, "%s aborted after running for %d ms", stats.name.c_str(), static_cast<int>(ms));
+    }
+    else
+    {
+        lua_pushfstring(L, "%s aborted after %I instructions", stats.name.c_str(), static_cast<lua_Integer>(call.instructions));
+    }
+
+    luaL_traceback(L, L, lua_tostring(L, -1), 0);
+    lua_error(L);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "system.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct lua_State;
+struct lua_Debug;
+
+// durations kept per callback for the rolling statistics
+#define CALLBACK_HISTORY 256
+// Lua instructions between two budget checks
+#define CALLBACK_HOOK_INTERVAL 1000
+// overruns of the same callback are logged at most this often
+#define CALLBACK_REPORT_INTERVAL 1.0F   /* s */
+#define CALLBACK_NUM_BUCKETS 8
+
+struct CALLBACKSTATS
+{
+    std::string name;
+    float samples[CALLBACK_HISTORY];    // ms, ring buffer
+    unsigned int next;
+    unsigned int numSamples;
+    UINT64 calls;
+    unsigned int overruns;
+    float maxTime;
+    std::string traceback;              // where the latest overrun was caught
+    std::chrono::steady_clock::time_point lastReport;
+};
+
+/*
+ * Times the script entry points the engine calls every frame and enforces an
+ * optional budget on them. Each call is timed into a rolling window of the
+ * last CALLBACK_HISTORY durations. With a budget set, a count hook checks the
+ * running callback every CALLBACK_HOOK_INTERVAL instructions: going over the
+ * time budget records and logs the traceback, going over the abort time or
+ * the instruction limit raises an error out of the callback, so a runaway
+ * loop can't hang the engine. Only the outermost callback is budgeted, nested
+ * ones such as native calls made from _update are only timed. Coroutines get
+ * the hook of the state they were created from, tasks spawned before the
+ * budget was set aren't checked.
+ */
+class CCallbackMonitor
+{
+public:
+    CCallbackMonitor(void);
+    void Release(void);
+
+    /* Every limit is optional, 0 turns it off */
+    void SetBudget(lua_State* L, float ms, float abortMs, UINT64 instructions);
+    void InstallHook(lua_State* L) const;
+
+    /* Unbudgeted callbacks are timed only, for loading and shutdown work */
+    void Begin(LPCSTR name, bool budgeted = TRUE);
+    void End(void);
+
+    /* Pushes a table of the statistics keyed by callback name */
+    void PushStats(lua_State* L) const;
+    void ResetStats(void);
+
+    auto GetBudget() const -> float { return mBudget; }
+
+private:
+    struct ACTIVECALL
+    {
+        unsigned int stats;
+        std::chrono::steady_clock::time_point start;
+        UINT64 instructions;
+        bool budgeted;
+        bool overran;
+    };
+
+    std::vector<CALLBACKSTATS> mStats;
+    std::vector<ACTIVECALL> mActive;
+    float mBudget;
+    float mAbortTime;
+    UINT64 mMaxInstructions;
+
+    auto FindStats(LPCSTR name) -> unsigned int;
+    void Report(CALLBACKSTATS& stats, float ms);
+    auto IsLimited() const -> bool { return mBudget > 0.0F || mAbortTime > 0.0F || mMaxInstructions > 0; }
+
+    static auto Elapsed(const ACTIVECALL& call) -> float;
+    static void Hook(lua_State* L, lua_Debug* ar);
+};
@@ -0,0 +1,277 @@
+#include "stdafx.h"
+
+#include "CollisionMesh.h"
+
+#include "FaceGroup.h"
+#include "Engine.h"
+
+CCollisionMesh::CCollisionMesh()
+{
+    mIsDirty = TRUE;
+}
+
+CCollisionMesh::~CCollisionMesh()
+{
+    Release();
+}
+
+void CCollisionMesh::Release()
+{
+    if (DelRef())
+    {
+        mVerts.Release();
+        mTree.Clear();
+        delete this;
+    }
+}
+
+void CCollisionMesh::AddTriangle(const D3DXVECTOR3& a, const D3DXVECTOR3& b, const D3DXVECTOR3& c)
+{
+    mVerts.Push(a);
+    mVerts.Push(b);
+    mVerts.Push(c);
+    mIsDirty = TRUE;
+}
+
+/*
+ * Adds the triangles of a face group transformed by mat, unindexed groups are
+ * read as a triangle list. Every vertex is transformed once up front instead
+ * of once per triangle that uses it.
+ */
+void CCollisionMesh::AddFaceGroup(CFaceGroup* fg, const D3DXMATRIX& mat)
+{
+    const auto* const indices = fg->GetIndexData();
+    const auto numVerts = fg->GetNumVertices();
+    const auto numIndices = fg->GetNumIndices();
+    const auto count = numIndices > 0 ? numIndices : numVerts;
+    CArray<D3DXVECTOR3> points;
+
+    if (FAILED(points.Resize(numVerts)))
+    {
+        MessageBoxA(nullptr, "Can't transform face group vertices!", "Out of memory error", MB_OK);
+        ENGINE->Shutdown();
+        return;
+    }
+
+    NVec3TransformCoordArray(points.GetData(), sizeof(D3DXVECTOR3), reinterpret_cast<const D3DXVECTOR3*>(fg->GetVertexData()),
+                             sizeof(VERTEX), &mat, numVerts);
+
+    for (unsigned int i = 0; i + 2 < count; i += 3)
+    {
+        D3DXVECTOR3 tri[3];
+        bool valid = TRUE;
+
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            const unsigned int idx = numIndices > 0 ? static_cast<unsigned short>(indices[i + j]) : i + j;
+
+            if (idx >= numVerts)
+            {
+                valid = FALSE;
+                break;
+            }
+
+            tri[j] = points.GetData()[idx];
+        }
+
+        if (valid)
+            AddTriangle(tri[0], tri[1], tri[2]);
+    }
+}
+
+void CCollisionMesh::Clear()
+{
+    mVerts.Clear();
+    mTree.Clear();
+    mIsDirty = TRUE;
+}
+
+void CCollisionMesh::Build()
+{
+    const auto numTris = GetNumTriangles();
+    CArray<D3DXVECTOR3> mins, maxs;
+
+    mins.Resize(numTris);
+    maxs.Resize(numTris);
+
+    for (unsigned int i = 0; i < numTris; i++)
+    {
+        const auto* const tri = GetTriangle(i);
+        auto* const min = mins.GetData() + i;
+        auto* const max = maxs.GetData() + i;
+
+        *min = *max = tri[0];
+        NVec3Minimize(min, min, &tri[1]);
+        NVec3Minimize(min, min, &tri[2]);
+        NVec3Maximize(max, max, &tri[1]);
+        NVec3Maximize(max, max, &tri[2]);
+    }
+
+    mTree.Build(mins.GetData(), maxs.GetData(), nullptr, numTris);
+    mIsDirty = FALSE;
+}
+
+void CCollisionMesh::GetBounds(D3DXVECTOR3* min, D3DXVECTOR3* max)
+{
+    if (mIsDirty)
+        Build();
+
+    mTree.GetBounds(min, max);
+}
+
+/*
+ * Same test the Lua triangle meshes did: the sphere center is projected onto
+ * the triangle plane and touches the triangle when the projection lies inside
+ * it, within the radius and in front of the face. Contacts come out in
+ * triangle order.
+ */
+auto CCollisionMesh::TestSphere(const D3DXVECTOR3& pos, float radius, COLLISIONCONTACT* contacts, unsigned int maxContacts) -> unsigned int
+{
+    if (mIsDirty)
+        Build();
+
+    const D3DXVECTOR3 ext(radius, radius, radius);
+    unsigned int numContacts = 0;
+
+    mTree.Query(pos - ext, pos + ext, [&](unsigned int triIdx)
+    {
+        const auto* const tri = GetTriangle(triIdx);
+        const auto u = tri[1] - tri[0];
+        const auto v = tri[2] - tri[0];
+        const auto w = pos - tri[0];
+        D3DXVECTOR3 n, uw, wv;
+
+        NVec3Cross(&n, &u, &v);
+        NVec3Cross(&uw, &u, &w);
+        NVec3Cross(&wv, &w, &v);
+
+        const auto n2 = NVec3Dot(&n, &n);
+
+        if (n2 == 0.0f)
+            return;
+
+        const auto a = NVec3Dot(&uw, &n) / n2;
+        const auto b = NVec3Dot(&wv, &n) / n2;
+        const auto c = 1.0f - a - b;
+
+        if (a < 0.0f || a > 1.0f || b < 0.0f || b > 1.0f || c < 0.0f || c > 1.0f)
+            return;
+
+        const auto pp = tri[0] * c + tri[1] * b + tri[2] * a;
+        const auto delta = pp - pos;
+        const auto d = NVec3Dot(&delta, &delta);
+
+        if (d > radius * radius || NVec3Dot(&delta, &n) >= 0.0f)
+            return;
+
+        if (numContacts < maxContacts)
+        {
+            auto* contact = contacts + numContacts;
+
+            // keep the contacts sorted by triangle
+            while (contact > contacts && (contact - 1)->triangle > triIdx)
+            {
+                *contact = *(contact - 1);
+                contact--;
+            }
+
+            contact->normal = n;
+            contact->point = pp;
+            contact->depth = d - radius;
+            contact->triangle = triIdx;
+            contact->instance = 0;
+        }
+
+        numContacts++;
+    });
+
+    return numContacts;
+}
+
+/* Triangles overlapping an axis aligned box, tested against the box faces and the triangle plane */
+auto CCollisionMesh::TestBox(const D3DXVECTOR3& min, const D3DXVECTOR3& max, unsigned int* triangles, unsigned int maxTriangles) -> unsigned int
+{
+    if (mIsDirty)
+        Build();
+
+    const auto center = (min + max) * 0.5f;
+    const auto half = (max - min) * 0.5f;
+    unsigned int numTris = 0;
+
+    mTree.Query(min, max, [&](unsigned int triIdx)
+    {
+        const auto* const tri = GetTriangle(triIdx);
+        const auto u = tri[1] - tri[0];
+        const auto v = tri[2] - tri[0];
+        const auto w = center - tri[0];
+        D3DXVECTOR3 n;
+
+        NVec3Cross(&n, &u, &v);
+
+        // projected box radius against the distance of its center to the plane
+        const auto r = half.x * fabsf(n.x) + half.y * fabsf(n.y) + half.z * fabsf(n.z);
+
+        if (fabsf(NVec3Dot(&n, &w)) > r)
+            return;
+
+        if (numTris < maxTriangles)
+            triangles[numTris] = triIdx;
+
+        numTris++;
+    });
+
+    return numTris;
+}
+
+/* Closest triangle along the ray within maxDist, both faces count */
+auto CCollisionMesh::TestRay(const D3DXVECTOR3& origin, const D3DXVECTOR3& dir, float maxDist, COLLISIONCONTACT* hit) -> bool
+{
+    if (mIsDirty)
+        Build();
+
+    auto best = maxDist;
+    bool found = FALSE;
+
+    mTree.QueryRay(origin, dir, maxDist, [&](unsigned int triIdx)
+    {
+        const auto* const tri = GetTriangle(triIdx);
+        const auto e1 = tri[1] - tri[0];
+        const auto e2 = tri[2] - tri[0];
+        D3DXVECTOR3 p, q;
+
+        NVec3Cross(&p, &dir, &e2);
+        const auto det = NVec3Dot(&e1, &p);
+
+        if (fabsf(det) < 1e-12f)
+            return best;
+
+        const auto invDet = 1.0f / det;
+        const auto s = origin - tri[0];
+        const auto a = NVec3Dot(&s, &p) * invDet;
+
+        if (a < 0.0f || a > 1.0f)
+            return best;
+
+        NVec3Cross(&q, &s, &e1);
+        const auto b = NVec3Dot(&dir, &q) * invDet;
+
+        if (b < 0.0f || a + b > 1.0f)
+            return best;
+
+        const auto t = NVec3Dot(&e2, &q) * invDet;
+
+        if (t < 0.0f || t > best)
+            return best;
+
+        best = t;
+        found = TRUE;
+        NVec3Cross(&hit->normal, &e1, &e2);
+        hit->point = origin + dir * t;
+        hit->depth = t;
+        hit->triangle = triIdx;
+        hit->instance = 0;
+        return best;
+    });
+
+    return found;
+}
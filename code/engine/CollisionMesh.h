@@ -0,0 +1,54 @@
+#pragma once
+
+#include "system.h"
+#include "RenderData.h"
+#include "ReferenceManager.h"
+#include "CollisionTree.h"
+
+class CFaceGroup;
+
+struct COLLISIONCONTACT
+{
+    D3DXVECTOR3 normal;     // unnormalized face normal
+    D3DXVECTOR3 point;      // closest point on the triangle
+    float depth;            // squared distance minus radius, distance along the ray for ray hits
+    unsigned int triangle;
+    unsigned int instance;  // see CCollisionWorld
+};
+
+/*
+ * Static triangle soup with a bounding volume hierarchy over it, used by the
+ * collisions library for its triangle meshes. Triangles are added in the
+ * space of the mesh, a CCollisionWorld can place one mesh many times. The
+ * hierarchy is rebuilt lazily by the first query after a change.
+ * Queries report contacts into a caller provided array and return how many
+ * contacts there were, which can be more than the array holds.
+ */
+class ENGINE_API CCollisionMesh : public CReferenceCounter, CAllocable<CCollisionMesh>, NoCopyAssign
+{
+public:
+    CCollisionMesh();
+    ~CCollisionMesh();
+
+    void Release();
+    void AddTriangle(const D3DXVECTOR3& a, const D3DXVECTOR3& b, const D3DXVECTOR3& c);
+    void AddFaceGroup(CFaceGroup* fg, const D3DXMATRIX& mat);
+    void Clear();
+    void Build();
+
+    /* Builds the hierarchy now if it is stale, after that queries only read the mesh */
+    void Prepare() { if (mIsDirty) Build(); }
+
+    auto TestSphere(const D3DXVECTOR3& pos, float radius, COLLISIONCONTACT* contacts, unsigned int maxContacts) -> unsigned int;
+    auto TestBox(const D3DXVECTOR3& min, const D3DXVECTOR3& max, unsigned int* triangles, unsigned int maxTriangles) -> unsigned int;
+    auto TestRay(const D3DXVECTOR3& origin, const D3DXVECTOR3& dir, float maxDist, COLLISIONCONTACT* hit) -> bool;
+
+    auto GetNumTriangles() const -> unsigned int { return mVerts.GetCount() / 3; }
+    auto GetTriangle(unsigned int idx) const -> const D3DXVECTOR3* { return mVerts.GetData() + idx * 3; }
+    void GetBounds(D3DXVECTOR3* min, D3DXVECTOR3* max);
+
+private:
+    CArray<D3DXVECTOR3> mVerts;
+    CCollisionTree mTree;
+    bool mIsDirty;
+};
@@ -0,0 +1,100 @@
+#include "stdafx.h"
+
+#include "CollisionTree.h"
+
+void CCollisionTree::Build(const D3DXVECTOR3* mins, const D3DXVECTOR3* maxs, const unsigned int* items, unsigned int count)
+{
+    mNodes.Clear();
+    mItems.Resize(count);
+
+    for (unsigned int i = 0; i < count; i++)
+        mItems.GetData()[i] = items ? items[i] : i;
+
+    if (count > 0)
+        BuildNode(mins, maxs, 0, count, 0);
+}
+
+void CCollisionTree::Clear()
+{
+    mNodes.Clear();
+    mItems.Clear();
+}
+
+void CCollisionTree::GetBounds(D3DXVECTOR3* min, D3DXVECTOR3* max) const
+{
+    if (IsEmpty())
+    {
+        *min = *max = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+        return;
+    }
+
+    *min = mNodes[0].min;
+    *max = mNodes[0].max;
+}
+
+/*
+ * Splits the items at the middle of their box centers along the longest axis,
+ * or in half when all of them land on one side.
+ */
+auto CCollisionTree::BuildNode(const D3DXVECTOR3* mins, const D3DXVECTOR3* maxs, unsigned int first, unsigned int count, unsigned int depth) -> unsigned int
+{
+    auto* const items = mItems.GetData();
+    NODE node;
+    D3DXVECTOR3 cmin, cmax;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const auto item = items[first + i];
+        const auto center = (mins[item] + maxs[item]) * 0.5f;
+
+        if (i == 0)
+        {
+            node.min = mins[item];
+            node.max = maxs[item];
+            cmin = cmax = center;
+        }
+
+        NVec3Minimize(&node.min, &node.min, &mins[item]);
+        NVec3Maximize(&node.max, &node.max, &maxs[item]);
+        NVec3Minimize(&cmin, &cmin, &center);
+        NVec3Maximize(&cmax, &cmax, &center);
+    }
+
+    const auto index = mNodes.GetCount();
+    node.first = first;
+    node.count = count;
+    mNodes.Push(node);
+
+    if (count <= COLLISIONTREE_LEAF_SIZE || depth >= COLLISIONTREE_MAX_DEPTH)
+        return index;
+
+    const auto extent = cmax - cmin;
+    const auto axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    const auto split = static_cast<const float*>(cmin)[axis] + static_cast<const float*>(cmax)[axis];
+    auto mid = first;
+
+    for (unsigned int i = first; i < first + count; i++)
+    {
+        const auto item = items[i];
+
+        // both sides doubled, compares centers without the halving
+        if (static_cast<const float*>(mins[item])[axis] + static_cast<const float*>(maxs[item])[axis] < split)
+        {
+            items[i] = items[mid];
+            items[mid++] = item;
+        }
+    }
+
+    if (mid == first || mid == first + count)
+        mid = first + count / 2;
+
+    BuildNode(mins, maxs, first, mid - first, depth + 1);
+    const auto right = BuildNode(mins, maxs, mid, first + count - mid, depth + 1);
+
+    // the children may have grown the array
+    auto& parent = mNodes.GetData()[index];
+    parent.first = right;
+    parent.count = 0;
+
+    return index;
+}
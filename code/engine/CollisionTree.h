@@ -0,0 +1,141 @@
+#pragma once
+
+#include "system.h"
+#include "RenderData.h"
+
+/*
+ * Bounding volume hierarchy over a set of boxes, shared by the collision
+ * meshes (one box per triangle) and the collision worlds (one box per
+ * instance). Items are referred to by the index of their box. Nodes are
+ * stored depth first, the left child follows its parent and only the right
+ * one is linked.
+ */
+class ENGINE_API CCollisionTree
+{
+public:
+    CCollisionTree() = default;
+
+    /* Builds over the boxes of items, or of all count boxes when items is null */
+    void Build(const D3DXVECTOR3* mins, const D3DXVECTOR3* maxs, const unsigned int* items, unsigned int count);
+    void Clear();
+
+    auto IsEmpty() const -> bool { return mNodes.GetCount() == 0; }
+    void GetBounds(D3DXVECTOR3* min, D3DXVECTOR3* max) const;
+
+    /* Calls fn(item) for every item whose box overlaps the query box */
+    template <typename Fn>
+    void Query(const D3DXVECTOR3& min, const D3DXVECTOR3& max, Fn fn) const;
+
+    /* Calls fn(item) for every item whose box the ray enters within maxDist, fn returns the new maxDist */
+    template <typename Fn>
+    void QueryRay(const D3DXVECTOR3& origin, const D3DXVECTOR3& dir, float maxDist, Fn fn) const;
+
+    static auto BoxOverlap(const D3DXVECTOR3& amin, const D3DXVECTOR3& amax, const D3DXVECTOR3& bmin, const D3DXVECTOR3& bmax) -> bool
+    {
+        return amin.x <= bmax.x && amax.x >= bmin.x &&
+               amin.y <= bmax.y && amax.y >= bmin.y &&
+               amin.z <= bmax.z && amax.z >= bmin.z;
+    }
+
+private:
+    struct NODE
+    {
+        D3DXVECTOR3 min, max;
+        unsigned int first;     // first item of a leaf, right child of an inner node
+        unsigned int count;     // 0 for inner nodes
+    };
+
+    CArray<NODE> mNodes;
+    CArray<unsigned int> mItems;
+
+    auto BuildNode(const D3DXVECTOR3* mins, const D3DXVECTOR3* maxs, unsigned int first, unsigned int count, unsigned int depth) -> unsigned int;
+};
+
+// leaves hold at most this many items, the depth bound keeps the query stacks small
+#define COLLISIONTREE_LEAF_SIZE 4
+#define COLLISIONTREE_MAX_DEPTH 32
+
+template <typename Fn>
+void CCollisionTree::Query(const D3DXVECTOR3& min, const D3DXVECTOR3& max, Fn fn) const
+{
+    if (IsEmpty())
+        return;
+
+    const auto* const nodes = mNodes.GetData();
+    unsigned int stack[COLLISIONTREE_MAX_DEPTH * 2];
+    unsigned int top = 0;
+
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const auto idx = stack[--top];
+        const auto& node = nodes[idx];
+
+        if (!BoxOverlap(node.min, node.max, min, max))
+            continue;
+
+        if (node.count == 0)
+        {
+            stack[top++] = node.first;
+            stack[top++] = idx + 1;
+            continue;
+        }
+
+        for (unsigned int i = node.first; i < node.first + node.count; i++)
+            fn(mItems[i]);
+    }
+}
+
+template <typename Fn>
+void CCollisionTree::QueryRay(const D3DXVECTOR3& origin, const D3DXVECTOR3& dir, float maxDist, Fn fn) const
+{
+    if (IsEmpty())
+        return;
+
+    const D3DXVECTOR3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+    const auto* const nodes = mNodes.GetData();
+    unsigned int stack[COLLISIONTREE_MAX_DEPTH * 2];
+    unsigned int top = 0;
+
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const auto idx = stack[--top];
+        const auto& node = nodes[idx];
+        auto tmin = 0.0f, tmax = maxDist;
+
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            const auto o = static_cast<const float*>(origin)[axis];
+            const auto inv = static_cast<const float*>(invDir)[axis];
+            auto t0 = (static_cast<const float*>(node.min)[axis] - o) * inv;
+            auto t1 = (static_cast<const float*>(node.max)[axis] - o) * inv;
+
+            if (t0 > t1)
+            {
+                const auto tmp = t0;
+                t0 = t1;
+                t1 = tmp;
+            }
+
+            // NaN from a zero direction against a touching slab keeps the node
+            tmin = t0 > tmin ? t0 : tmin;
+            tmax = t1 < tmax ? t1 : tmax;
+        }
+
+        if (tmin > tmax)
+            continue;
+
+        if (node.count == 0)
+        {
+            stack[top++] = node.first;
+            stack[top++] = idx + 1;
+            continue;
+        }
+
+        for (unsigned int i = node.first; i < node.first + node.count; i++)
+            maxDist = fn(mItems[i]);
+    }
+}
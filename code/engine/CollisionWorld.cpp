@@ -0,0 +1,287 @@
+#include "stdafx.h"
+
+#include "CollisionWorld.h"
+
+#include "JobPool.h"
+
+// contacts of one batch query gathered on the stack before going to the chunk list
+#define COLLISION_BATCH_CONTACTS 64
+
+CCollisionWorld::CCollisionWorld()
+{
+    mNumInstances = 0;
+    mIsDirty = FALSE;
+}
+
+CCollisionWorld::~CCollisionWorld()
+{
+    Release();
+}
+
+void CCollisionWorld::Release()
+{
+    if (DelRef())
+    {
+        for (auto& inst : mInstances)
+        {
+            SAFE_RELEASE(inst.mesh);
+        }
+
+        mInstances.Release();
+        mTree.Clear();
+        delete this;
+    }
+}
+
+auto CCollisionWorld::AddInstance(CCollisionMesh* mesh, const D3DXMATRIX& transform) -> unsigned int
+{
+    auto id = mInstances.GetCount();
+
+    for (unsigned int i = 0; i < mInstances.GetCount(); i++)
+    {
+        if (!mInstances[i].mesh)
+        {
+            id = i;
+            break;
+        }
+    }
+
+    if (id == mInstances.GetCount())
+    {
+        COLLISIONINSTANCE inst;
+        ZeroMemory(&inst, sizeof(COLLISIONINSTANCE));
+        mInstances.Push(inst);
+    }
+
+    mesh->AddRef();
+    mInstances.GetData()[id].mesh = mesh;
+    mNumInstances++;
+
+    SetTransform(id, transform);
+    return id;
+}
+
+void CCollisionWorld::RemoveInstance(unsigned int id)
+{
+    if (!IsInstance(id))
+        return;
+
+    SAFE_RELEASE(mInstances.GetData()[id].mesh);
+    mNumInstances--;
+    mIsDirty = TRUE;
+}
+
+auto CCollisionWorld::SetTransform(unsigned int id, const D3DXMATRIX& transform) -> bool
+{
+    if (!IsInstance(id))
+        return FALSE;
+
+    auto* const inst = mInstances.GetData() + id;
+    inst->transform = transform;
+    inst->isSingular = NMatrixInverse(&inst->inverse, nullptr, &transform) == nullptr;
+
+    // don't keep the inverse of the previous transform or of a removed instance
+    if (inst->isSingular)
+        D3DXMatrixIdentity(&inst->inverse);
+
+    UpdateBounds(inst);
+    mIsDirty = TRUE;
+    return !inst->isSingular;
+}
+
+/* World bounds of the transformed corners of the mesh bounds */
+void CCollisionWorld::UpdateBounds(COLLISIONINSTANCE* inst) const
+{
+    D3DXVECTOR3 min, max;
+    inst->mesh->GetBounds(&min, &max);
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        const D3DXVECTOR3 corner(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+        D3DXVECTOR3 pos;
+        NVec3TransformCoord(&pos, &corner, &inst->transform);
+
+        if (i == 0)
+            inst->min = inst->max = pos;
+
+        NVec3Minimize(&inst->min, &inst->min, &pos);
+        NVec3Maximize(&inst->max, &inst->max, &pos);
+    }
+}
+
+void CCollisionWorld::Build()
+{
+    const auto count = mInstances.GetCount();
+    CArray<D3DXVECTOR3> mins, maxs;
+    CArray<unsigned int> items;
+
+    mins.Resize(count);
+    maxs.Resize(count);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const auto& inst = mInstances.GetData()[i];
+        mins.GetData()[i] = inst.min;
+        maxs.GetData()[i] = inst.max;
+
+        if (inst.mesh && !inst.isSingular)
+            items.Push(i);
+    }
+
+    mTree.Build(mins.GetData(), maxs.GetData(), items.GetData(), items.GetCount());
+    mIsDirty = FALSE;
+}
+
+auto CCollisionWorld::TestSphere(const D3DXVECTOR3& pos, float radius, COLLISIONCONTACT* contacts, unsigned int maxContacts) -> unsigned int
+{
+    if (mIsDirty)
+        Build();
+
+    const D3DXVECTOR3 ext(radius, radius, radius);
+    unsigned int numContacts = 0;
+
+    mTree.Query(pos - ext, pos + ext, [&](unsigned int id)
+    {
+        const auto& inst = mInstances.GetData()[id];
+        D3DXVECTOR3 localPos;
+        NVec3TransformCoord(&localPos, &pos, &inst.inverse);
+
+        const auto stored = numContacts < maxContacts ? numContacts : maxContacts;
+        auto* const found = contacts + stored;
+        const auto count = inst.mesh->TestSphere(localPos, radius, found, maxContacts - stored);
+        const auto kept = count < maxContacts - stored ? count : maxContacts - stored;
+
+        for (unsigned int i = 0; i < kept; i++)
+        {
+            auto contact = found[i];
+            auto* slot = found + i;
+
+            NVec3TransformNormal(&contact.normal, &contact.normal, &inst.transform);
+            NVec3TransformCoord(&contact.point, &contact.point, &inst.transform);
+            contact.instance = id;
+
+            // the tree visits instances in no particular order, keep them sorted
+            while (slot > contacts && (slot - 1)->instance > id)
+            {
+                *slot = *(slot - 1);
+                slot--;
+            }
+
+            *slot = contact;
+        }
+
+        numContacts += count;
+    });
+
+    return numContacts;
+}
+
+/* Closest hit over all instances, in world space */
+auto CCollisionWorld::TestRay(const D3DXVECTOR3& origin, const D3DXVECTOR3& dir, float maxDist, COLLISIONCONTACT* hit) -> bool
+{
+    if (mIsDirty)
+        Build();
+
+    auto best = maxDist;
+    bool found = FALSE;
+
+    mTree.QueryRay(origin, dir, maxDist, [&](unsigned int id)
+    {
+        const auto& inst = mInstances.GetData()[id];
+        D3DXVECTOR3 localOrigin, localDir;
+        COLLISIONCONTACT localHit;
+
+        NVec3TransformCoord(&localOrigin, &origin, &inst.inverse);
+        NVec3TransformNormal(&localDir, &dir, &inst.inverse);
+
+        // rigid transforms keep distances, so the local distance is the world one
+        if (inst.mesh->TestRay(localOrigin, localDir, best, &localHit))
+        {
+            best = localHit.depth;
+            found = TRUE;
+            *hit = localHit;
+            NVec3TransformNormal(&hit->normal, &localHit.normal, &inst.transform);
+            hit->point = origin + dir * localHit.depth;
+            hit->instance = id;
+        }
+
+        return best;
+    });
+
+    return found;
+}
+
+void CCollisionWorld::Prepare()
+{
+    if (mIsDirty)
+        Build();
+
+    for (auto& inst : mInstances)
+    {
+        if (inst.mesh)
+            inst.mesh->Prepare();
+    }
+}
+
+void CCollisionWorld::TestSpheres(const COLLISIONSPHERE* spheres, unsigned int count, CJobPool* jobs, CArray<COLLISIONCONTACT>* contacts, unsigned int* counts)
+{
+    Prepare();
+
+    // one list per chunk, jobs can't grow a CArray
+    std::vector<std::vector<COLLISIONCONTACT>> chunks((count + COLLISION_BATCH_GRAIN - 1) / COLLISION_BATCH_GRAIN);
+
+    jobs->Run(count, COLLISION_BATCH_GRAIN, [&](unsigned int first, unsigned int last)
+    {
+        auto& found = chunks[first / COLLISION_BATCH_GRAIN];
+        COLLISIONCONTACT local[COLLISION_BATCH_CONTACTS];
+
+        for (auto i = first; i < last; i++)
+        {
+            const auto& sphere = spheres[i];
+            const auto numContacts = TestSphere(sphere.pos, sphere.radius, local, COLLISION_BATCH_CONTACTS);
+            counts[i] = numContacts;
+
+            if (numContacts > COLLISION_BATCH_CONTACTS)
+            {
+                const auto size = found.size();
+                found.resize(size + numContacts);
+                TestSphere(sphere.pos, sphere.radius, found.data() + size, numContacts);
+            }
+            else
+                found.insert(found.end(), local, local + numContacts);
+        }
+    });
+
+    size_t total = 0;
+
+    for (const auto& chunk : chunks)
+        total += chunk.size();
+
+    contacts->Resize(static_cast<unsigned int>(total));
+    auto* out = contacts->GetData();
+
+    for (const auto& chunk : chunks)
+    {
+        if (!chunk.empty())
+            ::memcpy(out, chunk.data(), chunk.size() * sizeof(COLLISIONCONTACT));
+
+        out += chunk.size();
+    }
+}
+
+void CCollisionWorld::TestRays(const COLLISIONRAY* rays, unsigned int count, float maxDist, CJobPool* jobs, COLLISIONCONTACT* hits)
+{
+    Prepare();
+
+    jobs->Run(count, COLLISION_BATCH_GRAIN, [&](unsigned int first, unsigned int last)
+    {
+        for (auto i = first; i < last; i++)
+        {
+            if (!TestRay(rays[i].origin, rays[i].dir, maxDist, hits + i))
+            {
+                ZeroMemory(hits + i, sizeof(COLLISIONCONTACT));
+                hits[i].depth = -1.0f;
+            }
+        }
+    });
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "system.h"
+#include "RenderData.h"
+#include "ReferenceManager.h"
+#include "CollisionMesh.h"
+
+class CJobPool;
+
+struct COLLISIONINSTANCE
+{
+    CCollisionMesh* mesh;   // null for a free slot
+    D3DXMATRIX transform;
+    D3DXMATRIX inverse;
+    D3DXVECTOR3 min, max;   // world bounds
+    bool isSingular;        // transform has no inverse, left out of queries
+};
+
+struct COLLISIONSPHERE
+{
+    D3DXVECTOR3 pos;
+    float radius;
+};
+
+struct COLLISIONRAY
+{
+    D3DXVECTOR3 origin;
+    D3DXVECTOR3 dir;
+};
+
+// queries handed to one job at a time by the batch tests
+#define COLLISION_BATCH_GRAIN 32
+
+/*
+ * Places collision meshes in the world, one instance per placement. An
+ * instance only stores its transform and world bounds and holds a reference
+ * to the shared mesh, so many instances of one mesh cost little more than one.
+ * A tree over the instance bounds picks the instances near a query, which then
+ * runs against the mesh in its local space. Transforms are expected to be
+ * rigid, a sphere radius is not scaled into the mesh space. Instance bounds
+ * are taken when the instance is placed, so meshes should be complete by then.
+ */
+class ENGINE_API CCollisionWorld : public CReferenceCounter, CAllocable<CCollisionWorld>, NoCopyAssign
+{
+public:
+    CCollisionWorld();
+    ~CCollisionWorld();
+
+    void Release();
+
+    /* Returns the id of the new instance, ids of removed instances are reused */
+    auto AddInstance(CCollisionMesh* mesh, const D3DXMATRIX& transform) -> unsigned int;
+    void RemoveInstance(unsigned int id);
+
+    /* Returns FALSE for a transform without an inverse, queries skip the instance until it gets a valid one */
+    auto SetTransform(unsigned int id, const D3DXMATRIX& transform) -> bool;
+    auto IsInstance(unsigned int id) const -> bool { return id < mInstances.GetCount() && mInstances[id].mesh; }
+    auto GetInstance(unsigned int id) const -> const COLLISIONINSTANCE& { return mInstances.GetData()[id]; }
+    auto GetNumInstances() const -> unsigned int { return mNumInstances; }
+
+    /* Contacts in world space, sorted by instance and then triangle */
+    auto TestSphere(const D3DXVECTOR3& pos, float radius, COLLISIONCONTACT* contacts, unsigned int maxContacts) -> unsigned int;
+    auto TestRay(const D3DXVECTOR3& origin, const D3DXVECTOR3& dir, float maxDist, COLLISIONCONTACT* hit) -> bool;
+
+    /*
+     * Batch tests run the queries in parallel on the job pool. Sphere contacts
+     * are packed query by query into contacts, counts receives the number of
+     * contacts of each query. Each ray gets its closest hit in hits, a ray
+     * that hits nothing gets a negative depth.
+     */
+    void TestSpheres(const COLLISIONSPHERE* spheres, unsigned int count, CJobPool* jobs, CArray<COLLISIONCONTACT>* contacts, unsigned int* counts);
+    void TestRays(const COLLISIONRAY* rays, unsigned int count, float maxDist, CJobPool* jobs, COLLISIONCONTACT* hits);
+
+    /* Builds the instance tree and the meshes now, after that queries only read the world */
+    void Prepare();
+
+private:
+    CArray<COLLISIONINSTANCE> mInstances;
+    CCollisionTree mTree;
+    unsigned int mNumInstances;
+    bool mIsDirty;
+
+    void UpdateBounds(COLLISIONINSTANCE* inst) const;
+    void Build();
+};
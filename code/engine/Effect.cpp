@@ -83,6 +83,13 @@ void CEffect::LoadEffect(LPCSTR effectPath, bool debugMode)
         return;
     }
 
+    LoadEffectFromMemory(f.data, f.size, debugMode);
+    FILESYSTEM->FreeResource(f.data);
+}
+
+/* Compiles effect source that was already read, includes are still loaded from the game directory */
+void CEffect::LoadEffectFromMemory(LPCVOID data, unsigned int size, bool debugMode)
+{
     DWORD shaderFlags = D3DXFX_NOT_CLONEABLE | D3DXSHADER_NO_PRESHADER;
 
     if (debugMode)
@@ -95,8 +102,8 @@ void CEffect::LoadEffect(LPCSTR effectPath, bool debugMode)
     LPD3DXBUFFER errors = nullptr;
     HRESULT hr = D3DXCreateEffect(
         RENDERER->GetDevice(),
-        static_cast<LPCSTR>(f.data),
-        static_cast<unsigned int>(f.size),
+        static_cast<LPCSTR>(data),
+        size,
         nullptr,
         reinterpret_cast<LPD3DXINCLUDE>(&inclHandler),
         shaderFlags,
@@ -6,11 +6,12 @@
 
 class CLight;
 
-class ENGINE_API CEffect : CReferenceCounter, public CAllocable<CEffect>
+class ENGINE_API CEffect : public CReferenceCounter, public CAllocable<CEffect>
 {
 public:
     CEffect();
     void LoadEffect(LPCSTR effectPath, bool debugMode);
+    void LoadEffectFromMemory(LPCVOID data, unsigned int size, bool debugMode);
     void Release();
 
     auto Begin(LPCSTR technique) -> unsigned int;
@@ -8,6 +8,10 @@
 #include "Renderer.h"
 #include "UserInterface.h"
 #include "VM.h"
+#include "ResourceCache.h"
+#include "JobPool.h"
+#include "TransformHierarchy.h"
+#include "NameTable.h"
 
 #include <ctime>
 
@@ -22,6 +26,10 @@ CEngine::CEngine()
     mVirtualMachine = nullptr;
     mDebugUI = nullptr;
     mAudioSystem = nullptr;
+    mResourceCache = nullptr;
+    mJobPool = nullptr;
+    mTransforms = nullptr;
+    mNames = nullptr;
 
     SetFPS(60.0F);
     mUnprocessedTime = 0.0F;
@@ -31,6 +39,10 @@ CEngine::CEngine()
 auto CEngine::Release() -> bool
 {
     SAFE_RELEASE(mVirtualMachine);
+    SAFE_RELEASE(mResourceCache);
+    SAFE_RELEASE(mJobPool);
+    SAFE_RELEASE(mTransforms);
+    SAFE_RELEASE(mNames);
     SAFE_RELEASE(mFileSystem);
     SAFE_RELEASE(mDebugUI);
     SAFE_RELEASE(mRenderer);
@@ -77,6 +89,10 @@ auto CEngine::Init(HWND window, RECT resolution) -> bool
     mInput = new CInput();
     mFileSystem = new CFileSystem();
     mVirtualMachine = new CVirtualMachine();
+    mResourceCache = new CResourceCache();
+    mJobPool = new CJobPool();
+    mTransforms = new CTransformHierarchy();
+    mNames = new CNameTable();
 
     if (mRenderer->CreateDevice(window, resolution) != ERROR_SUCCESS)
     {
@@ -134,6 +150,10 @@ void CEngine::Think()
     if (render != 0)
     {
         Render();
+
+        // Spend the rest of the frame slot collecting Lua garbage
+        CProfileScope scope(DefaultProfiling.mGCProfiler);
+        mVirtualMachine->CollectGarbage(mUpdateDuration - (GetTime() - startTime));
     }
     else
     {
@@ -196,11 +216,15 @@ void CEngine::CDefaultProfiling::SetupDefaultProfilers()
     mRenderProfiler = new CProfiler("Render");
     mRender2DProfiler = new CProfiler("RenderUI");
     mWindowProfiler = new CProfiler("Window");
+    mGCProfiler = new CProfiler("GC");
+    mTaskProfiler = new CProfiler("Tasks");
 
     mProfilers.Push(mUpdateProfiler);
     mProfilers.Push(mRenderProfiler);
     mProfilers.Push(mRender2DProfiler);
     mProfilers.Push(mWindowProfiler);
+    mProfilers.Push(mTaskProfiler);
+    mProfilers.Push(mGCProfiler);
 }
 
 void CEngine::CDefaultProfiling::PushProfiler(CProfiler* profile)
@@ -327,11 +351,19 @@ void CEngine::Update(float deltaTime) const
         mAudioSystem->Update();
     }
 
+    {
+        CProfileScope scope(DefaultProfiling.mTaskProfiler);
+        mVirtualMachine->UpdateTasks();
+    }
+
     mInput->Update();
 }
 
 void CEngine::Render() const
 {
+    // world matrices of whatever the update moved
+    mTransforms->Update();
+
     mRenderer->BeginRender();
 
     {
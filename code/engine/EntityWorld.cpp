@@ -0,0 +1,434 @@
+#include "stdafx.h"
+
+#include "EntityWorld.h"
+
+#include <algorithm>
+
+static auto MaskOf(const std::vector<unsigned int>& components) -> std::vector<UINT64>
+{
+    std::vector<UINT64> mask(components.empty() ? 0 : components.back() / 64 + 1);
+
+    for (const auto component : components)
+        mask[component / 64] |= 1ULL << (component % 64);
+
+    return mask;
+}
+
+/* Whether every component of sub is in mask */
+static auto MaskContains(const std::vector<UINT64>& mask, const std::vector<UINT64>& sub) -> bool
+{
+    if (sub.size() > mask.size())
+        return FALSE;
+
+    for (size_t i = 0; i < sub.size(); i++)
+    {
+        if ((mask[i] & sub[i]) != sub[i])
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+CEntityWorld::CEntityWorld()
+{
+    Reset();
+}
+
+CEntityWorld::~CEntityWorld()
+{
+    Release();
+}
+
+void CEntityWorld::Release()
+{
+    if (DelRef())
+    {
+        delete this;
+    }
+}
+
+/* Drops everything but the archetype without components, which entities start in */
+void CEntityWorld::Reset()
+{
+    mEntities.clear();
+    mFree.clear();
+    mArchetypes.clear();
+    mQueries.clear();
+    mArchetypes.emplace_back();
+}
+
+auto CEntityWorld::CreateEntity(int value) -> unsigned int
+{
+    unsigned int id;
+
+    if (!mFree.empty())
+    {
+        id = mFree.back();
+        mFree.pop_back();
+    }
+    else
+    {
+        id = static_cast<unsigned int>(mEntities.size());
+        mEntities.emplace_back();
+    }
+
+    auto& root = mArchetypes[0];
+    auto& rec = mEntities[id];
+
+    rec.archetype = 0;
+    rec.row = static_cast<unsigned int>(root.entities.size());
+    rec.value = value;
+    rec.alive = TRUE;
+    root.entities.push_back(id);
+    return id;
+}
+
+void CEntityWorld::DestroyEntity(unsigned int id)
+{
+    if (!IsEntity(id))
+        return;
+
+    auto& rec = mEntities[id];
+
+    RemoveRow(rec.archetype, rec.row);
+    rec.alive = FALSE;
+    mFree.push_back(id);
+}
+
+auto CEntityWorld::SetComponent(unsigned int id, unsigned int component, int value, int* old) -> bool
+{
+    if (!IsEntity(id))
+        return FALSE;
+
+    const auto& rec = mEntities[id];
+    auto& archetype = mArchetypes[rec.archetype];
+    const auto col = FindColumn(archetype, component);
+
+    if (col >= 0)
+    {
+        *old = archetype.columns[col][rec.row];
+        archetype.columns[col][rec.row] = value;
+        return TRUE;
+    }
+
+    MoveEntity(id, GetNextArchetype(rec.archetype, component), component, value);
+    return FALSE;
+}
+
+auto CEntityWorld::RemoveComponent(unsigned int id, unsigned int component, int* old) -> bool
+{
+    if (!IsEntity(id))
+        return FALSE;
+
+    const auto& rec = mEntities[id];
+    const auto& archetype = mArchetypes[rec.archetype];
+    const auto col = FindColumn(archetype, component);
+
+    if (col < 0)
+        return FALSE;
+
+    *old = archetype.columns[col][rec.row];
+    MoveEntity(id, GetNextArchetype(rec.archetype, component), component, 0);
+    return TRUE;
+}
+
+auto CEntityWorld::GetComponent(unsigned int id, unsigned int component, int* value) const -> bool
+{
+    if (!IsEntity(id))
+        return FALSE;
+
+    const auto& rec = mEntities[id];
+    const auto& archetype = mArchetypes[rec.archetype];
+    const auto col = FindColumn(archetype, component);
+
+    if (col < 0)
+        return FALSE;
+
+    *value = archetype.columns[col][rec.row];
+    return TRUE;
+}
+
+auto CEntityWorld::AddQuery(const unsigned int* components, unsigned int count) -> unsigned int
+{
+    std::vector<unsigned int> sorted(components, components + count);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    for (size_t i = 0; i < mQueries.size(); i++)
+    {
+        if (mQueries[i].components == sorted)
+            return static_cast<unsigned int>(i);
+    }
+
+    ENTITYQUERY query;
+    query.mask = MaskOf(sorted);
+    query.components = std::move(sorted);
+
+    for (size_t i = 0; i < mArchetypes.size(); i++)
+    {
+        if (MaskContains(mArchetypes[i].mask, query.mask))
+            query.archetypes.push_back(static_cast<unsigned int>(i));
+    }
+
+    mQueries.push_back(std::move(query));
+    return static_cast<unsigned int>(mQueries.size() - 1);
+}
+
+auto CEntityWorld::CountQuery(unsigned int id) const -> unsigned int
+{
+    unsigned int count = 0;
+
+    for (const auto archetype : mQueries[id].archetypes)
+        count += static_cast<unsigned int>(mArchetypes[archetype].entities.size());
+
+    return count;
+}
+
+/*
+ * Archetype with component toggled, looked up once and then kept as an edge
+ * of both archetypes. New archetypes are added to the queries they match.
+ */
+auto CEntityWorld::GetNextArchetype(unsigned int from, unsigned int component) -> unsigned int
+{
+    const auto edge = mArchetypes[from].edges.find(component);
+
+    if (edge != mArchetypes[from].edges.end())
+        return edge->second;
+
+    auto components = mArchetypes[from].components;
+    const auto pos = std::lower_bound(components.begin(), components.end(), component);
+
+    if (pos != components.end() && *pos == component)
+        components.erase(pos);
+    else
+        components.insert(pos, component);
+
+    auto to = static_cast<unsigned int>(mArchetypes.size());
+
+    for (unsigned int i = 0; i < mArchetypes.size(); i++)
+    {
+        if (mArchetypes[i].components == components)
+        {
+            to = i;
+            break;
+        }
+    }
+
+    if (to == mArchetypes.size())
+    {
+        ENTITYARCHETYPE archetype;
+        archetype.mask = MaskOf(components);
+        archetype.columns.resize(components.size());
+        archetype.components = std::move(components);
+
+        for (auto& query : mQueries)
+        {
+            if (MaskContains(archetype.mask, query.mask))
+                query.archetypes.push_back(to);
+        }
+
+        mArchetypes.push_back(std::move(archetype));
+    }
+
+    mArchetypes[from].edges[component] = to;
+    mArchetypes[to].edges[component] = from;
+    return to;
+}
+
+/* Moves the row of an entity over to archetype to, component gets value there when it is new */
+void CEntityWorld::MoveEntity(unsigned int id, unsigned int to, unsigned int component, int value)
+{
+    auto& rec = mEntities[id];
+    const auto& src = mArchetypes[rec.archetype];
+    auto& dst = mArchetypes[to];
+    unsigned int s = 0;
+
+    // both component lists are sorted, walk them side by side
+    for (unsigned int c = 0; c < dst.components.size(); c++)
+    {
+        while (s < src.components.size() && src.components[s] < dst.components[c])
+            s++;
+
+        if (s < src.components.size() && src.components[s] == dst.components[c])
+            dst.columns[c].push_back(src.columns[s][rec.row]);
+        else
+            dst.columns[c].push_back(value);
+    }
+
+    dst.entities.push_back(id);
+    RemoveRow(rec.archetype, rec.row);
+
+    rec.archetype = to;
+    rec.row = static_cast<unsigned int>(dst.entities.size() - 1);
+}
+
+/* Fills the row with the last one of the archetype */
+void CEntityWorld::RemoveRow(unsigned int archetype, unsigned int row)
+{
+    auto& arch = mArchetypes[archetype];
+    const auto last = static_cast<unsigned int>(arch.entities.size() - 1);
+
+    if (row != last)
+    {
+        arch.entities[row] = arch.entities[last];
+        mEntities[arch.entities[row]].row = row;
+
+        for (auto& column : arch.columns)
+            column[row] = column[last];
+    }
+
+    arch.entities.pop_back();
+
+    for (auto& column : arch.columns)
+        column.pop_back();
+}
+
+auto CEntityWorld::FindColumn(const ENTITYARCHETYPE& archetype, unsigned int component) -> int
+{
+    const auto& components = archetype.components;
+    const auto pos = std::lower_bound(components.begin(), components.end(), component);
+
+    if (pos == components.end() || *pos != component)
+        return -1;
+
+    return static_cast<int>(pos - components.begin());
+}
+
+/*
+ * Layout: version, number of entity slots, then per slot whether it is alive
+ * and for live ones the value and component id and value pairs. Followed by
+ * the free ids and the component lists of the queries.
+ */
+void CEntityWorld::Save(std::vector<int>* out) const
+{
+    out->clear();
+    out->push_back(ENTITYWORLD_VERSION);
+    out->push_back(static_cast<int>(mEntities.size()));
+
+    for (const auto& rec : mEntities)
+    {
+        out->push_back(rec.alive);
+
+        if (!rec.alive)
+            continue;
+
+        const auto& archetype = mArchetypes[rec.archetype];
+        out->push_back(rec.value);
+        out->push_back(static_cast<int>(archetype.components.size()));
+
+        for (size_t c = 0; c < archetype.components.size(); c++)
+        {
+            out->push_back(static_cast<int>(archetype.components[c]));
+            out->push_back(archetype.columns[c][rec.row]);
+        }
+    }
+
+    out->push_back(static_cast<int>(mFree.size()));
+    out->insert(out->end(), mFree.begin(), mFree.end());
+    out->push_back(static_cast<int>(mQueries.size()));
+
+    for (const auto& query : mQueries)
+    {
+        out->push_back(static_cast<int>(query.components.size()));
+        out->insert(out->end(), query.components.begin(), query.components.end());
+    }
+}
+
+auto CEntityWorld::Load(const int* data, size_t count) -> bool
+{
+    size_t pos = 0;
+    int version, numEntities, numFree, numQueries;
+
+    const auto read = [&](int* value) -> bool
+    {
+        if (pos >= count)
+            return FALSE;
+
+        *value = data[pos++];
+        return TRUE;
+    };
+
+    const auto fail = [this]() -> bool
+    {
+        Reset();
+        return FALSE;
+    };
+
+    Reset();
+
+    if (!read(&version) || version != ENTITYWORLD_VERSION || !read(&numEntities) || numEntities < 0)
+        return fail();
+
+    mEntities.resize(numEntities);
+
+    for (auto id = 0; id < numEntities; id++)
+    {
+        int alive, value, numComponents;
+
+        if (!read(&alive))
+            return fail();
+
+        if (!alive)
+            continue;
+
+        if (!read(&value) || !read(&numComponents))
+            return fail();
+
+        auto& root = mArchetypes[0];
+        auto& rec = mEntities[id];
+        rec.archetype = 0;
+        rec.row = static_cast<unsigned int>(root.entities.size());
+        rec.value = value;
+        rec.alive = TRUE;
+        root.entities.push_back(id);
+
+        for (auto c = 0; c < numComponents; c++)
+        {
+            int component, componentValue, old;
+
+            if (!read(&component) || !read(&componentValue) || component < 0 || component >= ENTITYWORLD_MAX_COMPONENTS)
+                return fail();
+
+            SetComponent(id, component, componentValue, &old);
+        }
+    }
+
+    if (!read(&numFree) || numFree < 0)
+        return fail();
+
+    for (auto i = 0; i < numFree; i++)
+    {
+        int id;
+
+        if (!read(&id) || id < 0 || id >= numEntities || mEntities[id].alive)
+            return fail();
+
+        mFree.push_back(id);
+    }
+
+    if (!read(&numQueries) || numQueries < 0)
+        return fail();
+
+    for (auto q = 0; q < numQueries; q++)
+    {
+        int numComponents;
+        std::vector<unsigned int> components;
+
+        if (!read(&numComponents) || numComponents < 0)
+            return fail();
+
+        for (auto c = 0; c < numComponents; c++)
+        {
+            int component;
+
+            if (!read(&component) || component < 0 || component >= ENTITYWORLD_MAX_COMPONENTS)
+                return fail();
+
+            components.push_back(component);
+        }
+
+        AddQuery(components.data(), static_cast<unsigned int>(components.size()));
+    }
+
+    return pos == count ? TRUE : fail();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "system.h"
+#include "ReferenceManager.h"
+
+#include <unordered_map>
+#include <vector>
+
+// component ids go from 0 up to this, they index the archetype masks
+#define ENTITYWORLD_MAX_COMPONENTS 4096
+// first value written by Save
+#define ENTITYWORLD_VERSION 1
+
+struct ENTITYARCHETYPE
+{
+    std::vector<unsigned int> components;   // sorted component ids
+    std::vector<UINT64> mask;               // one bit per component id
+    std::vector<unsigned int> entities;     // entity of each row
+    std::vector<std::vector<int>> columns;  // component values of each row, one column per component
+    std::unordered_map<unsigned int, unsigned int> edges;  // archetype with a component added or removed
+};
+
+struct ENTITYQUERY
+{
+    std::vector<unsigned int> components;   // sorted component ids
+    std::vector<UINT64> mask;
+    std::vector<unsigned int> archetypes;   // matching archetypes, appended as they appear
+};
+
+struct ENTITYRECORD
+{
+    unsigned int archetype;
+    unsigned int row;
+    int value;
+    bool alive;
+};
+
+/*
+ * Archetype based entity storage backing libs/ecs. Entities with the same set
+ * of components share an archetype, which keeps a column of values per
+ * component. Queries remember the archetypes holding all of their components
+ * and pick up new archetypes as they get created, so a system only walks the
+ * entities it matches. Entity and component values are opaque integers to the
+ * world, the Lua bindings store references to Lua values in them.
+ */
+class CEntityWorld : public CReferenceCounter, CAllocable<CEntityWorld>, NoCopyAssign
+{
+public:
+    CEntityWorld();
+    ~CEntityWorld();
+
+    void Release();
+
+    /* Ids of destroyed entities are reused */
+    auto CreateEntity(int value) -> unsigned int;
+    void DestroyEntity(unsigned int id);
+    auto IsEntity(unsigned int id) const -> bool { return id < mEntities.size() && mEntities[id].alive; }
+    auto GetEntity(unsigned int id) const -> const ENTITYRECORD& { return mEntities[id]; }
+    auto GetNumEntities() const -> unsigned int { return static_cast<unsigned int>(mEntities.size() - mFree.size()); }
+
+    /* Both return whether the entity had the component, old receives its previous value then */
+    auto SetComponent(unsigned int id, unsigned int component, int value, int* old) -> bool;
+    auto RemoveComponent(unsigned int id, unsigned int component, int* old) -> bool;
+    auto GetComponent(unsigned int id, unsigned int component, int* value) const -> bool;
+
+    /* Queries with the same components share an id */
+    auto AddQuery(const unsigned int* components, unsigned int count) -> unsigned int;
+    auto IsQuery(unsigned int id) const -> bool { return id < mQueries.size(); }
+    auto GetQuery(unsigned int id) const -> const ENTITYQUERY& { return mQueries[id]; }
+    auto CountQuery(unsigned int id) const -> unsigned int;
+
+    auto GetArchetype(unsigned int id) const -> const ENTITYARCHETYPE& { return mArchetypes[id]; }
+    auto GetNumArchetypes() const -> unsigned int { return static_cast<unsigned int>(mArchetypes.size()); }
+
+    /* Flattens entities, their components and the queries, Load restores them with the same ids */
+    void Save(std::vector<int>* out) const;
+    auto Load(const int* data, size_t count) -> bool;
+
+private:
+    std::vector<ENTITYRECORD> mEntities;
+    std::vector<unsigned int> mFree;
+    std::vector<ENTITYARCHETYPE> mArchetypes;
+    std::vector<ENTITYQUERY> mQueries;
+
+    void Reset();
+    auto GetNextArchetype(unsigned int from, unsigned int component) -> unsigned int;
+    void MoveEntity(unsigned int id, unsigned int to, unsigned int component, int value);
+    void RemoveRow(unsigned int archetype, unsigned int row);
+    static auto FindColumn(const ENTITYARCHETYPE& archetype, unsigned int component) -> int;
+};
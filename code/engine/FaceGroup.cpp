@@ -6,12 +6,13 @@
 #include "Renderer.h"
 
 #include "Material.h"
+#include "Geometry.h"
 
 CFaceGroup::CFaceGroup()
 {
     ZeroMemory(&mData, sizeof(RENDERDATA));
     mData.kind = PRIMITIVEKIND_TRIANGLELIST;
-    mIsDirty = FALSE;
+    mGeometry = new CGeometry();
 }
 
 CFaceGroup::~CFaceGroup()
@@ -19,13 +20,12 @@ CFaceGroup::~CFaceGroup()
     Release();
 }
 
+/* The device mesh in mData belongs to the geometry */
 void CFaceGroup::Release()
 {
     if (DelRef())
     {
-        mVerts.Release();
-        mIndices.Release();
-        SAFE_RELEASE(mData.mesh);
+        SAFE_RELEASE(mGeometry);
         SAFE_RELEASE(mData.mat);
         delete this;
     }
@@ -38,23 +38,95 @@ void CFaceGroup::SetMaterial(CMaterial* tex)
 
 void CFaceGroup::AddVertex(const VERTEX& vertex)
 {
-    mIsDirty = TRUE;
-    mVerts.Push(vertex);
+    Detach();
+    mGeometry->AddVertex(vertex);
 }
 
 void CFaceGroup::AddIndex(short index)
 {
-    mIsDirty = TRUE;
-    mIndices.Push(index);
+    Detach();
+    mGeometry->AddIndex(index);
 }
 
-void CFaceGroup::Draw(D3DXMATRIX* mat)
+void CFaceGroup::SetNumVertices(unsigned int count)
 {
-    if ((mData.mesh == nullptr) || mIsDirty)
+    Detach();
+    mGeometry->SetNumVertices(count);
+}
+
+void CFaceGroup::SetNumIndices(unsigned int count)
+{
+    Detach();
+    mGeometry->SetNumIndices(count);
+}
+
+void CFaceGroup::MarkDirty()
+{
+    Detach();
+    mGeometry->MarkDirty();
+}
+
+void CFaceGroup::Detach()
+{
+    if (!mGeometry->IsShared())
     {
-        Build();
+        return;
     }
 
+    auto* const copy = mGeometry->Copy();
+    mGeometry->Release();
+    mGeometry = copy;
+    mData.mesh = nullptr;
+}
+
+auto CFaceGroup::IsShared() const -> bool
+{
+    return mGeometry->IsShared();
+}
+
+auto CFaceGroup::GetNumVertices() const -> unsigned int
+{
+    return mGeometry->GetNumVertices();
+}
+
+auto CFaceGroup::GetNumIndices() const -> unsigned int
+{
+    return mGeometry->GetNumIndices();
+}
+
+auto CFaceGroup::GetVertices() -> VERTEX*
+{
+    Detach();
+    return mGeometry->GetVertices();
+}
+
+auto CFaceGroup::GetIndices() -> short*
+{
+    Detach();
+    return mGeometry->GetIndices();
+}
+
+auto CFaceGroup::GetVertexData() const -> const VERTEX*
+{
+    return mGeometry->GetVertices();
+}
+
+auto CFaceGroup::GetIndexData() const -> const short*
+{
+    return mGeometry->GetIndices();
+}
+
+auto CFaceGroup::GetBounds() -> D3DXVECTOR4*
+{
+    Refresh();
+    return mData.meshBounds;
+}
+
+void CFaceGroup::Draw(D3DXMATRIX* mat)
+{
+    // also picks up a mesh another face group built for the shared geometry
+    Refresh();
+
     if (mat != nullptr)
     {
         mData.usesMatrix = TRUE;
@@ -90,88 +162,58 @@ void CFaceGroup::Draw(D3DXMATRIX* mat)
     }
 }
 
-void CFaceGroup::CalculateNormals() const
+void CFaceGroup::CalculateNormals()
 {
-    if (mData.mesh == nullptr)
+    if (mGeometry->GetMesh() == nullptr)
     {
         MessageBoxA(nullptr, "Mesh is not built yet, you can not calculate normals!", "Mesh error", MB_OK);
         ENGINE->Shutdown();
         return;
     }
 
-    D3DXComputeNormals(mData.mesh, nullptr);
+    // the normals go into the device mesh, which every clone draws from
+    if (mGeometry->IsShared())
+    {
+        Detach();
+        Build();
+    }
+
+    D3DXComputeNormals(mGeometry->GetMesh(), nullptr);
 }
 
+/* Every clone of a loaded face group builds it, shared geometry that is already built is only picked up */
 void CFaceGroup::Build()
 {
-    LPDIRECT3DDEVICE9 dev = RENDERER->GetDevice();
-    void* vidMem = nullptr;
-    SAFE_RELEASE(mData.mesh);
-
-    if (mVerts.GetCount() == 0)
-    {
-        return;
-    }
-
-    if (mIndices.GetCount() == 0)
+    if (!mGeometry->IsShared() || mGeometry->NeedsBuild())
     {
-        // Small hack, populate indices from verts
-        for (unsigned int i = 0; i < mVerts.GetCount(); i++)
-        {
-            AddIndex(i);
-        }
+        mGeometry->Build();
     }
 
-    DWORD numFaces = mIndices.GetCount() / 3;
-
-    D3DXCreateMesh(numFaces,
-                   mVerts.GetCount(),
-                   D3DXMESH_MANAGED,
-                   meshVertexFormat,
-                   dev,
-                   &mData.mesh);
+    Refresh();
+}
 
-    if (mData.mesh == nullptr)
+/* Shared geometry is built once for all the face groups drawing it */
+void CFaceGroup::Refresh()
+{
+    if (mGeometry->NeedsBuild())
     {
-        MessageBoxA(nullptr, "Failed to allocate mesh!", "Renderer error", MB_OK);
-        ENGINE->Shutdown();
-        return;
+        mGeometry->Build();
     }
 
-    mData.mesh->LockVertexBuffer(0, static_cast<void**>(&vidMem));
-    memcpy(vidMem, mVerts.GetData(), mVerts.GetCount() * sizeof(VERTEX));
-
-    D3DXComputeBoundingSphere((D3DXVECTOR3*)mVerts.GetData(),
-                              mVerts.GetCount(),
-                              sizeof(VERTEX),
-                              &mData.meshOrigin,
-                              &mData.meshRadius);
-
-    D3DXComputeBoundingBox((D3DXVECTOR3*)mVerts.GetData(),
-                           mVerts.GetCount(),
-                           sizeof(VERTEX),
-                           (D3DXVECTOR3*)&mData.meshBounds[0],
-                           (D3DXVECTOR3*)&mData.meshBounds[1]
-    );
-
-    mData.mesh->UnlockVertexBuffer();
-
-    mData.mesh->LockIndexBuffer(0, static_cast<void**>(&vidMem));
-    memcpy(vidMem, mIndices.GetData(), mIndices.GetCount() * sizeof(short));
-    mData.mesh->UnlockIndexBuffer();
-
-    mIsDirty = FALSE;
+    mData.mesh = mGeometry->GetMesh();
+    mData.meshOrigin = mGeometry->GetOrigin();
+    mData.meshRadius = mGeometry->GetRadius();
+    mData.meshBounds[0] = mGeometry->GetBounds()[0];
+    mData.meshBounds[1] = mGeometry->GetBounds()[1];
 }
 
 void CFaceGroup::Clear()
 {
     ZeroMemory(&mData, sizeof(RENDERDATA));
     mData.kind = PRIMITIVEKIND_TRIANGLELIST;
-    mVerts.Release();
-    mIndices.Release();
-    SAFE_RELEASE(mData.mesh);
+    SAFE_RELEASE(mGeometry);
     SAFE_RELEASE(mData.mat);
-    mIsDirty = FALSE;
+    mGeometry = new CGeometry();
 }
 
 auto CFaceGroup::Clone() -> CFaceGroup*
@@ -180,15 +222,9 @@ auto CFaceGroup::Clone() -> CFaceGroup*
     clonedFG->SetMaterial(mData.mat);
     if (mData.mat) mData.mat->AddRef();
 
-    for (auto v : mVerts)
-    {
-        clonedFG->AddVertex(v);
-    }
-
-    for (auto i : mIndices)
-    {
-        clonedFG->AddIndex(i);
-    }
+    clonedFG->mGeometry->Release();
+    clonedFG->mGeometry = mGeometry;
+    mGeometry->AddRef();
 
     return clonedFG;
 }
@@ -5,43 +5,52 @@
 #include "ReferenceManager.h"
 
 class CMaterial;
+class CGeometry;
 
 class ENGINE_API CFaceGroup : public CReferenceCounter, CAllocable<CFaceGroup>
 {
 public:
     CFaceGroup(void);
-    CFaceGroup(const CFaceGroup&) = default;
+    CFaceGroup(const CFaceGroup&) = delete;
     ~CFaceGroup();
 
     void Release(void);
     void SetMaterial(CMaterial* tex);
     void AddVertex(const VERTEX& vertex);
     void AddIndex(short index);
+    void SetNumVertices(unsigned int count);
+    void SetNumIndices(unsigned int count);
+    void MarkDirty(void);
     void Draw(D3DXMATRIX*);
-    void CalculateNormals() const;
+    void CalculateNormals(void);
     void Build(void);
     void Clear(void);
 
+    /* Shares the geometry with the clone, whichever gets edited first copies it */
     auto Clone() -> CFaceGroup*;
 
-    auto GetNumVertices() const -> unsigned int { return mVerts.GetCount(); }
-    auto GetVertices() const -> VERTEX* { return mVerts.GetData(); }
+    /* Gives this face group its own copy of shared geometry, editing calls do it on their own */
+    void Detach(void);
+    auto IsShared() const -> bool;
 
-    auto GetNumIndices() const -> unsigned int { return mIndices.GetCount(); }
-    auto GetIndices() const -> short* { return mIndices.GetData(); }
+    auto GetNumVertices() const -> unsigned int;
+    auto GetNumIndices() const -> unsigned int;
+
+    /* For writing, detaches first */
+    auto GetVertices() -> VERTEX*;
+    auto GetIndices() -> short*;
+
+    /* For reading, leaves shared geometry alone */
+    auto GetVertexData() const -> const VERTEX*;
+    auto GetIndexData() const -> const short*;
 
     auto GetMaterial() const -> CMaterial* { return mData.mat; }
 
-    auto GetBounds() -> D3DXVECTOR4*
-    {
-        if (mData.meshBounds[0] == mData.meshBounds[1] && D3DXVec4LengthSq(&mData.meshBounds[0]) == 0.0f) Build();
-        return mData.meshBounds;
-    }
+    auto GetBounds() -> D3DXVECTOR4*;
 
 private:
     RENDERDATA mData;
+    CGeometry* mGeometry;
 
-    CArray<VERTEX> mVerts;
-    CArray<short> mIndices;
-    bool mIsDirty;
+    void Refresh(void);
 };
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 
 #include "FileSystem.h"
+#include "SaveWriter.h"
 
 #include <cstdio>
 #include <cstdlib>
@@ -9,6 +10,7 @@ CFileSystem::CFileSystem()
 {
     mGamePath = "";
     mLoadDone = FALSE;
+    mSaveWriter = new CSaveWriter();
 }
 
 auto CFileSystem::LoadGameInternal() const -> bool
@@ -136,13 +138,9 @@ auto CFileSystem::GetResource(LPCSTR resName/*=NULL*/) const -> FDATA
     return res;
 }
 
-void CFileSystem::SaveResource(LPCSTR data, UINT64 size) const
+auto CFileSystem::SaveResource(LPCSTR data, UINT64 size, bool compress) const -> DWORD
 {
-    FILE* fp = nullptr;
-    fopen_s(&fp, CString::Format("%s\\%s", mGamePath, RESOURCE_UDATA).Str(), "wb");
-
-    fwrite(data, size, 1, fp);
-    fclose(fp);
+    return mSaveWriter->Queue(CString::Format("%s\\%s", mGamePath, RESOURCE_UDATA).Str(), data, size, compress);
 }
 
 auto CFileSystem::OpenResource(LPCSTR resName /*= NULL*/) const -> FILE*
@@ -224,6 +222,9 @@ void CFileSystem::FreeResource(LPVOID data)
 
 void CFileSystem::Release()
 {
+    // pending saves still go out, they need the game path
+    SAFE_RELEASE(mSaveWriter);
+
     if (mLoadDone)
     {
         SAFE_DELETE(mGamePath);
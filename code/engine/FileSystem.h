@@ -19,6 +19,8 @@ typedef struct _iobuf
 } FILE;
 #endif
 
+class CSaveWriter;
+
 #define FILESYSTEM CEngine::the()->GetFileSystem()
 
 class ENGINE_API CFileSystem
@@ -27,7 +29,11 @@ public:
     CFileSystem(void);
     auto LoadGame(LPSTR gamePath) -> bool;
     auto GetResource(LPCSTR resName = nullptr) const -> FDATA;
-    void SaveResource(LPCSTR data, UINT64 size) const;
+
+    /* Queues the save data for the writer thread and returns its ticket */
+    auto SaveResource(LPCSTR data, UINT64 size, bool compress = FALSE) const -> DWORD;
+    auto GetSaveWriter() const -> CSaveWriter* { return mSaveWriter; }
+
     auto OpenResource(LPCSTR resName = nullptr) const -> FILE*;
     static void CloseResource(FILE* handle);
     auto ResourcePath(LPCSTR resName = nullptr) const -> LPCSTR;
@@ -40,6 +46,7 @@ public:
 private:
     LPSTR mGamePath;
     bool mLoadDone;
+    CSaveWriter* mSaveWriter;
 
     auto LoadGameInternal() const -> bool;
     static void FixName(LPCSTR* resName);
@@ -0,0 +1,159 @@
+#include "stdafx.h"
+
+#include "Geometry.h"
+
+#include "Engine.h"
+#include "Renderer.h"
+
+CGeometry::CGeometry()
+{
+    mMesh = nullptr;
+    mOrigin = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+    mRadius = 0.0f;
+    ZeroMemory(mBounds, sizeof(mBounds));
+    mIsDirty = FALSE;
+}
+
+void CGeometry::Release()
+{
+    if (DelRef())
+    {
+        mVerts.Release();
+        mIndices.Release();
+        SAFE_RELEASE(mMesh);
+        delete this;
+    }
+}
+
+auto CGeometry::Copy() const -> CGeometry*
+{
+    auto* const copy = new CGeometry();
+
+    copy->SetNumVertices(mVerts.GetCount());
+    copy->SetNumIndices(mIndices.GetCount());
+
+    if (mVerts.GetCount() > 0)
+        memcpy(copy->mVerts.GetData(), mVerts.GetData(), mVerts.GetCount() * sizeof(VERTEX));
+
+    if (mIndices.GetCount() > 0)
+        memcpy(copy->mIndices.GetData(), mIndices.GetData(), mIndices.GetCount() * sizeof(short));
+
+    copy->mOrigin = mOrigin;
+    copy->mRadius = mRadius;
+    copy->mBounds[0] = mBounds[0];
+    copy->mBounds[1] = mBounds[1];
+
+    return copy;
+}
+
+void CGeometry::AddVertex(const VERTEX& vertex)
+{
+    mIsDirty = TRUE;
+    mVerts.Push(vertex);
+}
+
+void CGeometry::AddIndex(short index)
+{
+    mIsDirty = TRUE;
+    mIndices.Push(index);
+}
+
+/* Resizes the vertex array in one allocation, new vertices are white and zeroed otherwise */
+void CGeometry::SetNumVertices(unsigned int count)
+{
+    const auto oldCount = mVerts.GetCount();
+
+    if (FAILED(mVerts.Resize(count)))
+    {
+        MessageBoxA(nullptr, "Can't resize face group vertices!", "Out of memory error", MB_OK);
+        ENGINE->Shutdown();
+        return;
+    }
+
+    for (auto i = oldCount; i < count; i++)
+    {
+        auto* const vert = mVerts.GetData() + i;
+        ZeroMemory(vert, sizeof(VERTEX));
+        vert->color = 0xFFFFFFFF;
+    }
+
+    mIsDirty = TRUE;
+}
+
+void CGeometry::SetNumIndices(unsigned int count)
+{
+    const auto oldCount = mIndices.GetCount();
+
+    if (FAILED(mIndices.Resize(count)))
+    {
+        MessageBoxA(nullptr, "Can't resize face group indices!", "Out of memory error", MB_OK);
+        ENGINE->Shutdown();
+        return;
+    }
+
+    if (count > oldCount)
+        ZeroMemory(mIndices.GetData() + oldCount, (count - oldCount) * sizeof(short));
+
+    mIsDirty = TRUE;
+}
+
+void CGeometry::Build()
+{
+    LPDIRECT3DDEVICE9 dev = RENDERER->GetDevice();
+    void* vidMem = nullptr;
+    SAFE_RELEASE(mMesh);
+
+    if (mVerts.GetCount() == 0)
+    {
+        return;
+    }
+
+    if (mIndices.GetCount() == 0)
+    {
+        // Small hack, populate indices from verts
+        for (unsigned int i = 0; i < mVerts.GetCount(); i++)
+        {
+            AddIndex(i);
+        }
+    }
+
+    DWORD numFaces = mIndices.GetCount() / 3;
+
+    D3DXCreateMesh(numFaces,
+                   mVerts.GetCount(),
+                   D3DXMESH_MANAGED,
+                   meshVertexFormat,
+                   dev,
+                   &mMesh);
+
+    if (mMesh == nullptr)
+    {
+        MessageBoxA(nullptr, "Failed to allocate mesh!", "Renderer error", MB_OK);
+        ENGINE->Shutdown();
+        return;
+    }
+
+    mMesh->LockVertexBuffer(0, static_cast<void**>(&vidMem));
+    memcpy(vidMem, mVerts.GetData(), mVerts.GetCount() * sizeof(VERTEX));
+
+    NComputeBoundingSphere((D3DXVECTOR3*)mVerts.GetData(),
+                           mVerts.GetCount(),
+                           sizeof(VERTEX),
+                           &mOrigin,
+                           &mRadius);
+
+    NComputeBoundingBox((D3DXVECTOR3*)mVerts.GetData(),
+                        mVerts.GetCount(),
+                        sizeof(VERTEX),
+                        (D3DXVECTOR3*)&mBounds[0],
+                        (D3DXVECTOR3*)&mBounds[1]
+    );
+
+    mMesh->UnlockVertexBuffer();
+
+    mMesh->LockIndexBuffer(0, static_cast<void**>(&vidMem));
+    memcpy(vidMem, mIndices.GetData(), mIndices.GetCount() * sizeof(short));
+    mMesh->UnlockIndexBuffer();
+
+    mIsDirty = FALSE;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "system.h"
+#include "RenderData.h"
+#include "ReferenceManager.h"
+
+/*
+ * Vertices, indices and the device mesh built from them. Face groups hold a
+ * reference each, so clones draw the same data instead of keeping copies in
+ * memory and on the GPU. Shared geometry must not change, a face group about
+ * to edit it makes its own copy first, see CFaceGroup::Detach.
+ */
+class CGeometry : public CReferenceCounter, CAllocable<CGeometry>
+{
+public:
+    CGeometry(void);
+    void Release(void);
+
+    /* Copies the vertices and indices, the device mesh gets built again on demand */
+    auto Copy() const -> CGeometry*;
+
+    void AddVertex(const VERTEX& vertex);
+    void AddIndex(short index);
+    void SetNumVertices(unsigned int count);
+    void SetNumIndices(unsigned int count);
+    void MarkDirty() { mIsDirty = TRUE; }
+    void Build(void);
+
+    auto IsShared() const -> bool { return GetRefCount() > 1; }
+    auto NeedsBuild() const -> bool { return mMesh == nullptr || mIsDirty; }
+
+    auto GetNumVertices() const -> unsigned int { return mVerts.GetCount(); }
+    auto GetVertices() const -> VERTEX* { return mVerts.GetData(); }
+
+    auto GetNumIndices() const -> unsigned int { return mIndices.GetCount(); }
+    auto GetIndices() const -> short* { return mIndices.GetData(); }
+
+    auto GetMesh() const -> LPD3DXMESH { return mMesh; }
+    auto GetOrigin() const -> const D3DXVECTOR3& { return mOrigin; }
+    auto GetRadius() const -> float { return mRadius; }
+    auto GetBounds() -> D3DXVECTOR4* { return mBounds; }
+
+private:
+    CArray<VERTEX> mVerts;
+    CArray<short> mIndices;
+    LPD3DXMESH mMesh;
+    D3DXVECTOR3 mOrigin;
+    float mRadius;
+    D3DXVECTOR4 mBounds[2];
+    bool mIsDirty;
+};
@@ -0,0 +1,126 @@
+#include "StdAfx.h"
+
+#include "JobPool.h"
+
+static thread_local bool sIsWorker = FALSE;
+
+CJobPool::CJobPool(unsigned int numWorkers)
+{
+    mJob = nullptr;
+    mCount = 0;
+    mGrain = 1;
+    mNext = 0;
+    mBusy = 0;
+    mBatch = 0;
+    mQuit = FALSE;
+
+    if (numWorkers == 0)
+    {
+        const auto cores = std::thread::hardware_concurrency();
+        numWorkers = cores > 1 ? cores - 1 : 0;
+    }
+
+    for (unsigned int i = 0; i < numWorkers; i++)
+    {
+        mWorkers.emplace_back(&CJobPool::Work, this);
+    }
+}
+
+void CJobPool::Release()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mQuit = TRUE;
+    }
+
+    mWake.notify_all();
+
+    for (auto& worker : mWorkers)
+    {
+        worker.join();
+    }
+
+    mWorkers.clear();
+    delete this;
+}
+
+void CJobPool::Run(unsigned int count, unsigned int grain, const JOBFN& fn)
+{
+    if (grain == 0)
+    {
+        grain = 1;
+    }
+
+    if (mWorkers.empty() || count <= grain || sIsWorker)
+    {
+        for (unsigned int first = 0; first < count; first += grain)
+        {
+            fn(first, count - first > grain ? first + grain : count);
+        }
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mJob = &fn;
+        mCount = count;
+        mGrain = grain;
+        mNext = 0;
+        mBusy = static_cast<unsigned int>(mWorkers.size());
+        mBatch++;
+    }
+
+    mWake.notify_all();
+    Drain();
+
+    std::unique_lock<std::mutex> lock(mLock);
+    mDone.wait(lock, [this] { return mBusy == 0; });
+    mJob = nullptr;
+}
+
+/* Takes chunks of the current batch until there are none left */
+void CJobPool::Drain()
+{
+    for (;;)
+    {
+        const auto first = mNext.fetch_add(mGrain);
+
+        if (first >= mCount)
+        {
+            return;
+        }
+
+        (*mJob)(first, mCount - first > mGrain ? first + mGrain : mCount);
+    }
+}
+
+void CJobPool::Work()
+{
+    UINT64 seen = 0;
+    sIsWorker = TRUE;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mWake.wait(lock, [&] { return mQuit || mBatch != seen; });
+
+            if (mQuit)
+            {
+                return;
+            }
+
+            seen = mBatch;
+        }
+
+        Drain();
+
+        std::lock_guard<std::mutex> lock(mLock);
+
+        if (--mBusy == 0)
+        {
+            mDone.notify_one();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "system.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define JOBS CEngine::the()->GetJobPool()
+
+using JOBFN = std::function<void(unsigned int first, unsigned int last)>;
+
+/*
+ * Fixed set of worker threads for data parallel work. Run splits a range of
+ * items into chunks and hands them out to the workers and the calling thread
+ * alike, returning once every chunk is done. Jobs run off the main thread, so
+ * they must not touch Lua or allocate through neon_malloc, which isn't thread
+ * safe; std containers are fine. Batches are run one at a time from the main
+ * thread, a Run from inside a job just runs inline.
+ */
+class CJobPool
+{
+public:
+    /* One worker per core besides the calling one when numWorkers is 0 */
+    CJobPool(unsigned int numWorkers = 0);
+    void Release(void);
+
+    /*
+     * Calls fn(first, last) for the chunks [first, last) of [0, count). Chunks
+     * start at multiples of grain and hold grain items except for the last.
+     */
+    void Run(unsigned int count, unsigned int grain, const JOBFN& fn);
+
+    auto GetNumWorkers() const -> unsigned int { return static_cast<unsigned int>(mWorkers.size()); }
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::mutex mLock;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+
+    const JOBFN* mJob;
+    unsigned int mCount;
+    unsigned int mGrain;
+    std::atomic<unsigned int> mNext;
+    unsigned int mBusy;     // workers that haven't finished the current batch
+    UINT64 mBatch;
+    bool mQuit;
+
+    void Work(void);
+    void Drain(void);
+};
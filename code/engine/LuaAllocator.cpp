@@ -0,0 +1,239 @@
+#include "StdAfx.h"
+
+#include "LuaAllocator.h"
+
+#include <cstdlib>
+
+#define LUAALLOC_PAGE_HEADER 16
+
+static const size_t sClassSizes[LUAALLOC_NUM_CLASSES] = {16, 32, 48, 64, 96, 128, 192, 256};
+
+/* size class by (size + 15) / 16 */
+static const int sClassLookup[LUAALLOC_MAX_BLOCK / 16 + 1] = {
+    0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7
+};
+
+CLuaAllocator::CLuaAllocator()
+{
+    ZeroMemory(mClasses, sizeof(mClasses));
+    ZeroMemory(&mLarge, sizeof(LUAALLOCSTATS));
+    mTotalBytes = 0;
+
+    for (auto i = 0; i < LUAALLOC_NUM_CLASSES; i++)
+    {
+        mClasses[i].stats.blockSize = sClassSizes[i];
+    }
+}
+
+CLuaAllocator::~CLuaAllocator()
+{
+    Release();
+}
+
+void CLuaAllocator::Release()
+{
+    for (auto& cls : mClasses)
+    {
+        auto* page = cls.pages;
+
+        while (page != nullptr)
+        {
+            auto* const next = page->next;
+            free(page);
+            page = next;
+        }
+
+        cls.pages = nullptr;
+        cls.freeList = nullptr;
+        cls.stats.used = 0;
+        cls.stats.pages = 0;
+        cls.stats.bytes = 0;
+    }
+
+    mTotalBytes = 0;
+    gMemUsedLua = 0;
+}
+
+auto CLuaAllocator::Alloc(void* ud, void* ptr, size_t osize, size_t nsize) -> void*
+{
+    auto* const self = static_cast<CLuaAllocator*>(ud);
+
+    /* for new objects osize holds the object type, not a size */
+    if (ptr == nullptr)
+    {
+        osize = 0;
+    }
+
+    const auto ocls = ptr != nullptr ? ClassOf(osize) : -1;
+
+    if (nsize == 0)
+    {
+        if (ocls >= 0)
+        {
+            self->FreeBlock(ocls, ptr);
+        }
+        else if (ptr != nullptr)
+        {
+            free(ptr);
+            self->mLarge.used--;
+            self->mLarge.bytes -= osize;
+        }
+
+        self->Track(osize, 0);
+        return nullptr;
+    }
+
+    const auto ncls = ClassOf(nsize);
+
+    /* block already fits */
+    if (ptr != nullptr && ncls >= 0 && ocls == ncls)
+    {
+        self->Track(osize, nsize);
+        return ptr;
+    }
+
+    /* large to large */
+    if (ncls < 0 && (ptr == nullptr || ocls < 0))
+    {
+        auto* const block = realloc(ptr, nsize);
+
+        if (block == nullptr)
+        {
+            return nullptr;
+        }
+
+        if (ptr == nullptr)
+        {
+            self->mLarge.used++;
+            self->mLarge.peak = self->mLarge.used > self->mLarge.peak ? self->mLarge.used : self->mLarge.peak;
+        }
+
+        self->mLarge.allocs++;
+        self->mLarge.bytes += nsize - osize;
+        self->Track(osize, nsize);
+        return block;
+    }
+
+    /* moving between a pool and the heap, or between two pools */
+    void* block = nullptr;
+
+    if (ncls >= 0)
+    {
+        block = self->AllocBlock(ncls);
+    }
+    else
+    {
+        block = malloc(nsize);
+
+        if (block != nullptr)
+        {
+            self->mLarge.used++;
+            self->mLarge.peak = self->mLarge.used > self->mLarge.peak ? self->mLarge.used : self->mLarge.peak;
+            self->mLarge.allocs++;
+            self->mLarge.bytes += nsize;
+        }
+    }
+
+    if (block == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (ptr != nullptr)
+    {
+        memcpy(block, ptr, osize < nsize ? osize : nsize);
+
+        if (ocls >= 0)
+        {
+            self->FreeBlock(ocls, ptr);
+        }
+        else
+        {
+            free(ptr);
+            self->mLarge.used--;
+            self->mLarge.bytes -= osize;
+        }
+    }
+
+    self->Track(osize, nsize);
+    return block;
+}
+
+auto CLuaAllocator::ClassOf(size_t size) -> int
+{
+    if (size == 0 || size > LUAALLOC_MAX_BLOCK)
+    {
+        return -1;
+    }
+
+    return sClassLookup[(size + 15) >> 4];
+}
+
+auto CLuaAllocator::AllocBlock(int cls) -> void*
+{
+    auto& sizeClass = mClasses[cls];
+
+    if (sizeClass.freeList == nullptr && !GrowClass(cls))
+    {
+        return nullptr;
+    }
+
+    auto* const block = sizeClass.freeList;
+    sizeClass.freeList = block->next;
+
+    auto& stats = sizeClass.stats;
+    stats.used++;
+    stats.peak = stats.used > stats.peak ? stats.used : stats.peak;
+    stats.allocs++;
+    stats.bytes += stats.blockSize;
+
+    return block;
+}
+
+void CLuaAllocator::FreeBlock(int cls, void* ptr)
+{
+    auto& sizeClass = mClasses[cls];
+    auto* const block = static_cast<FREEBLOCK*>(ptr);
+
+    block->next = sizeClass.freeList;
+    sizeClass.freeList = block;
+
+    sizeClass.stats.used--;
+    sizeClass.stats.bytes -= sizeClass.stats.blockSize;
+}
+
+auto CLuaAllocator::GrowClass(int cls) -> bool
+{
+    auto& sizeClass = mClasses[cls];
+    auto* const page = static_cast<POOLPAGE*>(malloc(LUAALLOC_PAGE_SIZE));
+
+    if (page == nullptr)
+    {
+        return FALSE;
+    }
+
+    page->next = sizeClass.pages;
+    sizeClass.pages = page;
+    sizeClass.stats.pages++;
+
+    const auto blockSize = sizeClass.stats.blockSize;
+    const auto numBlocks = (LUAALLOC_PAGE_SIZE - LUAALLOC_PAGE_HEADER) / blockSize;
+    auto* const base = reinterpret_cast<UCHAR*>(page) + LUAALLOC_PAGE_HEADER;
+
+    /* thread the blocks in address order */
+    for (auto i = numBlocks; i > 0; i--)
+    {
+        auto* const block = reinterpret_cast<FREEBLOCK*>(base + (i - 1) * blockSize);
+        block->next = sizeClass.freeList;
+        sizeClass.freeList = block;
+    }
+
+    return TRUE;
+}
+
+void CLuaAllocator::Track(size_t osize, size_t nsize)
+{
+    mTotalBytes += nsize;
+    mTotalBytes -= osize;
+    gMemUsedLua = mTotalBytes;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "system.h"
+
+#define LUAALLOC_PAGE_SIZE (64 * 1024)
+#define LUAALLOC_NUM_CLASSES 8
+#define LUAALLOC_MAX_BLOCK 256
+
+struct LUAALLOCSTATS
+{
+    size_t blockSize;
+    size_t used;
+    size_t peak;
+    size_t pages;
+    UINT64 bytes;
+    UINT64 allocs;
+};
+
+/*
+ * Allocator handed to lua_newstate. Blocks up to LUAALLOC_MAX_BLOCK bytes are
+ * served from per-size-class free lists carved out of fixed pages, larger ones
+ * fall back to realloc. Each Lua state owns its allocator and is only touched
+ * from the thread running the VM, so no locking is needed.
+ */
+class ENGINE_API CLuaAllocator: NoCopyAssign
+{
+public:
+    CLuaAllocator(void);
+    ~CLuaAllocator(void);
+    void Release(void);
+
+    static auto Alloc(void* ud, void* ptr, size_t osize, size_t nsize) -> void*;
+
+    auto GetClassStats(unsigned int idx) const -> LUAALLOCSTATS { return mClasses[idx].stats; }
+    auto GetLargeStats() const -> LUAALLOCSTATS { return mLarge; }
+    auto GetTotalBytes() const -> UINT64 { return mTotalBytes; }
+
+private:
+    struct FREEBLOCK
+    {
+        FREEBLOCK* next;
+    };
+
+    struct POOLPAGE
+    {
+        POOLPAGE* next;
+    };
+
+    struct SIZECLASS
+    {
+        FREEBLOCK* freeList;
+        POOLPAGE* pages;
+        LUAALLOCSTATS stats;
+    };
+
+    SIZECLASS mClasses[LUAALLOC_NUM_CLASSES];
+    LUAALLOCSTATS mLarge;
+    UINT64 mTotalBytes;
+
+    static auto ClassOf(size_t size) -> int;
+    auto AllocBlock(int cls) -> void*;
+    void FreeBlock(int cls, void* ptr);
+    auto GrowClass(int cls) -> bool;
+    void Track(size_t osize, size_t nsize);
+};
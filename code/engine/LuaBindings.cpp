@@ -14,78 +14,104 @@
 #include "RenderTarget.h"
 #include "Music.h"
 #include "Node.h"
+#include "CollisionWorld.h"
+#include "EntityWorld.h"
+#include "TweenLayer.h"
+#include "ScriptCache.h"
+#include "ResourceCache.h"
+#include "JobPool.h"
+#include "TaskScheduler.h"
+#include "Snapshot.h"
+#include "Serializer.h"
+#include "SaveWriter.h"
+#include "CallbackMonitor.h"
+#include "Preloader.h"
 
 #include <lua/lua.hpp>
 
 #include "LuaWrapper.h"
 
-auto luaH_getcomps(lua_State* L, unsigned int offset) -> D3DXVECTOR4
+/*
+ * The luaH_get* helpers read a value that can be passed in several forms,
+ * either as a single Vector or as loose numbers, starting at idx. When next is
+ * given it receives the index of the first argument after the value.
+ */
+auto luaH_getcomps(lua_State* L, int idx, int* next) -> D3DXVECTOR4
 {
-    if (luaL_testudata(L, 2 + offset, L_VECTOR))
+    if (luaH_testudata(L, idx, LC_VECTOR))
     {
-        return *static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 2 + offset, L_VECTOR));
+        if (next)
+            *next = idx + 1;
+
+        return *static_cast<D3DXVECTOR4*>(luaH_checkudata(L, idx, LC_VECTOR));
     }
 
-    const auto x = static_cast<float>(lua_tonumber(L, 2 + offset));
-    auto y = static_cast<float>(lua_tonumber(L, 3 + offset));
-    auto z = static_cast<float>(lua_tonumber(L, 4 + offset));
-    auto w = static_cast<float>(lua_tonumber(L, 5 + offset));
+    const auto x = static_cast<float>(lua_tonumber(L, idx));
+    auto y = static_cast<float>(lua_tonumber(L, idx + 1));
+    auto z = static_cast<float>(lua_tonumber(L, idx + 2));
+    auto w = static_cast<float>(lua_tonumber(L, idx + 3));
+    const auto count = lua_gettop(L) - idx + 1;
 
-    if (lua_gettop(L) == 2 + offset)
+    if (count == 1)
         w = y = z = x;
 
-    if (lua_gettop(L) == 3 + offset)
+    if (count == 2)
         w = z = x;
 
-    if (lua_gettop(L) == 4 + offset)
+    if (count == 3)
         w = 0;
 
+    if (next)
+        *next = idx + (count < 0 ? 0 : (count > 4 ? 4 : count));
+
     return {x, y, z, w};
 }
 
-auto luaH_getcolor(lua_State* L) -> DWORD
+auto luaH_getcolor(lua_State* L, int idx, int* next) -> DWORD
 {
     DWORD color = 0x0;
+    const auto count = lua_gettop(L) - idx + 1;
+    auto used = 0;
 
-    if (LuaTestClass(L, L_VECTOR))
+    if (LuaIs<D3DXVECTOR4>(L, idx))
     {
-        const auto vec = LuaGetInline<D3DXVECTOR4>(L);
+        const auto vec = LuaCheck<D3DXVECTOR4>(L, idx);
         BYTE col[4] = {
             static_cast<BYTE>(vec.w * 0xFF), static_cast<BYTE>(vec.x * 0xFF), static_cast<BYTE>(vec.y * 0xFF),
             static_cast<BYTE>(vec.z * 0xFF)
         };
         color = D3DCOLOR_ARGB(col[0], col[1], col[2], col[3]);
+        used = 1;
     }
-    else if (LuaLength(L) == 1)
+    else if (count == 1)
     {
-        color = LuaGetInline<DWORD>(L);
+        color = LuaCheck<DWORD>(L, idx);
+        used = 1;
     }
-    else if (LuaLength(L) >= 3)
+    else if (count >= 3)
     {
-        unsigned int r = 0;
-        unsigned int g = 0;
-        unsigned int b = 0;
-
-        r = LuaGetInline<uint32_t>(L);
-        g = LuaGetInline<uint32_t>(L);
-        b = LuaGetInline<uint32_t>(L);
+        const auto [r, g, b] = LuaArgs<uint32_t, uint32_t, uint32_t>(L, idx).Read();
         color = D3DCOLOR_ARGB(255, r, g, b);
+        used = 3;
     }
 
+    if (next)
+        *next = idx + used;
+
     return color;
 }
 
-auto luaH_getcolorlinear(lua_State* L, unsigned int offset) -> D3DCOLORVALUE
+auto luaH_getcolorlinear(lua_State* L, int idx) -> D3DCOLORVALUE
 {
     D3DCOLORVALUE color = {0.0F, 0.0F, 0.0F, 1.0F};
 
-    if (luaL_testudata(L, 1 + offset, L_VECTOR))
+    if (luaH_testudata(L, idx, LC_VECTOR))
     {
-        color = *static_cast<D3DCOLORVALUE*>(luaL_checkudata(L, 1 + offset, L_VECTOR));
+        color = *static_cast<D3DCOLORVALUE*>(luaH_checkudata(L, idx, LC_VECTOR));
     }
-    else if (static_cast<unsigned int>(lua_gettop(L)) == 1 + offset)
+    else if (lua_gettop(L) == idx)
     {
-        const auto encodedColor = static_cast<DWORD>(luaL_checkinteger(L, 1 + offset));
+        const auto encodedColor = static_cast<DWORD>(luaL_checkinteger(L, idx));
         BYTE r;
         BYTE g;
         BYTE b;
@@ -110,18 +136,16 @@ auto luaH_getcolorlinear(lua_State* L, unsigned int offset) -> D3DCOLORVALUE
             static_cast<float>(a) / 0xFF
         };
     }
-    else if (static_cast<unsigned int>(lua_gettop(L)) == 3 + offset)
+    else if (lua_gettop(L) == idx + 2)
     {
         unsigned int r = 0;
         unsigned int g = 0;
         unsigned int b = 0;
 
-        r = static_cast<unsigned int>(luaL_checknumber(L, 1 + offset));
-        g = static_cast<unsigned int>(luaL_checknumber(L, 2 + offset));
-        b = static_cast<unsigned int>(luaL_checknumber(L, 3 + offset));
+        r = static_cast<unsigned int>(luaL_checknumber(L, idx));
+        g = static_cast<unsigned int>(luaL_checknumber(L, idx + 1));
+        b = static_cast<unsigned int>(luaL_checknumber(L, idx + 2));
         color = {static_cast<float>(r) / 0xFF, static_cast<float>(g) / 0xFF, static_cast<float>(b) / 0xFF, 1.0F};
-        lua_remove(L, 2 + offset);
-        lua_remove(L, 2 + offset);
     }
 
     return color;
@@ -130,6 +154,7 @@ auto luaH_getcolorlinear(lua_State* L, unsigned int offset) -> D3DCOLORVALUE
 #include "LuaMatrix.h"
 #include "LuaVector4.h"
 #include "LuaVertex.h"
+#include "LuaBuffer.h"
 #include "LuaMaterial.h"
 #include "LuaLight.h"
 #include "LuaFaceGroup.h"
@@ -141,19 +166,22 @@ auto luaH_getcolorlinear(lua_State* L, unsigned int offset) -> D3DCOLORVALUE
 #include "LuaFont.h"
 #include "LuaSound.h"
 #include "LuaMusic.h"
+#include "LuaCollisionMesh.h"
+#include "LuaCollisionWorld.h"
+#include "LuaEntityWorld.h"
+#include "LuaTweenLayer.h"
 
 /// BASE METHODS
 LUAF(Base, ShowMessage)
 {
-    const auto* const caption = LuaGetInline<LPCSTR>(L);
-    const auto* const text  = LuaGetInline<LPCSTR>(L);
+    const auto [caption, text] = LuaArgs<LPCSTR, LPCSTR>(L).Read();
     MessageBoxA(nullptr, text , caption, MB_OK);
     return 0;
 }
 
 LUAF(Base, LogString)
 {
-    const auto* const msg = LuaGetInline<LPCSTR>(L);
+    const auto* const msg = LuaCheck<LPCSTR>(L, 1);
     PushLog(CString::Format("%s\n", msg).Str());
     return 0;
 }
@@ -182,7 +210,7 @@ LUAF(Base, IsDebugMode)
 
 LUAF(Base, SetFPS)
 {
-    const auto fps = LuaGetInline<float>(L);
+    const auto fps = LuaCheck<float>(L, 1);
     ENGINE->SetFPS(fps);
 
     return 0;
@@ -190,7 +218,7 @@ LUAF(Base, SetFPS)
 
 LUAF(Base, dofile)
 {
-    const auto* const scriptName = LuaGetInline<LPCSTR>(L);
+    const auto* const scriptName = LuaCheck<LPCSTR>(L, 1);
     const auto fd = FILESYSTEM->GetResource((LPSTR)scriptName);
 
     if (fd.data == nullptr)
@@ -199,7 +227,14 @@ LUAF(Base, dofile)
         return 0;
     }
 
-    const int res = luaL_dostring(L, static_cast<char*>(fd.data));
+    const auto chunkName = CString::Format("@%s", scriptName);
+    auto res = CScriptCache::LoadBuffer(L, static_cast<LPCSTR>(fd.data), fd.size, chunkName.Str());
+
+    if (res == LUA_OK)
+    {
+        res = lua_pcall(L, 0, LUA_MULTRET, 0);
+    }
+
     VM->CheckVMErrors(res);
     FILESYSTEM->FreeResource(fd.data);
 
@@ -208,7 +243,7 @@ LUAF(Base, dofile)
 
 LUAF(Base, loadfile)
 {
-    const auto* const scriptName = LuaGetInline<LPCSTR>(L);
+    const auto* const scriptName = LuaCheck<LPCSTR>(L, 1);
     const auto fd = FILESYSTEM->GetResource((LPSTR)scriptName);
 
     if (fd.data == nullptr)
@@ -223,21 +258,54 @@ LUAF(Base, loadfile)
     return 1;
 }
 
+/*
+ * SaveState(data[, compress]) hands the data to the save writer thread and
+ * returns a ticket right away. IsSaveDone(ticket) tells whether it's on the
+ * disk yet, returning nil and the error if the write failed. FlushSaves()
+ * blocks until everything queued is written.
+ */
 LUAF(Base, SaveState)
 {
-    const auto* const data = LuaGetInline<LPCSTR>(L);
-    auto len = strlen(data);
+    // Serialize output holds zero bytes, so the length comes from Lua
+    size_t len;
+    const auto* const data = luaL_checklstring(L, 1, &len);
+    const auto compress = lua_toboolean(L, 2) != 0;
 
-    const LPCSTR out = b64_encode((unsigned char*)data, len);
-    len = strlen(out);
+    lua_pushinteger(L, FILESYSTEM->SaveResource(data, len, compress));
+    return 1;
+}
+
+LUAF(Base, IsSaveDone)
+{
+    const auto ticket = static_cast<DWORD>(luaL_checkinteger(L, 1));
+    std::string error;
+
+    switch (FILESYSTEM->GetSaveWriter()->GetStatus(ticket, &error))
+    {
+    case SAVESTATUS_PENDING:
+        lua_pushboolean(L, FALSE);
+        return 1;
+    case SAVESTATUS_DONE:
+        lua_pushboolean(L, TRUE);
+        return 1;
+    default:
+        lua_pushnil(L);
+        lua_pushlstring(L, error.data(), error.size());
+        return 2;
+    }
+}
 
-    FILESYSTEM->SaveResource(out, len);
-    neon_free((LPVOID)out);
+LUAF(Base, FlushSaves)
+{
+    FILESYSTEM->GetSaveWriter()->Flush();
     return 0;
 }
 
 LUAF(Base, LoadState)
 {
+    // saves still in the queue would be missed otherwise
+    FILESYSTEM->GetSaveWriter()->Flush();
+
     const auto f = FILESYSTEM->GetResource(RESOURCE_UDATA);
 
     if (f.data == nullptr)
@@ -246,18 +314,52 @@ LUAF(Base, LoadState)
         return 1;
     }
 
-    const auto* const out = static_cast<LPCSTR>(neon_malloc(f.size + 1));
-    ZeroMemory((LPVOID)out, f.size+1);
+    std::string data;
+    const auto ok = CSaveWriter::Unpack(static_cast<const char*>(f.data), f.size, &data);
+    FILESYSTEM->FreeResource(f.data);
 
-    if (b64_decode(static_cast<const char*>(f.data), (unsigned char*)out, f.size) == 0)
+    if (!ok)
     {
-        neon_free((LPVOID)out);
         lua_pushnil(L);
         return 1;
     }
 
-    lua_pushstring(L, out);
-    neon_free((LPVOID)out);
+    lua_pushlstring(L, data.data(), data.size());
+    return 1;
+}
+
+/*
+ * Serialize(value[, withFunctions]) encodes plain Lua data into a binary
+ * string, Deserialize(data[, withFunctions]) turns it back into the value or
+ * returns nil and the error. Functions are only stored and loaded when asked
+ * for, loading them from untrusted data isn't safe.
+ */
+LUAF(Base, Serialize)
+{
+    luaL_checkany(L, 1);
+    auto* const serializer = VM->GetSerializer();
+
+    if (!serializer->Encode(L, 1, lua_toboolean(L, 2) != 0))
+    {
+        return lua_error(L);
+    }
+
+    lua_pushlstring(L, serializer->GetData(), serializer->GetSize());
+    return 1;
+}
+
+LUAF(Base, Deserialize)
+{
+    size_t len;
+    const auto* const data = luaL_checklstring(L, 1, &len);
+
+    if (!VM->GetSerializer()->Decode(L, data, len, lua_toboolean(L, 2) != 0))
+    {
+        lua_pushnil(L);
+        lua_insert(L, -2);
+        return 2;
+    }
+
     return 1;
 }
 
@@ -267,6 +369,259 @@ LUAF(Base, getTime)
     return 1;
 }
 
+LUAF(Base, SetGCMode)
+{
+    const LuaArgs<DWORD> args(L);
+    VM->SetGCMode(static_cast<UCHAR>(args.Get<0>()));
+
+    if (args.Extra() > 0)
+    {
+        VM->SetGCBudget(LuaCheck<float>(L, args.Index(0)));
+    }
+
+    return 0;
+}
+
+LUAF(Base, SetGCBudget)
+{
+    // the step size is optional, a missing one reads as 0
+    const auto [ms, stepSize] = LuaArgs<float, int>(L).Read();
+
+    VM->SetGCBudget(ms, stepSize);
+    return 0;
+}
+
+LUAF(Base, GetGCStats)
+{
+    const auto gc = VM->GetGCStats();
+    lua_newtable(L);
+
+    lua_pushinteger(L, gc.kind);
+    lua_setfield(L, -2, "mode");
+    lua_pushnumber(L, gc.pauseTime);
+    lua_setfield(L, -2, "pause");
+    lua_pushinteger(L, gc.bytesFreed);
+    lua_setfield(L, -2, "freed");
+    lua_pushinteger(L, static_cast<lua_Integer>(gc.liveBytes));
+    lua_setfield(L, -2, "live");
+    lua_pushinteger(L, gc.steps);
+    lua_setfield(L, -2, "steps");
+    lua_pushinteger(L, gc.cycles);
+    lua_setfield(L, -2, "cycles");
+
+    return 1;
+}
+
+/*
+ * SetCallbackBudget(ms[, abortMs[, instructions]]) holds _update, _render and
+ * the other per-frame callbacks to a budget. Going over ms logs the traceback,
+ * going over abortMs or the instruction count stops the callback with an
+ * error. 0 turns a limit off.
+ */
+LUAF(Base, SetCallbackBudget)
+{
+    const auto [ms, abortMs] = LuaArgs<float, float>(L).Read();
+    const auto instructions = luaL_optinteger(L, 3, 0);
+
+    VM->SetCallbackBudget(ms, abortMs, instructions > 0 ? static_cast<UINT64>(instructions) : 0);
+    return 0;
+}
+
+LUAF(Base, GetCallbackStats)
+{
+    VM->GetCallbackMonitor()->PushStats(L);
+    return 1;
+}
+
+LUAF(Base, ResetCallbackStats)
+{
+    VM->GetCallbackMonitor()->ResetStats();
+    return 0;
+}
+
+/*
+ * Preload{ {"model", path[, loadMaterials[, optimize]]}, {"material", path},
+ * {"sound", path}, {"music", path}, {"effect", path[, debug]}, ... } loads the
+ * listed assets at once, decoding them in parallel. The constructors called
+ * with the same arguments afterwards get the preloaded instances. Returns the
+ * number of assets loaded and the paths of the ones that failed.
+ */
+LUAF(Base, Preload)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    const auto numEntries = static_cast<int>(lua_rawlen(L, 1));
+    auto badEntry = 0;
+    unsigned int count = 0;
+    std::vector<std::string> failed;
+
+    // errors are raised once the preloader is gone, longjmp would skip its destructor
+    {
+        CPreloader preloader;
+
+        for (auto i = 1; i <= numEntries && !badEntry; i++)
+        {
+            lua_rawgeti(L, 1, i);
+
+            if (!lua_istable(L, -1))
+            {
+                badEntry = i;
+                lua_pop(L, 1);
+                break;
+            }
+
+            lua_rawgeti(L, -1, 1);
+            lua_rawgeti(L, -2, 2);
+            lua_rawgeti(L, -3, 3);
+            lua_rawgeti(L, -4, 4);
+
+            const auto* const kind = lua_tostring(L, -4);
+            const auto* const path = lua_tostring(L, -3);
+
+            // models load their materials unless told otherwise
+            const auto flag0 = lua_isnil(L, -2) ? kind != nullptr && !strcmp(kind, "model") : lua_toboolean(L, -2) != 0;
+            const auto flag1 = lua_toboolean(L, -1) != 0;
+
+            if (kind == nullptr || path == nullptr || !preloader.Add(kind, path, flag0, flag1))
+            {
+                badEntry = i;
+            }
+
+            lua_pop(L, 5);
+        }
+
+        if (!badEntry)
+        {
+            count = preloader.Run();
+            failed = preloader.GetFailed();
+        }
+    }
+
+    if (badEntry)
+    {
+        return luaL_error(L, "Preload: entry %d must be {kind, path, ...} with kind model, material, sound, music or effect", badEntry);
+    }
+
+    lua_pushinteger(L, count);
+    lua_createtable(L, static_cast<int>(failed.size()), 0);
+
+    for (size_t i = 0; i < failed.size(); i++)
+    {
+        lua_pushlstring(L, failed[i].data(), failed[i].size());
+        lua_rawseti(L, -2, static_cast<lua_Integer>(i + 1));
+    }
+
+    return 2;
+}
+
+static auto luaH_taskyield(lua_State* L, UCHAR kind) -> int
+{
+    if (!VM->GetScheduler()->IsTask(L))
+        return luaL_error(L, "waiting is only allowed inside a task created by spawn");
+
+    lua_pushlightuserdata(L, &CTaskScheduler::sYieldKey);
+    lua_pushinteger(L, kind);
+    lua_pushvalue(L, 1);
+    return lua_yield(L, 3);
+}
+
+LUAF(Base, spawn)
+{
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+    const auto id = VM->GetScheduler()->Spawn(L, lua_gettop(L) - 1);
+    lua_pushinteger(L, id);
+    return 1;
+}
+
+LUAF(Base, wait)
+{
+    luaL_checknumber(L, 1);
+    return luaH_taskyield(L, TASKWAIT_TIME);
+}
+
+LUAF(Base, waitFrames)
+{
+    if (lua_gettop(L) == 0)
+        lua_pushinteger(L, 1);
+
+    luaL_checkinteger(L, 1);
+    return luaH_taskyield(L, TASKWAIT_FRAMES);
+}
+
+LUAF(Base, waitEvent)
+{
+    luaL_checkstring(L, 1);
+    return luaH_taskyield(L, TASKWAIT_EVENT);
+}
+
+LUAF(Base, signal)
+{
+    const auto* const name = luaL_checkstring(L, 1);
+    const auto woken = VM->GetScheduler()->Signal(L, name, lua_gettop(L) - 1);
+    lua_pushinteger(L, woken);
+    return 1;
+}
+
+LUAF(Base, cancel)
+{
+    const auto id = LuaCheck<DWORD>(L, 1);
+    VM->GetScheduler()->Cancel(id);
+    return 0;
+}
+
+LUAF(Base, isTaskAlive)
+{
+    const auto id = LuaCheck<DWORD>(L, 1);
+    lua_pushboolean(L, VM->GetScheduler()->IsAlive(id));
+    return 1;
+}
+
+LUAF(Base, SaveSnapshot)
+{
+    const auto isState = lua_isnoneornil(L, 1);
+
+    if (isState && VM->GetScheduler()->IsTask(L))
+    {
+        return luaL_error(L, "the whole VM can't be snapshotted from inside a task");
+    }
+
+    if (!VM->SaveSnapshot(L, isState ? 0 : 1))
+    {
+        return lua_error(L);
+    }
+
+    const auto* const snapshot = VM->GetSnapshot();
+    lua_pushinteger(L, static_cast<lua_Integer>(snapshot->GetSize()));
+    lua_pushnumber(L, snapshot->GetSaveTime());
+    return 2;
+}
+
+LUAF(Base, LoadSnapshot)
+{
+    const auto* const snapshot = VM->GetSnapshot();
+
+    if (snapshot == nullptr || snapshot->IsEmpty())
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    // Whole-state snapshots replace the VM on the next frame
+    if (snapshot->IsState())
+    {
+        VM->ResumeSnapshot();
+        lua_pushboolean(L, TRUE);
+        return 1;
+    }
+
+    if (!VM->LoadSnapshot(L))
+    {
+        return lua_error(L);
+    }
+
+    return 1;
+}
+
 ///<END
 
 void CLuaBindings::BindBase(lua_State* L)
@@ -281,8 +636,35 @@ void CLuaBindings::BindBase(lua_State* L)
     REGF(Base, loadfile);
     REGF(Base, SaveState);
     REGF(Base, LoadState);
+    REGF(Base, IsSaveDone);
+    REGF(Base, FlushSaves);
+    REGF(Base, Serialize);
+    REGF(Base, Deserialize);
     REGF(Base, getTime);
     REGFN(Base, "GetTime", getTime);
+    REGF(Base, SetGCMode);
+    REGF(Base, SetGCBudget);
+    REGF(Base, GetGCStats);
+    REGF(Base, SetCallbackBudget);
+    REGF(Base, GetCallbackStats);
+    REGF(Base, ResetCallbackStats);
+    REGF(Base, Preload);
+    REGF(Base, spawn);
+    REGF(Base, wait);
+    REGF(Base, waitFrames);
+    REGF(Base, waitEvent);
+    REGF(Base, signal);
+    REGF(Base, cancel);
+    REGF(Base, isTaskAlive);
+    REGF(Base, SaveSnapshot);
+    REGF(Base, LoadSnapshot);
+
+    // enums
+    {
+        REGE(GCKIND_AUTO);
+        REGE(GCKIND_INCREMENTAL);
+        REGE(GCKIND_GENERATIONAL);
+    }
 }
 
 void CLuaBindings::BindAudio(lua_State* L)
@@ -294,14 +676,13 @@ void CLuaBindings::BindAudio(lua_State* L)
 /// MATH METHODS
 LUAF(Math, Color)
 {
-    const auto r = LuaGetInline<uint32_t>(L);
-    const auto g = LuaGetInline<uint32_t>(L);
-    const auto b = LuaGetInline<uint32_t>(L);
+    const LuaArgs<uint32_t, uint32_t, uint32_t> args(L);
+    const auto [r, g, b] = args.Read();
     unsigned int a = 0xFF;
 
-    if (lua_gettop(L) >= 1)
+    if (args.Extra() >= 1)
     {
-        a = LuaGetInline<uint32_t>(L);
+        a = LuaCheck<uint32_t>(L, args.Index(0));
     }
 
     lua_pushnumber(L, D3DCOLOR_ARGB(a, r, g, b));
@@ -310,14 +691,15 @@ LUAF(Math, Color)
 
 LUAF(Math, ColorLinear)
 {
-    const float r = LuaGetInline<float>(L) / static_cast<float>(0xFF);
-    const float g = LuaGetInline<float>(L) / static_cast<float>(0xFF);
-    const float b = LuaGetInline<float>(L) / static_cast<float>(0xFF);
+    const LuaArgs<float, float, float> args(L);
+    const float r = args.Get<0>() / static_cast<float>(0xFF);
+    const float g = args.Get<1>() / static_cast<float>(0xFF);
+    const float b = args.Get<2>() / static_cast<float>(0xFF);
     float a = 0xFF;
 
-    if (lua_gettop(L) >= 1)
+    if (args.Extra() >= 1)
     {
-        a = LuaGetInline<float>(L) / static_cast<float>(0xFF);
+        a = LuaCheck<float>(L, args.Index(0)) / static_cast<float>(0xFF);
     }
 
     lua_pushnumber(L, r);
@@ -329,9 +711,7 @@ LUAF(Math, ColorLinear)
 
 LUAF(Math, WorldToScreen)
 {
-    auto pos3D = LuaGetInline<D3DXVECTOR3>(L);
-    auto view = LuaGetInline<D3DXMATRIX>(L);
-    auto proj = LuaGetInline<D3DXMATRIX>(L);
+    auto [pos3D, view, proj] = LuaArgs<D3DXVECTOR3, D3DXMATRIX, D3DXMATRIX>(L).Read();
     D3DXMATRIX world;
     D3DXMatrixIdentity(&world);
 
@@ -345,9 +725,7 @@ LUAF(Math, WorldToScreen)
 
 LUAF(Math, ScreenToWorld)
 {
-    auto pos2D = LuaGetInline<D3DXVECTOR3>(L);
-    auto view = LuaGetInline<D3DXMATRIX>(L);
-    auto proj = LuaGetInline<D3DXMATRIX>(L);
+    auto [pos2D, view, proj] = LuaArgs<D3DXVECTOR3, D3DXMATRIX, D3DXMATRIX>(L).Read();
     D3DXMATRIX world;
     D3DXMatrixIdentity(&world);
 
@@ -381,20 +759,23 @@ LUAF(Rend, ClearScene)
 
 LUAF(Rend, CameraPerspective)
 {
-    const auto fov = LuaGetInline<float>(L);
+    const LuaArgs<float> args(L);
+    const auto fov = args.Get<0>();
     float zNear = 0.1f;
     float zFar = 1000.0f;
     bool flipHandedness = FALSE;
+    auto next = 0;
 
-    if (LuaLength(L) >= 1)
+    if (args.Extra() >= 1)
     {
-        zNear = LuaGetInline<float>(L);
-        zFar = LuaGetInline<float>(L);
+        zNear = LuaCheck<float>(L, args.Index(0));
+        zFar = LuaCheck<float>(L, args.Index(1));
+        next = 2;
     }
 
-    if (LuaLength(L) >= 1)
+    if (args.Extra() > next)
     {
-        flipHandedness = LuaGetInline<bool>(L);
+        flipHandedness = LuaCheck<bool>(L, args.Index(next));
     }
 
     D3DXMATRIX matProjection;
@@ -402,19 +783,19 @@ LUAF(Rend, CameraPerspective)
 
     if (flipHandedness)
     {
-        D3DXMatrixPerspectiveFovRH(&matProjection,
-                                   D3DXToRadian(fov),
-                                   static_cast<float>(res.right) / static_cast<float>(res.bottom),
-                                   zNear,
-                                   zFar);
+        NMatrixPerspectiveFovRH(&matProjection,
+                                NToRadian(fov),
+                                static_cast<float>(res.right) / static_cast<float>(res.bottom),
+                                zNear,
+                                zFar);
     }
     else
     {
-        D3DXMatrixPerspectiveFovLH(&matProjection,
-                                   D3DXToRadian(fov),
-                                   static_cast<float>(res.right) / static_cast<float>(res.bottom),
-                                   zNear,
-                                   zFar);
+        NMatrixPerspectiveFovLH(&matProjection,
+                                NToRadian(fov),
+                                static_cast<float>(res.right) / static_cast<float>(res.bottom),
+                                zNear,
+                                zFar);
     }
 
     RENDERER->SetMatrix(MATRIXKIND_PROJECTION, matProjection);
@@ -428,45 +809,49 @@ LUAF(Rend, CameraOrthographic)
     auto w = static_cast<float>(res.right);
     auto h = static_cast<float>(res.bottom);
     bool flipHandedness = FALSE;
+    const auto count = lua_gettop(L);
+    auto next = 1;
 
-    if (LuaLength(L) >= 2)
+    if (count - next + 1 >= 2)
     {
-        w = LuaGetInline<float>(L) * (static_cast<float>(res.right) / static_cast<float>(res.bottom)
+        w = LuaCheck<float>(L, next) * (static_cast<float>(res.right) / static_cast<float>(res.bottom)
         );
-        h = LuaGetInline<float>(L);
+        h = LuaCheck<float>(L, next + 1);
+        next += 2;
     }
 
     float zNear = 0.01f;
     float zFar = 100.0f;
 
-    if (LuaLength(L) >= 2)
+    if (count - next + 1 >= 2)
     {
-        zNear = LuaGetInline<float>(L);
-        zFar = LuaGetInline<float>(L);
+        zNear = LuaCheck<float>(L, next);
+        zFar = LuaCheck<float>(L, next + 1);
+        next += 2;
     }
 
-    if (LuaLength(L) >= 1)
+    if (count - next + 1 >= 1)
     {
-        flipHandedness = LuaGetInline<bool>(L);
+        flipHandedness = LuaCheck<bool>(L, next);
     }
 
     D3DXMATRIX matProjection;
 
     if (flipHandedness)
     {
-        D3DXMatrixOrthoRH(&matProjection,
-                          w,
-                          h,
-                          zNear,
-                          zFar);
+        NMatrixOrthoRH(&matProjection,
+                       w,
+                       h,
+                       zNear,
+                       zFar);
     }
     else
     {
-        D3DXMatrixOrthoLH(&matProjection,
-                          w,
-                          h,
-                          zNear,
-                          zFar);
+        NMatrixOrthoLH(&matProjection,
+                       w,
+                       h,
+                       zNear,
+                       zFar);
     }
 
     RENDERER->SetMatrix(MATRIXKIND_PROJECTION, matProjection);
@@ -482,44 +867,44 @@ LUAF(Rend, CameraOrthographicEx)
     auto r = static_cast<float>(res.right);
     auto b = static_cast<float>(res.bottom);
     bool flipHandedness = FALSE;
+    const auto count = lua_gettop(L);
+    auto next = 1;
 
-    if (LuaLength(L) >= 4)
+    if (count - next + 1 >= 4)
     {
-        l = LuaGetInline<float>(L);
-        r = LuaGetInline<float>(L);
-        b = LuaGetInline<float>(L);
-        t = LuaGetInline<float>(L);
+        std::tie(l, r, b, t) = LuaArgs<float, float, float, float>(L, next).Read();
+        next += 4;
     }
 
     float zNear = 0.01f;
     float zFar = 100.0f;
 
-    if (LuaLength(L) >= 2)
+    if (count - next + 1 >= 2)
     {
-        zNear = LuaGetInline<float>(L);
-        zFar = LuaGetInline<float>(L);
+        std::tie(zNear, zFar) = LuaArgs<float, float>(L, next).Read();
+        next += 2;
     }
 
-    if (LuaLength(L) >= 1)
+    if (count - next + 1 >= 1)
     {
-        flipHandedness = LuaGetInline<bool>(L);
+        flipHandedness = LuaCheck<bool>(L, next);
     }
 
     D3DXMATRIX matProjection;
 
     if (flipHandedness)
     {
-        D3DXMatrixOrthoOffCenterRH(&matProjection,
-                                   l, r, b, t,
-                                   zNear,
-                                   zFar);
+        NMatrixOrthoOffCenterRH(&matProjection,
+                                l, r, b, t,
+                                zNear,
+                                zFar);
     }
     else
     {
-        D3DXMatrixOrthoOffCenterLH(&matProjection,
-                                   l, r, b, t,
-                                   zNear,
-                                   zFar);
+        NMatrixOrthoOffCenterLH(&matProjection,
+                                l, r, b, t,
+                                zNear,
+                                zFar);
     }
 
     RENDERER->SetMatrix(MATRIXKIND_PROJECTION, matProjection);
@@ -529,23 +914,24 @@ LUAF(Rend, CameraOrthographicEx)
 
 LUAF(Rend, BindTexture)
 {
-    const auto stage = LuaGetInline<DWORD>(L);
+    const LuaArgs<DWORD> args(L);
+    const auto stage = args.Get<0>();
     CMaterial* tex = nullptr;
 
-    if (LuaTestClass(L, L_RENDERTARGET))
+    if (args.Is<CRenderTarget*>(0))
     {
-        auto* const rtt = LuaGetInline<CRenderTarget*>(L);
+        auto* const rtt = LuaCheck<CRenderTarget*>(L, args.Index(0));
         RENDERER->SetTexture(stage, rtt->GetTextureHandle());
     }
-    else if (LuaTestClass(L, L_MATERIAL))
+    else if (args.Is<CMaterial*>(0))
     {
-        auto* const mat = LuaGetInline<CMaterial*>(L);
+        auto* const mat = LuaCheck<CMaterial*>(L, args.Index(0));
         mat->Bind(stage);
         RENDERER->MarkMaterialOverride(true);
     }
-    else if (LuaLength(L) >= 1)
+    else if (args.Extra() >= 1)
     {
-        auto* const handle = LuaGetInline<LPDIRECT3DTEXTURE9>(L);
+        auto* const handle = LuaCheck<LPDIRECT3DTEXTURE9>(L, args.Index(0));
         RENDERER->SetTexture(stage, handle);
     }
     else
@@ -577,10 +963,10 @@ LUAF(Rend, GetResolution)
 
 LUAF(Rend, GetMatrix)
 {
-    const auto kind = LuaGetInline<DWORD>(L);
+    const auto kind = LuaCheck<DWORD>(L, 1);
 
     matrix_new(L);
-    auto* mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, -1, LC_MATRIX));
     *mat = RENDERER->GetDeviceMatrix(kind);
 
     return 1;
@@ -594,8 +980,7 @@ LUAF(Rend, IsFocused)
 
 LUAF(Rend, RenderState)
 {
-    const auto kind = LuaGetInline<DWORD>(L);
-    const bool state = LuaGetInline<bool>(L);
+    const auto [kind, state] = LuaArgs<DWORD, bool>(L).Read();
 
     RENDERER->SetRenderState(kind, static_cast<DWORD>(state));
     return 0;
@@ -603,14 +988,14 @@ LUAF(Rend, RenderState)
 
 LUAF(Rend, ToggleDepthTest)
 {
-    const bool state = LuaGetInline<bool>(L);
+    const bool state = LuaCheck<bool>(L, 1);
     RENDERER->SetRenderState(D3DRS_ZENABLE, static_cast<DWORD>(state));
     return 0;
 }
 
 LUAF(Rend, ToggleWireframe)
 {
-    const bool state = LuaGetInline<bool>(L);
+    const bool state = LuaCheck<bool>(L, 1);
 
     RENDERER->SetRenderState(D3DRS_FILLMODE, state ? D3DFILL_WIREFRAME : D3DFILL_SOLID);
     RENDERER->SetRenderState(D3DRS_CULLMODE, state ? D3DCULL_NONE : D3DCULL_CCW);
@@ -620,15 +1005,9 @@ LUAF(Rend, ToggleWireframe)
 
 LUAF(Rend, SetFog)
 {
-    const DWORD color = luaH_getcolor(L);
-    const auto mode = LuaGetInline<DWORD>(L);
-    const auto start = LuaGetInline<float>(L);
-    float end = 0.0F;
-
-    if (mode == D3DFOG_LINEAR)
-    {
-        end = LuaGetInline<float>(L);
-    }
+    auto next = 0;
+    const DWORD color = luaH_getcolor(L, 1, &next);
+    const auto [mode, start, end] = LuaArgs<DWORD, float, float>(L, next).Read();
 
     RENDERER->SetFog(color, mode, start, end);
     return 0;
@@ -642,9 +1021,7 @@ LUAF(Rend, ClearFog)
 
 LUAF(Rend, SamplerState)
 {
-    const auto stage = LuaGetInline<DWORD>(L);
-    const auto kind = LuaGetInline<DWORD>(L);
-    const auto state = LuaGetInline<DWORD>(L);
+    const auto [stage, kind, state] = LuaArgs<DWORD, DWORD, DWORD>(L).Read();
 
     RENDERER->SetSamplerState(stage, kind, state);
     return 0;
@@ -652,14 +1029,14 @@ LUAF(Rend, SamplerState)
 
 LUAF(Rend, EnableLighting)
 {
-    const bool state = LuaGetInline<bool>(L);
+    const bool state = LuaCheck<bool>(L, 1);
     RENDERER->EnableLighting(state);
     return 0;
 }
 
 LUAF(Rend, AmbientColor)
 {
-    if (LuaLength(L) == 0)
+    if (lua_gettop(L) == 0)
     {
         D3DCOLOR col = 0x0;
         RENDERER->GetDevice()->GetRenderState(D3DRS_AMBIENT, &col);
@@ -679,9 +1056,7 @@ LUAF(Rend, ClearTarget)
 
 LUAF(Rend, DrawBox)
 {
-    const auto mat = LuaGetInline<D3DXMATRIX>(L);
-    const auto dims = LuaGetInline<D3DXVECTOR4>(L);
-    const auto color = LuaGetInline<DWORD>(L);
+    const auto [mat, dims, color] = LuaArgs<D3DXMATRIX, D3DXVECTOR4, DWORD>(L).Read();
 
     RENDERER->DrawBox(mat, dims, color);
     return 0;
@@ -708,12 +1083,7 @@ LUAF(Rend, ReadyAlphaBlend)
 
 LUAF(Rend, DrawQuad)
 {
-    const auto x1 = LuaGetInline<float>(L);
-    const auto x2 = LuaGetInline<float>(L);
-    const auto y1 = LuaGetInline<float>(L);
-    const auto y2 = LuaGetInline<float>(L);
-    const auto color = LuaGetInline<DWORD>(L);
-    const bool flipY = LuaGetInline<bool>(L);
+    const auto [x1, x2, y1, y2, color, flipY] = LuaArgs<float, float, float, float, DWORD, bool>(L).Read();
 
     RENDERER->DrawQuad(x1, x2, y1, y2, color, flipY);
     return 0;
@@ -721,12 +1091,7 @@ LUAF(Rend, DrawQuad)
 
 LUAF(Rend, DrawQuadEx)
 {
-    const auto pos = LuaGetInline<D3DXVECTOR3>(L);
-    const auto w = LuaGetInline<float>(L);
-    const auto h = LuaGetInline<float>(L);
-    const auto color = LuaGetInline<DWORD>(L);
-    const bool usesDepth = LuaGetInline<bool>(L);
-    const bool flipY = LuaGetInline<bool>(L);
+    const auto [pos, w, h, color, usesDepth, flipY] = LuaArgs<D3DXVECTOR3, float, float, DWORD, bool, bool>(L).Read();
 
     RENDERER->DrawQuadEx(pos.x, pos.y, pos.z, w, h, color, usesDepth, flipY);
     return 0;
@@ -734,13 +1099,7 @@ LUAF(Rend, DrawQuadEx)
 
 LUAF(Rend, DrawQuad3D)
 {
-    const auto x1 = LuaGetInline<float>(L);
-    const auto x2 = LuaGetInline<float>(L);
-    const auto y1 = LuaGetInline<float>(L);
-    const auto y2 = LuaGetInline<float>(L);
-    const auto z1 = LuaGetInline<float>(L);
-    const auto z2 = LuaGetInline<float>(L);
-    const auto color = LuaGetInline<DWORD>(L);
+    const auto [x1, x2, y1, y2, z1, z2, color] = LuaArgs<float, float, float, float, float, float, DWORD>(L).Read();
 
     RENDERER->DrawQuad3D(x1, x2, y1, y2, z1, z2, color);
     return 0;
@@ -748,9 +1107,7 @@ LUAF(Rend, DrawQuad3D)
 
 LUAF(Rend, DrawPolygon)
 {
-    const auto a = LuaGetInline<VERTEX>(L);
-    const auto b = LuaGetInline<VERTEX>(L);
-    const auto c = LuaGetInline<VERTEX>(L);
+    const auto [a, b, c] = LuaArgs<VERTEX, VERTEX, VERTEX>(L).Read();
 
     RENDERER->DrawPolygon(a, b, c);
     return 0;
@@ -758,7 +1115,7 @@ LUAF(Rend, DrawPolygon)
 
 LUAF(Rend, CullMode)
 {
-    const auto mode = LuaGetInline<DWORD>(L);
+    const auto mode = LuaCheck<DWORD>(L, 1);
     RENDERER->SetRenderState(D3DRS_CULLMODE, mode);
     return 0;
 }
@@ -768,14 +1125,14 @@ LUAF(Rend, FillScreen)
     DWORD color = 0x00FFFFFF;
     bool flipY = FALSE;
 
-    if (LuaLength(L) >= 1)
+    if (lua_gettop(L) >= 1)
     {
-        color = LuaGetInline<DWORD>(L);
+        color = LuaCheck<DWORD>(L, 1);
     }
 
-    if (LuaLength(L) >= 1)
+    if (lua_gettop(L) >= 2)
     {
-        flipY = LuaGetInline<bool>(L);
+        flipY = LuaCheck<bool>(L, 2);
     }
 
     const RECT res = RENDERER->GetResolution();
@@ -785,7 +1142,7 @@ LUAF(Rend, FillScreen)
 
 LUAF(Rend, RegisterFontFile)
 {
-    const auto* const path = LuaGetInline<LPCSTR>(L);
+    const auto* const path = LuaCheck<LPCSTR>(L, 1);
     lua_pushboolean(L, static_cast<int>(CFont::AddFontToDatabase(path)));
     return 1;
 }
@@ -823,6 +1180,7 @@ void CLuaBindings::BindRenderer(lua_State* L)
     REGF(Rend, BindTexture);
 
     LuaVertex$Register(L);
+    LuaBuffer$Register(L);
     LuaMaterial$Register(L);
     LuaLight$Register(L);
     LuaMesh$Register(L);
@@ -832,6 +1190,10 @@ void CLuaBindings::BindRenderer(lua_State* L)
     LuaEffect$Register(L);
     LuaRenderTarget$Register(L);
     LuaFont$Register(L);
+    LuaCollisionMesh$Register(L);
+    LuaCollisionWorld$Register(L);
+    LuaEntityWorld$Register(L);
+    LuaTweenLayer$Register(L);
 
     // enums
     {
@@ -935,7 +1297,7 @@ LUAF(Input, IsCursorVisible)
 
 LUAF(Input, ShowCursor)
 {
-    const bool state = LuaGetInline<bool>(L);
+    const bool state = LuaCheck<bool>(L, 1);
     INPUT->SetCursor(state);
     return 0;
 }
@@ -963,21 +1325,21 @@ LUAF(Input, GetKeyUp)
 
 LUAF(Input, GetMouse)
 {
-    const auto code = LuaGetInline<DWORD>(L);
+    const auto code = LuaCheck<DWORD>(L, 1);
     lua_pushboolean(L, INPUT->GetMouse(code));
     return 1;
 }
 
 LUAF(Input, GetMouseDown)
 {
-    const auto code = LuaGetInline<DWORD>(L);
+    const auto code = LuaCheck<DWORD>(L, 1);
     lua_pushboolean(L, INPUT->GetMouseDown(code));
     return 1;
 }
 
 LUAF(Input, GetMouseUp)
 {
-    const auto code = LuaGetInline<DWORD>(L);
+    const auto code = LuaCheck<DWORD>(L, 1);
     lua_pushboolean(L, INPUT->GetMouseUp(code));
     return 1;
 }
@@ -1020,8 +1382,7 @@ LUAF(Input, GetMouseDelta)
 
 LUAF(Input, SetMouseXY)
 {
-    const auto x = LuaGetInline<short>(L);
-    const auto y = LuaGetInline<short>(L);
+    const auto [x, y] = LuaArgs<short, short>(L).Read();
     INPUT->SetMouseXY(x, y);
 
     return 0;
@@ -1035,7 +1396,7 @@ LUAF(Input, GetCursorMode)
 
 LUAF(Input, SetCursorMode)
 {
-    const auto mode = LuaGetInline<int>(L);
+    const auto mode = LuaCheck<int>(L, 1);
     INPUT->SetCursorMode(static_cast<UCHAR>(mode));
     return 0;
 }
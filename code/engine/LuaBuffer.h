@@ -0,0 +1,547 @@
+#pragma once
+
+#include "system.h"
+
+#include <lua/lua.hpp>
+
+#include "FaceGroup.h"
+
+/*
+ * Typed buffers hand bulk numeric data to Lua without a userdata or table per
+ * element. A buffer either owns its storage, allocated right behind the header
+ * inside the userdata, or is a strided view into the vertex or index array of
+ * a face group. Views keep a reference to the face group and look its arrays
+ * up on every access, so they stay valid when it grows, and only ever see as
+ * many elements as it currently has. Slices share the storage of the buffer
+ * they were taken from.
+ */
+enum
+{
+    BUFFERTYPE_FLOAT32,
+    BUFFERTYPE_INT16,
+};
+
+enum
+{
+    BUFFERSOURCE_OWNED,
+    BUFFERSOURCE_VERTICES,
+    BUFFERSOURCE_INDICES,
+};
+
+struct LUABUFFER
+{
+    UCHAR type;
+    UCHAR source;
+    USHORT comps;       // components per element
+    DWORD offset;       // byte offset of the first component within a storage element
+    DWORD stride;       // bytes per storage element
+    DWORD first;        // storage element the buffer starts at
+    DWORD step;         // storage elements between two buffer elements
+    DWORD count;
+    DWORD size;         // storage elements of owned storage
+    CFaceGroup* owner;  // face group behind a view
+    BYTE* data;         // owned storage, shared by its slices
+};
+
+static auto buffer_compsize(UCHAR type) -> DWORD
+{
+    return type == BUFFERTYPE_FLOAT32 ? sizeof(float) : sizeof(short);
+}
+
+/*
+ * Address of the first element and the number of elements currently backed by
+ * storage. Pass write when about to store through it, so a view into geometry
+ * shared between face group clones gets its own copy first.
+ */
+static auto buffer_resolve(const LUABUFFER* buf, DWORD* count, bool write = FALSE) -> BYTE*
+{
+    BYTE* base = buf->data;
+    DWORD size = buf->size;
+
+    if (buf->source == BUFFERSOURCE_VERTICES)
+    {
+        base = write ? reinterpret_cast<BYTE*>(buf->owner->GetVertices())
+                     : reinterpret_cast<BYTE*>(const_cast<VERTEX*>(buf->owner->GetVertexData()));
+        size = buf->owner->GetNumVertices();
+    }
+    else if (buf->source == BUFFERSOURCE_INDICES)
+    {
+        base = write ? reinterpret_cast<BYTE*>(buf->owner->GetIndices())
+                     : reinterpret_cast<BYTE*>(const_cast<short*>(buf->owner->GetIndexData()));
+        size = buf->owner->GetNumIndices();
+    }
+
+    *count = size > buf->first ? min(buf->count, (size - buf->first - 1) / buf->step + 1) : 0;
+    return base + buf->offset + static_cast<size_t>(buf->first) * buf->stride;
+}
+
+/* Address of element i relative to the base buffer_resolve returned */
+static auto buffer_elem(const LUABUFFER* buf, BYTE* base, lua_Integer i) -> BYTE*
+{
+    return base + static_cast<size_t>(i) * buf->step * buf->stride;
+}
+
+static auto buffer_read(const LUABUFFER* buf, const BYTE* elem, DWORD comp) -> float
+{
+    if (buf->type == BUFFERTYPE_FLOAT32)
+        return reinterpret_cast<const float*>(elem)[comp];
+
+    return reinterpret_cast<const short*>(elem)[comp];
+}
+
+static void buffer_write(const LUABUFFER* buf, BYTE* elem, DWORD comp, float value)
+{
+    if (buf->type == BUFFERTYPE_FLOAT32)
+        reinterpret_cast<float*>(elem)[comp] = value;
+    else
+        reinterpret_cast<short*>(elem)[comp] = static_cast<short>(value);
+}
+
+static void buffer_touch(const LUABUFFER* buf)
+{
+    if (buf->owner)
+        buf->owner->MarkDirty();
+}
+
+/*
+ * Copies as many elements and components as both buffers have, converting
+ * between the element types. Returns the number of elements copied.
+ */
+static auto buffer_copy(const LUABUFFER* dst, const LUABUFFER* src) -> DWORD
+{
+    DWORD dstCount, srcCount;
+    auto* const to = buffer_resolve(dst, &dstCount, TRUE);
+    auto* const from = buffer_resolve(src, &srcCount);
+    const auto count = min(dstCount, srcCount);
+    const DWORD comps = min(dst->comps, src->comps);
+
+    const auto packed = comps * buffer_compsize(dst->type);
+
+    if (dst->type == src->type && dst->step == 1 && src->step == 1 && dst->stride == packed && src->stride == packed)
+    {
+        ::memmove(to, from, static_cast<size_t>(count) * packed);
+    }
+    else
+    {
+        for (DWORD i = 0; i < count; i++)
+        {
+            const auto* const srcElem = buffer_elem(src, from, i);
+            auto* const dstElem = buffer_elem(dst, to, i);
+
+            for (DWORD c = 0; c < comps; c++)
+                buffer_write(dst, dstElem, c, buffer_read(src, srcElem, c));
+        }
+    }
+
+    buffer_touch(dst);
+    return count;
+}
+
+/* View of one attribute of a face group's vertices, or of its indices when comps is 0 */
+static auto buffer_faceview(CFaceGroup* fg, DWORD offset, USHORT comps) -> LUABUFFER
+{
+    LUABUFFER view = {};
+    view.owner = fg;
+    view.step = 1;
+
+    if (comps == 0)
+    {
+        view.type = BUFFERTYPE_INT16;
+        view.source = BUFFERSOURCE_INDICES;
+        view.comps = 1;
+        view.stride = sizeof(short);
+        view.count = fg->GetNumIndices();
+    }
+    else
+    {
+        view.type = BUFFERTYPE_FLOAT32;
+        view.source = BUFFERSOURCE_VERTICES;
+        view.comps = comps;
+        view.offset = offset;
+        view.stride = sizeof(VERTEX);
+        view.count = fg->GetNumVertices();
+    }
+
+    return view;
+}
+
+static auto buffer_push(lua_State* L, const LUABUFFER& buf) -> LUABUFFER*
+{
+    auto* const out = static_cast<LUABUFFER*>(lua_newuserdatauv(L, sizeof(LUABUFFER), 1));
+    *out = buf;
+
+    if (out->owner)
+        out->owner->AddRef();
+
+    luaH_setclass(L, LC_BUFFER);
+    return out;
+}
+
+static auto buffer_alloc(lua_State* L, UCHAR type, DWORD count, USHORT comps) -> LUABUFFER*
+{
+    const auto stride = comps * buffer_compsize(type);
+    auto* const buf = static_cast<LUABUFFER*>(lua_newuserdatauv(L, sizeof(LUABUFFER) + static_cast<size_t>(count) * stride, 1));
+
+    ZeroMemory(buf, sizeof(LUABUFFER) + static_cast<size_t>(count) * stride);
+    buf->type = type;
+    buf->source = BUFFERSOURCE_OWNED;
+    buf->comps = comps;
+    buf->stride = stride;
+    buf->step = 1;
+    buf->count = count;
+    buf->size = count;
+    buf->data = reinterpret_cast<BYTE*>(buf + 1);
+
+    luaH_setclass(L, LC_BUFFER);
+    return buf;
+}
+
+/*
+ * Reading a view of fg while fg gets resized or overwritten would see the new
+ * contents. Such a view is copied into an owned buffer, left on the stack, and
+ * any other buffer is returned as it is.
+ */
+static auto buffer_unalias(lua_State* L, const LUABUFFER* buf, const CFaceGroup* fg) -> const LUABUFFER*
+{
+    if (buf->owner != fg)
+        return buf;
+
+    DWORD count;
+    buffer_resolve(buf, &count);
+
+    auto* const copy = buffer_alloc(L, buf->type, count, buf->comps);
+    buffer_copy(copy, buf);
+    return copy;
+}
+
+/* Element index at idx, checked against the live size of the buffer */
+static auto buffer_checkelem(lua_State* L, const LUABUFFER* buf, int idx, bool write = FALSE) -> BYTE*
+{
+    DWORD count;
+    auto* const base = buffer_resolve(buf, &count, write);
+    const auto i = luaL_checkinteger(L, idx);
+
+    luaL_argcheck(L, i >= 1 && i <= static_cast<lua_Integer>(count), idx, "index out of range");
+    return buffer_elem(buf, base, i - 1);
+}
+
+static auto buffer_new(lua_State* L, UCHAR type) -> int
+{
+    const auto comps = static_cast<USHORT>(luaL_optinteger(L, 2, 1));
+    luaL_argcheck(L, comps >= 1, 2, "at least one component expected");
+
+    if (lua_istable(L, 1))
+    {
+        const auto len = static_cast<DWORD>(luaL_len(L, 1));
+        auto* const buf = buffer_alloc(L, type, len / comps, comps);
+
+        for (DWORD i = 0; i < buf->count * comps; i++)
+        {
+            lua_rawgeti(L, 1, i + 1LL);
+            buffer_write(buf, buf->data, i, static_cast<float>(lua_tonumber(L, -1)));
+            lua_pop(L, 1);
+        }
+
+        return 1;
+    }
+
+    const auto count = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, count >= 0, 1, "negative size");
+    buffer_alloc(L, type, static_cast<DWORD>(count), comps);
+    return 1;
+}
+
+static auto buffer_newfloat32(lua_State* L) -> int
+{
+    return buffer_new(L, BUFFERTYPE_FLOAT32);
+}
+
+static auto buffer_newint16(lua_State* L) -> int
+{
+    return buffer_new(L, BUFFERTYPE_INT16);
+}
+
+static auto buffer_len(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    DWORD count;
+    buffer_resolve(buf, &count);
+
+    lua_pushinteger(L, count);
+    return 1;
+}
+
+static auto buffer_components(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    lua_pushinteger(L, buf->comps);
+    return 1;
+}
+
+static void buffer_pushcomp(lua_State* L, const LUABUFFER* buf, const BYTE* elem, DWORD comp)
+{
+    if (buf->type == BUFFERTYPE_FLOAT32)
+        lua_pushnumber(L, reinterpret_cast<const float*>(elem)[comp]);
+    else
+        lua_pushinteger(L, reinterpret_cast<const short*>(elem)[comp]);
+}
+
+/* buf:get(i) returns all components of element i, buf:get(i, c) just one */
+static auto buffer_get(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    const auto* const elem = buffer_checkelem(L, buf, 2);
+
+    if (lua_gettop(L) >= 3)
+    {
+        const auto comp = luaL_checkinteger(L, 3);
+        luaL_argcheck(L, comp >= 1 && comp <= buf->comps, 3, "component out of range");
+        buffer_pushcomp(L, buf, elem, static_cast<DWORD>(comp - 1));
+        return 1;
+    }
+
+    luaL_checkstack(L, buf->comps, nullptr);
+
+    for (DWORD c = 0; c < buf->comps; c++)
+        buffer_pushcomp(L, buf, elem, c);
+
+    return buf->comps;
+}
+
+static auto buffer_set(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    auto* const elem = buffer_checkelem(L, buf, 2, TRUE);
+    const auto comps = min(static_cast<DWORD>(lua_gettop(L) - 2), static_cast<DWORD>(buf->comps));
+
+    for (DWORD c = 0; c < comps; c++)
+        buffer_write(buf, elem, c, static_cast<float>(luaL_checknumber(L, 3 + c)));
+
+    buffer_touch(buf);
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* buf:getVector(i [, out]) reads up to four components of element i into a Vector */
+static auto buffer_getvector(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    const auto* const elem = buffer_checkelem(L, buf, 2);
+    D3DXVECTOR4* out;
+
+    if (lua_gettop(L) >= 3)
+    {
+        out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
+        lua_pushvalue(L, 3);
+    }
+    else
+        out = vector4_ctor(L);
+
+    float comps[4] = {};
+
+    for (DWORD c = 0; c < min(static_cast<DWORD>(buf->comps), 4UL); c++)
+        comps[c] = buffer_read(buf, elem, c);
+
+    *out = D3DXVECTOR4(comps[0], comps[1], comps[2], comps[3]);
+    return 1;
+}
+
+static auto buffer_setvector(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    auto* const elem = buffer_checkelem(L, buf, 2, TRUE);
+    const auto* const vec = static_cast<const float*>(luaH_checkudata(L, 3, LC_VECTOR));
+
+    for (DWORD c = 0; c < min(static_cast<DWORD>(buf->comps), 4UL); c++)
+        buffer_write(buf, elem, c, vec[c]);
+
+    buffer_touch(buf);
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* buf:read([first [, n]]) returns the components of n elements as one flat table */
+static auto buffer_readtable(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    DWORD count;
+    auto* const base = buffer_resolve(buf, &count);
+    const auto first = luaL_optinteger(L, 2, 1);
+    const auto n = luaL_optinteger(L, 3, static_cast<lua_Integer>(count) - first + 1);
+
+    luaL_argcheck(L, first >= 1, 2, "index out of range");
+    luaL_argcheck(L, n >= 0 && first + n - 1 <= static_cast<lua_Integer>(count), 3, "range out of bounds");
+
+    lua_createtable(L, static_cast<int>(n * buf->comps), 0);
+    lua_Integer k = 1;
+
+    for (auto i = first - 1; i < first - 1 + n; i++)
+    {
+        for (DWORD c = 0; c < buf->comps; c++)
+        {
+            buffer_pushcomp(L, buf, buffer_elem(buf, base, i), c);
+            lua_rawseti(L, -2, k++);
+        }
+    }
+
+    return 1;
+}
+
+/* buf:write(first, values) stores a flat table of components from element first on */
+static auto buffer_writetable(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    DWORD count;
+    auto* const base = buffer_resolve(buf, &count, TRUE);
+    const auto first = luaL_checkinteger(L, 2);
+    luaL_checktype(L, 3, LUA_TTABLE);
+
+    const auto len = luaL_len(L, 3);
+    const auto n = (len + buf->comps - 1) / buf->comps;
+
+    luaL_argcheck(L, first >= 1 && first + n - 1 <= static_cast<lua_Integer>(count), 2, "range out of bounds");
+
+    for (lua_Integer k = 0; k < len; k++)
+    {
+        lua_rawgeti(L, 3, k + 1);
+        buffer_write(buf, buffer_elem(buf, base, first - 1 + k / buf->comps), static_cast<DWORD>(k % buf->comps),
+                     static_cast<float>(lua_tonumber(L, -1)));
+        lua_pop(L, 1);
+    }
+
+    buffer_touch(buf);
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* buf:copy(src) copies the overlapping elements and components of src */
+static auto buffer_copyfrom(lua_State* L) -> int
+{
+    const auto* const dst = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    const auto* const src = static_cast<LUABUFFER*>(luaH_checkudata(L, 2, LC_BUFFER));
+
+    buffer_copy(dst, src);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* buf:slice(first, n [, step]) views n elements from first on, every step-th one */
+static auto buffer_slice(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    DWORD count;
+    buffer_resolve(buf, &count);
+    const auto first = luaL_checkinteger(L, 2);
+    const auto n = luaL_checkinteger(L, 3);
+    const auto step = luaL_optinteger(L, 4, 1);
+
+    luaL_argcheck(L, first >= 1 && first <= static_cast<lua_Integer>(count) + 1, 2, "index out of range");
+    luaL_argcheck(L, step >= 1, 4, "step must be positive");
+    luaL_argcheck(L, n >= 0 && (n == 0 || first + (n - 1) * step <= static_cast<lua_Integer>(count)), 3,
+                  "range out of bounds");
+
+    auto view = *buf;
+    view.first = buf->first + static_cast<DWORD>(first - 1) * buf->step;
+    view.step = buf->step * static_cast<DWORD>(step);
+    view.count = static_cast<DWORD>(n);
+
+    buffer_push(L, view);
+
+    // owned storage lives in the userdata of the buffer the slice came from
+    if (buf->source == BUFFERSOURCE_OWNED)
+    {
+        lua_getiuservalue(L, 1, 1);
+
+        if (lua_isnil(L, -1))
+        {
+            lua_pop(L, 1);
+            lua_pushvalue(L, 1);
+        }
+
+        lua_setiuservalue(L, -2, 1);
+    }
+
+    return 1;
+}
+
+static auto buffer_delete(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+
+    if (buf->owner)
+        buf->owner->Release();
+
+    return 0;
+}
+
+/*
+ * Snapshots store the live elements packed into a string and restore them as
+ * an owned buffer, views of face groups come back as copies.
+ */
+static auto buffer_restore(lua_State* L) -> int
+{
+    const auto type = static_cast<UCHAR>(lua_tointeger(L, lua_upvalueindex(1)));
+    const auto comps = static_cast<USHORT>(lua_tointeger(L, lua_upvalueindex(2)));
+    size_t len;
+    const auto* const data = lua_tolstring(L, lua_upvalueindex(3), &len);
+
+    auto* const buf = buffer_alloc(L, type, static_cast<DWORD>(len / (comps * buffer_compsize(type))), comps);
+    ::memcpy(buf->data, data, static_cast<size_t>(buf->count) * buf->stride);
+    return 1;
+}
+
+static auto buffer_persist(lua_State* L) -> int
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, 1, LC_BUFFER));
+    DWORD count;
+    buffer_resolve(buf, &count);
+
+    lua_pushinteger(L, buf->type);
+    lua_pushinteger(L, buf->comps);
+
+    LUABUFFER packed = {};
+    packed.type = buf->type;
+    packed.comps = buf->comps;
+    packed.stride = buf->comps * buffer_compsize(buf->type);
+    packed.step = 1;
+    packed.count = count;
+    packed.size = count;
+
+    luaL_Buffer out;
+    const auto len = static_cast<size_t>(count) * packed.stride;
+    packed.data = reinterpret_cast<BYTE*>(luaL_buffinitsize(L, &out, len));
+    buffer_copy(&packed, buf);
+    luaL_pushresultsize(&out, len);
+
+    // the snapshot stores a call to buffer_restore with type, comps and the packed elements
+    lua_pushcclosure(L, buffer_restore, 3);
+    return 1;
+}
+
+static void LuaBuffer$Register(lua_State* L)
+{
+    lua_register(L, "Float32Buffer", buffer_newfloat32);
+    lua_register(L, "Int16Buffer", buffer_newint16);
+    luaH_newclass(L, LC_BUFFER);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+
+    REGC("count", buffer_len);
+    REGC("components", buffer_components);
+    REGC("get", buffer_get);
+    REGC("set", buffer_set);
+    REGC("getVector", buffer_getvector);
+    REGC("setVector", buffer_setvector);
+    REGC("read", buffer_readtable);
+    REGC("write", buffer_writetable);
+    REGC("copy", buffer_copyfrom);
+    REGC("slice", buffer_slice);
+
+    REGC("__len", buffer_len);
+    REGC("__gc", buffer_delete);
+    REGC("__persist", buffer_persist);
+    REGC("__restore", buffer_restore);
+
+    lua_pop(L, 1);
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+#include "system.h"
+
+#include <lua/lua.hpp>
+
+#include "CollisionMesh.h"
+
+// contacts gathered on the stack before falling back to the heap
+#define COLLISION_LOCAL_CONTACTS 64
+
+/*
+ * Calls the function at fn once per contact with normal, depth, what was hit
+ * and point, world contacts add the triangle after those. Pushes the table of
+ * the results of each call.
+ */
+static void collision_callcontacts(lua_State* L, int fn, const COLLISIONCONTACT* contacts, unsigned int count, bool instances)
+{
+    lua_createtable(L, static_cast<int>(count), 0);
+    const auto results = lua_gettop(L);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const auto& contact = contacts[i];
+        const auto base = lua_gettop(L);
+
+        lua_pushvalue(L, fn);
+        *vector4_ctor(L) = D3DXVECTOR4(contact.normal, 0.0f);
+        lua_pushnumber(L, contact.depth);
+        lua_pushinteger(L, (instances ? contact.instance : contact.triangle) + 1ULL);
+        *vector4_ctor(L) = D3DXVECTOR4(contact.point, 0.0f);
+
+        if (instances)
+            lua_pushinteger(L, contact.triangle + 1ULL);
+
+        lua_call(L, instances ? 5 : 4, LUA_MULTRET);
+
+        const auto numResults = lua_gettop(L) - base;
+        lua_createtable(L, numResults, 0);
+        lua_insert(L, base + 1);
+
+        for (auto j = numResults; j >= 1; j--)
+            lua_rawseti(L, base + 1, j);
+
+        lua_rawseti(L, results, i + 1LL);
+    }
+}
+
+auto collisionmesh_new(lua_State* L) -> int
+{
+    luaH_newproxy(L, LC_COLLISIONMESH, new CCollisionMesh());
+    return 1;
+}
+
+static auto collisionmesh_addpart(lua_State* L) -> int
+{
+    const LuaArgs<CCollisionMesh*, CFaceGroup*> args(L);
+    const auto [mesh, fg] = args.Read();
+    luaL_argcheck(L, fg != nullptr, 2, "face group expected");
+    D3DXMATRIX mat;
+
+    if (args.Is<D3DXMATRIX>(0))
+        mat = LuaCheck<D3DXMATRIX>(L, args.Index(0));
+    else
+        NMatrixIdentity(&mat);
+
+    mesh->AddFaceGroup(fg, mat);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* mesh:addTriangles({{v1, v2, v3}, ...} [, mat]) */
+static auto collisionmesh_addtriangles(lua_State* L) -> int
+{
+    auto* const mesh = LuaCheck<CCollisionMesh*>(L, 1);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    D3DXMATRIX mat;
+
+    if (LuaIs<D3DXMATRIX>(L, 3))
+        mat = LuaCheck<D3DXMATRIX>(L, 3);
+    else
+        NMatrixIdentity(&mat);
+
+    const auto count = luaL_len(L, 2);
+
+    for (lua_Integer i = 1; i <= count; i++)
+    {
+        D3DXVECTOR3 tri[3];
+
+        lua_geti(L, 2, i);
+        luaL_checktype(L, -1, LUA_TTABLE);
+
+        for (int j = 0; j < 3; j++)
+        {
+            lua_geti(L, -1, j + 1);
+            const auto pos = LuaCheck<D3DXVECTOR3>(L, -1);
+            NVec3TransformCoord(&tri[j], &pos, &mat);
+            lua_pop(L, 1);
+        }
+
+        lua_pop(L, 1);
+        mesh->AddTriangle(tri[0], tri[1], tri[2]);
+    }
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto collisionmesh_clear(lua_State* L) -> int
+{
+    LuaCheck<CCollisionMesh*>(L, 1)->Clear();
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto collisionmesh_build(lua_State* L) -> int
+{
+    LuaCheck<CCollisionMesh*>(L, 1)->Build();
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto collisionmesh_count(lua_State* L) -> int
+{
+    lua_pushinteger(L, LuaCheck<CCollisionMesh*>(L, 1)->GetNumTriangles());
+    return 1;
+}
+
+static auto collisionmesh_getbounds(lua_State* L) -> int
+{
+    auto* const mesh = LuaCheck<CCollisionMesh*>(L, 1);
+    D3DXVECTOR3 min, max;
+
+    mesh->GetBounds(&min, &max);
+    *vector4_ctor(L) = D3DXVECTOR4(min, 0.0f);
+    *vector4_ctor(L) = D3DXVECTOR4(max, 0.0f);
+    return 2;
+}
+
+static auto collisionmesh_gettriangle(lua_State* L) -> int
+{
+    const auto [mesh, idx] = LuaArgs<CCollisionMesh*, DWORD>(L).Read();
+    luaL_argcheck(L, idx >= 1 && idx <= mesh->GetNumTriangles(), 2, "triangle index out of range");
+
+    const auto* const tri = mesh->GetTriangle(idx - 1);
+
+    for (int i = 0; i < 3; i++)
+        *vector4_ctor(L) = D3DXVECTOR4(tri[i], 0.0f);
+
+    return 3;
+}
+
+/*
+ * mesh:testSphere(pos, radius [, fn]) calls fn(normal, depth, triangle, point)
+ * for every touched triangle, in triangle order, and returns the table of
+ * their results like the Lua shapes do. Without fn it only counts contacts.
+ */
+static auto collisionmesh_testsphere(lua_State* L) -> int
+{
+    const auto [mesh, pos, radius] = LuaArgs<CCollisionMesh*, D3DXVECTOR3, float>(L).Read();
+    const auto hasCallback = !lua_isnoneornil(L, 4);
+    COLLISIONCONTACT local[COLLISION_LOCAL_CONTACTS];
+    auto* contacts = local;
+
+    if (hasCallback)
+        luaL_checktype(L, 4, LUA_TFUNCTION);
+
+    auto count = mesh->TestSphere(pos, radius, contacts, COLLISION_LOCAL_CONTACTS);
+
+    if (!hasCallback)
+    {
+        lua_pushinteger(L, count);
+        return 1;
+    }
+
+    if (count > COLLISION_LOCAL_CONTACTS)
+    {
+        contacts = static_cast<COLLISIONCONTACT*>(lua_newuserdatauv(L, count * sizeof(COLLISIONCONTACT), 0));
+        count = mesh->TestSphere(pos, radius, contacts, count);
+    }
+
+    collision_callcontacts(L, 4, contacts, count, FALSE);
+    return 1;
+}
+
+/* mesh:testBox(min, max [, fn]) calls fn(triangle) for every triangle overlapping the box */
+static auto collisionmesh_testbox(lua_State* L) -> int
+{
+    const auto [mesh, min, max] = LuaArgs<CCollisionMesh*, D3DXVECTOR3, D3DXVECTOR3>(L).Read();
+    const auto hasCallback = !lua_isnoneornil(L, 4);
+    unsigned int local[COLLISION_LOCAL_CONTACTS];
+    auto* triangles = local;
+
+    if (hasCallback)
+        luaL_checktype(L, 4, LUA_TFUNCTION);
+
+    auto count = mesh->TestBox(min, max, triangles, COLLISION_LOCAL_CONTACTS);
+
+    if (!hasCallback)
+    {
+        lua_pushinteger(L, count);
+        return 1;
+    }
+
+    if (count > COLLISION_LOCAL_CONTACTS)
+    {
+        triangles = static_cast<unsigned int*>(lua_newuserdatauv(L, count * sizeof(unsigned int), 0));
+        count = mesh->TestBox(min, max, triangles, count);
+    }
+
+    lua_createtable(L, static_cast<int>(count), 0);
+    const auto results = lua_gettop(L);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        lua_pushvalue(L, 4);
+        lua_pushinteger(L, triangles[i] + 1ULL);
+        lua_call(L, 1, 1);
+        lua_rawseti(L, results, i + 1LL);
+    }
+
+    return 1;
+}
+
+/* mesh:testRay(origin, dir [, maxDist]) returns distance, normal, point and triangle of the closest hit */
+static auto collisionmesh_testray(lua_State* L) -> int
+{
+    const LuaArgs<CCollisionMesh*, D3DXVECTOR3, D3DXVECTOR3> args(L);
+    const auto [mesh, origin, dir] = args.Read();
+    const auto maxDist = args.Opt<float>(0, FLT_MAX);
+    COLLISIONCONTACT hit;
+
+    if (!mesh->TestRay(origin, dir, maxDist, &hit))
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_pushnumber(L, hit.depth);
+    *vector4_ctor(L) = D3DXVECTOR4(hit.normal, 0.0f);
+    *vector4_ctor(L) = D3DXVECTOR4(hit.point, 0.0f);
+    lua_pushinteger(L, hit.triangle + 1ULL);
+    return 4;
+}
+
+static auto collisionmesh_delete(lua_State* L) -> int
+{
+    LuaCheck<CCollisionMesh*>(L, 1)->Release();
+    return 0;
+}
+
+static void LuaCollisionMesh$Register(lua_State* L)
+{
+    lua_register(L, L_COLLISIONMESH, collisionmesh_new);
+    luaH_newclass(L, LC_COLLISIONMESH);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+
+    REGC("addPart", collisionmesh_addpart);
+    REGC("addTriangles", collisionmesh_addtriangles);
+    REGC("clear", collisionmesh_clear);
+    REGC("build", collisionmesh_build);
+    REGC("count", collisionmesh_count);
+    REGC("getBounds", collisionmesh_getbounds);
+    REGC("getTriangle", collisionmesh_gettriangle);
+    REGC("testSphere", collisionmesh_testsphere);
+    REGC("testBox", collisionmesh_testbox);
+    REGC("testRay", collisionmesh_testray);
+    REGC("__len", collisionmesh_count);
+    REGC("__gc", collisionmesh_delete);
+
+    lua_pop(L, 1);
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include "system.h"
+
+#include <lua/lua.hpp>
+
+#include "CollisionWorld.h"
+#include "JobPool.h"
+
+// components per contact in the buffers of the batch tests
+#define COLLISION_PACKED_COMPS 9
+
+auto collisionworld_new(lua_State* L) -> int
+{
+    luaH_newproxy(L, LC_COLLISIONWORLD, new CCollisionWorld());
+    return 1;
+}
+
+static auto collisionworld_checkinstance(lua_State* L, CCollisionWorld* world, int idx) -> unsigned int
+{
+    const auto id = static_cast<unsigned int>(luaL_checkinteger(L, idx)) - 1;
+    luaL_argcheck(L, world->IsInstance(id), idx, "no such instance");
+    return id;
+}
+
+/* world:addInstance(mesh, mat) places the mesh and returns the id of the instance */
+static auto collisionworld_addinstance(lua_State* L) -> int
+{
+    const auto [world, mesh, mat] = LuaArgs<CCollisionWorld*, CCollisionMesh*, D3DXMATRIX>(L).Read();
+    luaL_argcheck(L, mesh != nullptr, 2, "collision mesh expected");
+
+    lua_pushinteger(L, world->AddInstance(mesh, mat) + 1ULL);
+    return 1;
+}
+
+static auto collisionworld_removeinstance(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CCollisionWorld*>(L, 1);
+
+    world->RemoveInstance(collisionworld_checkinstance(L, world, 2));
+    return 0;
+}
+
+/* world:setTransform(id, mat) moves an instance, returns false when mat has no inverse */
+static auto collisionworld_settransform(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CCollisionWorld*>(L, 1);
+    const auto id = collisionworld_checkinstance(L, world, 2);
+
+    lua_pushboolean(L, world->SetTransform(id, LuaCheck<D3DXMATRIX>(L, 3)));
+    return 1;
+}
+
+static auto collisionworld_gettransform(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CCollisionWorld*>(L, 1);
+    const auto& inst = world->GetInstance(collisionworld_checkinstance(L, world, 2));
+
+    matrix_new(L);
+    *static_cast<D3DXMATRIX*>(luaH_checkudata(L, -1, LC_MATRIX)) = inst.transform;
+    return 1;
+}
+
+static auto collisionworld_getbounds(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CCollisionWorld*>(L, 1);
+    const auto& inst = world->GetInstance(collisionworld_checkinstance(L, world, 2));
+
+    *vector4_ctor(L) = D3DXVECTOR4(inst.min, 0.0f);
+    *vector4_ctor(L) = D3DXVECTOR4(inst.max, 0.0f);
+    return 2;
+}
+
+static auto collisionworld_count(lua_State* L) -> int
+{
+    lua_pushinteger(L, LuaCheck<CCollisionWorld*>(L, 1)->GetNumInstances());
+    return 1;
+}
+
+/*
+ * world:testSphere(pos, radius [, fn]) calls fn(normal, depth, instance, point, triangle)
+ * for every contact in world space and returns the table of their results.
+ * Without fn it only counts contacts.
+ */
+static auto collisionworld_testsphere(lua_State* L) -> int
+{
+    const auto [world, pos, radius] = LuaArgs<CCollisionWorld*, D3DXVECTOR3, float>(L).Read();
+    const auto hasCallback = !lua_isnoneornil(L, 4);
+    COLLISIONCONTACT local[COLLISION_LOCAL_CONTACTS];
+    auto* contacts = local;
+
+    if (hasCallback)
+        luaL_checktype(L, 4, LUA_TFUNCTION);
+
+    auto count = world->TestSphere(pos, radius, contacts, COLLISION_LOCAL_CONTACTS);
+
+    if (!hasCallback)
+    {
+        lua_pushinteger(L, count);
+        return 1;
+    }
+
+    if (count > COLLISION_LOCAL_CONTACTS)
+    {
+        contacts = static_cast<COLLISIONCONTACT*>(lua_newuserdatauv(L, count * sizeof(COLLISIONCONTACT), 0));
+        count = world->TestSphere(pos, radius, contacts, count);
+    }
+
+    collision_callcontacts(L, 4, contacts, count, TRUE);
+    return 1;
+}
+
+/* world:testRay(origin, dir [, maxDist]) returns distance, normal, point, instance and triangle of the closest hit */
+static auto collisionworld_testray(lua_State* L) -> int
+{
+    const LuaArgs<CCollisionWorld*, D3DXVECTOR3, D3DXVECTOR3> args(L);
+    const auto [world, origin, dir] = args.Read();
+    const auto maxDist = args.Opt<float>(0, FLT_MAX);
+    COLLISIONCONTACT hit;
+
+    if (!world->TestRay(origin, dir, maxDist, &hit))
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    lua_pushnumber(L, hit.depth);
+    *vector4_ctor(L) = D3DXVECTOR4(hit.normal, 0.0f);
+    *vector4_ctor(L) = D3DXVECTOR4(hit.point, 0.0f);
+    lua_pushinteger(L, hit.instance + 1ULL);
+    lua_pushinteger(L, hit.triangle + 1ULL);
+    return 5;
+}
+
+/* Packs depth, normal, point, instance and triangle, a miss has instance and triangle 0 */
+static void collisionworld_pack(float* out, const COLLISIONCONTACT& contact, bool hit)
+{
+    out[0] = contact.depth;
+    out[1] = contact.normal.x;
+    out[2] = contact.normal.y;
+    out[3] = contact.normal.z;
+    out[4] = contact.point.x;
+    out[5] = contact.point.y;
+    out[6] = contact.point.z;
+    out[7] = hit ? static_cast<float>(contact.instance + 1) : 0.0f;
+    out[8] = hit ? static_cast<float>(contact.triangle + 1) : 0.0f;
+}
+
+static auto collisionworld_checkpoints(lua_State* L, int idx) -> const LUABUFFER*
+{
+    const auto* const buf = static_cast<LUABUFFER*>(luaH_checkudata(L, idx, LC_BUFFER));
+    luaL_argcheck(L, buf->comps >= 3, idx, "buffer of at least three components expected");
+    return buf;
+}
+
+static auto collisionworld_readpoint(const LUABUFFER* buf, const BYTE* elem) -> D3DXVECTOR3
+{
+    return D3DXVECTOR3(buffer_read(buf, elem, 0), buffer_read(buf, elem, 1), buffer_read(buf, elem, 2));
+}
+
+/*
+ * world:testSpheres(spheres [, radius]) tests every element of the buffer as a
+ * sphere at x, y, z with radius w, or radius when the elements have no fourth
+ * component. The spheres are tested in parallel. Returns a Float32Buffer of all
+ * contacts, sphere by sphere, and one with the first contact and the number of
+ * contacts of each sphere.
+ */
+static auto collisionworld_testspheres(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CCollisionWorld*>(L, 1);
+    const auto* const buf = collisionworld_checkpoints(L, 2);
+    const auto radius = static_cast<float>(luaL_optnumber(L, 3, 0.0));
+    DWORD count;
+    auto* const base = buffer_resolve(buf, &count);
+    CArray<COLLISIONSPHERE> spheres;
+    CArray<unsigned int> counts;
+    CArray<COLLISIONCONTACT> contacts;
+
+    spheres.Resize(count);
+    counts.Resize(count);
+
+    for (DWORD i = 0; i < count; i++)
+    {
+        const auto* const elem = buffer_elem(buf, base, i);
+        auto* const sphere = spheres.GetData() + i;
+
+        sphere->pos = collisionworld_readpoint(buf, elem);
+        sphere->radius = buf->comps >= 4 ? buffer_read(buf, elem, 3) : radius;
+    }
+
+    world->TestSpheres(spheres.GetData(), count, JOBS, &contacts, counts.GetData());
+
+    auto* const packed = buffer_alloc(L, BUFFERTYPE_FLOAT32, contacts.GetCount(), COLLISION_PACKED_COMPS);
+    auto* const out = reinterpret_cast<float*>(packed->data);
+
+    for (unsigned int i = 0; i < contacts.GetCount(); i++)
+        collisionworld_pack(out + i * COLLISION_PACKED_COMPS, contacts.GetData()[i], TRUE);
+
+    auto* const ranges = buffer_alloc(L, BUFFERTYPE_FLOAT32, count, 2);
+    auto* const range = reinterpret_cast<float*>(ranges->data);
+    unsigned int first = 1;
+
+    for (DWORD i = 0; i < count; i++)
+    {
+        range[i * 2] = static_cast<float>(first);
+        range[i * 2 + 1] = static_cast<float>(counts[i]);
+        first += counts[i];
+    }
+
+    return 2;
+}
+
+/*
+ * world:testRays(origins, dirs [, maxDist]) casts a ray per element of the two
+ * buffers in parallel. Returns a Float32Buffer with the closest hit of each ray,
+ * a ray that hit nothing has a negative depth.
+ */
+static auto collisionworld_testrays(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CCollisionWorld*>(L, 1);
+    const auto* const origins = collisionworld_checkpoints(L, 2);
+    const auto* const dirs = collisionworld_checkpoints(L, 3);
+    const auto maxDist = static_cast<float>(luaL_optnumber(L, 4, FLT_MAX));
+    DWORD count, numDirs;
+    auto* const originBase = buffer_resolve(origins, &count);
+    auto* const dirBase = buffer_resolve(dirs, &numDirs);
+
+    luaL_argcheck(L, numDirs == count, 3, "as many directions as origins expected");
+    CArray<COLLISIONRAY> rays;
+    CArray<COLLISIONCONTACT> hits;
+
+    rays.Resize(count);
+    hits.Resize(count);
+
+    for (DWORD i = 0; i < count; i++)
+    {
+        auto* const ray = rays.GetData() + i;
+
+        ray->origin = collisionworld_readpoint(origins, buffer_elem(origins, originBase, i));
+        ray->dir = collisionworld_readpoint(dirs, buffer_elem(dirs, dirBase, i));
+    }
+
+    world->TestRays(rays.GetData(), count, maxDist, JOBS, hits.GetData());
+
+    auto* const packed = buffer_alloc(L, BUFFERTYPE_FLOAT32, count, COLLISION_PACKED_COMPS);
+    auto* const out = reinterpret_cast<float*>(packed->data);
+
+    for (DWORD i = 0; i < count; i++)
+    {
+        const auto& hit = hits.GetData()[i];
+        collisionworld_pack(out + i * COLLISION_PACKED_COMPS, hit, hit.depth >= 0.0f);
+    }
+
+    return 1;
+}
+
+static auto collisionworld_delete(lua_State* L) -> int
+{
+    LuaCheck<CCollisionWorld*>(L, 1)->Release();
+    return 0;
+}
+
+static void LuaCollisionWorld$Register(lua_State* L)
+{
+    lua_register(L, L_COLLISIONWORLD, collisionworld_new);
+    luaH_newclass(L, LC_COLLISIONWORLD);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+
+    REGC("addInstance", collisionworld_addinstance);
+    REGC("removeInstance", collisionworld_removeinstance);
+    REGC("setTransform", collisionworld_settransform);
+    REGC("getTransform", collisionworld_gettransform);
+    REGC("getBounds", collisionworld_getbounds);
+    REGC("count", collisionworld_count);
+    REGC("testSphere", collisionworld_testsphere);
+    REGC("testRay", collisionworld_testray);
+    REGC("testSpheres", collisionworld_testspheres);
+    REGC("testRays", collisionworld_testrays);
+    REGC("__len", collisionworld_count);
+    REGC("__gc", collisionworld_delete);
+
+    lua_pop(L, 1);
+}
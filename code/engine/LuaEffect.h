@@ -7,21 +7,26 @@
 
 auto effect_new(lua_State* L) -> int
 {
-    const auto* const effectPath = LuaGetInline<LPCSTR>(L);
-    const auto debugMode = LuaGetInline<bool>(L);
+    const auto [effectPath, debugMode] = LuaArgs<LPCSTR, bool>(L).Read();
 
+    const auto key = CString::Format("%s|%d", effectPath, debugMode);
     auto* const fx = static_cast<CEffect**>(lua_newuserdata(L, sizeof(CEffect*)));
-    *fx = new CEffect();
-    (*fx)->LoadEffect(effectPath, debugMode);
+    *fx = static_cast<CEffect*>(RESOURCES->Claim(RESOURCEKIND_EFFECT, key));
 
-    luaL_setmetatable(L, L_EFFECT);
+    if (*fx == nullptr)
+    {
+        *fx = new CEffect();
+        (*fx)->LoadEffect(effectPath, debugMode);
+        RESOURCES->Store(RESOURCEKIND_EFFECT, key, *fx);
+    }
+
+    luaH_setclass(L, LC_EFFECT);
     return 1;
 }
 
 static auto effect_begin(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
-    const auto* const technique = LuaGetInline<LPCSTR>(L);
+    const auto [fx, technique] = LuaArgs<CEffect*, LPCSTR>(L).Read();
 
     lua_pushinteger(L, fx->Begin(technique));
     return 1;
@@ -29,7 +34,7 @@ static auto effect_begin(lua_State* L) -> int
 
 static auto effect_end(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
+    auto* fx = LuaCheck<CEffect*>(L, 1);
 
     lua_pushinteger(L, fx->End());
     return 1;
@@ -37,17 +42,17 @@ static auto effect_end(lua_State* L) -> int
 
 static auto effect_beginpass(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
+    auto* fx = LuaCheck<CEffect*>(L, 1);
     unsigned int pass = -1;
 
-    if (lua_isinteger(L, 1) == 0)
+    if (lua_isinteger(L, 2) == 0)
     {
-        const auto* const passName = LuaGetInline<LPCSTR>(L);
+        const auto* const passName = LuaCheck<LPCSTR>(L, 2);
         pass = fx->FindPass(passName);
     }
     else
     {
-        pass = LuaGetInline<uint32_t>(L) - 1;
+        pass = LuaCheck<uint32_t>(L, 2) - 1;
     }
 
     lua_pushinteger(L, fx->BeginPass(pass));
@@ -56,7 +61,7 @@ static auto effect_beginpass(lua_State* L) -> int
 
 static auto effect_endpass(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
+    auto* fx = LuaCheck<CEffect*>(L, 1);
 
     lua_pushinteger(L, fx->EndPass());
     return 1;
@@ -64,7 +69,7 @@ static auto effect_endpass(lua_State* L) -> int
 
 static auto effect_commit(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
+    auto* fx = LuaCheck<CEffect*>(L, 1);
 
     fx->CommitChanges();
     return 0;
@@ -72,9 +77,7 @@ static auto effect_commit(lua_State* L) -> int
 
 static auto effect_setbool(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
-    const auto* const name = LuaGetInline<LPCSTR>(L);
-    const auto value = LuaGetInline<bool>(L);
+    const auto [fx, name, value] = LuaArgs<CEffect*, LPCSTR, bool>(L).Read();
 
     fx->SetBool(name, value);
     return 0;
@@ -82,9 +85,7 @@ static auto effect_setbool(lua_State* L) -> int
 
 static auto effect_setfloat(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
-    const auto* const name = LuaGetInline<LPCSTR>(L);
-    const auto value = LuaGetInline<float>(L);
+    const auto [fx, name, value] = LuaArgs<CEffect*, LPCSTR, float>(L).Read();
 
     fx->SetFloat(name, value);
     return 0;
@@ -92,9 +93,7 @@ static auto effect_setfloat(lua_State* L) -> int
 
 static auto effect_setmatrix(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
-    const auto* const name = LuaGetInline<LPCSTR>(L);
-    auto const value = LuaGetInline<D3DXMATRIX>(L);
+    const auto [fx, name, value] = LuaArgs<CEffect*, LPCSTR, D3DXMATRIX>(L).Read();
 
     fx->SetMatrix(name, value);
     return 0;
@@ -102,9 +101,7 @@ static auto effect_setmatrix(lua_State* L) -> int
 
 static auto effect_setvector3(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
-    const auto* const name = LuaGetInline<LPCSTR>(L);
-    auto const value = LuaGetInline<D3DXVECTOR3>(L);
+    const auto [fx, name, value] = LuaArgs<CEffect*, LPCSTR, D3DXVECTOR3>(L).Read();
 
     fx->SetVector3(name, value);
     return 0;
@@ -112,9 +109,7 @@ static auto effect_setvector3(lua_State* L) -> int
 
 static auto effect_setinteger(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
-    const auto* const name = LuaGetInline<LPCSTR>(L);
-    const auto value = LuaGetInline<DWORD>(L);
+    const auto [fx, name, value] = LuaArgs<CEffect*, LPCSTR, DWORD>(L).Read();
 
     fx->SetInteger(name, value);
     return 0;
@@ -122,13 +117,13 @@ static auto effect_setinteger(lua_State* L) -> int
 
 static auto effect_setlight(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
-    const auto* const name = LuaGetInline<LPCSTR>(L);
+    const LuaArgs<CEffect*, LPCSTR> args(L);
+    const auto [fx, name] = args.Read();
     CLight* value = nullptr;
 
-    if (LuaTestClass(L, L_LIGHT))
+    if (args.Is<CLight*>(0))
     {
-        value = LuaGetInline<CLight*>(L);
+        value = LuaCheck<CLight*>(L, args.Index(0));
     }
 
     fx->SetLight(name, value);
@@ -137,18 +132,17 @@ static auto effect_setlight(lua_State* L) -> int
 
 static auto effect_setvector4(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
-    const auto* const name = LuaGetInline<LPCSTR>(L);
+    const LuaArgs<CEffect*, LPCSTR> args(L);
+    const auto [fx, name] = args.Read();
 
-    if (LuaLength(L) >= 2)
+    if (args.Extra() >= 2)
     {
-        auto const value = LuaGetInline<D3DXVECTOR3>(L);
-        const auto value2 = LuaGetInline<float>(L);
+        const auto [value, value2] = LuaArgs<D3DXVECTOR3, float>(L, args.Index(0)).Read();
         fx->SetVector4(name, D3DXVECTOR4(value, value2));
     }
     else
     {
-        auto const value = LuaGetInline<D3DXVECTOR4>(L);
+        auto const value = LuaCheck<D3DXVECTOR4>(L, args.Index(0));
         fx->SetVector4(name, value);
     }
 
@@ -157,30 +151,30 @@ static auto effect_setvector4(lua_State* L) -> int
 
 static auto effect_settexture(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
-    const auto* const name = LuaGetInline<LPCSTR>(L);
+    const LuaArgs<CEffect*, LPCSTR> args(L);
+    const auto [fx, name] = args.Read();
 
-    if (LuaTestClass(L, L_RENDERTARGET))
+    if (args.Is<CRenderTarget*>(0))
     {
-        auto* rtt = LuaGetInline<CRenderTarget*>(L);
+        auto* rtt = LuaCheck<CRenderTarget*>(L, args.Index(0));
 
         fx->SetTexture(name, rtt->GetTextureHandle());
     }
-    else if (LuaTestClass(L, L_MATERIAL))
+    else if (args.Is<CMaterial*>(0))
     {
         unsigned int slot = TEXTURESLOT_ALBEDO;
-        auto* mat = LuaGetInline<CMaterial*>(L);
+        auto* mat = LuaCheck<CMaterial*>(L, args.Index(0));
 
-        if (LuaLength(L) >= 1)
+        if (args.Extra() >= 2)
         {
-            slot = LuaGetInline<uint32_t>(L);
+            slot = LuaCheck<uint32_t>(L, args.Index(1));
         }
 
         fx->SetTexture(name, mat->GetTextureHandle(slot));
     }
     else
     {
-        auto* const handle = LuaGetInline<LPDIRECT3DTEXTURE9>(L);
+        auto* const handle = LuaCheck<LPDIRECT3DTEXTURE9>(L, args.Index(0));
         fx->SetTexture(name, handle);
     }
 
@@ -189,7 +183,7 @@ static auto effect_settexture(lua_State* L) -> int
 
 static auto effect_delete(lua_State* L) -> int
 {
-    auto* fx = LuaGetInline<CEffect*>(L);
+    auto* fx = LuaCheck<CEffect*>(L, 1);
 
     fx->Release();
     return 0;
@@ -198,7 +192,7 @@ static auto effect_delete(lua_State* L) -> int
 static void LuaEffect$Register(lua_State* L)
 {
     lua_register(L, L_EFFECT, effect_new);
-    luaL_newmetatable(L, L_EFFECT);
+    luaH_newclass(L, LC_EFFECT);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "system.h"
+
+#include <lua/lua.hpp>
+
+#include "EntityWorld.h"
+
+/*
+ * The values the world keeps for entities and components are references into
+ * a store table, the user value of the world's proxy.
+ */
+static void entityworld_pushstore(lua_State* L, int idx)
+{
+    lua_getiuservalue(L, idx, 1);
+}
+
+/* References the value at idx in the store of the world at 1 */
+static auto entityworld_ref(lua_State* L, int idx) -> int
+{
+    idx = lua_absindex(L, idx);
+    entityworld_pushstore(L, 1);
+    lua_pushvalue(L, idx);
+    const auto ref = luaL_ref(L, -2);
+    lua_pop(L, 1);
+    return ref;
+}
+
+static void entityworld_unref(lua_State* L, int ref)
+{
+    entityworld_pushstore(L, 1);
+    luaL_unref(L, -1, ref);
+    lua_pop(L, 1);
+}
+
+auto entityworld_new(lua_State* L) -> int
+{
+    luaH_newproxy(L, LC_ENTITYWORLD, new CEntityWorld());
+    lua_newtable(L);
+    lua_setiuservalue(L, -2, 1);
+    return 1;
+}
+
+static auto entityworld_checkentity(lua_State* L, CEntityWorld* world, int idx) -> unsigned int
+{
+    const auto id = static_cast<unsigned int>(luaL_checkinteger(L, idx)) - 1;
+    luaL_argcheck(L, world->IsEntity(id), idx, "no such entity");
+    return id;
+}
+
+static auto entityworld_checkcomponent(lua_State* L, int idx) -> unsigned int
+{
+    const auto component = luaL_checkinteger(L, idx);
+    luaL_argcheck(L, component >= 1 && component <= ENTITYWORLD_MAX_COMPONENTS, idx, "component id out of range");
+    return static_cast<unsigned int>(component - 1);
+}
+
+static auto entityworld_checkquery(lua_State* L, CEntityWorld* world, int idx) -> unsigned int
+{
+    const auto id = static_cast<unsigned int>(luaL_checkinteger(L, idx)) - 1;
+    luaL_argcheck(L, world->IsQuery(id), idx, "no such query");
+    return id;
+}
+
+/* world:create(e) adds an entity without components for the value e and returns its id */
+static auto entityworld_create(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CEntityWorld*>(L, 1);
+    luaL_checkany(L, 2);
+
+    lua_pushinteger(L, world->CreateEntity(entityworld_ref(L, 2)) + 1ULL);
+    return 1;
+}
+
+static auto entityworld_destroy(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CEntityWorld*>(L, 1);
+    const auto id = entityworld_checkentity(L, world, 2);
+    const auto& rec = world->GetEntity(id);
+    const auto& archetype = world->GetArchetype(rec.archetype);
+
+    entityworld_unref(L, rec.value);
+
+    for (const auto& column : archetype.columns)
+        entityworld_unref(L, column[rec.row]);
+
+    world->DestroyEntity(id);
+    return 0;
+}
+
+/* world:set(id, component, value) adds or replaces a component of the entity */
+static auto entityworld_set(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CEntityWorld*>(L, 1);
+    const auto id = entityworld_checkentity(L, world, 2);
+    const auto component = entityworld_checkcomponent(L, 3);
+    luaL_checkany(L, 4);
+    int old;
+
+    if (world->SetComponent(id, component, entityworld_ref(L, 4), &old))
+        entityworld_unref(L, old);
+
+    return 0;
+}
+
+static auto entityworld_remove(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CEntityWorld*>(L, 1);
+    const auto id = entityworld_checkentity(L, world, 2);
+    int old;
+
+    if (world->RemoveComponent(id, entityworld_checkcomponent(L, 3), &old))
+        entityworld_unref(L, old);
+
+    return 0;
+}
+
+/* world:get(id, component) returns the component value or nil */
+static auto entityworld_get(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CEntityWorld*>(L, 1);
+    const auto id = entityworld_checkentity(L, world, 2);
+    int value;
+
+    if (!world->GetComponent(id, entityworld_checkcomponent(L, 3), &value))
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    entityworld_pushstore(L, 1);
+    lua_rawgeti(L, -1, value);
+    return 1;
+}
+
+/* world:query(component, ...) or world:query({component, ...}) returns the id of the cached query */
+static auto entityworld_query(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CEntityWorld*>(L, 1);
+
+    if (lua_istable(L, 2))
+    {
+        const auto count = luaL_len(L, 2);
+        lua_settop(L, 2);
+        luaL_checkstack(L, static_cast<int>(count), nullptr);
+
+        for (lua_Integer i = 1; i <= count; i++)
+            lua_rawgeti(L, 2, i);
+
+        lua_remove(L, 2);
+    }
+
+    // checked up front, a Lua error must not skip the destructor of the vector
+    for (auto i = 2; i <= lua_gettop(L); i++)
+        entityworld_checkcomponent(L, i);
+
+    std::vector<unsigned int> components;
+
+    for (auto i = 2; i <= lua_gettop(L); i++)
+        components.push_back(static_cast<unsigned int>(lua_tointeger(L, i)) - 1);
+
+    lua_pushinteger(L, world->AddQuery(components.data(), static_cast<unsigned int>(components.size())) + 1ULL);
+    return 1;
+}
+
+/* world:count([query]) returns the number of entities, or of the entities the query matches */
+static auto entityworld_count(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CEntityWorld*>(L, 1);
+
+    if (lua_isnoneornil(L, 2))
+        lua_pushinteger(L, world->GetNumEntities());
+    else
+        lua_pushinteger(L, world->CountQuery(entityworld_checkquery(L, world, 2)));
+
+    return 1;
+}
+
+/*
+ * world:entities(query, list) stores the entities the query matches in list
+ * from index 1 on, clears what list held past them and returns their number.
+ * Scripts loop over the list themselves, which is cheaper than being called
+ * back per entity and leaves them free to change the world meanwhile.
+ */
+static auto entityworld_entities(lua_State* L) -> int
+{
+    auto* const world = LuaCheck<CEntityWorld*>(L, 1);
+    const auto& query = world->GetQuery(entityworld_checkquery(L, world, 2));
+    luaL_checktype(L, 3, LUA_TTABLE);
+
+    const auto oldCount = static_cast<lua_Integer>(lua_rawlen(L, 3));
+    entityworld_pushstore(L, 1);
+    lua_Integer count = 0;
+
+    for (const auto archetype : query.archetypes)
+    {
+        for (const auto id : world->GetArchetype(archetype).entities)
+        {
+            lua_rawgeti(L, -1, world->GetEntity(id).value);
+            lua_rawseti(L, 3, ++count);
+        }
+    }
+
+    for (auto i = oldCount; i > count; i--)
+    {
+        lua_pushnil(L);
+        lua_rawseti(L, 3, i);
+    }
+
+    lua_pushinteger(L, count);
+    return 1;
+}
+
+static auto entityworld_delete(lua_State* L) -> int
+{
+    LuaCheck<CEntityWorld*>(L, 1)->Release();
+    return 0;
+}
+
+/*
+ * Snapshots store the flattened world next to its store table and restore
+ * both into a new world, so references keep pointing at the same values.
+ */
+static auto entityworld_restore(lua_State* L) -> int
+{
+    size_t len;
+    const auto* const data = lua_tolstring(L, lua_upvalueindex(1), &len);
+    auto* const world = new CEntityWorld();
+
+    if (!world->Load(reinterpret_cast<const int*>(data), len / sizeof(int)))
+    {
+        world->Release();
+        return luaL_error(L, "corrupt entity world");
+    }
+
+    luaH_newproxy(L, LC_ENTITYWORLD, world);
+    lua_pushvalue(L, lua_upvalueindex(2));
+    lua_setiuservalue(L, -2, 1);
+    return 1;
+}
+
+static auto entityworld_persist(lua_State* L) -> int
+{
+    std::vector<int> data;
+    LuaCheck<CEntityWorld*>(L, 1)->Save(&data);
+
+    lua_pushlstring(L, reinterpret_cast<const char*>(data.data()), data.size() * sizeof(int));
+    entityworld_pushstore(L, 1);
+
+    // saved as a call to entityworld_restore, the store table is persisted along with it
+    lua_pushcclosure(L, entityworld_restore, 2);
+    return 1;
+}
+
+static void LuaEntityWorld$Register(lua_State* L)
+{
+    lua_register(L, L_ENTITYWORLD, entityworld_new);
+    luaH_newclass(L, LC_ENTITYWORLD);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+
+    REGC("create", entityworld_create);
+    REGC("destroy", entityworld_destroy);
+    REGC("set", entityworld_set);
+    REGC("remove", entityworld_remove);
+    REGC("get", entityworld_get);
+    REGC("query", entityworld_query);
+    REGC("count", entityworld_count);
+    REGC("entities", entityworld_entities);
+    REGC("__gc", entityworld_delete);
+    REGC("__persist", entityworld_persist);
+    REGC("__restore", entityworld_restore);
+
+    lua_pop(L, 1);
+}
@@ -8,25 +8,20 @@
 
 auto facegroup_new(lua_State* L) -> int
 {
-    *static_cast<CFaceGroup**>(lua_newuserdata(L, sizeof(CFaceGroup*))) = new CFaceGroup();
-
-    luaL_setmetatable(L, L_FACEGROUP);
+    luaH_newproxy(L, LC_FACEGROUP, new CFaceGroup());
     return 1;
 }
 
 static auto facegroup_clone(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
-    *static_cast<CFaceGroup**>(lua_newuserdata(L, sizeof(CFaceGroup*))) = mesh->Clone();
-
-    luaL_setmetatable(L, L_FACEGROUP);
+    auto* mesh = LuaCheck<CFaceGroup*>(L, 1);
+    luaH_newproxy(L, LC_FACEGROUP, mesh->Clone());
     return 1;
 }
 
 static auto facegroup_addvertex(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
-    const auto vert = LuaGetInline<VERTEX>(L);
+    const auto [mesh, vert] = LuaArgs<CFaceGroup*, VERTEX>(L).Read();
     mesh->AddVertex(vert);
 
     lua_pushvalue(L, 1);
@@ -35,8 +30,7 @@ static auto facegroup_addvertex(lua_State* L) -> int
 
 static auto facegroup_addindex(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
-    const auto index = LuaGetInline<short>(L);
+    const auto [mesh, index] = LuaArgs<CFaceGroup*, short>(L).Read();
     mesh->AddIndex(index);
 
     lua_pushvalue(L, 1);
@@ -45,10 +39,7 @@ static auto facegroup_addindex(lua_State* L) -> int
 
 static auto facegroup_addtriangle(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
-    const auto i1 = LuaGetInline<short>(L);
-    const auto i2 = LuaGetInline<short>(L);
-    const auto i3 = LuaGetInline<short>(L);
+    const auto [mesh, i1, i2, i3] = LuaArgs<CFaceGroup*, short, short, short>(L).Read();
 
     mesh->AddIndex(i1);
     mesh->AddIndex(i2);
@@ -60,12 +51,12 @@ static auto facegroup_addtriangle(lua_State* L) -> int
 
 static auto facegroup_setmaterial(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* mesh = LuaCheck<CFaceGroup*>(L, 1);
     CMaterial* mat = nullptr;
 
-    if (LuaLength(L) == 1)
+    if (lua_gettop(L) == 2)
     {
-        mat = LuaGetInline<CMaterial*>(L);
+        mat = LuaCheck<CMaterial*>(L, 2);
         mat->AddRef();
     }
 
@@ -77,10 +68,10 @@ static auto facegroup_setmaterial(lua_State* L) -> int
 
 static auto facegroup_getmaterial(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* mesh = LuaCheck<CFaceGroup*>(L, 1);
     auto* const mat = mesh->GetMaterial();
 
-    if (mat) { LUAP(L, L_MATERIAL, CMaterial, mat); }
+    if (mat) { LUAP(L, LC_MATERIAL, CMaterial, mat); }
     else lua_pushnil(L);
 
     return 1;
@@ -88,14 +79,14 @@ static auto facegroup_getmaterial(lua_State* L) -> int
 
 static auto facegroup_draw(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* mesh = LuaCheck<CFaceGroup*>(L, 1);
     auto mat = D3DXMATRIX();
 
-    if (lua_gettop(L) >= 1)
+    if (lua_gettop(L) >= 2)
     {
-        mat = LuaGetInline<D3DXMATRIX>(L);
+        mat = LuaCheck<D3DXMATRIX>(L, 2);
     }
-    else D3DXMatrixIdentity(&mat);
+    else NMatrixIdentity(&mat);
 
     mesh->Draw(&mat);
 
@@ -105,7 +96,7 @@ static auto facegroup_draw(lua_State* L) -> int
 
 static auto facegroup_build(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* mesh = LuaCheck<CFaceGroup*>(L, 1);
 
     mesh->Build();
 
@@ -115,7 +106,7 @@ static auto facegroup_build(lua_State* L) -> int
 
 static auto facegroup_clear(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* mesh = LuaCheck<CFaceGroup*>(L, 1);
 
     mesh->Clear();
 
@@ -124,7 +115,7 @@ static auto facegroup_clear(lua_State* L) -> int
 
 static auto facegroup_calcnormals(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* mesh = LuaCheck<CFaceGroup*>(L, 1);
 
     mesh->CalculateNormals();
 
@@ -133,24 +124,26 @@ static auto facegroup_calcnormals(lua_State* L) -> int
 
 static auto facegroup_delete(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* mesh = LuaCheck<CFaceGroup*>(L, 1);
 
     mesh->Release();
 
     return 0;
 }
 
+/* Each Vertex is a copy, so reading them leaves geometry shared with clones alone */
 static auto facegroup_getvertices(lua_State* L) -> int
 {
-    auto* const mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* const mesh = LuaCheck<CFaceGroup*>(L, 1);
+    const auto* const verts = mesh->GetVertexData();
 
     lua_newtable(L);
 
     for (unsigned int i = 0; i < mesh->GetNumVertices(); i++)
     {
-        auto* const vert = mesh->GetVertices() + i;
+        const auto* const vert = verts + i;
         lua_pushinteger(L, i + 1ULL);
-        LUAPT(L, L_VERTEX, VERTEX, vert);
+        LUAPT(L, LC_VERTEX, VERTEX, vert);
         lua_settable(L, -3);
     }
 
@@ -159,7 +152,7 @@ static auto facegroup_getvertices(lua_State* L) -> int
 
 static auto facegroup_getbounds(lua_State* L) -> int
 {
-    auto* mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* mesh = LuaCheck<CFaceGroup*>(L, 1);
     auto* const b = mesh->GetBounds();
 
     lua_newtable(L);
@@ -177,15 +170,110 @@ static auto facegroup_getbounds(lua_State* L) -> int
     return 1;
 }
 
+static auto facegroup_getpositionbuffer(lua_State* L) -> int
+{
+    auto* const mesh = LuaCheck<CFaceGroup*>(L, 1);
+    buffer_push(L, buffer_faceview(mesh, offsetof(VERTEX, x), 3));
+    return 1;
+}
+
+static auto facegroup_getnormalbuffer(lua_State* L) -> int
+{
+    auto* const mesh = LuaCheck<CFaceGroup*>(L, 1);
+    buffer_push(L, buffer_faceview(mesh, offsetof(VERTEX, nx), 3));
+    return 1;
+}
+
+static auto facegroup_getuvbuffer(lua_State* L) -> int
+{
+    auto* const mesh = LuaCheck<CFaceGroup*>(L, 1);
+    buffer_push(L, buffer_faceview(mesh, offsetof(VERTEX, su), 2));
+    return 1;
+}
+
+static auto facegroup_getindexbuffer(lua_State* L) -> int
+{
+    auto* const mesh = LuaCheck<CFaceGroup*>(L, 1);
+    buffer_push(L, buffer_faceview(mesh, 0, 0));
+    return 1;
+}
+
+/*
+ * fg:setVertices(positions [, normals [, uvs]]) replaces all vertices at once,
+ * one vertex per element of positions. Attributes without a buffer are zeroed.
+ * The buffers may be views of fg itself, the storage is only reallocated when
+ * the vertex count changes.
+ */
+static auto facegroup_setvertices(lua_State* L) -> int
+{
+    auto* const mesh = LuaCheck<CFaceGroup*>(L, 1);
+    const LUABUFFER* sources[3] = {};
+
+    // views of this face group are read after its vertices were cleared
+    for (auto i = 0; i < 3; i++)
+    {
+        if (i == 0 || !lua_isnoneornil(L, i + 2))
+            sources[i] = buffer_unalias(L, static_cast<LUABUFFER*>(luaH_checkudata(L, i + 2, LC_BUFFER)), mesh);
+    }
+
+    DWORD count;
+    buffer_resolve(sources[0], &count);
+
+    if (mesh->GetNumVertices() != count)
+        mesh->SetNumVertices(count);
+
+    auto* const verts = mesh->GetVertices();
+
+    for (DWORD i = 0; i < count; i++)
+    {
+        ZeroMemory(verts + i, sizeof(VERTEX));
+        verts[i].color = 0xFFFFFFFF;
+    }
+
+    const auto posView = buffer_faceview(mesh, offsetof(VERTEX, x), 3);
+    buffer_copy(&posView, sources[0]);
+
+    if (sources[1])
+    {
+        const auto normalView = buffer_faceview(mesh, offsetof(VERTEX, nx), 3);
+        buffer_copy(&normalView, sources[1]);
+    }
+
+    if (sources[2])
+    {
+        const auto uvView = buffer_faceview(mesh, offsetof(VERTEX, su), 2);
+        buffer_copy(&uvView, sources[2]);
+    }
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto facegroup_setindices(lua_State* L) -> int
+{
+    auto* const mesh = LuaCheck<CFaceGroup*>(L, 1);
+    const auto* const indices = buffer_unalias(L, static_cast<LUABUFFER*>(luaH_checkudata(L, 2, LC_BUFFER)), mesh);
+    DWORD count;
+    buffer_resolve(indices, &count);
+
+    if (mesh->GetNumIndices() != count)
+        mesh->SetNumIndices(count);
+    const auto view = buffer_faceview(mesh, 0, 0);
+    buffer_copy(&view, indices);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
 static auto facegroup_getindices(lua_State* L) -> int
 {
-    auto* const mesh = LuaGetInline<CFaceGroup*>(L);
+    auto* const mesh = LuaCheck<CFaceGroup*>(L, 1);
 
     lua_newtable(L);
 
     for (unsigned int i = 0; i < mesh->GetNumIndices(); i++)
     {
-        const auto index = *(mesh->GetIndices() + i);
+        const auto index = *(mesh->GetIndexData() + i);
         lua_pushinteger(L, i + 1ULL);
         lua_pushinteger(L, index);
         lua_settable(L, -3);
@@ -197,7 +285,7 @@ static auto facegroup_getindices(lua_State* L) -> int
 static void LuaFaceGroup$Register(lua_State* L)
 {
     lua_register(L, L_FACEGROUP, facegroup_new);
-    luaL_newmetatable(L, L_FACEGROUP);
+    luaH_newclass(L, LC_FACEGROUP);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
@@ -215,6 +303,12 @@ static void LuaFaceGroup$Register(lua_State* L)
 
     REGC("getVertices", facegroup_getvertices);
     REGC("getIndices", facegroup_getindices);
+    REGC("getPositionBuffer", facegroup_getpositionbuffer);
+    REGC("getNormalBuffer", facegroup_getnormalbuffer);
+    REGC("getUVBuffer", facegroup_getuvbuffer);
+    REGC("getIndexBuffer", facegroup_getindexbuffer);
+    REGC("setVertices", facegroup_setvertices);
+    REGC("setIndices", facegroup_setindices);
 
     REGC("__gc", facegroup_delete);
 
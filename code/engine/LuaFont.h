@@ -7,60 +7,55 @@
 
 auto font_new(lua_State* L) -> int
 {
-    const auto* const fontFamily = LuaGetInline<LPCSTR>(L);
-    const auto fontSize = LuaGetInline<int>(L);
-    auto boldness = 0;
-    auto italic = FALSE;
+    // boldness and italic are optional, missing arguments read as 0 and false
+    const auto [fontFamily, fontSize, boldness, italic] = LuaArgs<LPCSTR, int, int, bool>(L).Read();
 
-    if (LuaLength(L) >= 1)
-        boldness = LuaGetInline<int>(L);
+    const auto key = CString::Format("%s|%d|%d|%d", fontFamily, fontSize, boldness, italic);
+    auto* font = static_cast<CFont*>(RESOURCES->Claim(RESOURCEKIND_FONT, key));
 
-    if (LuaLength(L) >= 1)
-        italic = LuaGetInline<bool>(L);
+    if (font == nullptr)
+    {
+        font = new CFont(fontFamily, fontSize, boldness, italic);
+        RESOURCES->Store(RESOURCEKIND_FONT, key, font);
+    }
 
-    *static_cast<CFont**>(lua_newuserdata(L, sizeof(CFont*))) = new CFont(fontFamily, fontSize, boldness, italic);
+    *static_cast<CFont**>(lua_newuserdata(L, sizeof(CFont*))) = font;
 
-    luaL_setmetatable(L, L_FONT);
+    luaH_setclass(L, LC_FONT);
     return 1;
 }
 
 static auto font_drawtext(lua_State* L) -> int
 {
-    auto* const font = LuaGetInline<CFont*>(L);
-    const auto color = LuaGetInline<DWORD>(L);
-    const auto* const text = LuaGetInline<LPCSTR>(L);
-    const auto x = LuaGetInline<uint32_t>(L);
-    const auto y = LuaGetInline<uint32_t>(L);
+    const LuaArgs<CFont*, DWORD, LPCSTR, uint32_t, uint32_t> args(L);
+    const auto [font, color, text, x, y] = args.Read();
+    auto next = 0;
 
     uint32_t w = 0, h = 0;
-    if (LuaLength(L) >= 2)
+    if (args.Extra() >= 2)
     {
-        w = LuaGetInline<uint32_t>(L);
-        h = LuaGetInline<uint32_t>(L);
+        w = LuaCheck<uint32_t>(L, args.Index(0));
+        h = LuaCheck<uint32_t>(L, args.Index(1));
+        next = 2;
     }
 
     DWORD flags = DT_WORDBREAK;
-    if (LuaLength(L) >= 1)
+    if (args.Extra() > next)
     {
-        flags = LuaGetInline<DWORD>(L);
+        flags = LuaCheck<DWORD>(L, args.Index(next));
     }
 
     font->RenderText(color, text, x, y, w, h, flags);
 
-    return 1;
+    return 0;
 }
 
 static auto font_measuretext(lua_State* L) -> int
 {
-    auto* const font = LuaGetInline<CFont*>(L);
-    const auto* const text = LuaGetInline<LPCSTR>(L);
-    const auto flags = LuaGetInline<DWORD>(L);
+    const auto [font, text, flags, width] = LuaArgs<CFont*, LPCSTR, DWORD, uint32_t>(L).Read();
 
     RECT rect = {0};
-    if (LuaLength(L) >= 1)
-    {
-        rect.right = LuaGetInline<uint32_t>(L);
-    }
+    rect.right = width;
 
     font->CalculateRect(text, &rect, flags);
 
@@ -77,7 +72,7 @@ static auto font_measuretext(lua_State* L) -> int
 
 static auto font_delete(lua_State* L) -> int
 {
-    auto* const font = LuaGetInline<CFont*>(L);
+    auto* const font = LuaCheck<CFont*>(L, 1);
 
     font->Release();
     return 0;
@@ -86,7 +81,7 @@ static auto font_delete(lua_State* L) -> int
 static void LuaFont$Register(lua_State* L)
 {
     lua_register(L, L_FONT, font_new);
-    luaL_newmetatable(L, L_FONT);
+    luaH_newclass(L, LC_FONT);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
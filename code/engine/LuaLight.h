@@ -13,18 +13,14 @@ auto light_new(lua_State* L) -> int
         slot = static_cast<unsigned int>(luaL_checkinteger(L, 1));
     }
 
-    const auto lit = static_cast<CLight**>(lua_newuserdata(L, sizeof(CLight*)));
-
-    *lit = new CLight(slot);
-
-    luaL_setmetatable(L, L_LIGHT);
+    luaH_newproxy(L, LC_LIGHT, new CLight(slot));
     return 1;
 }
 
 
 static auto light_delete(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
 
     lit->Release();
     return 0;
@@ -32,31 +28,31 @@ static auto light_delete(lua_State* L) -> int
 
 static auto light_setdiffuse(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
-    lit->SetDiffuse(luaH_getcolorlinear(L, 1));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
+    lit->SetDiffuse(luaH_getcolorlinear(L, 2));
 
     return 0;
 }
 
 static auto light_setambient(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
-    lit->SetAmbient(luaH_getcolorlinear(L, 1));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
+    lit->SetAmbient(luaH_getcolorlinear(L, 2));
 
     return 0;
 }
 
 static auto light_setspecular(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
-    lit->SetSpecular(luaH_getcolorlinear(L, 1));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
+    lit->SetSpecular(luaH_getcolorlinear(L, 2));
 
     return 0;
 }
 
 static auto light_setposition(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const D3DXVECTOR3 pos = luaH_getcomps(L);
     lit->SetPosition(pos);
 
@@ -65,7 +61,7 @@ static auto light_setposition(lua_State* L) -> int
 
 static auto light_setdirection(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const D3DXVECTOR3 dir = luaH_getcomps(L);
     lit->SetDirection(dir);
 
@@ -74,7 +70,7 @@ static auto light_setdirection(lua_State* L) -> int
 
 static auto light_setatten(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const D3DCOLORVALUE atten = {
         static_cast<float>(luaL_checknumber(L, 2)), static_cast<float>(luaL_checknumber(L, 3)),
         static_cast<float>(luaL_checknumber(L, 4))
@@ -87,7 +83,7 @@ static auto light_setatten(lua_State* L) -> int
 
 static auto light_setrange(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const auto val = static_cast<float>(luaL_checknumber(L, 2));
     lit->SetRange(val);
 
@@ -96,7 +92,7 @@ static auto light_setrange(lua_State* L) -> int
 
 static auto light_setfalloff(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const auto val = static_cast<float>(luaL_checknumber(L, 2));
     lit->SetFalloff(val);
 
@@ -105,7 +101,7 @@ static auto light_setfalloff(lua_State* L) -> int
 
 static auto light_setinnerangle(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const auto val = static_cast<float>(luaL_checknumber(L, 2));
     lit->SetInnerAngle(val);
 
@@ -114,7 +110,7 @@ static auto light_setinnerangle(lua_State* L) -> int
 
 static auto light_setouterangle(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const auto val = static_cast<float>(luaL_checknumber(L, 2));
     lit->SetOuterAngle(val);
 
@@ -123,7 +119,7 @@ static auto light_setouterangle(lua_State* L) -> int
 
 static auto light_settype(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const auto val = static_cast<DWORD>(luaL_checkinteger(L, 2));
     lit->SetType(val);
 
@@ -132,7 +128,7 @@ static auto light_settype(lua_State* L) -> int
 
 static auto light_setslot(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const auto val = static_cast<DWORD>(luaL_checkinteger(L, 2));
     lit->SetSlot(val);
 
@@ -141,7 +137,7 @@ static auto light_setslot(lua_State* L) -> int
 
 static auto light_enable(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     const auto val = static_cast<bool>(lua_toboolean(L, 2));
 
     if (lua_gettop(L) == 3)
@@ -155,7 +151,7 @@ static auto light_enable(lua_State* L) -> int
 
 static auto light_getslot(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     lua_pushinteger(L, lit->GetSlot());
 
     return 1;
@@ -163,7 +159,7 @@ static auto light_getslot(lua_State* L) -> int
 
 static auto light_gettype(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     lua_pushinteger(L, lit->GetLightData().Type);
 
     return 1;
@@ -171,18 +167,18 @@ static auto light_gettype(lua_State* L) -> int
 
 static auto light_getowner(lua_State* L) -> int
 {
-    auto lit = *static_cast<CLight**>(luaL_checkudata(L, 1, L_LIGHT));
+    auto lit = *static_cast<CLight**>(luaH_checkudata(L, 1, LC_LIGHT));
     if (!lit->GetOwner())
         lua_pushnil(L);
     else
-        LUAP(L, L_NODE, CNode, lit->GetOwner());
+        LUAP(L, LC_NODE, CNode, lit->GetOwner());
     return 1;
 }
 
 static void LuaLight$Register(lua_State* L)
 {
     lua_register(L, L_LIGHT, light_new);
-    luaL_newmetatable(L, L_LIGHT);
+    luaH_newclass(L, LC_LIGHT);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
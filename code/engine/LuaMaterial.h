@@ -18,22 +18,30 @@ auto material_new(lua_State* L) -> int
         h = static_cast<unsigned int>(luaL_checkinteger(L, 2));
     }
 
-    const auto mat = static_cast<CMaterial**>(lua_newuserdata(L, sizeof(CMaterial*)));
+    CMaterial* mat;
 
     if (matName)
-        *mat = new CMaterial(TEXTURESLOT_ALBEDO, matName);
+    {
+        mat = static_cast<CMaterial*>(RESOURCES->Claim(RESOURCEKIND_MATERIAL, matName));
+
+        if (!mat)
+        {
+            mat = new CMaterial(TEXTURESLOT_ALBEDO, matName);
+            RESOURCES->Store(RESOURCEKIND_MATERIAL, matName, mat);
+        }
+    }
     else if (lua_gettop(L) == 2)
-        *mat = new CMaterial(TEXTURESLOT_ALBEDO, w, h);
+        mat = new CMaterial(TEXTURESLOT_ALBEDO, w, h);
     else
-        *mat = new CMaterial();
+        mat = new CMaterial();
 
-    luaL_setmetatable(L, L_MATERIAL);
+    luaH_newproxy(L, LC_MATERIAL, mat);
     return 1;
 }
 
 static auto material_loadfile(lua_State* L) -> int
 {
-    auto mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    auto mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const auto texName = static_cast<LPCSTR>(luaL_checkstring(L, 2));
     const auto userSlot = static_cast<unsigned int>(luaL_checkinteger(L, 3)) - 1;
 
@@ -44,7 +52,7 @@ static auto material_loadfile(lua_State* L) -> int
 
 static auto material_getres(lua_State* L) -> int
 {
-    auto mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    auto mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const unsigned int userSlot = static_cast<unsigned int>(luaL_checkinteger(L, 3)) - 1;
     LPDIRECT3DTEXTURE9 h = mat->GetTextureHandle(userSlot);
     D3DSURFACE_DESC a;
@@ -68,7 +76,7 @@ static auto material_getres(lua_State* L) -> int
 
 static auto material_loaddata(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const unsigned int userSlot = static_cast<unsigned int>(luaL_checkinteger(L, 3)) - 1;
     const unsigned int width = static_cast<unsigned int>(luaL_checkinteger(L, 4));
     const unsigned int height = static_cast<unsigned int>(luaL_checkinteger(L, 5));
@@ -81,7 +89,7 @@ static auto material_loaddata(lua_State* L) -> int
 
 static auto material_getdata(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const unsigned int userSlot = static_cast<unsigned int>(luaL_checkinteger(L, 3)) - 1;
     D3DSURFACE_DESC a;
     mat->GetTextureHandle(userSlot)->GetLevelDesc(0, &a);
@@ -107,7 +115,7 @@ static auto material_getdata(lua_State* L) -> int
 
 static auto material_setsampler(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const unsigned int sampler = static_cast<unsigned int>(luaL_checkinteger(L, 2));
     const unsigned int val = static_cast<unsigned int>(luaL_checkinteger(L, 3));
 
@@ -118,7 +126,7 @@ static auto material_setsampler(lua_State* L) -> int
 
 static auto material_getsampler(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const unsigned int sampler = static_cast<unsigned int>(luaL_checkinteger(L, 2));
 
     lua_pushinteger(L, mat->GetSamplerState(sampler));
@@ -127,7 +135,7 @@ static auto material_getsampler(lua_State* L) -> int
 
 static auto material_gethandle(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const unsigned int slot = static_cast<unsigned int>(luaL_checkinteger(L, 2)) - 1;
 
     lua_pushlightuserdata(L, static_cast<void*>(mat->GetTextureHandle(slot)));
@@ -136,7 +144,7 @@ static auto material_gethandle(lua_State* L) -> int
 
 static auto material_sethandle(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const unsigned int slot = static_cast<unsigned int>(luaL_checkinteger(L, 2)) - 1;
     const auto handle = static_cast<LPDIRECT3DTEXTURE9>(lua_touserdata(L, 3));
 
@@ -146,7 +154,7 @@ static auto material_sethandle(lua_State* L) -> int
 
 static auto material_delete(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
 
     mat->Release();
 
@@ -155,39 +163,39 @@ static auto material_delete(lua_State* L) -> int
 
 static auto material_setdiffuse(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
-    mat->SetDiffuse(luaH_getcolorlinear(L, 1));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
+    mat->SetDiffuse(luaH_getcolorlinear(L, 2));
 
     return 0;
 }
 
 static auto material_setambient(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
-    mat->SetAmbient(luaH_getcolorlinear(L, 1));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
+    mat->SetAmbient(luaH_getcolorlinear(L, 2));
 
     return 0;
 }
 
 static auto material_setemission(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
-    mat->SetEmission(luaH_getcolorlinear(L, 1));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
+    mat->SetEmission(luaH_getcolorlinear(L, 2));
 
     return 0;
 }
 
 static auto material_setspecular(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
-    mat->SetSpecular(luaH_getcolorlinear(L, 1));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
+    mat->SetSpecular(luaH_getcolorlinear(L, 2));
 
     return 0;
 }
 
 static auto material_setpower(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const auto val = static_cast<float>(luaL_checknumber(L, 2));
     mat->SetPower(val);
 
@@ -196,7 +204,7 @@ static auto material_setpower(lua_State* L) -> int
 
 static auto material_setopacity(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const auto val = static_cast<float>(luaL_checknumber(L, 2));
     mat->SetOpacity(val);
 
@@ -205,7 +213,7 @@ static auto material_setopacity(lua_State* L) -> int
 
 static auto material_setalphaistransparency(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const bool val = static_cast<bool>(lua_toboolean(L, 2));
     mat->SetAlphaIsTransparency(val);
 
@@ -214,7 +222,7 @@ static auto material_setalphaistransparency(lua_State* L) -> int
 
 static auto material_setalphatest(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const bool val = static_cast<bool>(lua_toboolean(L, 2));
     mat->SetEnableAlphaTest(val);
 
@@ -223,7 +231,7 @@ static auto material_setalphatest(lua_State* L) -> int
 
 static auto material_setalpharef(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const auto val = static_cast<DWORD>(luaL_checkinteger(L, 2));
     mat->SetAlphaRef(val);
 
@@ -232,7 +240,7 @@ static auto material_setalpharef(lua_State* L) -> int
 
 static auto material_setshaded(lua_State* L) -> int
 {
-    CMaterial* mat = *static_cast<CMaterial**>(luaL_checkudata(L, 1, L_MATERIAL));
+    CMaterial* mat = *static_cast<CMaterial**>(luaH_checkudata(L, 1, LC_MATERIAL));
     const bool val = static_cast<bool>(lua_toboolean(L, 2));
     mat->SetShaded(val);
 
@@ -242,7 +250,7 @@ static auto material_setshaded(lua_State* L) -> int
 static void LuaMaterial$Register(lua_State* L)
 {
     lua_register(L, L_MATERIAL, material_new);
-    luaL_newmetatable(L, L_MATERIAL);
+    luaH_newclass(L, LC_MATERIAL);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
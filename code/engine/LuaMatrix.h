@@ -7,21 +7,21 @@
 auto matrix_new(lua_State* L) -> int
 {
     auto* const mat = static_cast<D3DXMATRIX*>(lua_newuserdata(L, sizeof(D3DXMATRIX)));
-    D3DXMatrixIdentity(mat);
+    NMatrixIdentity(mat);
 
-    luaL_setmetatable(L, L_MATRIX);
+    luaH_setclass(L, LC_MATRIX);
     return 1;
 }
 
 static auto matrix_translate(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const D3DXVECTOR3 vec = luaH_getcomps(L);
 
     D3DXMATRIX t;
-    D3DXMatrixTranslation(&t, vec.x, vec.y, vec.z);
+    NMatrixTranslation(&t, vec.x, vec.y, vec.z);
 
-    *mat *= t;
+    NMatrixMultiply(mat, mat, &t);
 
     lua_pushvalue(L, 1);
     return 1;
@@ -29,13 +29,13 @@ static auto matrix_translate(lua_State* L) -> int
 
 static auto matrix_rotate(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const D3DXVECTOR3 vec = luaH_getcomps(L);
 
     D3DXMATRIX t;
-    D3DXMatrixRotationYawPitchRoll(&t, vec.x, vec.y, vec.z);
+    NMatrixRotationYawPitchRoll(&t, vec.x, vec.y, vec.z);
 
-    *mat *= t;
+    NMatrixMultiply(mat, mat, &t);
 
     lua_pushvalue(L, 1);
     return 1;
@@ -43,11 +43,11 @@ static auto matrix_rotate(lua_State* L) -> int
 
 static auto matrix_scale(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const D3DXVECTOR3 vec = luaH_getcomps(L);
     D3DXMATRIX t;
-    D3DXMatrixScaling(&t, vec.x, vec.y, vec.z);
-    *mat *= t;
+    NMatrixScaling(&t, vec.x, vec.y, vec.z);
+    NMatrixMultiply(mat, mat, &t);
 
     lua_pushvalue(L, 1);
     return 1;
@@ -55,12 +55,12 @@ static auto matrix_scale(lua_State* L) -> int
 
 static auto matrix_reflect(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const auto vec = luaH_getcomps(L);
     D3DXMATRIX t;
     D3DXPLANE plane(vec.x, vec.y, vec.z, vec.w);
-    D3DXMatrixReflect(&t, &plane);
-    *mat *= t;
+    NMatrixReflect(&t, &plane);
+    NMatrixMultiply(mat, mat, &t);
 
     lua_pushvalue(L, 1);
     return 1;
@@ -68,13 +68,14 @@ static auto matrix_reflect(lua_State* L) -> int
 
 static auto matrix_shadow(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
-    const auto vec = luaH_getcomps(L);
-    auto lit = luaH_getcomps(L, 1);
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
+    auto next = 0;
+    const auto vec = luaH_getcomps(L, 2, &next);
+    auto lit = luaH_getcomps(L, next);
     D3DXMATRIX t;
     D3DXPLANE plane(vec.x, vec.y, vec.z, vec.w);
-    D3DXMatrixShadow(&t, &lit, &plane);
-    *mat *= t;
+    NMatrixShadow(&t, &lit, &plane);
+    NMatrixMultiply(mat, mat, &t);
 
     lua_pushvalue(L, 1);
     return 1;
@@ -82,19 +83,19 @@ static auto matrix_shadow(lua_State* L) -> int
 
 static auto matrix_mul(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
-    auto* const matRHS = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 2, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
+    auto* const matRHS = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
 
     auto* const out = static_cast<D3DXMATRIX*>(lua_newuserdata(L, sizeof(D3DXMATRIX)));
-    D3DXMatrixMultiply(out, mat, matRHS);
+    NMatrixMultiply(out, mat, matRHS);
 
-    luaL_setmetatable(L, L_MATRIX);
+    luaH_setclass(L, LC_MATRIX);
     return 1;
 }
 
 static auto matrix_bind(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const auto kind = static_cast<float>(luaL_checknumber(L, 2));
     RENDERER->SetMatrix(static_cast<unsigned int>(kind), *mat);
 
@@ -104,22 +105,22 @@ static auto matrix_bind(lua_State* L) -> int
 
 static auto matrix_lookat(lua_State* L) -> int
 {
-    auto* mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
-    auto* const eye = static_cast<D3DXVECTOR3*>(luaL_checkudata(L, 2, L_VECTOR));
-    auto* const at = static_cast<D3DXVECTOR3*>(luaL_checkudata(L, 3, L_VECTOR));
-    auto* const up = static_cast<D3DXVECTOR3*>(luaL_checkudata(L, 4, L_VECTOR));
+    auto* mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
+    auto* const eye = static_cast<D3DXVECTOR3*>(luaH_checkudata(L, 2, LC_VECTOR));
+    auto* const at = static_cast<D3DXVECTOR3*>(luaH_checkudata(L, 3, LC_VECTOR));
+    auto* const up = static_cast<D3DXVECTOR3*>(luaH_checkudata(L, 4, LC_VECTOR));
     D3DXMATRIX t;
 
-    D3DXMatrixLookAtLH(&t, eye, at, up);
+    NMatrixLookAtLH(&t, eye, at, up);
 
-    *mat *= t;
+    NMatrixMultiply(mat, mat, &t);
     lua_pushvalue(L, 1);
     return 1;
 }
 
 static auto matrix_persp(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const auto fov = static_cast<float>(luaL_checknumber(L, 2));
     auto zNear = 0.1f;
     auto zFar = 1000.0f;
@@ -140,19 +141,19 @@ static auto matrix_persp(lua_State* L) -> int
 
     if (flipHandedness != 0)
     {
-        D3DXMatrixPerspectiveFovRH(mat,
-                                   D3DXToRadian(fov),
-                                   static_cast<float>(res.right) / static_cast<float>(res.bottom),
-                                   zNear,
-                                   zFar);
+        NMatrixPerspectiveFovRH(mat,
+                                NToRadian(fov),
+                                static_cast<float>(res.right) / static_cast<float>(res.bottom),
+                                zNear,
+                                zFar);
     }
     else
     {
-        D3DXMatrixPerspectiveFovLH(mat,
-                                   D3DXToRadian(fov),
-                                   static_cast<float>(res.right) / static_cast<float>(res.bottom),
-                                   zNear,
-                                   zFar);
+        NMatrixPerspectiveFovLH(mat,
+                                NToRadian(fov),
+                                static_cast<float>(res.right) / static_cast<float>(res.bottom),
+                                zNear,
+                                zFar);
     }
 
     lua_pushvalue(L, 1);
@@ -161,7 +162,7 @@ static auto matrix_persp(lua_State* L) -> int
 
 static auto matrix_ortho(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const auto res = RENDERER->GetSurfaceResolution();
     auto w = static_cast<float>(res.right);
     auto h = static_cast<float>(res.bottom);
@@ -190,19 +191,19 @@ static auto matrix_ortho(lua_State* L) -> int
 
     if (flipHandedness != 0)
     {
-        D3DXMatrixOrthoRH(mat,
-                          w,
-                          h,
-                          zNear,
-                          zFar);
+        NMatrixOrthoRH(mat,
+                       w,
+                       h,
+                       zNear,
+                       zFar);
     }
     else
     {
-        D3DXMatrixOrthoLH(mat,
-                          w,
-                          h,
-                          zNear,
-                          zFar);
+        NMatrixOrthoLH(mat,
+                       w,
+                       h,
+                       zNear,
+                       zFar);
     }
 
     lua_pushvalue(L, 1);
@@ -212,7 +213,7 @@ static auto matrix_ortho(lua_State* L) -> int
 
 static auto matrix_orthoex(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const auto res = RENDERER->GetSurfaceResolution();
     auto l = 0.0f;
     auto t = 0.0f;
@@ -244,17 +245,17 @@ static auto matrix_orthoex(lua_State* L) -> int
 
     if (flipHandedness != 0)
     {
-        D3DXMatrixOrthoOffCenterRH(mat,
-                                   l, r, b, t,
-                                   zNear,
-                                   zFar);
+        NMatrixOrthoOffCenterRH(mat,
+                                l, r, b, t,
+                                zNear,
+                                zFar);
     }
     else
     {
-        D3DXMatrixOrthoOffCenterLH(mat,
-                                   l, r, b, t,
-                                   zNear,
-                                   zFar);
+        NMatrixOrthoOffCenterLH(mat,
+                                l, r, b, t,
+                                zNear,
+                                zFar);
     }
 
     lua_pushvalue(L, 1);
@@ -263,7 +264,7 @@ static auto matrix_orthoex(lua_State* L) -> int
 
 static auto matrix_getfield(lua_State* L) -> int
 {
-    auto* matPtr = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* matPtr = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const auto row = static_cast<unsigned int>(luaL_checkinteger(L, 2)) - 1;
     const auto col = static_cast<unsigned int>(luaL_checkinteger(L, 3)) - 1;
     auto val = 0.0F;
@@ -273,7 +274,7 @@ static auto matrix_getfield(lua_State* L) -> int
         val = static_cast<float>(luaL_checknumber(L, 4));
         matPtr->m[row][col] = val;
         matrix_new(L);
-        auto* const newMat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 5, L_MATRIX));
+        auto* const newMat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 5, LC_MATRIX));
         *newMat = *matPtr;
         return 1;
     }
@@ -285,14 +286,14 @@ static auto matrix_getfield(lua_State* L) -> int
 
 static auto matrix_getrow(lua_State* L) -> int
 {
-    auto* const matPtr = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const matPtr = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const auto row = static_cast<unsigned int>(luaL_checkinteger(L, 2)) - 1;
 
     if (lua_gettop(L) >= 3)
     {
-        auto* const vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 3, L_VECTOR));
+        auto* const vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
         matrix_new(L);
-        auto* const newMat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 4, L_MATRIX));
+        auto* const newMat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 4, LC_MATRIX));
         *newMat = *matPtr;
 
         newMat[row][0] = vec->x;
@@ -304,21 +305,21 @@ static auto matrix_getrow(lua_State* L) -> int
 
     auto mat = *matPtr;
     auto* const vec = static_cast<D3DXVECTOR4*>(lua_newuserdata(L, sizeof(D3DXVECTOR4)));
-    luaL_setmetatable(L, L_VECTOR);
+    luaH_setclass(L, LC_VECTOR);
     *vec = D3DXVECTOR4(mat(row, 0), mat(row, 1), mat(row, 2), mat(row, 3));
     return 1;
 }
 
 static auto matrix_getcol(lua_State* L) -> int
 {
-    auto* const matPtr = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const matPtr = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     const auto col = static_cast<unsigned int>(luaL_checkinteger(L, 2)) - 1;
 
     if (lua_gettop(L) >= 3)
     {
-        auto* const vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 3, L_VECTOR));
+        auto* const vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
         matrix_new(L);
-        auto* const newMat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 4, L_MATRIX));
+        auto* const newMat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 4, LC_MATRIX));
         *newMat = *matPtr;
 
         newMat[0][col] = vec->x;
@@ -330,18 +331,18 @@ static auto matrix_getcol(lua_State* L) -> int
 
     auto mat = *matPtr;
     auto* const vec = static_cast<D3DXVECTOR4*>(lua_newuserdata(L, sizeof(D3DXVECTOR4)));
-    luaL_setmetatable(L, L_VECTOR);
+    luaH_setclass(L, LC_VECTOR);
     *vec = D3DXVECTOR4(mat(0, col), mat(1, col), mat(2, col), mat(3, col));
     return 1;
 }
 
 static auto matrix_inverse(lua_State* L) -> int
 {
-    auto* const mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 1, L_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
     D3DXMATRIX t;
     float d;
 
-    auto* ok = D3DXMatrixInverse(&t, &d, mat);
+    auto* ok = NMatrixInverse(&t, &d, mat);
 
     if (ok == nullptr)
     {
@@ -365,13 +366,140 @@ static auto matrix_inverse(lua_State* L) -> int
     return 1;
 }
 
+static auto matrix_identity(lua_State* L) -> int
+{
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
+    NMatrixIdentity(mat);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto matrix_set(lua_State* L) -> int
+{
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
+    auto* const matRHS = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
+    *mat = *matRHS;
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto matrix_mulinplace(lua_State* L) -> int
+{
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
+    auto* const matRHS = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
+    NMatrixMultiply(mat, mat, matRHS);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/*
+ * Overwrites self with scale * rotation * translation, the same matrix as
+ * Matrix():scale(s):rotate(r):translate(t) but built in a single call. Any of
+ * the arguments can be nil, the scale can be a number or a Vector and the
+ * rotation holds yaw, pitch and roll.
+ */
+static auto matrix_settrs(lua_State* L) -> int
+{
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
+    D3DXMATRIX t;
+
+    if (lua_isnumber(L, 4))
+    {
+        const auto s = static_cast<float>(lua_tonumber(L, 4));
+        NMatrixScaling(mat, s, s, s);
+    }
+    else if (!lua_isnoneornil(L, 4))
+    {
+        auto* const scale = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 4, LC_VECTOR));
+        NMatrixScaling(mat, scale->x, scale->y, scale->z);
+    }
+    else
+    {
+        NMatrixIdentity(mat);
+    }
+
+    if (!lua_isnoneornil(L, 3))
+    {
+        auto* const rot = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
+        NMatrixRotationYawPitchRoll(&t, rot->x, rot->y, rot->z);
+        NMatrixMultiply(mat, mat, &t);
+    }
+
+    if (!lua_isnoneornil(L, 2))
+    {
+        auto* const pos = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+        mat->_41 += pos->x;
+        mat->_42 += pos->y;
+        mat->_43 += pos->z;
+    }
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* Matrix.mul(out, a, b), out may be one of the operands */
+static auto matrix_multo(lua_State* L) -> int
+{
+    auto* const out = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 1, LC_MATRIX));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
+    auto* const matRHS = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 3, LC_MATRIX));
+
+    NMatrixMultiply(out, mat, matRHS);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* Matrix.row(out, m, i) writes the row into the out Vector */
+static auto matrix_rowto(lua_State* L) -> int
+{
+    auto* const out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
+    const auto row = static_cast<unsigned int>(luaL_checkinteger(L, 3)) - 1;
+
+    luaL_argcheck(L, row < 4, 3, "row out of range");
+    *out = D3DXVECTOR4(mat->m[row][0], mat->m[row][1], mat->m[row][2], mat->m[row][3]);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* Matrix.col(out, m, i) writes the column into the out Vector */
+static auto matrix_colto(lua_State* L) -> int
+{
+    auto* const out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    auto* const mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
+    const auto col = static_cast<unsigned int>(luaL_checkinteger(L, 3)) - 1;
+
+    luaL_argcheck(L, col < 4, 3, "column out of range");
+    *out = D3DXVECTOR4(mat->m[0][col], mat->m[1][col], mat->m[2][col], mat->m[3][col]);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
 static void LuaMatrix$Register(lua_State* L)
 {
-    lua_register(L, L_MATRIX, matrix_new);
-    luaL_newmetatable(L, L_MATRIX);
+    lua_newtable(L);
+    REGC("mul", matrix_multo);
+    REGC("row", matrix_rowto);
+    REGC("col", matrix_colto);
+    lua_newtable(L);
+    REGC("__call", matrix_new);
+    lua_setmetatable(L, -2);
+    lua_setglobal(L, L_MATRIX);
+
+    luaH_newclass(L, LC_MATRIX);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
+    // plain values, snapshots copy them as they are
+    lua_pushboolean(L, TRUE);
+    lua_setfield(L, -2, "__persist");
+
     REGC("translate", matrix_translate);
     REGC("rotate", matrix_rotate);
     REGC("scale", matrix_scale);
@@ -388,5 +516,10 @@ static void LuaMatrix$Register(lua_State* L)
     REGC("row", matrix_getrow);
     REGC("col", matrix_getcol);
 
+    REGC("identity", matrix_identity);
+    REGC("set", matrix_set);
+    REGC("mulInPlace", matrix_mulinplace);
+    REGC("setTRS", matrix_settrs);
+
     lua_pop(L, 1);
 }
@@ -8,26 +8,22 @@
 
 auto mesh_new(lua_State* L) -> int
 {
-    *static_cast<CMesh**>(lua_newuserdata(L, sizeof(CMesh*))) = new CMesh();
-
-    luaL_setmetatable(L, L_MESH);
+    luaH_newproxy(L, LC_MESH, new CMesh());
     return 1;
 }
 
 static auto mesh_clone(lua_State* L) -> int
 {
-    auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
-    *static_cast<CMesh**>(lua_newuserdata(L, sizeof(CMesh*))) = mesh->Clone();
-
-    luaL_setmetatable(L, L_MESH);
+    auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
+    luaH_newproxy(L, LC_MESH, mesh->Clone());
     return 1;
 }
 
 static auto mesh_addfgroup(lua_State* L) -> int
 {
-    auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
-    auto fg = *static_cast<CFaceGroup**>(luaL_checkudata(L, 2, L_FACEGROUP));
-    const auto mat = static_cast<D3DMATRIX*>(luaL_checkudata(L, 3, L_MATRIX));
+    auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
+    auto fg = *static_cast<CFaceGroup**>(luaH_checkudata(L, 2, LC_FACEGROUP));
+    const auto mat = static_cast<D3DMATRIX*>(luaH_checkudata(L, 3, LC_MATRIX));
 
     mesh->AddFaceGroup(fg->Clone(), *mat);
 
@@ -37,7 +33,10 @@ static auto mesh_addfgroup(lua_State* L) -> int
 
 static auto mesh_getfgroups(lua_State* L) -> int
 {
-    const auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
+    const auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
+
+    if (luaH_getlist(L, 1, LL_FGROUPS, mesh->GetRevision()))
+        return 1;
 
     lua_newtable(L);
 
@@ -45,21 +44,22 @@ static auto mesh_getfgroups(lua_State* L) -> int
     {
         const auto fg = mesh->GetFGroupData()[i];
         lua_pushinteger(L, i + 1ULL);
-        LUAP(L, L_FACEGROUP, CFaceGroup, fg);
+        LUAP(L, LC_FACEGROUP, CFaceGroup, fg);
         lua_settable(L, -3);
     }
 
+    luaH_setlist(L, 1, LL_FGROUPS, mesh->GetRevision());
     return 1;
 }
 
 static auto mesh_draw(lua_State* L) -> int
 {
-    auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
+    auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
     auto mat = &D3DXMATRIX();
 
     if (lua_gettop(L) >= 2)
     {
-        mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 2, L_MATRIX));
+        mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
     }
 
     mesh->Draw(*mat);
@@ -70,7 +70,7 @@ static auto mesh_draw(lua_State* L) -> int
 
 static auto mesh_delete(lua_State* L) -> int
 {
-    auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
+    auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
 
     mesh->Release();
 
@@ -79,7 +79,7 @@ static auto mesh_delete(lua_State* L) -> int
 
 static auto mesh_clear(lua_State* L) -> int
 {
-    auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
+    auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
 
     mesh->Clear();
 
@@ -88,7 +88,7 @@ static auto mesh_clear(lua_State* L) -> int
 
 static auto mesh_setname(lua_State* L) -> int
 {
-    auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
+    auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
     const auto meshName = luaL_checkstring(L, 2);
 
     mesh->SetName(meshName);
@@ -98,7 +98,7 @@ static auto mesh_setname(lua_State* L) -> int
 
 static auto mesh_getname(lua_State* L) -> int
 {
-    auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
+    auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
 
     lua_pushstring(L, mesh->GetName().Str());
     return 1;
@@ -106,12 +106,12 @@ static auto mesh_getname(lua_State* L) -> int
 
 static auto mesh_setmaterial(lua_State* L) -> int
 {
-    const auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
+    const auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
     CMaterial* mat = nullptr;
 
     if (lua_gettop(L) == 2)
     {
-        mat = *static_cast<CMaterial**>(luaL_checkudata(L, 2, L_MATERIAL));
+        mat = *static_cast<CMaterial**>(luaH_checkudata(L, 2, LC_MATERIAL));
     }
 
     for (unsigned int i = 0; i < mesh->GetNumFGroups(); ++i)
@@ -126,7 +126,7 @@ static auto mesh_setmaterial(lua_State* L) -> int
 
 static auto mesh_getmaterial(lua_State* L) -> int
 {
-    const auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
+    const auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
     const auto matid = static_cast<DWORD>(luaL_checkinteger(L, 2)) - 1;
 
     if (matid < 0 || matid >= mesh->GetNumFGroups())
@@ -138,7 +138,7 @@ static auto mesh_getmaterial(lua_State* L) -> int
         if (!fg->GetMaterial())
             lua_pushnil(L);
         else
-            LUAP(L, L_MATERIAL, CMaterial, fg->GetMaterial());
+            LUAP(L, LC_MATERIAL, CMaterial, fg->GetMaterial());
     }
 
     return 1;
@@ -146,18 +146,18 @@ static auto mesh_getmaterial(lua_State* L) -> int
 
 static auto mesh_getowner(lua_State* L) -> int
 {
-    auto mesh = *static_cast<CMesh**>(luaL_checkudata(L, 1, L_MESH));
+    auto mesh = *static_cast<CMesh**>(luaH_checkudata(L, 1, LC_MESH));
     if (!mesh->GetOwner())
         lua_pushnil(L);
     else
-        LUAP(L, L_NODE, CNode, mesh->GetOwner());
+        LUAP(L, LC_NODE, CNode, mesh->GetOwner());
     return 1;
 }
 
 static void LuaMesh$Register(lua_State* L)
 {
     lua_register(L, L_MESH, mesh_new);
-    luaL_newmetatable(L, L_MESH);
+    luaH_newclass(L, LC_MESH);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
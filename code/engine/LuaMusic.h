@@ -3,35 +3,43 @@
 auto music_new(lua_State* L) -> int
 {
     const auto path = (LPSTR)luaL_checkstring(L, 1);
-    *static_cast<CMusic**>(lua_newuserdata(L, sizeof(CMusic*))) = new CMusic(path);
-    luaL_setmetatable(L, L_MUSIC);
+    auto snd = static_cast<CMusic*>(RESOURCES->Claim(RESOURCEKIND_MUSIC, path));
+
+    if (!snd)
+    {
+        snd = new CMusic(path);
+        RESOURCES->Store(RESOURCEKIND_MUSIC, path, snd);
+    }
+
+    *static_cast<CMusic**>(lua_newuserdata(L, sizeof(CMusic*))) = snd;
+    luaH_setclass(L, LC_MUSIC);
     return 1;
 }
 
 auto music_play(lua_State* L) -> int
 {
-    auto snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    auto snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     snd->Play();
     return 0;
 }
 
 auto music_pause(lua_State* L) -> int
 {
-    auto snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    auto snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     snd->Pause();
     return 0;
 }
 
 auto music_stop(lua_State* L) -> int
 {
-    auto snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    auto snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     snd->Stop();
     return 0;
 }
 
 auto music_setvolume(lua_State* L) -> int
 {
-    auto snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    auto snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     const auto vol = static_cast<LONG>(luaL_checkinteger(L, 2));
     snd->SetVolume(vol);
     return 0;
@@ -39,7 +47,7 @@ auto music_setvolume(lua_State* L) -> int
 
 auto music_setpan(lua_State* L) -> int
 {
-    CMusic* snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    CMusic* snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     const LONG pan = static_cast<LONG>(luaL_checkinteger(L, 2));
     snd->SetPan(pan);
     return 0;
@@ -47,28 +55,28 @@ auto music_setpan(lua_State* L) -> int
 
 auto music_getvolume(lua_State* L) -> int
 {
-    CMusic* snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    CMusic* snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     lua_pushinteger(L, snd->GetVolume());
     return 1;
 }
 
 auto music_getpan(lua_State* L) -> int
 {
-    CMusic* snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    CMusic* snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     lua_pushinteger(L, snd->GetPan());
     return 1;
 }
 
 auto music_playing(lua_State* L) -> int
 {
-    CMusic* snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    CMusic* snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     lua_pushboolean(L, snd->IsPlaying());
     return 1;
 }
 
 auto music_setpos(lua_State* L) -> int
 {
-    CMusic* snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    CMusic* snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     const auto pos = static_cast<DWORD>(luaL_checkinteger(L, 2));
     snd->SetCurrentPosition(pos);
     return 0;
@@ -76,21 +84,21 @@ auto music_setpos(lua_State* L) -> int
 
 auto music_getpos(lua_State* L) -> int
 {
-    CMusic* snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    CMusic* snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     lua_pushinteger(L, snd->GetCurrentPosition());
     return 1;
 }
 
 auto music_getsize(lua_State* L) -> int
 {
-    CMusic* snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    CMusic* snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     lua_pushinteger(L, snd->GetTotalSize());
     return 1;
 }
 
 static auto music_delete(lua_State* L) -> int
 {
-    CMusic* snd = *static_cast<CMusic**>(luaL_checkudata(L, 1, L_MUSIC));
+    CMusic* snd = *static_cast<CMusic**>(luaH_checkudata(L, 1, LC_MUSIC));
     snd->Release();
 
     return 0;
@@ -99,7 +107,7 @@ static auto music_delete(lua_State* L) -> int
 static void LuaMusic$Register(lua_State* L)
 {
     lua_register(L, L_MUSIC, music_new);
-    luaL_newmetatable(L, L_MUSIC);
+    luaH_newclass(L, LC_MUSIC);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
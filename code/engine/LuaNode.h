@@ -7,25 +7,24 @@
 #include "Light.h"
 #include "Node.h"
 #include "Scene.h"
+#include "MetadataStore.h"
 
 auto node_new(lua_State* L) -> int
 {
-    *static_cast<CNode**>(lua_newuserdata(L, sizeof(CNode*))) = new CNode();
-    luaL_setmetatable(L, L_NODE);
+    luaH_newproxy(L, LC_NODE, new CNode());
     return 1;
 }
 
 static auto node_clone(lua_State* L) -> int
 {
-    auto node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
-    *static_cast<CNode**>(lua_newuserdata(L, sizeof(CNode*))) = node->Clone();
-    luaL_setmetatable(L, L_NODE);
+    auto node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
+    luaH_newproxy(L, LC_NODE, node->Clone());
     return 1;
 }
 
 static auto node_getname(lua_State* L) -> int
 {
-    auto node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    auto node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
     lua_pushstring(L, node->GetName().Str());
 
     return 1;
@@ -33,7 +32,7 @@ static auto node_getname(lua_State* L) -> int
 
 static auto node_setname(lua_State* L) -> int
 {
-    auto node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    auto node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
     const auto name = (LPSTR)luaL_checkstring(L, 2);
     node->SetName(name);
 
@@ -42,30 +41,45 @@ static auto node_setname(lua_State* L) -> int
 
 static auto node_getmeshes(lua_State* L) -> int
 {
-    auto node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    auto node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
+
+    if (luaH_getlist(L, 1, LL_MESHES, node->GetRevision()))
+        return 1;
 
     lua_newtable(L);
 
     for (unsigned int i = 0; i < node->GetNumMeshes(); i++)
     {
-        const auto mesh = node->GetMeshes()[i];
+        const auto mesh = node->GetMeshData()[i];
         lua_pushinteger(L, i + 1ULL);
-        LUAP(L, L_MESH, CMesh, mesh);
+        LUAP(L, LC_MESH, CMesh, mesh);
         lua_settable(L, -3);
     }
 
+    luaH_setlist(L, 1, LL_MESHES, node->GetRevision());
     return 1;
 }
 
 static auto node_getmeshparts(lua_State* L) -> int
 {
-    auto node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    auto node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
+
+    // revisions only ever grow, the sum changes whenever any of them does
+    lua_Integer rev = node->GetRevision();
+
+    for (unsigned int i = 0; i < node->GetNumMeshes(); i++)
+    {
+        rev += node->GetMeshData()[i]->GetRevision();
+    }
+
+    if (luaH_getlist(L, 1, LL_MESHPARTS, rev))
+        return 1;
 
     lua_newtable(L);
 
     for (unsigned int i = 0; i < node->GetNumMeshes(); i++)
     {
-        CMesh* mesh = node->GetMeshes()[i];
+        CMesh* mesh = node->GetMeshData()[i];
         lua_pushinteger(L, i + 1ULL);
         {
             lua_newtable(L);
@@ -73,19 +87,23 @@ static auto node_getmeshparts(lua_State* L) -> int
             {
                 CFaceGroup* fg = mesh->GetFGroupData()[i];
                 lua_pushinteger(L, i + 1ULL);
-                LUAP(L, L_FACEGROUP, CFaceGroup, fg);
+                LUAP(L, LC_FACEGROUP, CFaceGroup, fg);
                 lua_settable(L, -3);
             }
         }
         lua_settable(L, -3);
     }
 
+    luaH_setlist(L, 1, LL_MESHPARTS, rev);
     return 1;
 }
 
 static auto node_getlights(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
+
+    if (luaH_getlist(L, 1, LL_LIGHTS, node->GetRevision()))
+        return 1;
 
     lua_newtable(L);
 
@@ -93,16 +111,20 @@ static auto node_getlights(lua_State* L) -> int
     {
         CLight* lit = node->GetLightData()[i];
         lua_pushinteger(L, i + 1ULL);
-        LUAP(L, L_LIGHT, CLight, lit);
+        LUAP(L, LC_LIGHT, CLight, lit);
         lua_settable(L, -3);
     }
 
+    luaH_setlist(L, 1, LL_LIGHTS, node->GetRevision());
     return 1;
 }
 
 static auto node_getnodes(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
+
+    if (luaH_getlist(L, 1, LL_NODES, node->GetRevision()))
+        return 1;
 
     lua_newtable(L);
 
@@ -110,16 +132,17 @@ static auto node_getnodes(lua_State* L) -> int
     {
         CNode* mg = node->GetNodeData()[i];
         lua_pushinteger(L, i + 1ULL);
-        LUAP(L, L_NODE, CNode, mg);
+        LUAP(L, LC_NODE, CNode, mg);
         lua_settable(L, -3);
     }
 
+    luaH_setlist(L, 1, LL_NODES, node->GetRevision());
     return 1;
 }
 
 static auto node_gettargets(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
 
     lua_newtable(L);
 
@@ -141,14 +164,14 @@ static auto node_gettargets(lua_State* L) -> int
 
 static auto node_findmesh(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
     const auto meshName = (LPSTR)luaL_checkstring(L, 2);
 
     CMesh* mg = node->FindMesh(meshName);
 
     if (mg)
     {
-        LUAP(L, L_MESH, CMesh, mg);
+        LUAP(L, LC_MESH, CMesh, mg);
     }
     else lua_pushnil(L);
 
@@ -157,14 +180,14 @@ static auto node_findmesh(lua_State* L) -> int
 
 static auto node_findlight(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
     const auto lightName = (LPSTR)luaL_checkstring(L, 2);
 
     CLight* mg = node->FindLight(lightName);
 
     if (mg)
     {
-        LUAP(L, L_LIGHT, CLight, mg);
+        LUAP(L, LC_LIGHT, CLight, mg);
     }
     else lua_pushnil(L);
 
@@ -173,14 +196,14 @@ static auto node_findlight(lua_State* L) -> int
 
 static auto node_findnode(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
     const auto childName = (LPSTR)luaL_checkstring(L, 2);
 
     CNode* mg = node->FindNode(childName);
 
     if (mg)
     {
-        LUAP(L, L_NODE, CNode, mg);
+        LUAP(L, LC_NODE, CNode, mg);
     }
     else lua_pushnil(L);
 
@@ -189,7 +212,7 @@ static auto node_findnode(lua_State* L) -> int
 
 static auto node_findtarget(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
     const auto targetName = (LPSTR)luaL_checkstring(L, 2);
 
     CNode* mg = node->FindNode(targetName);
@@ -206,7 +229,7 @@ static auto node_findtarget(lua_State* L) -> int
 
 static auto node_gettransform(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
 
     matrix_new(L);
     *static_cast<D3DXMATRIX*>(lua_touserdata(L, 2)) = node->GetTransform();
@@ -216,8 +239,8 @@ static auto node_gettransform(lua_State* L) -> int
 
 static auto node_settransform(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
-    const D3DXMATRIX mat = *static_cast<D3DXMATRIX*>(luaL_checkudata(L, 2, L_MATRIX));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
+    const D3DXMATRIX mat = *static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
 
     node->SetTransform(mat);
     return 0;
@@ -225,7 +248,7 @@ static auto node_settransform(lua_State* L) -> int
 
 static auto node_getfinaltransform(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
 
     matrix_new(L);
     *static_cast<D3DXMATRIX*>(lua_touserdata(L, 2)) = node->GetFinalTransform();
@@ -235,13 +258,13 @@ static auto node_getfinaltransform(lua_State* L) -> int
 
 static auto node_draw(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
     D3DXMATRIX* mat = &D3DXMATRIX();
-    D3DXMatrixIdentity(mat);
+    NMatrixIdentity(mat);
 
     if (lua_gettop(L) >= 2)
     {
-        mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 2, L_MATRIX));
+        mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
     }
 
     node->Draw(*mat);
@@ -252,8 +275,8 @@ static auto node_draw(lua_State* L) -> int
 
 static auto node_addnode(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
-    CNode* child = *static_cast<CNode**>(luaL_checkudata(L, 2, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
+    CNode* child = *static_cast<CNode**>(luaH_checkudata(L, 2, LC_NODE));
 
     child->AddRef();
     child->SetParent(node);
@@ -265,11 +288,11 @@ static auto node_addnode(lua_State* L) -> int
 
 static auto node_addmesh(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
 
-    if (luaL_testudata(L, 2, L_MESH))
+    if (luaH_testudata(L, 2, LC_MESH))
     {
-        CMesh* mesh = *static_cast<CMesh**>(luaL_checkudata(L, 2, L_MESH));
+        CMesh* mesh = *static_cast<CMesh**>(luaH_checkudata(L, 2, LC_MESH));
         CMesh* clonedMesh = mesh->Clone();
 
         if (mesh->GetOwner())
@@ -283,9 +306,9 @@ static auto node_addmesh(lua_State* L) -> int
         node->AddMesh(clonedMesh);
     }
 
-    if (luaL_testudata(L, 2, L_SCENE))
+    if (luaH_testudata(L, 2, LC_SCENE))
     {
-        CScene* child = *static_cast<CScene**>(luaL_checkudata(L, 2, L_SCENE));
+        CScene* child = *static_cast<CScene**>(luaH_checkudata(L, 2, LC_SCENE));
 
         for (auto& m : child->GetMeshes())
         {
@@ -306,14 +329,14 @@ static auto node_addmesh(lua_State* L) -> int
 
 static auto node_drawsubset(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
     const unsigned int subset = static_cast<unsigned int>(luaL_checkinteger(L, 2)) - 1;
     D3DXMATRIX* mat = &D3DXMATRIX();
-    D3DXMatrixIdentity(mat);
+    NMatrixIdentity(mat);
 
     if (lua_gettop(L) >= 3)
     {
-        mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 3, L_MATRIX));
+        mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 3, LC_MATRIX));
     }
 
     node->DrawSubset(subset, *mat);
@@ -324,21 +347,45 @@ static auto node_drawsubset(lua_State* L) -> int
 
 static auto node_getmeta(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
     const auto meta = static_cast<LPCSTR>(luaL_checkstring(L, 2));
 
-    const METADATA_RESULT res = node->GetMetadata(meta);
+    const auto* const e = node->GetMetadata(meta);
 
-    if (res.found)
-        lua_pushstring(L, res.value.c_str());
-    else lua_pushnil(L);
+    if (e == nullptr)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    switch (e->kind)
+    {
+    case METAKIND_BOOL:
+        lua_pushboolean(L, e->b);
+        break;
+    case METAKIND_INT:
+        lua_pushinteger(L, e->i);
+        break;
+    case METAKIND_DOUBLE:
+        lua_pushnumber(L, e->d);
+        break;
+    case METAKIND_VEC3:
+        *vector4_ctor(L) = D3DXVECTOR4(e->v[0], e->v[1], e->v[2], 0.0f);
+        break;
+    case METAKIND_STRING:
+        lua_pushstring(L, node->GetMetadataStore()->GetString(e));
+        break;
+    default:
+        lua_pushnil(L);
+        break;
+    }
 
     return 1;
 }
 
 static auto node_delete(lua_State* L) -> int
 {
-    CNode* node = *static_cast<CNode**>(luaL_checkudata(L, 1, L_NODE));
+    CNode* node = *static_cast<CNode**>(luaH_checkudata(L, 1, LC_NODE));
 
     node->Release();
 
@@ -349,7 +396,7 @@ static auto node_delete(lua_State* L) -> int
 static void LuaNode$Register(lua_State* L)
 {
     lua_register(L, L_NODE, node_new);
-    luaL_newmetatable(L, L_NODE);
+    luaH_newclass(L, LC_NODE);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
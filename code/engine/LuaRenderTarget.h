@@ -21,13 +21,13 @@ auto rtt_new(lua_State* L) -> int
     const auto rtt = static_cast<CRenderTarget**>(lua_newuserdata(L, sizeof(CRenderTarget*)));
     *rtt = new CRenderTarget(w, h, kind);
 
-    luaL_setmetatable(L, L_RENDERTARGET);
+    luaH_setclass(L, LC_RENDERTARGET);
     return (*rtt)->GetSurfaceHandle() != nullptr;
 }
 
 static auto rtt_gethandle(lua_State* L) -> int
 {
-    auto rtt = *static_cast<CRenderTarget**>(luaL_checkudata(L, 1, L_RENDERTARGET));
+    auto rtt = *static_cast<CRenderTarget**>(luaH_checkudata(L, 1, LC_RENDERTARGET));
 
     lua_pushlightuserdata(L, static_cast<void*>(rtt->GetTextureHandle()));
     return 1;
@@ -35,7 +35,7 @@ static auto rtt_gethandle(lua_State* L) -> int
 
 static auto rtt_delete(lua_State* L) -> int
 {
-    auto rtt = *static_cast<CRenderTarget**>(luaL_checkudata(L, 1, L_RENDERTARGET));
+    auto rtt = *static_cast<CRenderTarget**>(luaH_checkudata(L, 1, LC_RENDERTARGET));
 
     rtt->Release();
     return 0;
@@ -43,7 +43,7 @@ static auto rtt_delete(lua_State* L) -> int
 
 static auto rtt_bind(lua_State* L) -> int
 {
-    auto rtt = *static_cast<CRenderTarget**>(luaL_checkudata(L, 1, L_RENDERTARGET));
+    auto rtt = *static_cast<CRenderTarget**>(luaH_checkudata(L, 1, LC_RENDERTARGET));
 
     rtt->Bind();
     return 0;
@@ -52,7 +52,7 @@ static auto rtt_bind(lua_State* L) -> int
 static void LuaRenderTarget$Register(lua_State* L)
 {
     lua_register(L, L_RENDERTARGET, rtt_new);
-    luaL_newmetatable(L, L_RENDERTARGET);
+    luaH_newclass(L, LC_RENDERTARGET);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
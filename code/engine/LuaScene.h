@@ -23,37 +23,60 @@ auto scene_new(lua_State* L) -> int
     if (lua_gettop(L) >= 3)
         optimizeMesh = static_cast<unsigned int>(lua_toboolean(L, 3));
 
-    const auto scene = static_cast<CScene**>(lua_newuserdata(L, sizeof(CScene*)));
-    *scene = new CScene();
+    CScene* scene;
 
     if (modelPath)
-        if (!(*scene)->LoadScene(modelPath, loadMaterials, optimizeMesh))
-            return 0;
+    {
+        const auto key = CString::Format("%s|%d|%d", modelPath, loadMaterials, optimizeMesh);
+        scene = static_cast<CScene*>(RESOURCES->Claim(RESOURCEKIND_SCENE, key));
+
+        if (!scene)
+        {
+            scene = new CScene();
+
+            if (!scene->LoadScene(modelPath, loadMaterials, optimizeMesh))
+            {
+                scene->Release();
+                return 0;
+            }
+
+            RESOURCES->Store(RESOURCEKIND_SCENE, key, scene);
+        }
+    }
+    else
+        scene = new CScene();
 
-    luaL_setmetatable(L, L_SCENE);
+    luaH_newproxy(L, LC_SCENE, scene);
     return 1;
 }
 
 static auto scene_getmeshes(lua_State* L) -> int
 {
-    auto scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    auto scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
+
+    if (luaH_getlist(L, 1, LL_MESHES, scene->GetRevision()))
+        return 1;
 
     lua_newtable(L);
 
     for (unsigned int i = 0; i < scene->GetNumMeshes(); i++)
     {
-        const auto mesh = scene->GetMeshes()[i];
+        const auto mesh = scene->GetMeshData()[i];
         lua_pushinteger(L, i + 1ULL);
-        LUAP(L, L_MESH, CMesh, mesh);
+        LUAP(L, LC_MESH, CMesh, mesh);
         lua_settable(L, -3);
     }
 
+    luaH_setlist(L, 1, LL_MESHES, scene->GetRevision());
     return 1;
 }
 
 static auto scene_getlights(lua_State* L) -> int
 {
-    auto scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    auto scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
+
+    if (luaH_getlist(L, 1, LL_LIGHTS, scene->GetRevision()))
+        return 1;
 
     lua_newtable(L);
 
@@ -61,16 +84,17 @@ static auto scene_getlights(lua_State* L) -> int
     {
         const auto lit = scene->GetLightData()[i];
         lua_pushinteger(L, i + 1ULL);
-        LUAP(L, L_LIGHT, CLight, lit);
+        LUAP(L, LC_LIGHT, CLight, lit);
         lua_settable(L, -3);
     }
 
+    luaH_setlist(L, 1, LL_LIGHTS, scene->GetRevision());
     return 1;
 }
 
 static auto scene_gettargets(lua_State* L) -> int
 {
-    auto scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    auto scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
 
     lua_newtable(L);
 
@@ -92,7 +116,10 @@ static auto scene_gettargets(lua_State* L) -> int
 
 static auto scene_getflattennodes(lua_State* L) -> int
 {
-    auto scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    auto scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
+
+    if (luaH_getlist(L, 1, LL_NODES, scene->GetRevision()))
+        return 1;
 
     lua_newtable(L);
 
@@ -100,22 +127,23 @@ static auto scene_getflattennodes(lua_State* L) -> int
     {
         const auto tgt = scene->GetNodeData()[i];
         lua_pushinteger(L, i + 1ULL);
-        LUAP(L, L_NODE, CNode, tgt);
+        LUAP(L, LC_NODE, CNode, tgt);
         lua_settable(L, -3);
     }
 
+    luaH_setlist(L, 1, LL_NODES, scene->GetRevision());
     return 1;
 }
 
 static auto scene_draw(lua_State* L) -> int
 {
-    auto scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    auto scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
     auto mat = &D3DXMATRIX();
-    D3DXMatrixIdentity(mat);
+    NMatrixIdentity(mat);
 
     if (lua_gettop(L) >= 2)
     {
-        mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 2, L_MATRIX));
+        mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 2, LC_MATRIX));
     }
 
     scene->Draw(*mat);
@@ -126,14 +154,14 @@ static auto scene_draw(lua_State* L) -> int
 
 static auto scene_drawsubset(lua_State* L) -> int
 {
-    auto scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    auto scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
     const auto subset = static_cast<unsigned int>(luaL_checkinteger(L, 2)) - 1;
     auto mat = &D3DXMATRIX();
-    D3DXMatrixIdentity(mat);
+    NMatrixIdentity(mat);
 
     if (lua_gettop(L) >= 3)
     {
-        mat = static_cast<D3DXMATRIX*>(luaL_checkudata(L, 3, L_MATRIX));
+        mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 3, LC_MATRIX));
     }
 
     scene->DrawSubset(subset, *mat);
@@ -144,7 +172,7 @@ static auto scene_drawsubset(lua_State* L) -> int
 
 static auto scene_loadmodel(lua_State* L) -> int
 {
-    auto scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    auto scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
     const auto meshName = (LPSTR)luaL_checkstring(L, 2);
     auto loadMaterials = TRUE;
     auto optimizeMesh = FALSE;
@@ -163,14 +191,14 @@ static auto scene_loadmodel(lua_State* L) -> int
 
 static auto scene_findmesh(lua_State* L) -> int
 {
-    auto scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    auto scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
     const auto meshName = (LPSTR)luaL_checkstring(L, 2);
 
     CMesh* mg = scene->FindMesh(meshName);
 
     if (mg)
     {
-        LUAP(L, L_MESH, CMesh, mg);
+        LUAP(L, LC_MESH, CMesh, mg);
     }
     else lua_pushnil(L);
 
@@ -179,14 +207,14 @@ static auto scene_findmesh(lua_State* L) -> int
 
 static auto scene_findlight(lua_State* L) -> int
 {
-    CScene* scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    CScene* scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
     const auto lightName = (LPSTR)luaL_checkstring(L, 2);
 
     CLight* mg = scene->FindLight(lightName);
 
     if (mg)
     {
-        LUAP(L, L_LIGHT, CLight, mg);
+        LUAP(L, LC_LIGHT, CLight, mg);
     }
     else lua_pushnil(L);
 
@@ -195,7 +223,7 @@ static auto scene_findlight(lua_State* L) -> int
 
 static auto scene_findtarget(lua_State* L) -> int
 {
-    CScene* scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    CScene* scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
     const auto targetName = (LPSTR)luaL_checkstring(L, 2);
 
     CNode* mg = scene->FindNode(targetName);
@@ -212,13 +240,13 @@ static auto scene_findtarget(lua_State* L) -> int
 
 static auto scene_getrootnode(lua_State* L) -> int
 {
-    CScene* scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    CScene* scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
 
     CNode* mg = scene->GetRootNode();
 
     if (mg)
     {
-        LUAP(L, L_NODE, CNode, mg);
+        LUAP(L, LC_NODE, CNode, mg);
     }
     else lua_pushnil(L);
 
@@ -227,7 +255,7 @@ static auto scene_getrootnode(lua_State* L) -> int
 
 static auto scene_delete(lua_State* L) -> int
 {
-    CScene* scene = *static_cast<CScene**>(luaL_checkudata(L, 1, L_SCENE));
+    CScene* scene = *static_cast<CScene**>(luaH_checkudata(L, 1, LC_SCENE));
 
     scene->Release();
 
@@ -239,7 +267,7 @@ static void LuaScene$Register(lua_State* L)
 {
     lua_register(L, L_SCENE, scene_new);
     lua_register(L, "Model", scene_new);
-    luaL_newmetatable(L, L_SCENE);
+    luaH_newclass(L, LC_SCENE);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
@@ -3,35 +3,43 @@
 auto sound_new(lua_State* L) -> int
 {
     const auto wavPath = (LPSTR)luaL_checkstring(L, 1);
-    *static_cast<CSound**>(lua_newuserdata(L, sizeof(CSound*))) = new CSound(wavPath);
-    luaL_setmetatable(L, L_SOUND);
+    auto snd = static_cast<CSound*>(RESOURCES->Claim(RESOURCEKIND_SOUND, wavPath));
+
+    if (!snd)
+    {
+        snd = new CSound(wavPath);
+        RESOURCES->Store(RESOURCEKIND_SOUND, wavPath, snd);
+    }
+
+    *static_cast<CSound**>(lua_newuserdata(L, sizeof(CSound*))) = snd;
+    luaH_setclass(L, LC_SOUND);
     return 1;
 }
 
 auto sound_play(lua_State* L) -> int
 {
-    auto snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    auto snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     snd->Play();
     return 0;
 }
 
 auto sound_pause(lua_State* L) -> int
 {
-    auto snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    auto snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     snd->Pause();
     return 0;
 }
 
 auto sound_stop(lua_State* L) -> int
 {
-    auto snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    auto snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     snd->Stop();
     return 0;
 }
 
 auto sound_getdata(lua_State* L) -> int
 {
-    auto snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    auto snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     ULONG dataLen = 0;
     auto data = snd->GetData(&dataLen);
 
@@ -48,7 +56,7 @@ auto sound_getdata(lua_State* L) -> int
 
 auto sound_setvolume(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     const LONG vol = static_cast<LONG>(luaL_checkinteger(L, 2));
     snd->SetVolume(vol);
     return 0;
@@ -56,7 +64,7 @@ auto sound_setvolume(lua_State* L) -> int
 
 auto sound_setpan(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     const LONG pan = static_cast<LONG>(luaL_checkinteger(L, 2));
     snd->SetPan(pan);
     return 0;
@@ -64,7 +72,7 @@ auto sound_setpan(lua_State* L) -> int
 
 auto sound_setfrequency(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     const auto val = static_cast<DWORD>(luaL_checkinteger(L, 2));
     snd->SetFrequency(val);
     return 0;
@@ -72,7 +80,7 @@ auto sound_setfrequency(lua_State* L) -> int
 
 auto sound_setcursor(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     const auto pos = static_cast<DWORD>(luaL_checkinteger(L, 2));
     snd->SetCurrentPosition(pos);
     return 0;
@@ -80,42 +88,42 @@ auto sound_setcursor(lua_State* L) -> int
 
 auto sound_getvolume(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     lua_pushinteger(L, snd->GetVolume());
     return 1;
 }
 
 auto sound_getpan(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     lua_pushinteger(L, snd->GetPan());
     return 1;
 }
 
 auto sound_getfrequency(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     lua_pushinteger(L, snd->GetFrequency());
     return 1;
 }
 
 auto sound_getcursor(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     lua_pushinteger(L, snd->GetCurrentPosition());
     return 1;
 }
 
 auto sound_playing(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     lua_pushboolean(L, snd->IsPlaying());
     return 1;
 }
 
 auto sound_setloop(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     const bool loop = static_cast<bool>(lua_toboolean(L, 2));
     snd->SetLoop(loop);
     return 0;
@@ -123,14 +131,14 @@ auto sound_setloop(lua_State* L) -> int
 
 auto sound_looping(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     lua_pushboolean(L, snd->IsLooping());
     return 1;
 }
 
 auto sound_setpos(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     const auto pos = static_cast<DWORD>(luaL_checkinteger(L, 2));
     snd->SetCurrentPosition(pos);
     return 0;
@@ -138,21 +146,21 @@ auto sound_setpos(lua_State* L) -> int
 
 auto sound_getpos(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     lua_pushinteger(L, snd->GetCurrentPosition());
     return 1;
 }
 
 auto sound_getsize(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     lua_pushinteger(L, snd->GetTotalSize());
     return 1;
 }
 
 static auto sound_delete(lua_State* L) -> int
 {
-    CSound* snd = *static_cast<CSound**>(luaL_checkudata(L, 1, L_SOUND));
+    CSound* snd = *static_cast<CSound**>(luaH_checkudata(L, 1, LC_SOUND));
     snd->Release();
 
     return 0;
@@ -161,7 +169,7 @@ static auto sound_delete(lua_State* L) -> int
 static void LuaSound$Register(lua_State* L)
 {
     lua_register(L, L_SOUND, sound_new);
-    luaL_newmetatable(L, L_SOUND);
+    luaH_newclass(L, LC_SOUND);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "system.h"
+
+#include <lua/lua.hpp>
+
+#include "TweenLayer.h"
+
+#include <string>
+
+/*
+ * A layer can be bound to the comps table of a FramePose and a Matrix, each
+ * step then writes the pose into the Vectors and Matrices already there
+ * instead of creating new ones. Both sit in the user value table of the proxy.
+ */
+auto tweenlayer_new(lua_State* L) -> int
+{
+    luaH_newproxy(L, LC_TWEENLAYER, new CTweenLayer());
+    lua_newtable(L);
+    lua_setiuservalue(L, -2, 1);
+    return 1;
+}
+
+/* TweenLayer() goes through the TweenLayer table's __call */
+static auto tweenlayer_call(lua_State* L) -> int
+{
+    lua_remove(L, 1);
+    return tweenlayer_new(L);
+}
+
+static void tweenlayer_setvector(lua_State* L, int comps, int i, const D3DXVECTOR4& value)
+{
+    lua_rawgeti(L, comps, i);
+    auto* const vec = static_cast<D3DXVECTOR4*>(luaH_testudata(L, -1, LC_VECTOR));
+    lua_pop(L, 1);
+
+    if (vec)
+    {
+        *vec = value;
+        return;
+    }
+
+    *vector4_ctor(L) = value;
+    lua_rawseti(L, comps, i);
+}
+
+static void tweenlayer_setmatrix(lua_State* L, int comps, int i, const D3DXMATRIX& value)
+{
+    lua_rawgeti(L, comps, i);
+    auto* mat = static_cast<D3DXMATRIX*>(luaH_testudata(L, -1, LC_MATRIX));
+    lua_pop(L, 1);
+
+    if (!mat)
+    {
+        matrix_new(L);
+        mat = static_cast<D3DXMATRIX*>(lua_touserdata(L, -1));
+        lua_rawseti(L, comps, i);
+    }
+
+    *mat = value;
+}
+
+/* Writes the pose of the layer at idx into whatever it is bound to */
+static void tweenlayer_write(lua_State* L, int idx, const CTweenLayer* layer)
+{
+    const auto& pose = layer->GetPose();
+
+    lua_getiuservalue(L, idx, 1);
+    const auto out = lua_gettop(L);
+
+    if (lua_rawgeti(L, out, 1) == LUA_TTABLE)
+    {
+        const auto comps = lua_gettop(L);
+        tweenlayer_setvector(L, comps, 1, pose.pos);
+        tweenlayer_setvector(L, comps, 2, pose.rot);
+        tweenlayer_setvector(L, comps, 3, pose.scale);
+        lua_pushnumber(L, pose.prop);
+        lua_rawseti(L, comps, 4);
+        tweenlayer_setmatrix(L, comps, 5, pose.mat);
+    }
+
+    lua_pop(L, 1);
+
+    auto* const world = static_cast<D3DXMATRIX*>(lua_rawgeti(L, out, 2) != LUA_TNIL ? luaH_testudata(L, -1, LC_MATRIX) : nullptr);
+
+    if (world)
+        *world = pose.world;
+
+    lua_pop(L, 2);
+}
+
+/*
+ * layer:add(time, pos, rot, scale, prop, mat) adds a keyframe to the tracks of
+ * the components that aren't nil. Keyframes can come in any order.
+ */
+static auto tweenlayer_add(lua_State* L) -> int
+{
+    auto* const layer = LuaCheck<CTweenLayer*>(L, 1);
+    const auto time = static_cast<float>(luaL_checknumber(L, 2));
+    const D3DXVECTOR4* vecs[TWEENCOMP_PROP] = {};
+    const D3DXMATRIX* mat = nullptr;
+    auto prop = 0.0f;
+
+    // everything is checked before the first keyframe goes in
+    for (auto comp = 0; comp < TWEENCOMP_PROP; comp++)
+    {
+        if (!lua_isnoneornil(L, 3 + comp))
+            vecs[comp] = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3 + comp, LC_VECTOR));
+    }
+
+    const auto hasProp = !lua_isnoneornil(L, 3 + TWEENCOMP_PROP);
+
+    if (hasProp)
+        prop = static_cast<float>(luaL_checknumber(L, 3 + TWEENCOMP_PROP));
+
+    if (!lua_isnoneornil(L, 3 + TWEENCOMP_MAT))
+        mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 3 + TWEENCOMP_MAT, LC_MATRIX));
+
+    for (auto comp = 0; comp < TWEENCOMP_PROP; comp++)
+    {
+        if (vecs[comp])
+            layer->AddKey(static_cast<TWEENCOMP>(comp), time, *vecs[comp]);
+    }
+
+    if (hasProp)
+        layer->AddKey(TWEENCOMP_PROP, time, &prop);
+
+    if (mat)
+        layer->AddKey(TWEENCOMP_MAT, time, *mat);
+
+    return 0;
+}
+
+static auto tweenlayer_clear(lua_State* L) -> int
+{
+    LuaCheck<CTweenLayer*>(L, 1)->Clear();
+    return 0;
+}
+
+/* layer:bind(comps, mat), either can be nil to stop writing there */
+static auto tweenlayer_bind(lua_State* L) -> int
+{
+    LuaCheck<CTweenLayer*>(L, 1);
+    luaL_checkany(L, 2);
+    lua_settop(L, 3);
+
+    lua_getiuservalue(L, 1, 1);
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, -2, 1);
+    lua_pushvalue(L, 3);
+    lua_rawseti(L, -2, 2);
+    return 0;
+}
+
+static auto tweenlayer_step(lua_State* L) -> int
+{
+    auto* const layer = LuaCheck<CTweenLayer*>(L, 1);
+
+    layer->Step(static_cast<float>(luaL_checknumber(L, 2)));
+    tweenlayer_write(L, 1, layer);
+    return 0;
+}
+
+/* TweenLayer.step(layers, time) steps every layer of the list in a single call */
+static auto tweenlayer_stepall(lua_State* L) -> int
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    const auto time = static_cast<float>(luaL_checknumber(L, 2));
+    const auto count = static_cast<lua_Integer>(lua_rawlen(L, 1));
+
+    for (lua_Integer i = 1; i <= count; i++)
+    {
+        lua_rawgeti(L, 1, i);
+        auto* const proxy = static_cast<CTweenLayer**>(luaH_testudata(L, -1, LC_TWEENLAYER));
+
+        if (!proxy)
+            return luaL_error(L, "layer %d is not a " L_TWEENLAYER, static_cast<int>(i));
+
+        auto* const layer = *proxy;
+
+        layer->Step(time);
+        tweenlayer_write(L, lua_gettop(L), layer);
+        lua_pop(L, 1);
+    }
+
+    return 0;
+}
+
+static auto tweenlayer_maxtime(lua_State* L) -> int
+{
+    lua_pushnumber(L, LuaCheck<CTweenLayer*>(L, 1)->GetMaxTime());
+    return 1;
+}
+
+static auto tweenlayer_delete(lua_State* L) -> int
+{
+    LuaCheck<CTweenLayer*>(L, 1)->Release();
+    return 0;
+}
+
+/* Snapshots store the keyframes next to the user value table, so bound poses stay bound */
+static auto tweenlayer_restore(lua_State* L) -> int
+{
+    size_t len;
+    const auto* const data = lua_tolstring(L, lua_upvalueindex(1), &len);
+    auto* const layer = new CTweenLayer();
+
+    if (!layer->Load(data, len))
+    {
+        layer->Release();
+        return luaL_error(L, "corrupt tween layer");
+    }
+
+    luaH_newproxy(L, LC_TWEENLAYER, layer);
+    lua_pushvalue(L, lua_upvalueindex(2));
+    lua_setiuservalue(L, -2, 1);
+    return 1;
+}
+
+static auto tweenlayer_persist(lua_State* L) -> int
+{
+    std::string data;
+    LuaCheck<CTweenLayer*>(L, 1)->Save(&data);
+
+    lua_pushlstring(L, data.data(), data.size());
+    lua_getiuservalue(L, 1, 1);
+
+    // the bound targets travel in the second upvalue, tweenlayer_restore reattaches them
+    lua_pushcclosure(L, tweenlayer_restore, 2);
+    return 1;
+}
+
+static void LuaTweenLayer$Register(lua_State* L)
+{
+    lua_newtable(L);
+    REGC("step", tweenlayer_stepall);
+    lua_newtable(L);
+    REGC("__call", tweenlayer_call);
+    lua_setmetatable(L, -2);
+    lua_setglobal(L, L_TWEENLAYER);
+
+    luaH_newclass(L, LC_TWEENLAYER);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+
+    REGC("add", tweenlayer_add);
+    REGC("clear", tweenlayer_clear);
+    REGC("bind", tweenlayer_bind);
+    REGC("step", tweenlayer_step);
+    REGC("maxTime", tweenlayer_maxtime);
+    REGC("__gc", tweenlayer_delete);
+    REGC("__persist", tweenlayer_persist);
+    REGC("__restore", tweenlayer_restore);
+
+    lua_pop(L, 1);
+}
@@ -8,7 +8,7 @@ auto vector4_ctor(lua_State* L) -> D3DXVECTOR4*
 {
     const auto vec = static_cast<D3DXVECTOR4*>(lua_newuserdata(L, sizeof(D3DXVECTOR4)));
     *vec = {0, 0, 0, 0};
-    luaL_setmetatable(L, L_VECTOR);
+    luaH_setclass(L, LC_VECTOR);
     return vec;
 }
 
@@ -19,7 +19,7 @@ auto vector4_new(lua_State* L) -> int
 
     if (lua_gettop(L) == 1)
     {
-        vecRHS = static_cast<D3DXVECTOR4*>(luaL_testudata(L, 1, L_VECTOR));
+        vecRHS = static_cast<D3DXVECTOR4*>(luaH_testudata(L, 1, LC_VECTOR));
 
         if (!vecRHS)
             x = y = z = w = static_cast<float>(lua_tonumber(L, 1));
@@ -54,84 +54,97 @@ static auto vector4_newrgba(lua_State* L) -> int
     const auto vec = static_cast<D3DXVECTOR4*>(lua_newuserdata(L, sizeof(D3DXVECTOR4)));
     *vec = D3DXVECTOR4(r, g, b, a);
 
-    luaL_setmetatable(L, L_VECTOR);
+    luaH_setclass(L, LC_VECTOR);
     return 1;
 }
 
-static auto vector4_add(lua_State* L) -> int
+/*
+ * Shared by the metamethods and their in-place and out-parameter variants
+ * below, out may alias vec. The value at idx is either a number or a Vector.
+ */
+static auto vector4_doadd(lua_State* L, D3DXVECTOR4* out, const D3DXVECTOR4* vec, int idx) -> bool
 {
-    const auto vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
     D3DXVECTOR4* vecRHS = nullptr;
-    auto scalarRHS = 0.0f;
 
-    if (lua_isnumber(L, 2))
+    if (lua_isnumber(L, idx))
     {
-        scalarRHS = static_cast<float>(luaL_checknumber(L, 2));
-
-        vector4_new(L);
-        const auto out = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 3, L_VECTOR));
+        const auto scalarRHS = static_cast<float>(lua_tonumber(L, idx));
         *out = D3DXVECTOR4(vec->x + scalarRHS, vec->y + scalarRHS, vec->z + scalarRHS, vec->w + scalarRHS);
-        return 1;
+        return TRUE;
     }
 
-    if ((vecRHS = static_cast<D3DXVECTOR4*>(luaL_testudata(L, 2, L_VECTOR))))
+    if ((vecRHS = static_cast<D3DXVECTOR4*>(luaH_testudata(L, idx, LC_VECTOR))))
     {
-        vector4_new(L);
-        const auto out = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 3, L_VECTOR));
-        D3DXVec4Add(out, vec, vecRHS);
-
-        return 1;
+        NVec4Add(out, vec, vecRHS);
+        return TRUE;
     }
 
-    return 0;
+    return FALSE;
 }
 
-static auto vector4_sub(lua_State* L) -> int
+static auto vector4_dosub(lua_State* L, D3DXVECTOR4* out, const D3DXVECTOR4* vec, int idx) -> bool
 {
-    const auto vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
     D3DXVECTOR4* vecRHS = nullptr;
-    auto scalarRHS = 0.0f;
 
-    if (lua_isnumber(L, 2))
+    if (lua_isnumber(L, idx))
     {
-        scalarRHS = static_cast<float>(luaL_checknumber(L, 2));
-
-        vector4_new(L);
-        const auto out = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 3, L_VECTOR));
+        const auto scalarRHS = static_cast<float>(lua_tonumber(L, idx));
         *out = D3DXVECTOR4(vec->x - scalarRHS, vec->y - scalarRHS, vec->z - scalarRHS, vec->w - scalarRHS);
-        return 1;
+        return TRUE;
     }
 
-    if ((vecRHS = static_cast<D3DXVECTOR4*>(luaL_testudata(L, 2, L_VECTOR))))
+    if ((vecRHS = static_cast<D3DXVECTOR4*>(luaH_testudata(L, idx, LC_VECTOR))))
     {
-        vector4_new(L);
-        const auto out = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 3, L_VECTOR));
-        D3DXVec4Subtract(out, vec, vecRHS);
+        NVec4Subtract(out, vec, vecRHS);
         out->w = 0.0f;
-        return 1;
+        return TRUE;
     }
 
-    return 0;
+    return FALSE;
+}
+
+static auto vector4_add(lua_State* L) -> int
+{
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    D3DXVECTOR4 res;
+
+    if (!vector4_doadd(L, &res, vec, 2))
+        return 0;
+
+    *vector4_ctor(L) = res;
+    return 1;
+}
+
+static auto vector4_sub(lua_State* L) -> int
+{
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    D3DXVECTOR4 res;
+
+    if (!vector4_dosub(L, &res, vec, 2))
+        return 0;
+
+    *vector4_ctor(L) = res;
+    return 1;
 }
 
 static auto vector4_cross(lua_State* L) -> int
 {
-    const auto vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
-    const auto vecRHS = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 2, L_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vecRHS = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
 
     vector4_new(L);
-    const auto out = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 3, L_VECTOR));
+    const auto out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
 
     D3DXVECTOR3 a = *vec, b = *vecRHS, c;
 
-    D3DXVec3Cross(&c, &a, &b);
+    NVec3Cross(&c, &a, &b);
     *out = D3DXVECTOR4(c, 0.0f);
     return 1;
 }
 
 static auto vector4_div(lua_State* L) -> int
 {
-    const auto vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
     const auto scalarRHS = static_cast<float>(luaL_checknumber(L, 2));
 
     if (scalarRHS == 0.0f)
@@ -141,7 +154,7 @@ static auto vector4_div(lua_State* L) -> int
     }
 
     vector4_new(L);
-    const auto out = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 3, L_VECTOR));
+    const auto out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
     vec->w = 0.0f;
     *out = *vec / scalarRHS;
     return 1;
@@ -149,7 +162,7 @@ static auto vector4_div(lua_State* L) -> int
 
 static auto vector4_dot(lua_State* L) -> int
 {
-    const auto vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
     D3DXVECTOR4* vecRHS = nullptr;
     D3DXMATRIX* matRHS = nullptr;
     auto scalarRHS = 0.0f;
@@ -159,23 +172,23 @@ static auto vector4_dot(lua_State* L) -> int
         scalarRHS = static_cast<float>(luaL_checknumber(L, 2));
 
         vector4_new(L);
-        const auto out = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 3, L_VECTOR));
+        const auto out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
         *out = *vec * scalarRHS;
         return 1;
     }
 
-    if ((vecRHS = static_cast<D3DXVECTOR4*>(luaL_testudata(L, 2, L_VECTOR))))
+    if ((vecRHS = static_cast<D3DXVECTOR4*>(luaH_testudata(L, 2, LC_VECTOR))))
     {
-        const auto num = D3DXVec4Dot(vec, vecRHS);
+        const auto num = NVec4Dot(vec, vecRHS);
         lua_pushnumber(L, num);
         return 1;
     }
 
-    if ((matRHS = static_cast<D3DXMATRIX*>(luaL_testudata(L, 2, L_MATRIX))))
+    if ((matRHS = static_cast<D3DXMATRIX*>(luaH_testudata(L, 2, LC_MATRIX))))
     {
         vector4_new(L);
-        const auto out = static_cast<D3DXVECTOR3*>(luaL_checkudata(L, 3, L_VECTOR));
-        D3DXVec3TransformCoord(out, (D3DXVECTOR3*)vec, matRHS);
+        const auto out = static_cast<D3DXVECTOR3*>(luaH_checkudata(L, 3, LC_VECTOR));
+        NVec3TransformCoord(out, (D3DXVECTOR3*)vec, matRHS);
         return 1;
     }
 
@@ -184,7 +197,7 @@ static auto vector4_dot(lua_State* L) -> int
 
 static auto vector4_get(lua_State* L) -> int
 {
-    const auto vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
     const auto onlyThreeComponents = static_cast<unsigned int>(lua_tointeger(L, 2));
     float arr[4] = {vec->x, vec->y, vec->z, vec->w};
 
@@ -201,7 +214,7 @@ static auto vector4_get(lua_State* L) -> int
 
 static auto vector4_field(lua_State* L) -> int
 {
-    const auto vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
     const auto idx = static_cast<int>(luaL_checkinteger(L, 2));
     const auto val = static_cast<float>(luaL_checknumber(L, 3));
 
@@ -223,18 +236,18 @@ static auto vector4_field(lua_State* L) -> int
 
 static auto vector4_normalize(lua_State* L) -> int
 {
-    auto* vec = static_cast<D3DXVECTOR3*>(luaL_checkudata(L, 1, L_VECTOR));
+    auto* vec = static_cast<D3DXVECTOR3*>(luaH_checkudata(L, 1, LC_VECTOR));
 
     vector4_new(L);
-    auto* out = static_cast<D3DXVECTOR3*>(luaL_checkudata(L, 2, L_VECTOR));
-    D3DXVec3Normalize(out, vec);
+    auto* out = static_cast<D3DXVECTOR3*>(luaH_checkudata(L, 2, LC_VECTOR));
+    NVec3Normalize(out, vec);
 
     return 1;
 }
 
 static auto vector4_color(lua_State* L) -> int
 {
-    auto* vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
     BYTE color[4] = {
         static_cast<BYTE>(vec->w * 0xFF), static_cast<BYTE>(vec->x * 0xFF), static_cast<BYTE>(vec->y * 0xFF),
         static_cast<BYTE>(vec->z * 0xFF)
@@ -245,44 +258,257 @@ static auto vector4_color(lua_State* L) -> int
 
 static auto vector4_mag(lua_State* L) -> int
 {
-    auto* vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
-    lua_pushnumber(L, D3DXVec4Length(vec));
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    lua_pushnumber(L, NVec4Length(vec));
     return 1;
 }
 
 static auto vector4_magsq(lua_State* L) -> int
 {
-    auto* vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
-    lua_pushnumber(L, D3DXVec4LengthSq(vec));
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    lua_pushnumber(L, NVec4LengthSq(vec));
     return 1;
 }
 
 static auto vector4_lerp(lua_State* L) -> int
 {
-    auto* vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
-    auto* vecRHS = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 2, L_VECTOR));
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    auto* vecRHS = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
     const auto t = static_cast<float>(luaL_checknumber(L, 3));
 
     vector4_new(L);
-    auto* out = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 4, L_VECTOR));
-    D3DXVec4Lerp(out, vec, vecRHS, t);
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 4, LC_VECTOR));
+    NVec4Lerp(out, vec, vecRHS, t);
     return 1;
 }
 
 static auto vector4_neg(lua_State* L) -> int
 {
-    auto* vec = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 1, L_VECTOR));
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
 
     vector4_new(L);
-    auto* out = static_cast<D3DXVECTOR4*>(luaL_checkudata(L, 2, L_VECTOR));
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+    *out = *vec * -1;
+    return 1;
+}
+
+/*
+ * In-place variants, these overwrite self and return it so they can be chained
+ * without creating a new Vector per step.
+ */
+static auto vector4_set(lua_State* L) -> int
+{
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    D3DXVECTOR4* vecRHS = nullptr;
+
+    if ((vecRHS = static_cast<D3DXVECTOR4*>(luaH_testudata(L, 2, LC_VECTOR))))
+    {
+        *vec = *vecRHS;
+    }
+    else
+    {
+        *vec = D3DXVECTOR4(static_cast<float>(lua_tonumber(L, 2)), static_cast<float>(lua_tonumber(L, 3)),
+                           static_cast<float>(lua_tonumber(L, 4)), static_cast<float>(lua_tonumber(L, 5)));
+    }
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_addinplace(lua_State* L) -> int
+{
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+
+    if (!vector4_doadd(L, vec, vec, 2))
+        return luaL_typeerror(L, 2, "number or Vector");
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_subinplace(lua_State* L) -> int
+{
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+
+    if (!vector4_dosub(L, vec, vec, 2))
+        return luaL_typeerror(L, 2, "number or Vector");
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_scaleinplace(lua_State* L) -> int
+{
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    *vec *= static_cast<float>(luaL_checknumber(L, 2));
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_lerpinplace(lua_State* L) -> int
+{
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    auto* vecRHS = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+    const auto t = static_cast<float>(luaL_checknumber(L, 3));
+
+    NVec4Lerp(vec, vec, vecRHS, t);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_normalizeinplace(lua_State* L) -> int
+{
+    auto* vec = static_cast<D3DXVECTOR3*>(luaH_checkudata(L, 1, LC_VECTOR));
+    NVec3Normalize(vec, vec);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_neginplace(lua_State* L) -> int
+{
+    auto* vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    *vec *= -1;
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/*
+ * Out-parameter variants exposed on the Vector table, e.g. Vector.add(out, a, b).
+ * The result is written into out, which may be one of the operands, and out is
+ * returned.
+ */
+static auto vector4_addto(lua_State* L) -> int
+{
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+
+    if (!vector4_doadd(L, out, vec, 3))
+        return luaL_typeerror(L, 3, "number or Vector");
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_subto(lua_State* L) -> int
+{
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+
+    if (!vector4_dosub(L, out, vec, 3))
+        return luaL_typeerror(L, 3, "number or Vector");
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_scaleto(lua_State* L) -> int
+{
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+    const auto scalarRHS = static_cast<float>(luaL_checknumber(L, 3));
+
+    *out = *vec * scalarRHS;
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* out = a + b * s */
+static auto vector4_maddto(lua_State* L) -> int
+{
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+    const auto vecRHS = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
+    const auto scalarRHS = static_cast<float>(luaL_checknumber(L, 4));
+
+    *out = *vec + *vecRHS * scalarRHS;
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_lerpto(lua_State* L) -> int
+{
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+    const auto vecRHS = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
+    const auto t = static_cast<float>(luaL_checknumber(L, 4));
+
+    NVec4Lerp(out, vec, vecRHS, t);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_normalizeto(lua_State* L) -> int
+{
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+
+    out->w = vec->w;
+    NVec3Normalize(reinterpret_cast<D3DXVECTOR3*>(out), reinterpret_cast<D3DXVECTOR3*>(vec));
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+static auto vector4_negto(lua_State* L) -> int
+{
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+
     *out = *vec * -1;
+
+    lua_pushvalue(L, 1);
     return 1;
 }
 
-LUAS(D3DXVECTOR4, L_VECTOR, vector4_x, x);
-LUAS(D3DXVECTOR4, L_VECTOR, vector4_y, y);
-LUAS(D3DXVECTOR4, L_VECTOR, vector4_z, z);
-LUAS(D3DXVECTOR4, L_VECTOR, vector4_w, w);
+static auto vector4_crossto(lua_State* L) -> int
+{
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+    const auto vecRHS = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 3, LC_VECTOR));
+
+    D3DXVECTOR3 a = *vec, b = *vecRHS, c;
+
+    NVec3Cross(&c, &a, &b);
+    *out = D3DXVECTOR4(c, 0.0f);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* same as v * m */
+static auto vector4_transformto(lua_State* L) -> int
+{
+    auto* out = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 1, LC_VECTOR));
+    const auto vec = static_cast<D3DXVECTOR4*>(luaH_checkudata(L, 2, LC_VECTOR));
+    const auto mat = static_cast<D3DXMATRIX*>(luaH_checkudata(L, 3, LC_MATRIX));
+
+    D3DXVECTOR3 a = *vec, c;
+
+    NVec3TransformCoord(&c, &a, mat);
+    *out = D3DXVECTOR4(c, 0.0f);
+
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
+/* Vector(...) goes through the Vector table's __call */
+static auto vector4_call(lua_State* L) -> int
+{
+    lua_remove(L, 1);
+    return vector4_new(L);
+}
+
+LUAS(D3DXVECTOR4, LC_VECTOR, vector4_x, x);
+LUAS(D3DXVECTOR4, LC_VECTOR, vector4_y, y);
+LUAS(D3DXVECTOR4, LC_VECTOR, vector4_z, z);
+LUAS(D3DXVECTOR4, LC_VECTOR, vector4_w, w);
 
 static void LuaVector$Register(lua_State* L)
 {
@@ -291,11 +517,29 @@ static void LuaVector$Register(lua_State* L)
     lua_register(L, "Vector4", vector4_new);
     lua_register(L, "VectorRGBA", vector4_newrgba);
     //<
-    lua_register(L, L_VECTOR, vector4_new);
-    luaL_newmetatable(L, L_VECTOR);
+    lua_newtable(L);
+    REGC("add", vector4_addto);
+    REGC("sub", vector4_subto);
+    REGC("scale", vector4_scaleto);
+    REGC("madd", vector4_maddto);
+    REGC("lerp", vector4_lerpto);
+    REGC("normalize", vector4_normalizeto);
+    REGC("neg", vector4_negto);
+    REGC("cross", vector4_crossto);
+    REGC("transform", vector4_transformto);
+    lua_newtable(L);
+    REGC("__call", vector4_call);
+    lua_setmetatable(L, -2);
+    lua_setglobal(L, L_VECTOR);
+
+    luaH_newclass(L, LC_VECTOR);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
+    // plain values, snapshots copy them as they are
+    lua_pushboolean(L, TRUE);
+    lua_setfield(L, -2, "__persist");
+
     REGC("cross", vector4_cross);
     REGC("get", vector4_get);
     REGC("color", vector4_color);
@@ -305,6 +549,14 @@ static void LuaVector$Register(lua_State* L)
     REGC("neg", vector4_neg);
     REGC("normalize", vector4_normalize);
 
+    REGC("set", vector4_set);
+    REGC("addInPlace", vector4_addinplace);
+    REGC("subInPlace", vector4_subinplace);
+    REGC("scaleInPlace", vector4_scaleinplace);
+    REGC("lerpInPlace", vector4_lerpinplace);
+    REGC("normalizeInPlace", vector4_normalizeinplace);
+    REGC("negInPlace", vector4_neginplace);
+
     REGC("__add", vector4_add);
     REGC("__sub", vector4_sub);
     REGC("__mul", vector4_dot);
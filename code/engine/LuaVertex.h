@@ -84,13 +84,13 @@ auto vertex_new(lua_State* L) -> int
     vert->bz = bz;
     vert->color = color;
 
-    luaL_setmetatable(L, L_VERTEX);
+    luaH_setclass(L, LC_VERTEX);
     return 1;
 }
 
 static auto vertex_get(lua_State* L) -> int
 {
-    auto vert = static_cast<VERTEX*>(luaL_checkudata(L, 1, L_VERTEX));
+    auto vert = static_cast<VERTEX*>(luaH_checkudata(L, 1, LC_VERTEX));
     float arr[] = {
         vert->x, vert->y, vert->z, vert->su, vert->tv, vert->nx, vert->ny, vert->nz, vert->tx, vert->ty, vert->tz,
         vert->bx, vert->by, vert->bz, vert->su2, vert->tv2
@@ -126,10 +126,14 @@ static auto vertex_get(lua_State* L) -> int
 static void LuaVertex$Register(lua_State* L)
 {
     lua_register(L, L_VERTEX, vertex_new);
-    luaL_newmetatable(L, L_VERTEX);
+    luaH_newclass(L, LC_VERTEX);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
 
+    // plain values, snapshots copy them as they are
+    lua_pushboolean(L, TRUE);
+    lua_setfield(L, -2, "__persist");
+
     REGC("get", vertex_get);
 
     lua_pop(L, 1);
@@ -1,99 +1,374 @@
 #pragma once
 
+#include <tuple>
 #include <type_traits>
+#include <utility>
 #include <lua/lua.hpp>
- 
+
 template<typename>
 struct AlwaysFalse : std::false_type {};
 
-template<typename T>
-auto LuaGetClass(lua_State* L, LPCSTR lname, T& value) -> bool
+/*
+ * Metatables of the registered classes, indexed by LuaClass. luaH_newclass
+ * fills them in when the bindings register, the checks then compare the
+ * metatable of a userdata with the cached pointer rather than fetching it from
+ * the registry by name. The registry entries stay, so snapshots and
+ * luaL_checkudata keep working.
+ */
+struct LuaClassCache
+{
+    const void* meta[LC_MAX];
+    int ref[LC_MAX];
+};
+
+inline LuaClassCache gLuaClasses = {};
+
+inline LPCSTR const gLuaClassNames[LC_MAX] = {
+    L_MATRIX, L_VECTOR, L_VERTEX, L_MATERIAL, L_FACEGROUP, L_MESH, L_SCENE, L_NODE, L_EFFECT, L_RENDERTARGET,
+    L_LIGHT, L_FONT, L_SOUND, L_MUSIC, L_BUFFER, L_COLLISIONMESH, L_COLLISIONWORLD,
+    L_ENTITYWORLD, L_TWEENLAYER
+};
+
+/*
+ * luaL_newmetatable for a tagged class, leaves the metatable on the stack.
+ * Registering a class again in the same state keeps its reference, a new
+ * state never has the metatable yet and takes a fresh one.
+ */
+inline auto luaH_newclass(lua_State* L, LuaClass cls) -> int
+{
+    const auto created = luaL_newmetatable(L, gLuaClassNames[cls]);
+
+    if (!created && gLuaClasses.meta[cls] == lua_topointer(L, -1))
+        return created;
+
+    lua_pushvalue(L, -1);
+    gLuaClasses.meta[cls] = lua_topointer(L, -1);
+    gLuaClasses.ref[cls] = luaL_ref(L, LUA_REGISTRYINDEX);
+    return created;
+}
+
+inline auto luaH_setclass(lua_State* L, LuaClass cls) -> void
+{
+    lua_rawgeti(L, LUA_REGISTRYINDEX, gLuaClasses.ref[cls]);
+    lua_setmetatable(L, -2);
+}
+
+inline auto luaH_testudata(lua_State* L, int idx, LuaClass cls) -> void*
+{
+    auto* const ptr = lua_touserdata(L, idx);
+
+    if (ptr == nullptr || !lua_getmetatable(L, idx))
+        return nullptr;
+
+    const auto match = lua_topointer(L, -1) == gLuaClasses.meta[cls];
+    lua_pop(L, 1);
+    return match ? ptr : nullptr;
+}
+
+inline auto luaH_checkudata(lua_State* L, int idx, LuaClass cls) -> void*
 {
-    auto* ptr = static_cast<T*>(luaL_testudata(L, 1, lname));
-    luaL_argexpected(L, ptr != nullptr, 1, lname);
+    auto* const ptr = luaH_testudata(L, idx, cls);
 
     if (ptr == nullptr)
-        return false;
+        luaL_typeerror(L, idx, gLuaClassNames[cls]);
 
-    value = *ptr;
-    return true;
+    return ptr;
+}
+
+/*
+ * Engine objects cross into Lua through a single proxy each. The proxies are
+ * kept in a weak-valued table per class keyed by the object's address, so
+ * pushing an object that Lua still holds returns the very same userdata and
+ * only the first push takes a reference. A scene also seen as a node has one
+ * proxy of each class. Lua clears the entry before the proxy's __gc releases
+ * the object, a reused address never finds a stale proxy.
+ */
+inline char gLuaProxyKey;
+
+inline auto luaH_getproxies(lua_State* L, LuaClass cls) -> void
+{
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, &gLuaProxyKey) != LUA_TTABLE)
+    {
+        lua_pop(L, 1);
+        lua_createtable(L, LC_MAX, 0);
+        lua_pushvalue(L, -1);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &gLuaProxyKey);
+    }
+
+    if (lua_rawgeti(L, -1, cls + 1LL) != LUA_TTABLE)
+    {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_createtable(L, 0, 1);
+        lua_pushliteral(L, "v");
+        lua_setfield(L, -2, "__mode");
+        lua_setmetatable(L, -2);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, cls + 1LL);
+    }
+
+    lua_remove(L, -2);
+}
+
+/* Pushes the live proxy of obj and returns true, pushes nothing otherwise */
+inline auto luaH_findproxy(lua_State* L, LuaClass cls, const void* obj) -> bool
+{
+    luaH_getproxies(L, cls);
+
+    if (lua_rawgetp(L, -1, obj) != LUA_TNIL && luaH_testudata(L, -1, cls))
+    {
+        lua_remove(L, -2);
+        return true;
+    }
+
+    lua_pop(L, 2);
+    return false;
 }
 
+/* Boxes obj into a new proxy that owns one reference to it */
 template<typename T>
-auto LuaGet(lua_State* L, T& value) -> bool
+auto luaH_newproxy(lua_State* L, LuaClass cls, T* obj) -> void
+{
+    *static_cast<T**>(lua_newuserdatauv(L, sizeof(T*), 1)) = obj;
+    luaH_setclass(L, cls);
+
+    luaH_getproxies(L, cls);
+    lua_pushvalue(L, -2);
+    lua_rawsetp(L, -2, obj);
+    lua_pop(L, 1);
+}
+
+/* Pushes the proxy of obj, creating it and taking a reference on first use */
+template<typename T>
+auto luaH_pushproxy(lua_State* L, LuaClass cls, T* obj) -> void
+{
+    if (luaH_findproxy(L, cls, obj))
+        return;
+
+    obj->AddRef();
+    luaH_newproxy(L, cls, obj);
+}
+
+/* Child lists cached on a proxy's user value table */
+enum LuaListSlot
+{
+    LL_MESHES = 1,
+    LL_MESHPARTS,
+    LL_LIGHTS,
+    LL_NODES,
+    LL_FGROUPS
+};
+
+/*
+ * Pushes the list cached on the proxy at idx when it was built for revision
+ * rev and returns true. Returns false with nothing pushed otherwise, the
+ * binding then builds the list and stores it with luaH_setlist. The lists are
+ * shared between calls, scripts treat them as read-only.
+ */
+inline auto luaH_getlist(lua_State* L, int idx, LuaListSlot slot, lua_Integer rev) -> bool
 {
-    if (lua_gettop(L) < 1)
+    if (lua_getiuservalue(L, idx, 1) != LUA_TTABLE)
+    {
+        lua_pop(L, 1);
         return false;
+    }
 
-    // builtins
-    if constexpr (std::is_same_v<T, int> || std::is_same_v<T, DWORD> || std::is_same_v<T, uint32_t> || std::is_same_v<T, short>)
-        value = static_cast<T>(luaL_checkinteger(L, 1));
-    else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
-        value = static_cast<T>(luaL_checknumber(L, 1));
-    else if constexpr (std::is_same_v<T, bool>)
-        value = static_cast<T>(lua_toboolean(L, 1));
-    else if constexpr (std::is_same_v<T, LPCSTR>)
-        value = static_cast<T>(luaL_checkstring(L, 1));
-    else if constexpr (std::is_same_v<T, CString>)
-        value = CString(static_cast<LPCSTR>(luaL_checkstring(L, 1)));
-    else if constexpr (std::is_same_v<T, LPDIRECT3DTEXTURE9>)
-        value = static_cast<LPDIRECT3DTEXTURE9>(lua_touserdata(L, 1));
+    lua_rawgeti(L, -1, -slot);
+    const auto valid = lua_isinteger(L, -1) && lua_tointeger(L, -1) == rev;
+    lua_pop(L, 1);
 
-    // modules
-    else if constexpr (std::is_same_v<T, D3DXMATRIX>)
-        LuaGetClass<T>(L, L_MATRIX, value);
+    if (!valid)
+    {
+        lua_pop(L, 1);
+        return false;
+    }
+
+    lua_rawgeti(L, -1, slot);
+    lua_remove(L, -2);
+    return true;
+}
+
+/* Caches the list on top of the stack on the proxy at idx, the list stays pushed */
+inline auto luaH_setlist(lua_State* L, int idx, LuaListSlot slot, lua_Integer rev) -> void
+{
+    idx = lua_absindex(L, idx);
+
+    if (lua_getiuservalue(L, idx, 1) != LUA_TTABLE)
+    {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setiuservalue(L, idx, 1);
+    }
+
+    lua_pushvalue(L, -2);
+    lua_rawseti(L, -2, slot);
+    lua_pushinteger(L, rev);
+    lua_rawseti(L, -2, -slot);
+    lua_pop(L, 1);
+}
+
+/* Class tag of the module types handed out to Lua, LC_MAX for builtins */
+template<typename T>
+constexpr auto LuaClassTag() -> LuaClass
+{
+    if constexpr (std::is_same_v<T, D3DXMATRIX>)
+        return LC_MATRIX;
     else if constexpr (std::is_same_v<T, VERTEX>)
-        LuaGetClass<T>(L, L_VERTEX, value);
+        return LC_VERTEX;
     else if constexpr (std::is_same_v<T, D3DXVECTOR3> || std::is_same_v<T, D3DXVECTOR4>)
-        LuaGetClass<T>(L, L_VECTOR, value);
+        return LC_VECTOR;
     else if constexpr (std::is_same_v<T, CMaterial*>)
-        LuaGetClass<T>(L, L_MATERIAL, value);
+        return LC_MATERIAL;
     else if constexpr (std::is_same_v<T, CFaceGroup*>)
-        LuaGetClass<T>(L, L_FACEGROUP, value);
+        return LC_FACEGROUP;
     else if constexpr (std::is_same_v<T, CMesh*>)
-        LuaGetClass<T>(L, L_MESH, value);
+        return LC_MESH;
     else if constexpr (std::is_same_v<T, CScene*>)
-        LuaGetClass<T>(L, L_SCENE, value);
+        return LC_SCENE;
     else if constexpr (std::is_same_v<T, CNode*>)
-        LuaGetClass<T>(L, L_NODE, value);
+        return LC_NODE;
     else if constexpr (std::is_same_v<T, CEffect*>)
-        LuaGetClass<T>(L, L_EFFECT, value);
+        return LC_EFFECT;
     else if constexpr (std::is_same_v<T, CRenderTarget*>)
-        LuaGetClass<T>(L, L_RENDERTARGET, value);
+        return LC_RENDERTARGET;
     else if constexpr (std::is_same_v<T, CLight*>)
-        LuaGetClass<T>(L, L_LIGHT, value);
+        return LC_LIGHT;
     else if constexpr (std::is_same_v<T, CFont*>)
-        LuaGetClass<T>(L, L_FONT, value);
+        return LC_FONT;
     else if constexpr (std::is_same_v<T, CSound*>)
-        LuaGetClass<T>(L, L_SOUND, value);
+        return LC_SOUND;
     else if constexpr (std::is_same_v<T, CMusic*>)
-        LuaGetClass<T>(L, L_MUSIC, value);
+        return LC_MUSIC;
+    else if constexpr (std::is_same_v<T, CCollisionMesh*>)
+        return LC_COLLISIONMESH;
+    else if constexpr (std::is_same_v<T, CCollisionWorld*>)
+        return LC_COLLISIONWORLD;
+    else if constexpr (std::is_same_v<T, CEntityWorld*>)
+        return LC_ENTITYWORLD;
+    else if constexpr (std::is_same_v<T, CTweenLayer*>)
+        return LC_TWEENLAYER;
+    else
+        return LC_MAX;
+}
+
+/*
+ * Reads the argument at idx as T without touching the stack. A missing
+ * argument reads as T's default value, anything else of the wrong type raises
+ * the usual Lua argument error.
+ */
+template<typename T>
+auto LuaCheck(lua_State* L, int idx) -> T
+{
+    if (lua_isnone(L, idx))
+        return T{};
+
+    // builtins
+    if constexpr (std::is_same_v<T, int> || std::is_same_v<T, DWORD> || std::is_same_v<T, uint32_t> || std::is_same_v<T, short>)
+        return static_cast<T>(luaL_checkinteger(L, idx));
+    else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+        return static_cast<T>(luaL_checknumber(L, idx));
+    else if constexpr (std::is_same_v<T, bool>)
+        return lua_toboolean(L, idx) != 0;
+    else if constexpr (std::is_same_v<T, LPCSTR>)
+        return luaL_checkstring(L, idx);
+    else if constexpr (std::is_same_v<T, CString>)
+        return CString(static_cast<LPCSTR>(luaL_checkstring(L, idx)));
+    else if constexpr (std::is_same_v<T, LPDIRECT3DTEXTURE9>)
+        return static_cast<LPDIRECT3DTEXTURE9>(lua_touserdata(L, idx));
+
+    // modules
+    else if constexpr (LuaClassTag<T>() != LC_MAX)
+        return *static_cast<T*>(luaH_checkudata(L, idx, LuaClassTag<T>()));
 
     // unknown type, error out
     else
     {
         static_assert(AlwaysFalse<T>::value, "Type not implemented!");
-        return false;
+        return T{};
     }
- 
-    lua_remove(L, 1);
-    return true;
 }
 
+/* Tests whether the argument at idx can be read as T */
 template<typename T>
-auto LuaGetInline(lua_State* L) -> T
+auto LuaIs(lua_State* L, int idx) -> bool
 {
-    T value{};
-    LuaGet<T>(L, value);
-    return value;
+    if constexpr (LuaClassTag<T>() != LC_MAX)
+        return luaH_testudata(L, idx, LuaClassTag<T>()) != nullptr;
+    else if constexpr (std::is_same_v<T, LPCSTR> || std::is_same_v<T, CString>)
+        return lua_type(L, idx) == LUA_TSTRING;
+    else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+        return lua_isnumber(L, idx) != 0;
+    else if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+        return lua_isinteger(L, idx) != 0;
+    else
+        return !lua_isnone(L, idx);
 }
 
-inline auto LuaTestClass(lua_State* L, LPCSTR lname) -> bool
+/*
+ * Typed view over the arguments of a binding. The fixed arguments Ts are read
+ * by index starting at first, nothing is popped or shifted, so the optional
+ * arguments after them stay addressable through Extra, Is and Opt:
+ *
+ *     const LuaArgs<CFont*, LPCSTR, DWORD> args(L);
+ *     const auto [font, text, flags] = args.Read();
+ *     const auto width = args.Opt<uint32_t>(0, 0);
+ */
+template<typename... Ts>
+class LuaArgs
 {
-    return lua_gettop(L) == 0 ? false : luaL_testudata(L, 1, lname) != nullptr;
-}
+public:
+    static constexpr int Count = static_cast<int>(sizeof...(Ts));
 
-inline auto LuaLength(lua_State* L) -> int
-{
-    return lua_gettop(L);
-}
+    explicit LuaArgs(lua_State* L, int first = 1)
+        : mLuaVM(L), mFirst(first)
+    {
+    }
+
+    auto Read() const -> std::tuple<Ts...>
+    {
+        return ReadAll(std::index_sequence_for<Ts...>{});
+    }
+
+    template<size_t I>
+    auto Get() const -> std::tuple_element_t<I, std::tuple<Ts...>>
+    {
+        return LuaCheck<std::tuple_element_t<I, std::tuple<Ts...>>>(mLuaVM, mFirst + static_cast<int>(I));
+    }
+
+    /* number of arguments passed after the fixed ones */
+    auto Extra() const -> int
+    {
+        const auto extra = lua_gettop(mLuaVM) - (mFirst + Count) + 1;
+        return extra > 0 ? extra : 0;
+    }
+
+    /* stack index of the i-th argument after the fixed ones */
+    auto Index(int i) const -> int
+    {
+        return mFirst + Count + i;
+    }
+
+    template<typename T>
+    auto Is(int i) const -> bool
+    {
+        return LuaIs<T>(mLuaVM, Index(i));
+    }
+
+    template<typename T>
+    auto Opt(int i, T def) const -> T
+    {
+        return lua_isnoneornil(mLuaVM, Index(i)) ? def : LuaCheck<T>(mLuaVM, Index(i));
+    }
+
+private:
+    lua_State* mLuaVM;
+    int mFirst;
+
+    template<size_t... I>
+    auto ReadAll(std::index_sequence<I...>) const -> std::tuple<Ts...>
+    {
+        // braced init keeps the checks, and their errors, in argument order
+        return std::tuple<Ts...>{LuaCheck<Ts>(mLuaVM, mFirst + static_cast<int>(I))...};
+    }
+};
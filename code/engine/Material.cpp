@@ -21,6 +21,7 @@ CMaterial::CMaterial()
     ZeroMemory(mTextureHandle, sizeof(mTextureHandle));
     ZeroMemory(mStats, sizeof(mStats));
     DefaultMaterial();
+    mIsModified = FALSE;
 }
 
 CMaterial::~CMaterial()
@@ -66,6 +67,7 @@ void CMaterial::Release()
 
 void CMaterial::CreateTextureForSlot(unsigned int slot, LPSTR texName, unsigned int w, unsigned int h)
 {
+    mIsModified = TRUE;
     LPDIRECT3DDEVICE9 dev = RENDERER->GetDevice();
 
     if (texName == nullptr)
@@ -86,6 +88,7 @@ void CMaterial::CreateTextureForSlot(unsigned int slot, LPSTR texName, unsigned
 
 void CMaterial::CreateEmbeddedTextureForSlot(unsigned int slot, LPVOID data, unsigned int size)
 {
+    mIsModified = TRUE;
     LPDIRECT3DDEVICE9 dev = RENDERER->GetDevice();
 
     if (data == nullptr)
@@ -106,6 +109,7 @@ void CMaterial::SetUserTexture(unsigned int userSlot, LPDIRECT3DTEXTURE9 handle)
     }
 
     mTextureHandle[userSlot] = handle;
+    mIsModified = TRUE;
 }
 
 void CMaterial::Bind(DWORD stage)
@@ -132,6 +136,7 @@ void CMaterial::Unbind(DWORD stage)
 
 auto CMaterial::Lock(int& pitch, unsigned int slot) -> LPVOID
 {
+    mIsModified = TRUE;
     D3DLOCKED_RECT r;
     mTextureHandle[slot]->LockRect(0, &r, nullptr, 0);
     pitch = r.Pitch;
@@ -140,6 +145,7 @@ auto CMaterial::Lock(int& pitch, unsigned int slot) -> LPVOID
 
 auto CMaterial::LockRect(RECT zone, int& pitch, unsigned slot) -> LPVOID
 {
+    mIsModified = TRUE;
     D3DLOCKED_RECT r;
     mTextureHandle[slot]->LockRect(0, &r, &zone, 0);
     pitch = r.Pitch;
@@ -148,6 +154,7 @@ auto CMaterial::LockRect(RECT zone, int& pitch, unsigned slot) -> LPVOID
 
 void CMaterial::UploadARGB(unsigned int slot, void* data, unsigned int size)
 {
+    mIsModified = TRUE;
     D3DLOCKED_RECT r;
     mTextureHandle[slot]->LockRect(0, &r, nullptr, D3DLOCK_DISCARD);
     memcpy(r.pBits, data, size);
@@ -161,50 +168,60 @@ void CMaterial::Unlock(unsigned int slot)
 
 void CMaterial::SetAmbient(D3DCOLORVALUE color)
 {
+    mIsModified = TRUE;
     memcpy(&mMaterialData.Ambient, &color, sizeof(D3DCOLORVALUE));
 }
 
 void CMaterial::SetDiffuse(D3DCOLORVALUE color)
 {
+    mIsModified = TRUE;
     memcpy(&mMaterialData.Diffuse, &color, sizeof(D3DCOLORVALUE));
 }
 
 void CMaterial::SetSpecular(D3DCOLORVALUE color)
 {
+    mIsModified = TRUE;
     memcpy(&mMaterialData.Specular, &color, sizeof(D3DCOLORVALUE));
 }
 
 void CMaterial::SetEmission(D3DCOLORVALUE color)
 {
+    mIsModified = TRUE;
     memcpy(&mMaterialData.Emissive, &color, sizeof(D3DCOLORVALUE));
 }
 
 void CMaterial::SetPower(float val)
 {
+    mIsModified = TRUE;
     mMaterialData.Power = val;
 }
 
 void CMaterial::SetOpacity(float val)
 {
+    mIsModified = TRUE;
     mMaterialData.Opacity = val;
 }
 
 void CMaterial::SetShaded(bool state)
 {
+    mIsModified = TRUE;
     mMaterialData.Shaded = state;
 }
 
 void CMaterial::SetAlphaIsTransparency(bool state)
 {
+    mIsModified = TRUE;
     mMaterialData.AlphaIsTransparency = state;
 }
 
 void CMaterial::SetEnableAlphaTest(bool state)
 {
+    mIsModified = TRUE;
     mMaterialData.AlphaTestEnabled = TRUE;
 }
 
 void CMaterial::SetAlphaRef(DWORD refval)
 {
+    mIsModified = TRUE;
     mMaterialData.AlphaRef = refval;
 }
@@ -21,7 +21,7 @@ public:
     void CreateTextureForSlot(unsigned int slot, LPSTR texName = nullptr, unsigned int w = 1, unsigned int h = 1);
     void CreateEmbeddedTextureForSlot(unsigned int slot, LPVOID data, unsigned int size);
 
-    void SetSamplerState(unsigned int state, unsigned int value) { mStats[state] = value; }
+    void SetSamplerState(unsigned int state, unsigned int value) { mStats[state] = value; mIsModified = TRUE; }
     auto GetSamplerState(unsigned int state) const -> unsigned int { return mStats[state]; }
     auto GetTextureHandle(unsigned int slot = TEXTURESLOT_ALBEDO) -> LPDIRECT3DTEXTURE9 { return mTextureHandle[slot]; }
 
@@ -48,9 +48,14 @@ public:
     auto GetMaterialData() const -> MATERIAL { return mMaterialData; }
     auto IsTransparent() const -> bool { return mMaterialData.Opacity < 1.0f || mMaterialData.AlphaIsTransparency; }
 
+    /* Set by anything that changes the material or its textures, see CResourceCache::EndSession */
+    auto IsModified() const -> bool { return mIsModified; }
+    void ClearModified() { mIsModified = FALSE; }
+
 private:
     LPDIRECT3DTEXTURE9 mTextureHandle[MAX_TEXTURE_SLOTS];
     MATERIAL mMaterialData;
 
     unsigned int mStats[MAX_SAMPLER_STATES];
+    bool mIsModified;
 };
@@ -48,6 +48,8 @@ void CMesh::AddFaceGroup(CFaceGroup* mesh, const D3DXMATRIX& mat)
         return;
     }
 
+    mRevision++;
+
     if (FAILED(mTransforms.Push(mat)))
     {
         MessageBoxA(nullptr, "Can't add transform to mesh!", "Out of memory error", MB_OK);
@@ -70,10 +72,19 @@ auto CMesh::Clone() -> CMesh*
 
 void CMesh::Draw(const D3DXMATRIX& wmat) const
 {
+    auto world = wmat;
+
+    if (GetOwner() != nullptr)
+    {
+        const auto owner = GetOwner()->GetFinalTransform();
+        NMatrixMultiply(&world, &owner, &wmat);
+    }
+
     for (unsigned int i = 0; i < mFaceGroups.GetCount(); i++)
     {
-        auto mat = (GetOwner() != nullptr ? mTransforms[i] * GetOwner()->GetFinalTransform() : mTransforms[i]) *
-                wmat;
+        auto mat = mTransforms[i];
+
+        NMatrixMultiply(&mat, &mat, &world);
         mFaceGroups[i]->Draw(&mat);
     }
 }
@@ -82,4 +93,5 @@ void CMesh::Clear()
 {
     mFaceGroups.Clear();
     mTransforms.Clear();
+    mRevision++;
 }
@@ -24,7 +24,11 @@ public:
     auto GetFGroupData() const -> CFaceGroup** { return mFaceGroups.GetData(); }
     auto GetTransformData() const -> D3DXMATRIX* { return mTransforms.GetData(); }
     auto GetTransforms() const -> CArray<D3DXMATRIX> { return mTransforms; }
+
+    /* bumped whenever the face groups change, see mesh:getFGroups */
+    auto GetRevision() const -> unsigned int { return mRevision; }
 private:
     CArray<CFaceGroup*> mFaceGroups;
     CArray<D3DXMATRIX> mTransforms;
+    unsigned int mRevision{};
 };
@@ -0,0 +1,80 @@
+#include "StdAfx.h"
+
+#include "MetadataStore.h"
+
+#include "Engine.h"
+#include "NameTable.h"
+
+void CMetadataStore::Release()
+{
+    if (DelRef())
+    {
+        delete this;
+    }
+}
+
+auto CMetadataStore::Add(LPCSTR key, METAKIND kind) -> METAENTRY*
+{
+    METAENTRY entry = {};
+
+    entry.key = NAMES->Intern(key);
+    entry.kind = kind;
+    mEntries.push_back(entry);
+
+    return &mEntries.back();
+}
+
+void CMetadataStore::AddBool(LPCSTR key, bool value)
+{
+    Add(key, METAKIND_BOOL)->b = value;
+}
+
+void CMetadataStore::AddInt(LPCSTR key, long long value)
+{
+    Add(key, METAKIND_INT)->i = value;
+}
+
+void CMetadataStore::AddDouble(LPCSTR key, double value)
+{
+    Add(key, METAKIND_DOUBLE)->d = value;
+}
+
+void CMetadataStore::AddVec3(LPCSTR key, float x, float y, float z)
+{
+    auto* const entry = Add(key, METAKIND_VEC3);
+
+    entry->v[0] = x;
+    entry->v[1] = y;
+    entry->v[2] = z;
+}
+
+void CMetadataStore::AddString(LPCSTR key, LPCSTR value)
+{
+    Add(key, METAKIND_STRING)->str = static_cast<unsigned int>(mStrings.size());
+    mStrings.insert(mStrings.end(), value, value + strlen(value) + 1);
+}
+
+void CMetadataStore::Compact()
+{
+    mEntries.shrink_to_fit();
+    mStrings.shrink_to_fit();
+}
+
+/* Nodes carry a handful of entries at most, a scan over the IDs beats hashing */
+auto CMetadataStore::Find(unsigned int first, unsigned int count, unsigned int key) const -> const METAENTRY*
+{
+    if (key == NAME_NONE)
+    {
+        return nullptr;
+    }
+
+    for (auto i = first; i < first + count; i++)
+    {
+        if (mEntries[i].key == key)
+        {
+            return &mEntries[i];
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "system.h"
+#include "ReferenceManager.h"
+
+#include <vector>
+
+enum METAKIND
+{
+    METAKIND_BOOL,
+    METAKIND_INT,
+    METAKIND_DOUBLE,
+    METAKIND_VEC3,
+    METAKIND_STRING,
+};
+
+struct METAENTRY
+{
+    unsigned int key;       // interned, see CNameTable
+    METAKIND kind;
+
+    union
+    {
+        bool b;
+        long long i;
+        double d;
+        float v[3];
+        unsigned int str;   // offset into the store's string pool
+    };
+};
+
+/*
+ * Metadata of every node in a scene, kept in one flat array. The entries of
+ * a node sit next to each other, nodes refer to them by their first index and
+ * count, so nodes without any metadata cost nothing. Nodes hold a reference
+ * each, clones share the entries of their source.
+ */
+class CMetadataStore : public CReferenceCounter
+{
+public:
+    void Release(void);
+
+    /* Entries added from here on belong to the same node until the next call */
+    auto Begin() const -> unsigned int { return static_cast<unsigned int>(mEntries.size()); }
+
+    void AddBool(LPCSTR key, bool value);
+    void AddInt(LPCSTR key, long long value);
+    void AddDouble(LPCSTR key, double value);
+    void AddVec3(LPCSTR key, float x, float y, float z);
+    void AddString(LPCSTR key, LPCSTR value);
+
+    /* Drops the spare capacity once loading is done */
+    void Compact(void);
+
+    auto Find(unsigned int first, unsigned int count, unsigned int key) const -> const METAENTRY*;
+    auto GetString(const METAENTRY* entry) const -> LPCSTR { return &mStrings[entry->str]; }
+
+    auto GetCount() const -> unsigned int { return static_cast<unsigned int>(mEntries.size()); }
+
+private:
+    std::vector<METAENTRY> mEntries;
+    std::vector<CHAR> mStrings;
+
+    auto Add(LPCSTR key, METAKIND kind) -> METAENTRY*;
+};
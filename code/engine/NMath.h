@@ -0,0 +1,1070 @@
+#pragma once
+
+/*
+ * Header-only vector, matrix and quaternion math. The types share the memory
+ * layout of their D3DX counterparts (row vectors, row-major matrices with the
+ * translation in _41.._43) and the functions follow the D3DX conventions and
+ * signatures, so code can move over one call at a time. Nothing here depends
+ * on Windows; the matrix, 4D vector and batch paths use SSE2 (plus AVX for
+ * matrix batches) on x86, NEON on ARM and plain C++ everywhere else or with
+ * NMATH_SCALAR set.
+ * Overloads taking the D3DX types are provided when d3dx9math.h is included.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(NMATH_SCALAR)
+#elif defined(__AVX__)
+#define NMATH_SSE2
+#define NMATH_AVX
+#elif defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define NMATH_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define NMATH_NEON
+#endif
+
+#if defined(NMATH_AVX)
+#include <immintrin.h>
+#elif defined(NMATH_SSE2)
+#include <emmintrin.h>
+#elif defined(NMATH_NEON)
+#include <arm_neon.h>
+#endif
+
+#define NMATH_PI 3.141592654F
+
+struct NVECTOR3
+{
+    float x, y, z;
+
+    NVECTOR3() = default;
+    NVECTOR3(float vx, float vy, float vz): x(vx), y(vy), z(vz) {}
+
+    auto operator+(const NVECTOR3& v) const -> NVECTOR3 { return {x + v.x, y + v.y, z + v.z}; }
+    auto operator-(const NVECTOR3& v) const -> NVECTOR3 { return {x - v.x, y - v.y, z - v.z}; }
+    auto operator*(float s) const -> NVECTOR3 { return {x * s, y * s, z * s}; }
+    auto operator-() const -> NVECTOR3 { return {-x, -y, -z}; }
+};
+
+struct NVECTOR4
+{
+    float x, y, z, w;
+
+    NVECTOR4() = default;
+    NVECTOR4(float vx, float vy, float vz, float vw): x(vx), y(vy), z(vz), w(vw) {}
+
+    auto operator+(const NVECTOR4& v) const -> NVECTOR4 { return {x + v.x, y + v.y, z + v.z, w + v.w}; }
+    auto operator-(const NVECTOR4& v) const -> NVECTOR4 { return {x - v.x, y - v.y, z - v.z, w - v.w}; }
+    auto operator*(float s) const -> NVECTOR4 { return {x * s, y * s, z * s, w * s}; }
+};
+
+/* Planes are stored as (a, b, c, d) in a 4D vector, like D3DXPLANE */
+using NPLANE = NVECTOR4;
+
+struct NQUATERNION
+{
+    float x, y, z, w;
+};
+
+struct NMATRIX
+{
+    union
+    {
+        struct
+        {
+            float _11, _12, _13, _14;
+            float _21, _22, _23, _24;
+            float _31, _32, _33, _34;
+            float _41, _42, _43, _44;
+        };
+
+        float m[4][4];
+    };
+};
+
+static_assert(sizeof(NVECTOR3) == 12, "NVECTOR3 must match D3DXVECTOR3");
+static_assert(sizeof(NVECTOR4) == 16, "NVECTOR4 must match D3DXVECTOR4");
+static_assert(sizeof(NQUATERNION) == 16, "NQUATERNION must match D3DXQUATERNION");
+static_assert(sizeof(NMATRIX) == 64, "NMATRIX must match D3DXMATRIX");
+
+inline auto NToRadian(float degree) -> float { return degree * (NMATH_PI / 180.0F); }
+inline auto NToDegree(float radian) -> float { return radian * (180.0F / NMATH_PI); }
+
+/* ---- 3D vectors ---- */
+
+inline auto NVec3Dot(const NVECTOR3* a, const NVECTOR3* b) -> float
+{
+    return a->x * b->x + a->y * b->y + a->z * b->z;
+}
+
+inline auto NVec3Cross(NVECTOR3* out, const NVECTOR3* a, const NVECTOR3* b) -> NVECTOR3*
+{
+    const NVECTOR3 r(a->y * b->z - a->z * b->y, a->z * b->x - a->x * b->z, a->x * b->y - a->y * b->x);
+    *out = r;
+    return out;
+}
+
+inline auto NVec3LengthSq(const NVECTOR3* v) -> float { return NVec3Dot(v, v); }
+inline auto NVec3Length(const NVECTOR3* v) -> float { return sqrtf(NVec3Dot(v, v)); }
+
+/* A zero vector stays zero */
+inline auto NVec3Normalize(NVECTOR3* out, const NVECTOR3* v) -> NVECTOR3*
+{
+    const auto len = NVec3Length(v);
+
+    if (len == 0.0F)
+    {
+        *out = NVECTOR3(0.0F, 0.0F, 0.0F);
+        return out;
+    }
+
+    *out = *v * (1.0F / len);
+    return out;
+}
+
+inline auto NVec3Minimize(NVECTOR3* out, const NVECTOR3* a, const NVECTOR3* b) -> NVECTOR3*
+{
+    *out = NVECTOR3(fminf(a->x, b->x), fminf(a->y, b->y), fminf(a->z, b->z));
+    return out;
+}
+
+inline auto NVec3Maximize(NVECTOR3* out, const NVECTOR3* a, const NVECTOR3* b) -> NVECTOR3*
+{
+    *out = NVECTOR3(fmaxf(a->x, b->x), fmaxf(a->y, b->y), fmaxf(a->z, b->z));
+    return out;
+}
+
+inline auto NVec3Lerp(NVECTOR3* out, const NVECTOR3* a, const NVECTOR3* b, float s) -> NVECTOR3*
+{
+    *out = *a + (*b - *a) * s;
+    return out;
+}
+
+/* (x, y, z, 1) * m, divided by the resulting w */
+inline auto NVec3TransformCoord(NVECTOR3* out, const NVECTOR3* v, const NMATRIX* m) -> NVECTOR3*
+{
+    const auto x = v->x * m->_11 + v->y * m->_21 + v->z * m->_31 + m->_41;
+    const auto y = v->x * m->_12 + v->y * m->_22 + v->z * m->_32 + m->_42;
+    const auto z = v->x * m->_13 + v->y * m->_23 + v->z * m->_33 + m->_43;
+    const auto w = v->x * m->_14 + v->y * m->_24 + v->z * m->_34 + m->_44;
+    const auto invW = w != 0.0F ? 1.0F / w : 0.0F;
+
+    *out = NVECTOR3(x * invW, y * invW, z * invW);
+    return out;
+}
+
+/* (x, y, z, 0) * m, directions skip the translation */
+inline auto NVec3TransformNormal(NVECTOR3* out, const NVECTOR3* v, const NMATRIX* m) -> NVECTOR3*
+{
+    const NVECTOR3 r(v->x * m->_11 + v->y * m->_21 + v->z * m->_31,
+                     v->x * m->_12 + v->y * m->_22 + v->z * m->_32,
+                     v->x * m->_13 + v->y * m->_23 + v->z * m->_33);
+    *out = r;
+    return out;
+}
+
+/* ---- 4D vectors ---- */
+
+inline auto NVec4Add(NVECTOR4* out, const NVECTOR4* a, const NVECTOR4* b) -> NVECTOR4*
+{
+    *out = *a + *b;
+    return out;
+}
+
+inline auto NVec4Subtract(NVECTOR4* out, const NVECTOR4* a, const NVECTOR4* b) -> NVECTOR4*
+{
+    *out = *a - *b;
+    return out;
+}
+
+inline auto NVec4Dot(const NVECTOR4* a, const NVECTOR4* b) -> float
+{
+    return a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w;
+}
+
+inline auto NVec4LengthSq(const NVECTOR4* v) -> float { return NVec4Dot(v, v); }
+inline auto NVec4Length(const NVECTOR4* v) -> float { return sqrtf(NVec4Dot(v, v)); }
+
+inline auto NVec4Lerp(NVECTOR4* out, const NVECTOR4* a, const NVECTOR4* b, float s) -> NVECTOR4*
+{
+    *out = *a + (*b - *a) * s;
+    return out;
+}
+
+/* v * m */
+inline auto NVec4Transform(NVECTOR4* out, const NVECTOR4* v, const NMATRIX* m) -> NVECTOR4*
+{
+#if defined(NMATH_SSE2)
+    auto r = _mm_mul_ps(_mm_set1_ps(v->x), _mm_loadu_ps(m->m[0]));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v->y), _mm_loadu_ps(m->m[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v->z), _mm_loadu_ps(m->m[2])));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v->w), _mm_loadu_ps(m->m[3])));
+    _mm_storeu_ps(&out->x, r);
+#elif defined(NMATH_NEON)
+    auto r = vmulq_n_f32(vld1q_f32(m->m[0]), v->x);
+    r = vmlaq_n_f32(r, vld1q_f32(m->m[1]), v->y);
+    r = vmlaq_n_f32(r, vld1q_f32(m->m[2]), v->z);
+    r = vmlaq_n_f32(r, vld1q_f32(m->m[3]), v->w);
+    vst1q_f32(&out->x, r);
+#else
+    const NVECTOR4 r(v->x * m->_11 + v->y * m->_21 + v->z * m->_31 + v->w * m->_41,
+                     v->x * m->_12 + v->y * m->_22 + v->z * m->_32 + v->w * m->_42,
+                     v->x * m->_13 + v->y * m->_23 + v->z * m->_33 + v->w * m->_43,
+                     v->x * m->_14 + v->y * m->_24 + v->z * m->_34 + v->w * m->_44);
+    *out = r;
+#endif
+    return out;
+}
+
+/* ---- Matrices ---- */
+
+inline auto NMatrixIdentity(NMATRIX* out) -> NMATRIX*
+{
+    memset(out, 0, sizeof(NMATRIX));
+    out->_11 = out->_22 = out->_33 = out->_44 = 1.0F;
+    return out;
+}
+
+inline auto NMatrixIsIdentity(const NMATRIX* m) -> bool
+{
+    for (auto i = 0; i < 4; i++)
+    {
+        for (auto j = 0; j < 4; j++)
+        {
+            if (m->m[i][j] != (i == j ? 1.0F : 0.0F))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/* a * b, out may be either operand */
+inline auto NMatrixMultiply(NMATRIX* out, const NMATRIX* a, const NMATRIX* b) -> NMATRIX*
+{
+#if defined(NMATH_SSE2)
+    const auto b0 = _mm_loadu_ps(b->m[0]);
+    const auto b1 = _mm_loadu_ps(b->m[1]);
+    const auto b2 = _mm_loadu_ps(b->m[2]);
+    const auto b3 = _mm_loadu_ps(b->m[3]);
+
+    for (auto i = 0; i < 4; i++)
+    {
+        const auto row = _mm_loadu_ps(a->m[i]);
+        auto r = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+        _mm_storeu_ps(out->m[i], r);
+    }
+#elif defined(NMATH_NEON)
+    const auto b0 = vld1q_f32(b->m[0]);
+    const auto b1 = vld1q_f32(b->m[1]);
+    const auto b2 = vld1q_f32(b->m[2]);
+    const auto b3 = vld1q_f32(b->m[3]);
+
+    for (auto i = 0; i < 4; i++)
+    {
+        const auto row = vld1q_f32(a->m[i]);
+        auto r = vmulq_lane_f32(b0, vget_low_f32(row), 0);
+        r = vmlaq_lane_f32(r, b1, vget_low_f32(row), 1);
+        r = vmlaq_lane_f32(r, b2, vget_high_f32(row), 0);
+        r = vmlaq_lane_f32(r, b3, vget_high_f32(row), 1);
+        vst1q_f32(out->m[i], r);
+    }
+#else
+    NMATRIX r;
+
+    for (auto i = 0; i < 4; i++)
+    {
+        for (auto j = 0; j < 4; j++)
+        {
+            r.m[i][j] = a->m[i][0] * b->m[0][j] + a->m[i][1] * b->m[1][j] + a->m[i][2] * b->m[2][j] + a->m[i][3] * b->m[3][j];
+        }
+    }
+
+    *out = r;
+#endif
+    return out;
+}
+
+/* out[i] = a[i] * b[i], the arrays must not overlap */
+inline void NMatrixMultiplyArray(NMATRIX* out, const NMATRIX* a, const NMATRIX* b, size_t count)
+{
+#if defined(NMATH_AVX)
+    // two rows per 256-bit register, so a product takes two passes instead of four
+    for (size_t n = 0; n < count; n++)
+    {
+        const auto b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b[n].m[0]));
+        const auto b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b[n].m[1]));
+        const auto b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b[n].m[2]));
+        const auto b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b[n].m[3]));
+
+        for (auto i = 0; i < 4; i += 2)
+        {
+            const auto rows = _mm256_loadu_ps(a[n].m[i]);
+            auto r = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+            _mm256_storeu_ps(out[n].m[i], r);
+        }
+    }
+#else
+    for (size_t n = 0; n < count; n++)
+    {
+        NMatrixMultiply(out + n, a + n, b + n);
+    }
+#endif
+}
+
+inline auto NMatrixTranspose(NMATRIX* out, const NMATRIX* m) -> NMATRIX*
+{
+#if defined(NMATH_SSE2)
+    auto r0 = _mm_loadu_ps(m->m[0]);
+    auto r1 = _mm_loadu_ps(m->m[1]);
+    auto r2 = _mm_loadu_ps(m->m[2]);
+    auto r3 = _mm_loadu_ps(m->m[3]);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(out->m[0], r0);
+    _mm_storeu_ps(out->m[1], r1);
+    _mm_storeu_ps(out->m[2], r2);
+    _mm_storeu_ps(out->m[3], r3);
+#else
+    NMATRIX r;
+
+    for (auto i = 0; i < 4; i++)
+    {
+        for (auto j = 0; j < 4; j++)
+        {
+            r.m[i][j] = m->m[j][i];
+        }
+    }
+
+    *out = r;
+#endif
+    return out;
+}
+
+/* Returns nullptr and leaves out alone when m isn't invertible, det is optional */
+inline auto NMatrixInverse(NMATRIX* out, float* det, const NMATRIX* m) -> NMATRIX*
+{
+    const auto* a = &m->m[0][0];
+    float inv[16];
+
+    // cofactors of the 2x2 minors, shared between the terms below
+    const auto s0 = a[0] * a[5] - a[4] * a[1];
+    const auto s1 = a[0] * a[6] - a[4] * a[2];
+    const auto s2 = a[0] * a[7] - a[4] * a[3];
+    const auto s3 = a[1] * a[6] - a[5] * a[2];
+    const auto s4 = a[1] * a[7] - a[5] * a[3];
+    const auto s5 = a[2] * a[7] - a[6] * a[3];
+
+    const auto c5 = a[10] * a[15] - a[14] * a[11];
+    const auto c4 = a[9] * a[15] - a[13] * a[11];
+    const auto c3 = a[9] * a[14] - a[13] * a[10];
+    const auto c2 = a[8] * a[15] - a[12] * a[11];
+    const auto c1 = a[8] * a[14] - a[12] * a[10];
+    const auto c0 = a[8] * a[13] - a[12] * a[9];
+
+    const auto d = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+    if (det != nullptr)
+        *det = d;
+
+    if (d == 0.0F || !std::isfinite(d))
+        return nullptr;
+
+    const auto invDet = 1.0F / d;
+
+    inv[0] = (a[5] * c5 - a[6] * c4 + a[7] * c3) * invDet;
+    inv[1] = (-a[1] * c5 + a[2] * c4 - a[3] * c3) * invDet;
+    inv[2] = (a[13] * s5 - a[14] * s4 + a[15] * s3) * invDet;
+    inv[3] = (-a[9] * s5 + a[10] * s4 - a[11] * s3) * invDet;
+
+    inv[4] = (-a[4] * c5 + a[6] * c2 - a[7] * c1) * invDet;
+    inv[5] = (a[0] * c5 - a[2] * c2 + a[3] * c1) * invDet;
+    inv[6] = (-a[12] * s5 + a[14] * s2 - a[15] * s1) * invDet;
+    inv[7] = (a[8] * s5 - a[10] * s2 + a[11] * s1) * invDet;
+
+    inv[8] = (a[4] * c4 - a[5] * c2 + a[7] * c0) * invDet;
+    inv[9] = (-a[0] * c4 + a[1] * c2 - a[3] * c0) * invDet;
+    inv[10] = (a[12] * s4 - a[13] * s2 + a[15] * s0) * invDet;
+    inv[11] = (-a[8] * s4 + a[9] * s2 - a[11] * s0) * invDet;
+
+    inv[12] = (-a[4] * c3 + a[5] * c1 - a[6] * c0) * invDet;
+    inv[13] = (a[0] * c3 - a[1] * c1 + a[2] * c0) * invDet;
+    inv[14] = (-a[12] * s3 + a[13] * s1 - a[14] * s0) * invDet;
+    inv[15] = (a[8] * s3 - a[9] * s1 + a[10] * s0) * invDet;
+
+    memcpy(out, inv, sizeof(inv));
+    return out;
+}
+
+inline auto NMatrixTranslation(NMATRIX* out, float x, float y, float z) -> NMATRIX*
+{
+    NMatrixIdentity(out);
+    out->_41 = x;
+    out->_42 = y;
+    out->_43 = z;
+    return out;
+}
+
+inline auto NMatrixScaling(NMATRIX* out, float x, float y, float z) -> NMATRIX*
+{
+    NMatrixIdentity(out);
+    out->_11 = x;
+    out->_22 = y;
+    out->_33 = z;
+    return out;
+}
+
+inline auto NMatrixRotationX(NMATRIX* out, float angle) -> NMATRIX*
+{
+    const auto s = sinf(angle), c = cosf(angle);
+    NMatrixIdentity(out);
+    out->_22 = c;
+    out->_23 = s;
+    out->_32 = -s;
+    out->_33 = c;
+    return out;
+}
+
+inline auto NMatrixRotationY(NMATRIX* out, float angle) -> NMATRIX*
+{
+    const auto s = sinf(angle), c = cosf(angle);
+    NMatrixIdentity(out);
+    out->_11 = c;
+    out->_13 = -s;
+    out->_31 = s;
+    out->_33 = c;
+    return out;
+}
+
+inline auto NMatrixRotationZ(NMATRIX* out, float angle) -> NMATRIX*
+{
+    const auto s = sinf(angle), c = cosf(angle);
+    NMatrixIdentity(out);
+    out->_11 = c;
+    out->_12 = s;
+    out->_21 = -s;
+    out->_22 = c;
+    return out;
+}
+
+/* Roll about z, then pitch about x, then yaw about y */
+inline auto NMatrixRotationYawPitchRoll(NMATRIX* out, float yaw, float pitch, float roll) -> NMATRIX*
+{
+    const auto sy = sinf(yaw), cy = cosf(yaw);
+    const auto sp = sinf(pitch), cp = cosf(pitch);
+    const auto sr = sinf(roll), cr = cosf(roll);
+
+    out->_11 = cr * cy + sr * sp * sy;
+    out->_12 = sr * cp;
+    out->_13 = sr * sp * cy - cr * sy;
+    out->_14 = 0.0F;
+    out->_21 = cr * sp * sy - sr * cy;
+    out->_22 = cr * cp;
+    out->_23 = sr * sy + cr * sp * cy;
+    out->_24 = 0.0F;
+    out->_31 = cp * sy;
+    out->_32 = -sp;
+    out->_33 = cp * cy;
+    out->_34 = 0.0F;
+    out->_41 = out->_42 = out->_43 = 0.0F;
+    out->_44 = 1.0F;
+    return out;
+}
+
+inline auto NMatrixRotationQuaternion(NMATRIX* out, const NQUATERNION* q) -> NMATRIX*
+{
+    const auto xx = q->x * q->x, yy = q->y * q->y, zz = q->z * q->z;
+    const auto xy = q->x * q->y, xz = q->x * q->z, yz = q->y * q->z;
+    const auto wx = q->w * q->x, wy = q->w * q->y, wz = q->w * q->z;
+
+    NMatrixIdentity(out);
+    out->_11 = 1.0F - 2.0F * (yy + zz);
+    out->_12 = 2.0F * (xy + wz);
+    out->_13 = 2.0F * (xz - wy);
+    out->_21 = 2.0F * (xy - wz);
+    out->_22 = 1.0F - 2.0F * (xx + zz);
+    out->_23 = 2.0F * (yz + wx);
+    out->_31 = 2.0F * (xz + wy);
+    out->_32 = 2.0F * (yz - wx);
+    out->_33 = 1.0F - 2.0F * (xx + yy);
+    return out;
+}
+
+inline auto NMatrixLookAt(NMATRIX* out, const NVECTOR3* eye, const NVECTOR3* at, const NVECTOR3* up, bool rightHanded) -> NMATRIX*
+{
+    NVECTOR3 xaxis, yaxis, zaxis;
+    const auto dir = rightHanded ? *eye - *at : *at - *eye;
+
+    NVec3Normalize(&zaxis, &dir);
+    NVec3Cross(&xaxis, up, &zaxis);
+    NVec3Normalize(&xaxis, &xaxis);
+    NVec3Cross(&yaxis, &zaxis, &xaxis);
+
+    out->_11 = xaxis.x; out->_12 = yaxis.x; out->_13 = zaxis.x; out->_14 = 0.0F;
+    out->_21 = xaxis.y; out->_22 = yaxis.y; out->_23 = zaxis.y; out->_24 = 0.0F;
+    out->_31 = xaxis.z; out->_32 = yaxis.z; out->_33 = zaxis.z; out->_34 = 0.0F;
+    out->_41 = -NVec3Dot(&xaxis, eye);
+    out->_42 = -NVec3Dot(&yaxis, eye);
+    out->_43 = -NVec3Dot(&zaxis, eye);
+    out->_44 = 1.0F;
+    return out;
+}
+
+inline auto NMatrixLookAtLH(NMATRIX* out, const NVECTOR3* eye, const NVECTOR3* at, const NVECTOR3* up) -> NMATRIX*
+{
+    return NMatrixLookAt(out, eye, at, up, false);
+}
+
+inline auto NMatrixLookAtRH(NMATRIX* out, const NVECTOR3* eye, const NVECTOR3* at, const NVECTOR3* up) -> NMATRIX*
+{
+    return NMatrixLookAt(out, eye, at, up, true);
+}
+
+inline auto NMatrixPerspectiveFovLH(NMATRIX* out, float fovY, float aspect, float zn, float zf) -> NMATRIX*
+{
+    const auto yScale = 1.0F / tanf(fovY / 2.0F);
+
+    memset(out, 0, sizeof(NMATRIX));
+    out->_11 = yScale / aspect;
+    out->_22 = yScale;
+    out->_33 = zf / (zf - zn);
+    out->_34 = 1.0F;
+    out->_43 = -zn * zf / (zf - zn);
+    return out;
+}
+
+inline auto NMatrixPerspectiveFovRH(NMATRIX* out, float fovY, float aspect, float zn, float zf) -> NMATRIX*
+{
+    const auto yScale = 1.0F / tanf(fovY / 2.0F);
+
+    memset(out, 0, sizeof(NMATRIX));
+    out->_11 = yScale / aspect;
+    out->_22 = yScale;
+    out->_33 = zf / (zn - zf);
+    out->_34 = -1.0F;
+    out->_43 = zn * zf / (zn - zf);
+    return out;
+}
+
+inline auto NMatrixOrthoOffCenterLH(NMATRIX* out, float l, float r, float b, float t, float zn, float zf) -> NMATRIX*
+{
+    NMatrixIdentity(out);
+    out->_11 = 2.0F / (r - l);
+    out->_22 = 2.0F / (t - b);
+    out->_33 = 1.0F / (zf - zn);
+    out->_41 = (l + r) / (l - r);
+    out->_42 = (t + b) / (b - t);
+    out->_43 = zn / (zn - zf);
+    return out;
+}
+
+inline auto NMatrixOrthoOffCenterRH(NMATRIX* out, float l, float r, float b, float t, float zn, float zf) -> NMATRIX*
+{
+    NMatrixOrthoOffCenterLH(out, l, r, b, t, zn, zf);
+    out->_33 = -out->_33;
+    return out;
+}
+
+inline auto NMatrixOrthoLH(NMATRIX* out, float w, float h, float zn, float zf) -> NMATRIX*
+{
+    return NMatrixOrthoOffCenterLH(out, -w / 2.0F, w / 2.0F, -h / 2.0F, h / 2.0F, zn, zf);
+}
+
+inline auto NMatrixOrthoRH(NMATRIX* out, float w, float h, float zn, float zf) -> NMATRIX*
+{
+    return NMatrixOrthoOffCenterRH(out, -w / 2.0F, w / 2.0F, -h / 2.0F, h / 2.0F, zn, zf);
+}
+
+/* The plane's normal gets normalized, d is scaled along */
+inline auto NPlaneNormalize(NPLANE* out, const NPLANE* p) -> NPLANE*
+{
+    const auto len = sqrtf(p->x * p->x + p->y * p->y + p->z * p->z);
+
+    if (len == 0.0F)
+    {
+        *out = NPLANE(0.0F, 0.0F, 0.0F, 0.0F);
+        return out;
+    }
+
+    *out = *p * (1.0F / len);
+    return out;
+}
+
+/* Mirrors about the plane */
+inline auto NMatrixReflect(NMATRIX* out, const NPLANE* plane) -> NMATRIX*
+{
+    NPLANE p;
+    NPlaneNormalize(&p, plane);
+
+    const float n[4] = {p.x, p.y, p.z, p.w};
+
+    for (auto i = 0; i < 4; i++)
+    {
+        for (auto j = 0; j < 3; j++)
+        {
+            out->m[i][j] = (i == j ? 1.0F : 0.0F) - 2.0F * n[i] * n[j];
+        }
+
+        out->m[i][3] = i == 3 ? 1.0F : 0.0F;
+    }
+
+    return out;
+}
+
+/* Flattens geometry onto the plane as lit by light, w = 0 for a directional light */
+inline auto NMatrixShadow(NMATRIX* out, const NVECTOR4* light, const NPLANE* plane) -> NMATRIX*
+{
+    NPLANE p;
+    NPlaneNormalize(&p, plane);
+
+    const auto d = NVec4Dot(&p, light);
+    const float n[4] = {p.x, p.y, p.z, p.w};
+    const float l[4] = {light->x, light->y, light->z, light->w};
+
+    for (auto i = 0; i < 4; i++)
+    {
+        for (auto j = 0; j < 4; j++)
+        {
+            out->m[i][j] = (i == j ? d : 0.0F) - n[i] * l[j];
+        }
+    }
+
+    return out;
+}
+
+/* ---- Quaternions ---- */
+
+inline auto NQuaternionIdentity(NQUATERNION* out) -> NQUATERNION*
+{
+    *out = {0.0F, 0.0F, 0.0F, 1.0F};
+    return out;
+}
+
+/* Rotation by a followed by b, the same order as multiplying their matrices */
+inline auto NQuaternionMultiply(NQUATERNION* out, const NQUATERNION* a, const NQUATERNION* b) -> NQUATERNION*
+{
+    const NQUATERNION r = {
+        b->w * a->x + b->x * a->w + b->y * a->z - b->z * a->y,
+        b->w * a->y - b->x * a->z + b->y * a->w + b->z * a->x,
+        b->w * a->z + b->x * a->y - b->y * a->x + b->z * a->w,
+        b->w * a->w - b->x * a->x - b->y * a->y - b->z * a->z,
+    };
+
+    *out = r;
+    return out;
+}
+
+inline auto NQuaternionNormalize(NQUATERNION* out, const NQUATERNION* q) -> NQUATERNION*
+{
+    const auto len = sqrtf(q->x * q->x + q->y * q->y + q->z * q->z + q->w * q->w);
+
+    if (len == 0.0F)
+        return NQuaternionIdentity(out);
+
+    const auto inv = 1.0F / len;
+    *out = {q->x * inv, q->y * inv, q->z * inv, q->w * inv};
+    return out;
+}
+
+inline auto NQuaternionRotationAxis(NQUATERNION* out, const NVECTOR3* axis, float angle) -> NQUATERNION*
+{
+    NVECTOR3 n;
+    NVec3Normalize(&n, axis);
+
+    const auto s = sinf(angle / 2.0F);
+    *out = {n.x * s, n.y * s, n.z * s, cosf(angle / 2.0F)};
+    return out;
+}
+
+/* Same rotation as NMatrixRotationYawPitchRoll */
+inline auto NQuaternionRotationYawPitchRoll(NQUATERNION* out, float yaw, float pitch, float roll) -> NQUATERNION*
+{
+    const auto sy = sinf(yaw / 2.0F), cy = cosf(yaw / 2.0F);
+    const auto sp = sinf(pitch / 2.0F), cp = cosf(pitch / 2.0F);
+    const auto sr = sinf(roll / 2.0F), cr = cosf(roll / 2.0F);
+
+    *out = {
+        cy * sp * cr + sy * cp * sr,
+        sy * cp * cr - cy * sp * sr,
+        cy * cp * sr - sy * sp * cr,
+        cy * cp * cr + sy * sp * sr,
+    };
+    return out;
+}
+
+/* Takes the shorter way around, falls back to a lerp for nearly equal rotations */
+inline auto NQuaternionSlerp(NQUATERNION* out, const NQUATERNION* a, const NQUATERNION* b, float t) -> NQUATERNION*
+{
+    auto cosom = a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w;
+    auto sign = 1.0F;
+
+    if (cosom < 0.0F)
+    {
+        cosom = -cosom;
+        sign = -1.0F;
+    }
+
+    auto s0 = 1.0F - t;
+    auto s1 = t;
+
+    if (cosom < 0.9999F)
+    {
+        const auto omega = acosf(cosom);
+        const auto invSin = 1.0F / sinf(omega);
+        s0 = sinf((1.0F - t) * omega) * invSin;
+        s1 = sinf(t * omega) * invSin;
+    }
+
+    s1 *= sign;
+    *out = {s0 * a->x + s1 * b->x, s0 * a->y + s1 * b->y, s0 * a->z + s1 * b->z, s0 * a->w + s1 * b->w};
+    return out;
+}
+
+/* ---- Batches and bounds ---- */
+
+/*
+ * Strides are in bytes, like the D3DX array functions. The matrix rows stay in
+ * registers for the whole batch, and only three floats are read and written
+ * per point so tightly packed arrays don't overrun.
+ */
+inline void NVec3TransformCoordArray(NVECTOR3* out, size_t outStride, const NVECTOR3* in, size_t inStride, const NMATRIX* m, size_t count)
+{
+    auto* dst = reinterpret_cast<unsigned char*>(out);
+    const auto* src = reinterpret_cast<const unsigned char*>(in);
+
+#if defined(NMATH_SSE2)
+    const auto m0 = _mm_loadu_ps(m->m[0]);
+    const auto m1 = _mm_loadu_ps(m->m[1]);
+    const auto m2 = _mm_loadu_ps(m->m[2]);
+    const auto m3 = _mm_loadu_ps(m->m[3]);
+
+    for (size_t i = 0; i < count; i++, dst += outStride, src += inStride)
+    {
+        const auto* v = reinterpret_cast<const NVECTOR3*>(src);
+        auto r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v->x), m0), m3);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v->y), m1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v->z), m2));
+
+        const auto w = _mm_cvtss_f32(_mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)));
+        r = _mm_mul_ps(r, _mm_set1_ps(w != 0.0F ? 1.0F / w : 0.0F));
+
+        _mm_storel_pi(reinterpret_cast<__m64*>(dst), r);
+        _mm_store_ss(reinterpret_cast<float*>(dst) + 2, _mm_movehl_ps(r, r));
+    }
+#elif defined(NMATH_NEON)
+    const auto m0 = vld1q_f32(m->m[0]);
+    const auto m1 = vld1q_f32(m->m[1]);
+    const auto m2 = vld1q_f32(m->m[2]);
+    const auto m3 = vld1q_f32(m->m[3]);
+
+    for (size_t i = 0; i < count; i++, dst += outStride, src += inStride)
+    {
+        const auto* v = reinterpret_cast<const NVECTOR3*>(src);
+        auto r = vmlaq_n_f32(m3, m0, v->x);
+        r = vmlaq_n_f32(r, m1, v->y);
+        r = vmlaq_n_f32(r, m2, v->z);
+
+        const auto w = vgetq_lane_f32(r, 3);
+        r = vmulq_n_f32(r, w != 0.0F ? 1.0F / w : 0.0F);
+
+        vst1_f32(reinterpret_cast<float*>(dst), vget_low_f32(r));
+        vst1q_lane_f32(reinterpret_cast<float*>(dst) + 2, r, 2);
+    }
+#else
+    for (size_t i = 0; i < count; i++, dst += outStride, src += inStride)
+    {
+        NVec3TransformCoord(reinterpret_cast<NVECTOR3*>(dst), reinterpret_cast<const NVECTOR3*>(src), m);
+    }
+#endif
+}
+
+/* Centered on the average of the points, like D3DXComputeBoundingSphere */
+inline void NComputeBoundingSphere(const NVECTOR3* points, size_t count, size_t stride, NVECTOR3* center, float* radius)
+{
+    const auto* p = reinterpret_cast<const unsigned char*>(points);
+    NVECTOR3 sum(0.0F, 0.0F, 0.0F);
+    auto maxDistSq = 0.0F;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        sum = sum + *reinterpret_cast<const NVECTOR3*>(p + i * stride);
+    }
+
+    *center = count > 0 ? sum * (1.0F / static_cast<float>(count)) : sum;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const auto d = *reinterpret_cast<const NVECTOR3*>(p + i * stride) - *center;
+        maxDistSq = fmaxf(maxDistSq, NVec3LengthSq(&d));
+    }
+
+    *radius = sqrtf(maxDistSq);
+}
+
+inline void NComputeBoundingBox(const NVECTOR3* points, size_t count, size_t stride, NVECTOR3* min, NVECTOR3* max)
+{
+    const auto* p = reinterpret_cast<const unsigned char*>(points);
+
+    if (count == 0)
+    {
+        *min = *max = NVECTOR3(0.0F, 0.0F, 0.0F);
+        return;
+    }
+
+    *min = *max = *points;
+
+    for (size_t i = 1; i < count; i++)
+    {
+        const auto* v = reinterpret_cast<const NVECTOR3*>(p + i * stride);
+        NVec3Minimize(min, min, v);
+        NVec3Maximize(max, max, v);
+    }
+}
+
+/* ---- D3DX interop ---- */
+
+#ifdef __D3DX9MATH_H__
+
+#define NMATH_M(p) reinterpret_cast<NMATRIX*>(p)
+#define NMATH_CM(p) reinterpret_cast<const NMATRIX*>(p)
+#define NMATH_V3(p) reinterpret_cast<NVECTOR3*>(p)
+#define NMATH_CV3(p) reinterpret_cast<const NVECTOR3*>(p)
+#define NMATH_V4(p) reinterpret_cast<NVECTOR4*>(p)
+#define NMATH_CV4(p) reinterpret_cast<const NVECTOR4*>(p)
+#define NMATH_Q(p) reinterpret_cast<NQUATERNION*>(p)
+#define NMATH_CQ(p) reinterpret_cast<const NQUATERNION*>(p)
+
+static_assert(sizeof(D3DXMATRIX) == sizeof(NMATRIX), "D3DXMATRIX layout changed");
+static_assert(sizeof(D3DXVECTOR3) == sizeof(NVECTOR3), "D3DXVECTOR3 layout changed");
+static_assert(sizeof(D3DXVECTOR4) == sizeof(NVECTOR4), "D3DXVECTOR4 layout changed");
+static_assert(sizeof(D3DXPLANE) == sizeof(NPLANE), "D3DXPLANE layout changed");
+static_assert(sizeof(D3DXQUATERNION) == sizeof(NQUATERNION), "D3DXQUATERNION layout changed");
+
+inline auto NVec3Dot(const D3DXVECTOR3* a, const D3DXVECTOR3* b) -> float { return NVec3Dot(NMATH_CV3(a), NMATH_CV3(b)); }
+inline auto NVec3LengthSq(const D3DXVECTOR3* v) -> float { return NVec3LengthSq(NMATH_CV3(v)); }
+inline auto NVec3Length(const D3DXVECTOR3* v) -> float { return NVec3Length(NMATH_CV3(v)); }
+
+inline auto NVec3Cross(D3DXVECTOR3* out, const D3DXVECTOR3* a, const D3DXVECTOR3* b) -> D3DXVECTOR3*
+{
+    NVec3Cross(NMATH_V3(out), NMATH_CV3(a), NMATH_CV3(b));
+    return out;
+}
+
+inline auto NVec3Normalize(D3DXVECTOR3* out, const D3DXVECTOR3* v) -> D3DXVECTOR3*
+{
+    NVec3Normalize(NMATH_V3(out), NMATH_CV3(v));
+    return out;
+}
+
+inline auto NVec3Minimize(D3DXVECTOR3* out, const D3DXVECTOR3* a, const D3DXVECTOR3* b) -> D3DXVECTOR3*
+{
+    NVec3Minimize(NMATH_V3(out), NMATH_CV3(a), NMATH_CV3(b));
+    return out;
+}
+
+inline auto NVec3Maximize(D3DXVECTOR3* out, const D3DXVECTOR3* a, const D3DXVECTOR3* b) -> D3DXVECTOR3*
+{
+    NVec3Maximize(NMATH_V3(out), NMATH_CV3(a), NMATH_CV3(b));
+    return out;
+}
+
+inline auto NVec3TransformCoord(D3DXVECTOR3* out, const D3DXVECTOR3* v, const D3DXMATRIX* m) -> D3DXVECTOR3*
+{
+    NVec3TransformCoord(NMATH_V3(out), NMATH_CV3(v), NMATH_CM(m));
+    return out;
+}
+
+inline auto NVec3TransformNormal(D3DXVECTOR3* out, const D3DXVECTOR3* v, const D3DXMATRIX* m) -> D3DXVECTOR3*
+{
+    NVec3TransformNormal(NMATH_V3(out), NMATH_CV3(v), NMATH_CM(m));
+    return out;
+}
+
+inline auto NVec4Add(D3DXVECTOR4* out, const D3DXVECTOR4* a, const D3DXVECTOR4* b) -> D3DXVECTOR4*
+{
+    NVec4Add(NMATH_V4(out), NMATH_CV4(a), NMATH_CV4(b));
+    return out;
+}
+
+inline auto NVec4Subtract(D3DXVECTOR4* out, const D3DXVECTOR4* a, const D3DXVECTOR4* b) -> D3DXVECTOR4*
+{
+    NVec4Subtract(NMATH_V4(out), NMATH_CV4(a), NMATH_CV4(b));
+    return out;
+}
+
+inline auto NVec4Dot(const D3DXVECTOR4* a, const D3DXVECTOR4* b) -> float { return NVec4Dot(NMATH_CV4(a), NMATH_CV4(b)); }
+inline auto NVec4LengthSq(const D3DXVECTOR4* v) -> float { return NVec4LengthSq(NMATH_CV4(v)); }
+inline auto NVec4Length(const D3DXVECTOR4* v) -> float { return NVec4Length(NMATH_CV4(v)); }
+
+inline auto NVec4Lerp(D3DXVECTOR4* out, const D3DXVECTOR4* a, const D3DXVECTOR4* b, float s) -> D3DXVECTOR4*
+{
+    NVec4Lerp(NMATH_V4(out), NMATH_CV4(a), NMATH_CV4(b), s);
+    return out;
+}
+
+inline auto NMatrixIdentity(D3DXMATRIX* out) -> D3DXMATRIX*
+{
+    NMatrixIdentity(NMATH_M(out));
+    return out;
+}
+
+inline auto NMatrixMultiply(D3DXMATRIX* out, const D3DXMATRIX* a, const D3DXMATRIX* b) -> D3DXMATRIX*
+{
+    NMatrixMultiply(NMATH_M(out), NMATH_CM(a), NMATH_CM(b));
+    return out;
+}
+
+inline void NMatrixMultiplyArray(D3DXMATRIX* out, const D3DXMATRIX* a, const D3DXMATRIX* b, size_t count)
+{
+    NMatrixMultiplyArray(NMATH_M(out), NMATH_CM(a), NMATH_CM(b), count);
+}
+
+inline auto NMatrixInverse(D3DXMATRIX* out, float* det, const D3DXMATRIX* m) -> D3DXMATRIX*
+{
+    return NMatrixInverse(NMATH_M(out), det, NMATH_CM(m)) != nullptr ? out : nullptr;
+}
+
+inline auto NMatrixTranslation(D3DXMATRIX* out, float x, float y, float z) -> D3DXMATRIX*
+{
+    NMatrixTranslation(NMATH_M(out), x, y, z);
+    return out;
+}
+
+inline auto NMatrixScaling(D3DXMATRIX* out, float x, float y, float z) -> D3DXMATRIX*
+{
+    NMatrixScaling(NMATH_M(out), x, y, z);
+    return out;
+}
+
+inline auto NMatrixRotationYawPitchRoll(D3DXMATRIX* out, float yaw, float pitch, float roll) -> D3DXMATRIX*
+{
+    NMatrixRotationYawPitchRoll(NMATH_M(out), yaw, pitch, roll);
+    return out;
+}
+
+inline auto NMatrixRotationQuaternion(D3DXMATRIX* out, const D3DXQUATERNION* q) -> D3DXMATRIX*
+{
+    NMatrixRotationQuaternion(NMATH_M(out), NMATH_CQ(q));
+    return out;
+}
+
+inline auto NMatrixLookAtLH(D3DXMATRIX* out, const D3DXVECTOR3* eye, const D3DXVECTOR3* at, const D3DXVECTOR3* up) -> D3DXMATRIX*
+{
+    NMatrixLookAtLH(NMATH_M(out), NMATH_CV3(eye), NMATH_CV3(at), NMATH_CV3(up));
+    return out;
+}
+
+inline auto NMatrixPerspectiveFovLH(D3DXMATRIX* out, float fovY, float aspect, float zn, float zf) -> D3DXMATRIX*
+{
+    NMatrixPerspectiveFovLH(NMATH_M(out), fovY, aspect, zn, zf);
+    return out;
+}
+
+inline auto NMatrixPerspectiveFovRH(D3DXMATRIX* out, float fovY, float aspect, float zn, float zf) -> D3DXMATRIX*
+{
+    NMatrixPerspectiveFovRH(NMATH_M(out), fovY, aspect, zn, zf);
+    return out;
+}
+
+inline auto NMatrixOrthoLH(D3DXMATRIX* out, float w, float h, float zn, float zf) -> D3DXMATRIX*
+{
+    NMatrixOrthoLH(NMATH_M(out), w, h, zn, zf);
+    return out;
+}
+
+inline auto NMatrixOrthoRH(D3DXMATRIX* out, float w, float h, float zn, float zf) -> D3DXMATRIX*
+{
+    NMatrixOrthoRH(NMATH_M(out), w, h, zn, zf);
+    return out;
+}
+
+inline auto NMatrixOrthoOffCenterLH(D3DXMATRIX* out, float l, float r, float b, float t, float zn, float zf) -> D3DXMATRIX*
+{
+    NMatrixOrthoOffCenterLH(NMATH_M(out), l, r, b, t, zn, zf);
+    return out;
+}
+
+inline auto NMatrixOrthoOffCenterRH(D3DXMATRIX* out, float l, float r, float b, float t, float zn, float zf) -> D3DXMATRIX*
+{
+    NMatrixOrthoOffCenterRH(NMATH_M(out), l, r, b, t, zn, zf);
+    return out;
+}
+
+inline auto NMatrixReflect(D3DXMATRIX* out, const D3DXPLANE* plane) -> D3DXMATRIX*
+{
+    NMatrixReflect(NMATH_M(out), NMATH_CV4(plane));
+    return out;
+}
+
+inline auto NMatrixShadow(D3DXMATRIX* out, const D3DXVECTOR4* light, const D3DXPLANE* plane) -> D3DXMATRIX*
+{
+    NMatrixShadow(NMATH_M(out), NMATH_CV4(light), NMATH_CV4(plane));
+    return out;
+}
+
+inline auto NQuaternionIdentity(D3DXQUATERNION* out) -> D3DXQUATERNION*
+{
+    NQuaternionIdentity(NMATH_Q(out));
+    return out;
+}
+
+inline auto NQuaternionMultiply(D3DXQUATERNION* out, const D3DXQUATERNION* a, const D3DXQUATERNION* b) -> D3DXQUATERNION*
+{
+    NQuaternionMultiply(NMATH_Q(out), NMATH_CQ(a), NMATH_CQ(b));
+    return out;
+}
+
+inline auto NQuaternionNormalize(D3DXQUATERNION* out, const D3DXQUATERNION* q) -> D3DXQUATERNION*
+{
+    NQuaternionNormalize(NMATH_Q(out), NMATH_CQ(q));
+    return out;
+}
+
+inline auto NQuaternionRotationAxis(D3DXQUATERNION* out, const D3DXVECTOR3* axis, float angle) -> D3DXQUATERNION*
+{
+    NQuaternionRotationAxis(NMATH_Q(out), NMATH_CV3(axis), angle);
+    return out;
+}
+
+inline auto NQuaternionRotationYawPitchRoll(D3DXQUATERNION* out, float yaw, float pitch, float roll) -> D3DXQUATERNION*
+{
+    NQuaternionRotationYawPitchRoll(NMATH_Q(out), yaw, pitch, roll);
+    return out;
+}
+
+inline auto NQuaternionSlerp(D3DXQUATERNION* out, const D3DXQUATERNION* a, const D3DXQUATERNION* b, float t) -> D3DXQUATERNION*
+{
+    NQuaternionSlerp(NMATH_Q(out), NMATH_CQ(a), NMATH_CQ(b), t);
+    return out;
+}
+
+inline void NVec3TransformCoordArray(D3DXVECTOR3* out, size_t outStride, const D3DXVECTOR3* in, size_t inStride, const D3DXMATRIX* m, size_t count)
+{
+    NVec3TransformCoordArray(NMATH_V3(out), outStride, NMATH_CV3(in), inStride, NMATH_CM(m), count);
+}
+
+inline void NComputeBoundingSphere(const D3DXVECTOR3* points, size_t count, size_t stride, D3DXVECTOR3* center, float* radius)
+{
+    NComputeBoundingSphere(NMATH_CV3(points), count, stride, NMATH_V3(center), radius);
+}
+
+inline void NComputeBoundingBox(const D3DXVECTOR3* points, size_t count, size_t stride, D3DXVECTOR3* min, D3DXVECTOR3* max)
+{
+    NComputeBoundingBox(NMATH_CV3(points), count, stride, NMATH_V3(min), NMATH_V3(max));
+}
+
+#undef NMATH_M
+#undef NMATH_CM
+#undef NMATH_V3
+#undef NMATH_CV3
+#undef NMATH_V4
+#undef NMATH_CV4
+
+#endif
@@ -0,0 +1,37 @@
+#include "StdAfx.h"
+
+#include "NameTable.h"
+
+CNameTable::CNameTable()
+{
+    mGeneration = 0;
+}
+
+void CNameTable::Release()
+{
+    delete this;
+}
+
+auto CNameTable::Intern(LPCSTR name) -> unsigned int
+{
+    const auto e = mIds.find(name);
+
+    if (e != mIds.end())
+    {
+        return e->second;
+    }
+
+    const auto id = static_cast<unsigned int>(mStrings.size());
+
+    // deque keeps the strings in place as it grows, so the view stays valid
+    mStrings.emplace_back(name);
+    mIds.emplace(mStrings.back(), id);
+
+    return id;
+}
+
+auto CNameTable::Find(LPCSTR name, size_t length) const -> unsigned int
+{
+    const auto e = mIds.find(std::string_view(name, length));
+    return e != mIds.end() ? e->second : NAME_NONE;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "system.h"
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#define NAMES CEngine::the()->GetNames()
+
+#define NAME_NONE 0xFFFFFFFF
+
+/*
+ * Interns node, mesh and light names into 32-bit IDs so lookups compare
+ * integers instead of strings. Interned strings are never freed, the IDs stay
+ * valid for the lifetime of the engine. Find only ever reads the table, a
+ * name nobody was given can't match anything and comes back as NAME_NONE.
+ */
+class CNameTable
+{
+public:
+    CNameTable(void);
+    void Release(void);
+
+    auto Intern(LPCSTR name) -> unsigned int;
+    auto Find(LPCSTR name, size_t length) const -> unsigned int;
+    auto Find(LPCSTR name) const -> unsigned int { return Find(name, strlen(name)); }
+
+    auto GetString(unsigned int id) const -> LPCSTR { return mStrings[id].c_str(); }
+
+    /* Bumped when a component already in a node is renamed, see CNode::FindNode */
+    void Invalidate() { mGeneration++; }
+    auto GetGeneration() const -> unsigned int { return mGeneration; }
+
+private:
+    std::unordered_map<std::string_view, unsigned int> mIds;
+    std::deque<std::string> mStrings;       // indexed by ID, the keys above point in here
+    unsigned int mGeneration;
+};
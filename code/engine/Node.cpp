@@ -5,10 +5,106 @@
 
 #include "Engine.h"
 #include "Renderer.h"
+#include "TransformHierarchy.h"
+#include "NameTable.h"
+#include "MetadataStore.h"
+
+CNode::CNode(): CAllocable()
+{
+    D3DXMATRIX identity;
+    NMatrixIdentity(&identity);
+
+    mTransform = TRANSFORMS->Add(identity);
+    mMetaStore = nullptr;
+    mMetaFirst = mMetaCount = 0;
+    mIndex = nullptr;
+    SetName("(unknown)");
+    mParent = nullptr;
+}
+
+CNode::CNode(const D3DXMATRIX mat, const CString& name): CAllocable()
+{
+    SetName(name);
+    mTransform = TRANSFORMS->Add(mat);
+    mMetaStore = nullptr;
+    mMetaFirst = mMetaCount = 0;
+    mIndex = nullptr;
+    mParent = nullptr;
+}
+
+/* Scenes release themselves without going through CNode::Release, so the transform, index and metadata go here */
+CNode::~CNode()
+{
+    Release();
+    SAFE_DELETE(mIndex);
+    SAFE_RELEASE(mMetaStore);
+
+    if (mTransform != TRANSFORM_NONE && TRANSFORMS != nullptr)
+    {
+        TRANSFORMS->Remove(mTransform);
+        mTransform = TRANSFORM_NONE;
+    }
+}
+
+void CNode::SetMetadata(CMetadataStore* store, unsigned int first, unsigned int count)
+{
+    if (store != nullptr && count > 0)
+    {
+        store->AddRef();
+    }
+    else
+    {
+        store = nullptr;
+        first = count = 0;
+    }
+
+    SAFE_RELEASE(mMetaStore);
+    mMetaStore = store;
+    mMetaFirst = first;
+    mMetaCount = count;
+}
+
+auto CNode::GetMetadata(LPCSTR name) const -> const METAENTRY*
+{
+    if (mMetaStore == nullptr)
+    {
+        return nullptr;
+    }
+
+    return mMetaStore->Find(mMetaFirst, mMetaCount, NAMES->Find(name));
+}
+
+template <typename T>
+auto CNode::FindChild(LPCSTR name, std::unordered_map<unsigned int, T*> NODEINDEX::* children) -> T*
+{
+    if (name == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto* node = this;
+    auto id = NAMES->Find(name);
+
+    if ((GetIndex()->*children).count(id) == 0)
+    {
+        node = ResolvePath(&name);
+
+        if (node == nullptr)
+        {
+            return nullptr;
+        }
+
+        id = NAMES->Find(name);
+    }
+
+    const auto& index = node->GetIndex()->*children;
+    const auto e = index.find(id);
+    return e != index.end() ? e->second : nullptr;
+}
 
 auto CNode::FindMesh(LPCSTR name) -> CMesh*
 {
-    return mMeshes.Find(name);
+    return FindChild(name, &NODEINDEX::meshes);
 }
 
 void CNode::AddMesh(CMesh* mg)
@@ -26,11 +122,12 @@ void CNode::AddMesh(CMesh* mg)
     }
 
     mg->SetOwner(this);
+    mRevision++;
 }
 
 auto CNode::FindLight(LPCSTR name) -> CLight*
 {
-    return mLights.Find(name);
+    return FindChild(name, &NODEINDEX::lights);
 }
 
 void CNode::AddLight(CLight* lit)
@@ -48,16 +145,12 @@ void CNode::AddLight(CLight* lit)
     }
 
     lit->SetOwner(this);
+    mRevision++;
 }
 
 auto CNode::FindNode(LPCSTR name) -> CNode*
 {
-    if (name == nullptr)
-    {
-        return nullptr;
-    }
-
-    return mNodes.Find(name);
+    return FindChild(name, &NODEINDEX::nodes);
 }
 
 void CNode::AddNode(CNode* tgt)
@@ -70,13 +163,86 @@ void CNode::AddNode(CNode* tgt)
     }
 
     tgt->SetOwner(this);
+    mRevision++;
+}
+
+/*
+ * Walks the path up to its last slash and points name at what follows. Returns
+ * nullptr when there is no slash or a node along the way doesn't exist.
+ */
+auto CNode::ResolvePath(LPCSTR* name) -> CNode*
+{
+    auto* sep = strchr(*name, '/');
+
+    if (sep == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto* node = this;
+
+    while (sep != nullptr)
+    {
+        const auto& nodes = node->GetIndex()->nodes;
+        const auto e = nodes.find(NAMES->Find(*name, sep - *name));
+
+        if (e == nodes.end())
+        {
+            return nullptr;
+        }
+
+        node = e->second;
+        *name = sep + 1;
+        sep = strchr(*name, '/');
+    }
+
+    return node;
+}
+
+/* Only rebuilt after something got added or renamed, lookups in between don't allocate */
+auto CNode::GetIndex() -> NODEINDEX*
+{
+    if (mIndex == nullptr)
+    {
+        mIndex = new NODEINDEX();
+        mIndex->revision = mRevision - 1;
+    }
+
+    if (mIndex->revision == mRevision && mIndex->generation == NAMES->GetGeneration())
+    {
+        return mIndex;
+    }
+
+    mIndex->meshes.clear();
+    mIndex->lights.clear();
+    mIndex->nodes.clear();
+
+    // emplace keeps the first of several children with the same name
+    for (auto* a : mMeshes)
+    {
+        mIndex->meshes.emplace(a->GetNameId(), a);
+    }
+
+    for (auto* a : mLights)
+    {
+        mIndex->lights.emplace(a->GetNameId(), a);
+    }
+
+    for (auto* a : mNodes)
+    {
+        mIndex->nodes.emplace(a->GetNameId(), a);
+    }
+
+    mIndex->revision = mRevision;
+    mIndex->generation = NAMES->GetGeneration();
+    return mIndex;
 }
 
 auto CNode::Clone() -> CNode*
 {
     auto* clonedNode = new CNode();
 
-    *clonedNode->mMetadata = *mMetadata;
+    clonedNode->SetMetadata(mMetaStore, mMetaFirst, mMetaCount);
     clonedNode->SetName(GetName());
 
     for (auto* a : mMeshes)
@@ -96,7 +262,7 @@ auto CNode::Clone() -> CNode*
         clonedNode->AddNode(b);
     }
 
-    clonedNode->SetTransform(*mTransform);
+    clonedNode->SetTransform(GetTransform());
 
     return clonedNode;
 }
@@ -107,32 +273,32 @@ auto CNode::IsEmpty() -> bool
         == 0);
 }
 
-auto CNode::GetFinalTransform() -> D3DXMATRIX
+void CNode::SetTransform(const D3DXMATRIX& transform)
+{
+    TRANSFORMS->SetLocal(mTransform, transform);
+}
+
+auto CNode::GetTransform() const -> D3DXMATRIX
+{
+    return TRANSFORMS->GetLocal(mTransform);
+}
+
+void CNode::SetParent(CNode* node)
 {
-    if (!mIsTransformDirty)
+    if (node == this)
     {
-        return *mCachedTransform;
+        return;
     }
 
-    if (GetParent() == nullptr)
+    if (TRANSFORMS->SetParent(mTransform, node != nullptr ? node->mTransform : TRANSFORM_NONE))
     {
-        return *mTransform;
+        mParent = node;
     }
-
-    *mCachedTransform = *mTransform * GetParent()->GetFinalTransform();
-    mIsTransformDirty = FALSE;
-
-    return *mCachedTransform;
 }
 
-void CNode::InvalidateTransformRecursively()
+auto CNode::GetFinalTransform() const -> D3DXMATRIX
 {
-    InvalidateTransform();
-
-    for (unsigned int i = 0; i < mNodes.GetCount(); ++i)
-    {
-        mNodes[i]->InvalidateTransformRecursively();
-    }
+    return TRANSFORMS->GetWorld(mTransform);
 }
 
 void CNode::Release()
@@ -158,10 +324,6 @@ void CNode::Release()
         mLights.Release();
         mNodes.Release();
 
-        SAFE_DELETE(mTransform);
-        SAFE_DELETE(mCachedTransform);
-        SAFE_DELETE(mMetadata);
-
         delete this;
     }
 }
@@ -7,77 +7,42 @@
 #include <d3dx9.h>
 
 #include <unordered_map>
-#include <string>
 
 class CMesh;
 class CLight;
+class CMetadataStore;
+struct METAENTRY;
 
-using METADATA = std::unordered_map<std::string, std::string>;
-
-struct METADATA_RESULT
+/* Children by interned name, rebuilt when the node or any name changes */
+struct NODEINDEX
 {
-    bool found;
-    std::string value;
+    std::unordered_map<unsigned int, CMesh*> meshes;
+    std::unordered_map<unsigned int, CLight*> lights;
+    std::unordered_map<unsigned int, CNode*> nodes;
+    unsigned int revision;
+    unsigned int generation;
 };
 
 class ENGINE_API CNode : public CNodeComponent, public CReferenceCounter, CAllocable<CNode>, NoCopyAssign
 {
 public:
-    CNode(): CAllocable()
-    {
-        mTransform = new D3DXMATRIX();
-        mCachedTransform = new D3DXMATRIX();
-        mMetadata = new METADATA();
-
-        D3DXMatrixIdentity(mTransform);
-        D3DXMatrixIdentity(mCachedTransform);
-        SetName("(unknown)");
-        mIsTransformDirty = TRUE;
-        mParent = nullptr;
-    }
-
-    CNode(const D3DXMATRIX mat, const CString& name): CAllocable()
-    {
-        SetName(name);
-        mTransform = new D3DXMATRIX(mat);
-        mCachedTransform = new D3DXMATRIX();
-        mMetadata = new METADATA();
-        mMetadata->clear();
-
-        mParent = nullptr;
-        mIsTransformDirty = TRUE;
-    }
+    CNode();
+    CNode(const D3DXMATRIX mat, const CString& name);
 
     CNode(const CNode&&) = delete;
     CNode& operator=(const CNode&&) = delete;
 
     auto Release() -> void;
 
-    ~CNode() override { Release(); }
+    ~CNode() override;
 
     void Draw(const D3DXMATRIX& wmat);
     void DrawSubset(unsigned int subset, const D3DXMATRIX& wmat);
 
-    void SetMetadata(LPCSTR name, LPCSTR value) const { (*mMetadata)[name] = value; }
-
-    auto GetMetadata(LPCSTR name) const -> METADATA_RESULT
-    {
-        METADATA_RESULT res = {0};
-        const auto e = mMetadata->find(name);
-
-        if (e == mMetadata->end())
-        {
-            res.found = FALSE;
-            res.value = "";
-        }
-        else
-        {
-            res.found = TRUE;
-            res.value = e->second;
-        }
-
-        return res;
-    }
+    /* Points the node at count entries of a scene's store starting at first */
+    void SetMetadata(CMetadataStore* store, unsigned int first, unsigned int count);
+    auto GetMetadata(LPCSTR name) const -> const METAENTRY*;
+    auto GetMetadataStore() const -> CMetadataStore* { return mMetaStore; }
 
     auto GetNumMeshes() const -> unsigned int { return mMeshes.GetCount(); }
     auto GetMeshes() const -> CArray<CMesh*> { return mMeshes; }
@@ -93,37 +58,48 @@ public:
     auto GetNumNodes() const -> unsigned int { return mNodes.GetCount(); }
     auto GetNodeData() const -> CNode** { return mNodes.GetData(); }
 
+    /*
+     * Lookups are hashed on the interned name. A path such as "backdrop/bd/child"
+     * walks down the child nodes, a name that has a slash in it still matches
+     * as a whole first. The first child with a given name wins.
+     */
     auto FindNode(LPCSTR name) -> CNode*;
 
     void AddNode(CNode* tgt);
 
+    /* bumped whenever a mesh, light or node is added, see node:getMeshes */
+    auto GetRevision() const -> unsigned int { return mRevision; }
+
     auto Clone() -> CNode*;
 
     auto IsEmpty() -> bool;
 
-    void SetTransform(D3DXMATRIX transform)
-    {
-        *mTransform = transform;
-        InvalidateTransformRecursively();
-    }
-
-    auto GetTransform() const -> D3DXMATRIX { return *mTransform; }
+    void SetTransform(const D3DXMATRIX& transform);
+    auto GetTransform() const -> D3DXMATRIX;
 
-    void SetParent(CNode* node) { if (node != this) mParent = node; }
+    void SetParent(CNode* node);
     auto GetParent() const -> CNode* { return mParent; }
 
-    auto GetFinalTransform() -> D3DXMATRIX;
-    void InvalidateTransform() { mIsTransformDirty = TRUE; }
-    void InvalidateTransformRecursively();
+    /* Parent transforms applied, see CTransformHierarchy */
+    auto GetFinalTransform() const -> D3DXMATRIX;
 
 protected:
     CArray<CMesh*> mMeshes;
     CArray<CLight*> mLights;
     CArray<CNode*> mNodes;
     CNode* mParent;
+    unsigned int mRevision{};
 
 private:
-    bool mIsTransformDirty;
-    D3DXMATRIX *mTransform, *mCachedTransform;
-    METADATA* mMetadata;
+    unsigned int mTransform;    // handle into CTransformHierarchy
+    CMetadataStore* mMetaStore;     // nullptr without metadata
+    unsigned int mMetaFirst;
+    unsigned int mMetaCount;
+    NODEINDEX* mIndex;
+
+    auto GetIndex() -> NODEINDEX*;
+
+    template <typename T>
+    auto FindChild(LPCSTR name, std::unordered_map<unsigned int, T*> NODEINDEX::* children) -> T*;
+    auto ResolvePath(LPCSTR* name) -> CNode*;
 };
@@ -0,0 +1,24 @@
+#include "StdAfx.h"
+
+#include "NodeComponent.h"
+
+#include "Engine.h"
+#include "NameTable.h"
+
+CNodeComponent::CNodeComponent()
+{
+    mOwner = nullptr;
+    SetName("(unknown)");
+}
+
+void CNodeComponent::SetName(CString name)
+{
+    mName = name;
+    mNameId = NAMES->Intern(name.Str());
+
+    // nodes holding this one have it indexed under the old name
+    if (mOwner != nullptr)
+    {
+        NAMES->Invalidate();
+    }
+}
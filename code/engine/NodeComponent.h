@@ -7,23 +7,23 @@ class CNode;
 class ENGINE_API CNodeComponent
 {
 public:
-    CNodeComponent()
-    {
-        mName = "(unknown)";
-        mOwner = nullptr;
-    }
+    CNodeComponent();
 
     virtual ~CNodeComponent() = default;
 
     virtual auto GetKind() -> LPCSTR { return "Unknown"; }
 
-    void SetName(CString name) { mName = name; }
-    auto GetName() const -> CString { return mName; }
+    void SetName(CString name);
+    auto GetName() const -> const CString& { return mName; }
+
+    /* Interned name, see CNameTable */
+    auto GetNameId() const -> unsigned int { return mNameId; }
 
     void SetOwner(CNode* node) { mOwner = node; }
     auto GetOwner() const -> CNode* { return mOwner; }
 
 private:
     CString mName;
+    unsigned int mNameId;
     CNode* mOwner;
 };
@@ -0,0 +1,233 @@
+#include "StdAfx.h"
+
+#include "Preloader.h"
+
+#include "Engine.h"
+#include "FileSystem.h"
+#include "JobPool.h"
+#include "ResourceCache.h"
+#include "Scene.h"
+#include "SceneLoader.h"
+#include "Material.h"
+#include "Sound.h"
+#include "Music.h"
+#include "Effect.h"
+
+#include <assimp/Importer.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+/* Cleans up whatever Run didn't get to hand over */
+CPreloader::~CPreloader()
+{
+    for (auto& item : mItems)
+    {
+        delete item.importer;
+        free(item.sound.samples);
+    }
+}
+
+auto CPreloader::Add(LPCSTR kind, LPCSTR path, bool flag0, bool flag1) -> bool
+{
+    PRELOADITEM item;
+    CString key;
+
+    item.flags[0] = flag0;
+    item.flags[1] = flag1;
+    item.importer = nullptr;
+    item.sound = {-1, 0, 0, nullptr};
+    item.cached = FALSE;
+    item.ok = FALSE;
+
+    // keys have to match what the Lua constructors claim
+    if (!strcmp(kind, "model"))
+    {
+        item.kind = RESOURCEKIND_SCENE;
+        key = CString::Format("%s|%d|%d", path, flag0, flag1);
+    }
+    else if (!strcmp(kind, "material"))
+    {
+        item.kind = RESOURCEKIND_MATERIAL;
+        key = path;
+    }
+    else if (!strcmp(kind, "sound"))
+    {
+        item.kind = RESOURCEKIND_SOUND;
+        key = path;
+    }
+    else if (!strcmp(kind, "music"))
+    {
+        item.kind = RESOURCEKIND_MUSIC;
+        key = path;
+    }
+    else if (!strcmp(kind, "effect"))
+    {
+        item.kind = RESOURCEKIND_EFFECT;
+        key = CString::Format("%s|%d", path, flag0);
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    item.key = key.Str();
+
+    // listing an asset twice asks for two instances, like two calls to its constructor would
+    const auto queued = std::count_if(mItems.begin(), mItems.end(), [&item](const PRELOADITEM& it)
+    {
+        return it.kind == item.kind && it.key == item.key;
+    });
+
+    item.path = path;
+    item.cached = RESOURCES->CountUnclaimed(item.kind, key) > static_cast<unsigned int>(queued);
+
+    // ResourcePath returns a shared buffer, the workers get their own copy
+    if (!item.cached)
+    {
+        item.fullPath = FILESYSTEM->ResourcePath(path);
+    }
+
+    mItems.push_back(std::move(item));
+    return TRUE;
+}
+
+auto CPreloader::Run() -> unsigned int
+{
+    JOBS->Run(static_cast<unsigned int>(mItems.size()), 1, [this](unsigned int first, unsigned int last)
+    {
+        for (auto i = first; i < last; i++)
+        {
+            Decode(&mItems[i]);
+        }
+    });
+
+    unsigned int count = 0;
+
+    for (auto& item : mItems)
+    {
+        if (item.cached)
+        {
+            count++;
+            continue;
+        }
+
+        auto* const res = item.ok ? Create(&item) : nullptr;
+
+        delete item.importer;
+        item.importer = nullptr;
+        item.data.clear();
+        item.data.shrink_to_fit();
+
+        if (res == nullptr)
+        {
+            mFailed.push_back(item.path);
+            continue;
+        }
+
+        RESOURCES->Adopt(item.kind, item.key.c_str(), res);
+        count++;
+    }
+
+    mItems.clear();
+    return count;
+}
+
+/* Runs on a worker, nothing in here may touch the device, Lua or neon_malloc */
+void CPreloader::Decode(PRELOADITEM* item)
+{
+    if (item->cached)
+    {
+        return;
+    }
+
+    switch (item->kind)
+    {
+    case RESOURCEKIND_SCENE:
+        item->importer = new Assimp::Importer();
+        item->ok = CSceneLoader::ImportScene(item->fullPath.c_str(), item->flags[1], item->importer) != nullptr;
+        break;
+    case RESOURCEKIND_SOUND:
+        if (item->path.find(".ogg") != std::string::npos)
+        {
+            CSoundLoader::DecodeOGGFile(item->fullPath.c_str(), &item->sound);
+            item->ok = item->sound.count != -1;
+            break;
+        }
+
+        // WAV files are read again on the main thread, this only warms the file cache
+        item->ok = ReadFile(item->fullPath, &item->data);
+        break;
+    default:
+        // music streams from the disk, reading it only warms the file cache
+        item->ok = ReadFile(item->fullPath, &item->data);
+        break;
+    }
+}
+
+/* Runs on the main thread once the batch is decoded */
+auto CPreloader::Create(PRELOADITEM* item) -> LPVOID
+{
+    auto* const path = const_cast<LPSTR>(item->path.c_str());
+
+    switch (item->kind)
+    {
+    case RESOURCEKIND_SCENE:
+    {
+        auto* const scene = new CScene();
+        scene->LoadImported(item->importer->GetScene(), item->flags[0]);
+        return scene;
+    }
+    case RESOURCEKIND_MATERIAL:
+        return new CMaterial(TEXTURESLOT_ALBEDO, item->data.data(), static_cast<unsigned int>(item->data.size()));
+    case RESOURCEKIND_SOUND:
+    {
+        if (item->sound.samples == nullptr)
+        {
+            return new CSound(path);
+        }
+
+        // the sound keeps the samples
+        auto* const snd = new CSound(path, item->sound);
+        item->sound.samples = nullptr;
+        return snd;
+    }
+    case RESOURCEKIND_MUSIC:
+        return new CMusic(path);
+    case RESOURCEKIND_EFFECT:
+    {
+        auto* const fx = new CEffect();
+        fx->LoadEffectFromMemory(item->data.data(), static_cast<unsigned int>(item->data.size()), item->flags[0]);
+        return fx;
+    }
+    default:
+        return nullptr;
+    }
+}
+
+auto CPreloader::ReadFile(const std::string& path, std::vector<char>* out) -> bool
+{
+    FILE* fp = nullptr;
+
+    if (fopen_s(&fp, path.c_str(), "rb") != 0 || fp == nullptr)
+    {
+        return FALSE;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    const auto size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (size <= 0)
+    {
+        fclose(fp);
+        return FALSE;
+    }
+
+    out->resize(static_cast<size_t>(size));
+    const auto ok = fread(out->data(), out->size(), 1, fp) == 1;
+    fclose(fp);
+
+    return ok;
+}
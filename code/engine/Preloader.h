@@ -0,0 +1,58 @@
+#pragma once
+
+#include "system.h"
+#include "SoundLoader.h"
+
+#include <string>
+#include <vector>
+
+namespace Assimp
+{
+    class Importer;
+}
+
+struct PRELOADITEM
+{
+    UCHAR kind;                 // RESOURCEKIND_*
+    std::string path;
+    std::string fullPath;
+    std::string key;            // resource cache key, as the Lua constructors build it
+    bool flags[2];              // loadMaterials and optimizeMesh for models, debugMode for effects
+    bool cached;                // an unclaimed copy is already in the resource cache
+
+    // filled in by the workers
+    std::vector<char> data;
+    Assimp::Importer* importer;
+    DECODEDSOUND sound;
+    bool ok;
+};
+
+/*
+ * Loads a batch of assets up front, so the startup script doesn't stall on
+ * each one in turn. The file reading and decoding of every asset runs on the
+ * job pool; what needs the device or DirectSound (textures, effects, sound
+ * buffers) is then created on the main thread. The results go to the resource
+ * cache unclaimed, the regular constructors pick them up from there. Assets
+ * already waiting in the cache aren't loaded again.
+ */
+class CPreloader
+{
+public:
+    ~CPreloader(void);
+
+    /* Returns FALSE for an unknown kind */
+    auto Add(LPCSTR kind, LPCSTR path, bool flag0, bool flag1) -> bool;
+
+    /* Blocks until the batch is loaded, returns the number of assets ready */
+    auto Run(void) -> unsigned int;
+
+    auto GetFailed() const -> const std::vector<std::string>& { return mFailed; }
+
+private:
+    std::vector<PRELOADITEM> mItems;
+    std::vector<std::string> mFailed;
+
+    static void Decode(PRELOADITEM* item);
+    static auto Create(PRELOADITEM* item) -> LPVOID;
+    static auto ReadFile(const std::string& path, std::vector<char>* out) -> bool;
+};
@@ -0,0 +1,297 @@
+#include "StdAfx.h"
+
+#include "ResourceCache.h"
+
+#include "Scene.h"
+#include "Mesh.h"
+#include "FaceGroup.h"
+#include "Material.h"
+#include "Sound.h"
+#include "Music.h"
+#include "Effect.h"
+#include "Font.h"
+
+CResourceCache::CResourceCache()
+{
+    mEntries = new RESOURCETABLE();
+    mReused = 0;
+}
+
+void CResourceCache::Release()
+{
+    Flush();
+    SAFE_DELETE(mEntries);
+}
+
+auto CResourceCache::Claim(UCHAR kind, const CString& key) -> LPVOID
+{
+    const auto range = mEntries->equal_range(MakeKey(kind, key));
+
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        auto& entry = it->second;
+
+        if (entry.claimed)
+        {
+            continue;
+        }
+
+        entry.claimed = TRUE;
+        mReused++;
+
+        switch (entry.kind)
+        {
+        case RESOURCEKIND_SCENE:
+            // the entry is never handed out itself, scripts get a fresh copy
+            return static_cast<CScene*>(entry.data)->Clone();
+        case RESOURCEKIND_MATERIAL:
+            static_cast<CMaterial*>(entry.data)->AddRef();
+            break;
+        case RESOURCEKIND_SOUND:
+            // volume, pan, frequency and looping are back to what a fresh load gives
+            static_cast<CSound*>(entry.data)->Reset();
+            static_cast<CSound*>(entry.data)->AddRef();
+            break;
+        case RESOURCEKIND_MUSIC:
+            static_cast<CMusic*>(entry.data)->Reset();
+            static_cast<CMusic*>(entry.data)->AddRef();
+            break;
+        case RESOURCEKIND_EFFECT:
+            static_cast<CEffect*>(entry.data)->AddRef();
+            break;
+        case RESOURCEKIND_FONT:
+            static_cast<CFont*>(entry.data)->AddRef();
+            break;
+        }
+
+        return entry.data;
+    }
+
+    return nullptr;
+}
+
+void CResourceCache::Store(UCHAR kind, const CString& key, LPVOID res)
+{
+    if (res == nullptr)
+    {
+        return;
+    }
+
+    RESOURCEENTRY entry = {kind, res, TRUE};
+
+    switch (kind)
+    {
+    case RESOURCEKIND_SCENE:
+        // the session edits its own scene, the entry keeps an untouched copy
+        entry.data = static_cast<CScene*>(res)->Clone();
+        break;
+    case RESOURCEKIND_MATERIAL:
+        static_cast<CMaterial*>(res)->AddRef();
+        break;
+    case RESOURCEKIND_SOUND:
+        static_cast<CSound*>(res)->AddRef();
+        break;
+    case RESOURCEKIND_MUSIC:
+        static_cast<CMusic*>(res)->AddRef();
+        break;
+    case RESOURCEKIND_EFFECT:
+        static_cast<CEffect*>(res)->AddRef();
+        break;
+    case RESOURCEKIND_FONT:
+        static_cast<CFont*>(res)->AddRef();
+        break;
+    default:
+        return;
+    }
+
+    ClearModified(entry);
+    mEntries->emplace(MakeKey(kind, key), entry);
+}
+
+/*
+ * Takes over the caller's reference to a resource loaded ahead of time, the
+ * entry waits for the first Claim of the key.
+ */
+void CResourceCache::Adopt(UCHAR kind, const CString& key, LPVOID res)
+{
+    if (res == nullptr || kind > RESOURCEKIND_FONT)
+    {
+        return;
+    }
+
+    const RESOURCEENTRY entry = {kind, res, FALSE};
+    ClearModified(entry);
+    mEntries->emplace(MakeKey(kind, key), entry);
+}
+
+auto CResourceCache::CountUnclaimed(UCHAR kind, const CString& key) const -> unsigned int
+{
+    const auto range = mEntries->equal_range(MakeKey(kind, key));
+    unsigned int count = 0;
+
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (!it->second.claimed)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Used when a session gets an instance by other means than Claim, e.g. a VM
+ * snapshot, so that the instance isn't handed out a second time.
+ */
+void CResourceCache::MarkClaimed(LPVOID res)
+{
+    for (auto& it : *mEntries)
+    {
+        if (it.second.data == res)
+        {
+            it.second.claimed = TRUE;
+        }
+    }
+}
+
+/*
+ * Called once the Lua state has been closed. When the VM is about to be
+ * restarted, resources used during the session stay loaded for the next one,
+ * anything the session didn't ask for or changed is released.
+ */
+void CResourceCache::EndSession(bool keep)
+{
+    if (!keep)
+    {
+        Flush();
+        return;
+    }
+
+    const auto total = GetCount();
+
+    for (auto it = mEntries->begin(); it != mEntries->end();)
+    {
+        if (!it->second.claimed || IsModified(it->second))
+        {
+            ReleaseEntry(it->second);
+            it = mEntries->erase(it);
+            continue;
+        }
+
+        it->second.claimed = FALSE;
+        ++it;
+    }
+
+    PushLog(CString::Format("Resource cache: %u of %u resources reused, %u kept\n", mReused, total, GetCount()).Str());
+    mReused = 0;
+}
+
+void CResourceCache::Flush()
+{
+    for (const auto& it : *mEntries)
+    {
+        ReleaseEntry(it.second);
+    }
+
+    mEntries->clear();
+    mReused = 0;
+}
+
+void CResourceCache::ReleaseEntry(const RESOURCEENTRY& entry)
+{
+    switch (entry.kind)
+    {
+    case RESOURCEKIND_SCENE:
+        static_cast<CScene*>(entry.data)->Release();
+        break;
+    case RESOURCEKIND_MATERIAL:
+        static_cast<CMaterial*>(entry.data)->Release();
+        break;
+    case RESOURCEKIND_SOUND:
+        static_cast<CSound*>(entry.data)->Release();
+        break;
+    case RESOURCEKIND_MUSIC:
+        static_cast<CMusic*>(entry.data)->Release();
+        break;
+    case RESOURCEKIND_EFFECT:
+        static_cast<CEffect*>(entry.data)->Release();
+        break;
+    case RESOURCEKIND_FONT:
+        static_cast<CFont*>(entry.data)->Release();
+        break;
+    }
+}
+
+/*
+ * Scenes are handed out as copies, but share their materials with the entry,
+ * so a scene counts as changed as soon as one of its materials is.
+ */
+auto CResourceCache::IsModified(const RESOURCEENTRY& entry) -> bool
+{
+    if (entry.kind == RESOURCEKIND_MATERIAL)
+    {
+        return static_cast<CMaterial*>(entry.data)->IsModified();
+    }
+
+    if (entry.kind != RESOURCEKIND_SCENE)
+    {
+        return FALSE;
+    }
+
+    const auto* const scene = static_cast<CScene*>(entry.data);
+
+    for (unsigned int i = 0; i < scene->GetNumMeshes(); i++)
+    {
+        const auto* const mesh = scene->GetMeshData()[i];
+
+        for (unsigned int j = 0; j < mesh->GetNumFGroups(); j++)
+        {
+            const auto* const mat = mesh->GetFGroupData()[j]->GetMaterial();
+
+            if (mat != nullptr && mat->IsModified())
+            {
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+/* Loading sets the flags, only changes made after the entry was recorded count */
+void CResourceCache::ClearModified(const RESOURCEENTRY& entry)
+{
+    if (entry.kind == RESOURCEKIND_MATERIAL)
+    {
+        static_cast<CMaterial*>(entry.data)->ClearModified();
+        return;
+    }
+
+    if (entry.kind != RESOURCEKIND_SCENE)
+    {
+        return;
+    }
+
+    const auto* const scene = static_cast<CScene*>(entry.data);
+
+    for (unsigned int i = 0; i < scene->GetNumMeshes(); i++)
+    {
+        const auto* const mesh = scene->GetMeshData()[i];
+
+        for (unsigned int j = 0; j < mesh->GetNumFGroups(); j++)
+        {
+            auto* const mat = mesh->GetFGroupData()[j]->GetMaterial();
+
+            if (mat != nullptr)
+            {
+                mat->ClearModified();
+            }
+        }
+    }
+}
+
+auto CResourceCache::MakeKey(UCHAR kind, const CString& key) -> std::string
+{
+    return std::to_string(kind) + ":" + key.Str();
+}
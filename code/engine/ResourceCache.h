@@ -0,0 +1,63 @@
+#pragma once
+
+#include "system.h"
+
+#include <unordered_map>
+#include <string>
+
+#define RESOURCES CEngine::the()->GetResourceCache()
+
+enum RESOURCEKIND
+{
+    RESOURCEKIND_SCENE,
+    RESOURCEKIND_MATERIAL,
+    RESOURCEKIND_SOUND,
+    RESOURCEKIND_MUSIC,
+    RESOURCEKIND_EFFECT,
+    RESOURCEKIND_FONT,
+};
+
+struct RESOURCEENTRY
+{
+    UCHAR kind;
+    LPVOID data;
+    bool claimed;
+};
+
+using RESOURCETABLE = std::unordered_multimap<std::string, RESOURCEENTRY>;
+
+/*
+ * Keeps file-backed resources alive across VM restarts. Every resource loaded
+ * by a script is recorded under its path and load flags; when the VM restarts
+ * the next script asking for the same key gets the already-loaded instance.
+ * Each entry is handed out at most once per session, so scripts never end up
+ * sharing an instance they didn't share before. Scenes are kept as an untouched
+ * copy and cloned on reuse, materials a session changed are not reused at all,
+ * sounds and music are stopped and get their load-time settings back.
+ */
+class ENGINE_API CResourceCache
+{
+public:
+    CResourceCache(void);
+    void Release(void);
+
+    auto Claim(UCHAR kind, const CString& key) -> LPVOID;
+    void Store(UCHAR kind, const CString& key, LPVOID res);
+    void Adopt(UCHAR kind, const CString& key, LPVOID res);
+    auto CountUnclaimed(UCHAR kind, const CString& key) const -> unsigned int;
+    void MarkClaimed(LPVOID res);
+    void EndSession(bool keep);
+    void Flush(void);
+
+    auto GetCount() const -> unsigned int { return static_cast<unsigned int>(mEntries->size()); }
+    auto GetReusedCount() const -> unsigned int { return mReused; }
+
+private:
+    RESOURCETABLE* mEntries;
+    unsigned int mReused;
+
+    static void ReleaseEntry(const RESOURCEENTRY& entry);
+    static auto IsModified(const RESOURCEENTRY& entry) -> bool;
+    static void ClearModified(const RESOURCEENTRY& entry);
+    static auto MakeKey(UCHAR kind, const CString& key) -> std::string;
+};
@@ -0,0 +1,266 @@
+#include "StdAfx.h"
+
+#include "SaveWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <io.h>
+
+CSaveWriter::CSaveWriter()
+{
+    mLastTicket = 0;
+    mBusy = FALSE;
+    mFlushing = FALSE;
+    mQuit = FALSE;
+    mThread = std::thread(&CSaveWriter::Work, this);
+}
+
+void CSaveWriter::Release()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mQuit = TRUE;
+    }
+
+    mWake.notify_all();
+    mThread.join();
+    delete this;
+}
+
+auto CSaveWriter::Queue(LPCSTR path, const char* data, size_t size, bool compress) -> DWORD
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    const auto ticket = ++mLastTicket;
+
+    mPending.insert(ticket);
+
+    const auto it = std::find_if(mQueue.begin(), mQueue.end(), [path](const SAVEREQUEST& req) { return req.path == path; });
+
+    // the earlier save keeps its due time, so constant saving can't hold off the write
+    if (it != mQueue.end())
+    {
+        it->data.assign(data, size);
+        it->compress = compress;
+        it->tickets.push_back(ticket);
+        return ticket;
+    }
+
+    SAVEREQUEST req;
+    req.path = path;
+    req.data.assign(data, size);
+    req.compress = compress;
+    req.tickets.push_back(ticket);
+    req.due = std::chrono::steady_clock::now() + std::chrono::milliseconds(SAVEWRITER_COALESCE_MS);
+    mQueue.push_back(std::move(req));
+
+    lock.unlock();
+    mWake.notify_all();
+    return ticket;
+}
+
+auto CSaveWriter::GetStatus(DWORD ticket, std::string* error) -> SAVESTATUS
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (ticket == 0 || ticket > mLastTicket)
+    {
+        if (error)
+            *error = "unknown save";
+
+        return SAVESTATUS_FAILED;
+    }
+
+    if (mPending.count(ticket))
+        return SAVESTATUS_PENDING;
+
+    const auto it = mErrors.find(ticket);
+
+    if (it == mErrors.end())
+        return SAVESTATUS_DONE;
+
+    if (error)
+        *error = it->second;
+
+    return SAVESTATUS_FAILED;
+}
+
+void CSaveWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    if (mQueue.empty() && !mBusy)
+        return;
+
+    mFlushing = TRUE;
+    mWake.notify_all();
+    mDone.wait(lock, [this] { return mQueue.empty() && !mBusy; });
+    mFlushing = FALSE;
+}
+
+void CSaveWriter::Work()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    for (;;)
+    {
+        if (mQueue.empty())
+        {
+            if (mQuit)
+                break;
+
+            mWake.wait(lock);
+            continue;
+        }
+
+        const auto next = std::min_element(mQueue.begin(), mQueue.end(), [](const SAVEREQUEST& a, const SAVEREQUEST& b) { return a.due < b.due; });
+
+        if (!mFlushing && !mQuit && next->due > std::chrono::steady_clock::now())
+        {
+            mWake.wait_until(lock, next->due);
+            continue;
+        }
+
+        const auto req = std::move(*next);
+        mQueue.erase(next);
+        mBusy = TRUE;
+        lock.unlock();
+
+        std::string error;
+        const auto ok = Write(req, &error);
+
+        lock.lock();
+        mBusy = FALSE;
+
+        for (const auto ticket : req.tickets)
+        {
+            mPending.erase(ticket);
+
+            if (!ok)
+                mErrors[ticket] = error;
+        }
+
+        mDone.notify_all();
+    }
+}
+
+/* Writes the header, then the data compressed when asked to and encoded to base64 */
+auto CSaveWriter::Pack(const SAVEREQUEST& req) -> std::string
+{
+    SAVEHEADER header;
+    memcpy(header.magic, SAVEWRITER_MAGIC, SAVEWRITER_MAGIC_LEN);
+    header.version = SAVEWRITER_VERSION;
+    header.flags = req.compress ? SAVEWRITER_FLAG_LZ : 0;
+    header.reserved = 0;
+    header.rawSize = static_cast<DWORD>(req.data.size());
+
+    std::string packed;
+    const auto* payload = &req.data;
+
+    if (req.compress)
+    {
+        packed.resize(lz_compressbound(req.data.size()));
+        packed.resize(lz_compress(reinterpret_cast<const unsigned char*>(req.data.data()), req.data.size(), reinterpret_cast<unsigned char*>(&packed[0])));
+        payload = &packed;
+    }
+
+    std::string encoded(sizeof(header) + b64_encoded_size(payload->size()), '\0');
+    memcpy(&encoded[0], &header, sizeof(header));
+
+    if (!payload->empty())
+        b64_encodeto(reinterpret_cast<const unsigned char*>(payload->data()), payload->size(), &encoded[sizeof(header)]);
+
+    return encoded;
+}
+
+/*
+ * Runs on the writer thread, so no neon_malloc here. The data is committed to
+ * the disk before the rename, otherwise a crash could leave the renamed file
+ * empty.
+ */
+auto CSaveWriter::Write(const SAVEREQUEST& req, std::string* error) -> bool
+{
+    const auto data = Pack(req);
+    const auto tmpPath = req.path + ".tmp";
+    char msg[MAX_PATH + 64];
+    FILE* fp = nullptr;
+
+    if (fopen_s(&fp, tmpPath.c_str(), "wb") != 0 || fp == nullptr)
+    {
+        sprintf_s(msg, sizeof(msg), "can't open %s", tmpPath.c_str());
+        *error = msg;
+        return FALSE;
+    }
+
+    const auto written = data.empty() || fwrite(data.data(), data.size(), 1, fp) == 1;
+    const auto flushed = written && fflush(fp) == 0 && _commit(_fileno(fp)) == 0;
+    fclose(fp);
+
+    if (!flushed)
+    {
+        remove(tmpPath.c_str());
+        sprintf_s(msg, sizeof(msg), "can't write %s", tmpPath.c_str());
+        *error = msg;
+        return FALSE;
+    }
+
+    if (!MoveFileExA(tmpPath.c_str(), req.path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        remove(tmpPath.c_str());
+        sprintf_s(msg, sizeof(msg), "can't replace %s (error %lu)", req.path.c_str(), GetLastError());
+        *error = msg;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Saves without a header are plain base64, the way they were written before it */
+auto CSaveWriter::Unpack(const char* data, size_t size, std::string* out) -> bool
+{
+    SAVEHEADER header;
+    ZeroMemory(&header, sizeof(header));
+
+    if (size >= sizeof(header) && memcmp(data, SAVEWRITER_MAGIC, SAVEWRITER_MAGIC_LEN) == 0 && static_cast<BYTE>(data[SAVEWRITER_MAGIC_LEN]) < '+')
+    {
+        memcpy(&header, data, sizeof(header));
+
+        // saves of a newer engine are refused rather than misread
+        if (header.version == 0 || header.version > SAVEWRITER_VERSION || (header.flags & ~SAVEWRITER_FLAG_LZ) != 0)
+            return FALSE;
+
+        data += sizeof(header);
+        size -= sizeof(header);
+    }
+
+    // b64_decode wants a terminated string
+    const std::string text(data, size);
+    const auto rawLen = b64_decoded_size(text.c_str());
+
+    // padding alone underflows the decoded size
+    if (size % 4 != 0 || rawLen > size / 4 * 3)
+        return FALSE;
+
+    std::string raw(rawLen, '\0');
+
+    if (!b64_decode(text.c_str(), reinterpret_cast<unsigned char*>(&raw[0]), raw.size()))
+        return FALSE;
+
+    if (!(header.flags & SAVEWRITER_FLAG_LZ))
+    {
+        if (header.version != 0 && raw.size() != header.rawSize)
+            return FALSE;
+
+        out->swap(raw);
+        return TRUE;
+    }
+
+    // no block expands by more than 255 times, anything past that is corrupt
+    if (header.rawSize > raw.size() * 255)
+        return FALSE;
+
+    out->resize(header.rawSize);
+
+    return lz_decompress(reinterpret_cast<const unsigned char*>(raw.data()), raw.size(),
+                         reinterpret_cast<unsigned char*>(&(*out)[0]), header.rawSize) != 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "system.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// saves to the same file within this window are written once, with the latest data
+#define SAVEWRITER_COALESCE_MS 250
+// saves start with a SAVEHEADER, the payload after it is base64
+#define SAVEWRITER_MAGIC "NSAV"
+#define SAVEWRITER_MAGIC_LEN 4
+#define SAVEWRITER_VERSION 1
+// header flags, a save with flags it doesn't know is rejected
+#define SAVEWRITER_FLAG_LZ 0x01
+
+/*
+ * Versions stay below '+', the lowest base64 character, so saves from before
+ * the header, plain base64 text, can't be taken for one with a header.
+ */
+#pragma pack(push, 1)
+struct SAVEHEADER
+{
+    char magic[SAVEWRITER_MAGIC_LEN];
+    BYTE version;
+    BYTE flags;
+    WORD reserved;
+    DWORD rawSize;          // size of the data before compression
+};
+#pragma pack(pop)
+
+enum SAVESTATUS
+{
+    SAVESTATUS_PENDING,
+    SAVESTATUS_DONE,
+    SAVESTATUS_FAILED,
+};
+
+/*
+ * Writes save files on a background thread so the game never waits on the
+ * disk. Data goes to a temporary file next to the target, gets flushed to the
+ * disk and is then moved over the target, a crash midway leaves the previous
+ * save intact. Every save gets a ticket to poll its status with. Saves to the
+ * same file that come in while one is still waiting out the coalesce window
+ * replace its data, the tickets of both complete with the one write.
+ * Compression and base64 encoding happen on the writer thread as well.
+ */
+class CSaveWriter
+{
+public:
+    CSaveWriter(void);
+
+    /* Writes whatever is still queued before the thread stops */
+    void Release(void);
+
+    auto Queue(LPCSTR path, const char* data, size_t size, bool compress) -> DWORD;
+
+    /* The error message is only set for failed saves */
+    auto GetStatus(DWORD ticket, std::string* error = nullptr) -> SAVESTATUS;
+
+    /* Writes every queued save right away and waits for them */
+    void Flush(void);
+
+    /* Turns the contents of a save file back into the data it was queued with */
+    static auto Unpack(const char* data, size_t size, std::string* out) -> bool;
+
+private:
+    struct SAVEREQUEST
+    {
+        std::string path;
+        std::string data;
+        bool compress;
+        std::vector<DWORD> tickets;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    std::thread mThread;
+    std::mutex mLock;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+
+    std::vector<SAVEREQUEST> mQueue;
+    std::unordered_set<DWORD> mPending;
+    std::unordered_map<DWORD, std::string> mErrors;
+    DWORD mLastTicket;
+    bool mBusy;                 // a save is being written
+    bool mFlushing;
+    bool mQuit;
+
+    void Work(void);
+
+    static auto Pack(const SAVEREQUEST& req) -> std::string;
+    static auto Write(const SAVEREQUEST& req, std::string* error) -> bool;
+};
@@ -47,3 +47,52 @@ auto CScene::LoadScene(LPCSTR modelPath, bool loadMaterials, bool optimizeMesh)
     mRootNode = mNodes[0];
     return TRUE;
 }
+
+void CScene::LoadImported(const aiScene* model, bool loadMaterials)
+{
+    CSceneLoader::BuildScene(model, this, loadMaterials);
+    mRootNode = mNodes[0];
+}
+
+auto CScene::Clone() -> CScene*
+{
+    auto* const scene = new CScene();
+
+    if (mRootNode != nullptr)
+    {
+        scene->mRootNode = mRootNode->Clone();
+        scene->AddNode(scene->mRootNode);
+        scene->mRootNode->SetParent(scene);
+        scene->Flatten(scene->mRootNode);
+    }
+
+    return scene;
+}
+
+/* Lists the nodes, meshes and lights below node on the scene the way CSceneLoader does */
+void CScene::Flatten(CNode* node)
+{
+    if (node != mRootNode)
+    {
+        AddNode(node);
+    }
+
+    for (unsigned int i = 0; i < node->GetNumMeshes(); i++)
+    {
+        auto* const mesh = node->GetMeshData()[i];
+        AddMesh(mesh);
+        mesh->SetOwner(node);
+    }
+
+    for (unsigned int i = 0; i < node->GetNumLights(); i++)
+    {
+        auto* const lit = node->GetLightData()[i];
+        AddLight(lit);
+        lit->SetOwner(node);
+    }
+
+    for (unsigned int i = 0; i < node->GetNumNodes(); i++)
+    {
+        Flatten(node->GetNodeData()[i]);
+    }
+}
@@ -4,6 +4,8 @@
 #include "RenderData.h"
 #include "Node.h"
 
+struct aiScene;
+
 class ENGINE_API CScene : public CNode
 {
 public:
@@ -12,7 +14,15 @@ public:
 
     auto LoadScene(LPCSTR modelPath, bool loadMaterials = TRUE, bool optimizeMesh = FALSE) -> bool;
 
+    /* Builds the nodes out of a model imported beforehand, see CSceneLoader::ImportScene */
+    void LoadImported(const aiScene* model, bool loadMaterials = TRUE);
+
     auto GetRootNode() const -> CNode* { return mRootNode; }
+
+    /* Face groups share their geometry with the source until either side edits it */
+    auto Clone() -> CScene*;
 private:
     CNode* mRootNode;
+
+    void Flatten(CNode* node);
 };
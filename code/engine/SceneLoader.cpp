@@ -6,6 +6,7 @@
 #include "Mesh.h"
 #include "Light.h"
 #include "ReferenceManager.h"
+#include "MetadataStore.h"
 
 #include "Engine.h"
 #include "FileSystem.h"
@@ -14,7 +15,6 @@
 #include <assimp/scene.h>
 #include <assimp/matrix4x4.h>
 #include <assimp/postprocess.h>
-#include <sstream>
 
 #ifndef _DEBUG
 #pragma comment (lib, "assimp.lib")
@@ -32,7 +32,7 @@
 extern auto ComputeFinalTransformation(const aiNode* node) -> aiMatrix4x4;
 
 void CSceneLoader::LoadNodesRecursively(const aiScene* impScene, const aiNode* impNode, CScene* scene, CNode* node,
-                                        bool loadMaterials)
+                                        CMetadataStore* meta, bool loadMaterials)
 {
     aiMatrix4x4 mat = impNode->mTransformation;
     mat = mat.Transpose();
@@ -49,38 +49,52 @@ void CSceneLoader::LoadNodesRecursively(const aiScene* impScene, const aiNode* i
 
     if (impNode->mMetaData != nullptr)
     {
+        const auto first = meta->Begin();
+
         for (unsigned int i = 0; i < impNode->mMetaData->mNumProperties; ++i)
         {
-            aiString k = impNode->mMetaData->mKeys[i];
+            const auto key = impNode->mMetaData->mKeys[i].C_Str();
             const aiMetadataEntry* e = &impNode->mMetaData->mValues[i];
-            std::string data;
 
             switch (e->mType)
             {
-            case AI_AISTRING:
-                data = (*static_cast<aiString*>(e->mData)).C_Str();
+            case AI_BOOL:
+                meta->AddBool(key, *static_cast<bool*>(e->mData));
                 break;
 
-            case AI_BOOL:
-            case AI_DOUBLE:
-            case AI_FLOAT:
             case AI_INT32:
+                meta->AddInt(key, *static_cast<int32_t*>(e->mData));
+                break;
+
             case AI_UINT64:
-                data = std::to_string(*static_cast<DOUBLE*>(e->mData));
+                meta->AddInt(key, static_cast<long long>(*static_cast<uint64_t*>(e->mData)));
+                break;
+
+            case AI_FLOAT:
+                meta->AddDouble(key, *static_cast<float*>(e->mData));
+                break;
+
+            case AI_DOUBLE:
+                meta->AddDouble(key, *static_cast<DOUBLE*>(e->mData));
+                break;
+
+            case AI_AISTRING:
+                meta->AddString(key, static_cast<aiString*>(e->mData)->C_Str());
                 break;
 
             case AI_AIVECTOR3D:
                 {
-                    aiVector3D a = *static_cast<aiVector3D*>(e->mData);
-                    std::stringstream ss;
-                    ss << a.x << "," << a.y << "," << a.z;
-                    data = ss.str();
+                    const auto* a = static_cast<aiVector3D*>(e->mData);
+                    meta->AddVec3(key, a->x, a->y, a->z);
                 }
                 break;
-            }
 
-            newNode->SetMetadata(static_cast<LPCSTR>(k.C_Str()), data.c_str());
+            default:
+                break;
+            }
         }
+
+        newNode->SetMetadata(meta, first, meta->Begin() - first);
     }
 
     aiString lastMeshName = aiString("(unknown)");
@@ -131,14 +145,38 @@ void CSceneLoader::LoadNodesRecursively(const aiScene* impScene, const aiNode* i
     // Iterate over children
     for (unsigned int i = 0; i < impNode->mNumChildren; i++)
     {
-        LoadNodesRecursively(impScene, impNode->mChildren[i], scene, newNode, loadMaterials);
+        LoadNodesRecursively(impScene, impNode->mChildren[i], scene, newNode, meta, loadMaterials);
     }
 }
 
 auto CSceneLoader::LoadScene(LPCSTR modelPath, CScene* scene, bool loadMaterials, bool optimizeMeshes) -> bool
 {
     Assimp::Importer imp;
-    imp.SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, 32762);
+    const aiScene* model = ImportScene(FILESYSTEM->ResourcePath(modelPath), optimizeMeshes, &imp);
+
+    if (model == nullptr)
+    {
+        return FALSE;
+    }
+
+    BuildScene(model, scene, loadMaterials);
+    return TRUE;
+}
+
+void CSceneLoader::BuildScene(const aiScene* model, CScene* scene, bool loadMaterials)
+{
+    auto* const meta = new CMetadataStore();
+
+    LoadNodesRecursively(model, model->mRootNode, scene, scene, meta, loadMaterials);
+
+    // the nodes hold their own references, a scene without metadata frees the store here
+    meta->Compact();
+    meta->Release();
+}
+
+auto CSceneLoader::ImportScene(LPCSTR fullPath, bool optimizeMeshes, Assimp::Importer* imp) -> const aiScene*
+{
+    imp->SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, 32762);
 
     DWORD meshFlags = MESHIMPORT_FLAGS;
 
@@ -148,15 +186,7 @@ auto CSceneLoader::LoadScene(LPCSTR modelPath, CScene* scene, bool loadMaterials
                 | aiProcess_RemoveRedundantMaterials;
     }
 
-    const aiScene* model = imp.ReadFile(FILESYSTEM->ResourcePath(modelPath), meshFlags);
-
-    if (model == nullptr)
-    {
-        return FALSE;
-    }
-
-    LoadNodesRecursively(model, model->mRootNode, scene, scene, loadMaterials);
-    return TRUE;
+    return imp->ReadFile(fullPath, meshFlags);
 }
 
 auto CSceneLoader::LoadFaceGroup(const aiScene* scene, const aiMesh* mesh, bool loadMaterials) -> CFaceGroup*
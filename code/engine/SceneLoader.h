@@ -7,18 +7,28 @@ class CMaterial;
 class CScene;
 class CNode;
 class CLight;
+class CMetadataStore;
 struct aiScene;
 struct aiMesh;
 struct aiNode;
 struct aiLight;
 struct aiMaterial;
 
+namespace Assimp
+{
+    class Importer;
+}
+
 class ENGINE_API CSceneLoader
 {
 public:
     static void LoadNodesRecursively(const aiScene* impScene, const aiNode* impNode, CScene* scene, CNode* node,
-                                     bool loadMaterials);
+                                     CMetadataStore* meta, bool loadMaterials);
     static auto LoadScene(LPCSTR modelPath, CScene* scene, bool loadMaterials, bool optimizeMeshes) -> bool;
+
+    /* Only runs Assimp, safe off the main thread. The scene lives as long as the importer */
+    static auto ImportScene(LPCSTR fullPath, bool optimizeMeshes, Assimp::Importer* imp) -> const aiScene*;
+    static void BuildScene(const aiScene* model, CScene* scene, bool loadMaterials);
     static auto LoadFaceGroup(const aiScene* scene, const aiMesh* mesh, bool loadMaterials) -> CFaceGroup*;
     static auto LoadLight(const aiNode* impNode, const aiLight* impLight) -> CLight*;
     static void LoadTextureMap(const aiScene* scene, const aiMaterial* mat, CMaterial* newMaterial, unsigned int slot,
@@ -0,0 +1,224 @@
+#include "StdAfx.h"
+
+#include "ScriptCache.h"
+
+#include "Engine.h"
+#include "FileSystem.h"
+
+#include <lua/lua.hpp>
+#include <cstdio>
+
+#define SCRIPTCACHE_MAGIC 0x43415543 /* CUAC */
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+struct SCRIPTCACHEHEADER
+{
+    DWORD magic;
+    DWORD version;
+    UINT64 sourceHash;
+    UINT64 size;
+};
+
+bool CScriptCache::sEnabled = TRUE;
+SCRIPTCACHESTATS CScriptCache::sStats = {0, 0, 0.0F};
+
+static auto neon_scriptwriter(lua_State* L, const void* p, size_t sz, void* ud) -> int
+{
+    (void)L;
+    auto* const fp = static_cast<FILE*>(ud);
+    return fwrite(p, 1, sz, fp) == sz ? 0 : 1;
+}
+
+/*
+ * Replacement for the stock Lua file searcher, so modules pulled in by require
+ * go through the bytecode cache as well.
+ */
+static auto neon_searcher_Lua(lua_State* L) -> int
+{
+    const auto* const name = luaL_checkstring(L, 1);
+
+    lua_getglobal(L, LUA_LOADLIBNAME);
+    lua_getfield(L, -1, "searchpath");
+    lua_pushstring(L, name);
+    lua_getfield(L, -3, "path");
+    lua_call(L, 2, 2);
+
+    if (lua_isnil(L, -2))
+    {
+        return 1; /* error message */
+    }
+
+    lua_pop(L, 1);
+    const auto* const fileName = lua_tostring(L, -1);
+
+    FILE* fp = nullptr;
+    fopen_s(&fp, fileName, "rb");
+
+    if (fp == nullptr)
+    {
+        return luaL_error(L, "cannot open module '%s' from file '%s'", name, fileName);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    const auto size = static_cast<size_t>(ftell(fp));
+    fseek(fp, 0, SEEK_SET);
+
+    auto* const data = static_cast<LPSTR>(neon_malloc(size + 1));
+    const auto read = fread(data, 1, size, fp);
+    fclose(fp);
+
+    /* a truncated source must neither be compiled nor stored in the cache */
+    if (read != size)
+    {
+        neon_free(data);
+        return luaL_error(L, "cannot read module '%s' from file '%s'", name, fileName);
+    }
+
+    data[size] = 0;
+
+    const auto chunkName = CString::Format("@%s", fileName);
+    const auto res = CScriptCache::LoadBuffer(L, data, size, chunkName.Str());
+    neon_free(data);
+
+    if (res != LUA_OK)
+    {
+        return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s", name, fileName, lua_tostring(L, -1));
+    }
+
+    lua_pushvalue(L, -2); /* file name is the second argument to the loader */
+    return 2;
+}
+
+auto CScriptCache::Hash(LPCVOID data, size_t size, UINT64 seed) -> UINT64
+{
+    const auto* p = static_cast<const UCHAR*>(data);
+    auto hash = seed;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/*
+ * Compiles a chunk, preferring a previously dumped copy stored in the game's
+ * cache directory. Entries are keyed by chunk name and validated against the
+ * source hash and script version, anything that fails to match or load is
+ * recompiled from source and written back.
+ */
+auto CScriptCache::LoadBuffer(lua_State* L, LPCSTR source, size_t size, LPCSTR chunkName) -> int
+{
+    if (!sEnabled)
+    {
+        return luaL_loadbuffer(L, source, size, chunkName);
+    }
+
+    const auto startTime = GetTime();
+    const DWORD version[] = {NEON_SCRIPT_VERSION, LUA_VERSION_NUM};
+    const auto sourceHash = Hash(source, size, Hash(version, sizeof(version), FNV_OFFSET));
+    const auto cacheName = CString::Format("%s\\%016llx.luac", SCRIPTCACHE_DIR,
+                                           Hash(chunkName, strlen(chunkName), FNV_OFFSET));
+
+    if (LoadCached(L, cacheName.Str(), sourceHash, chunkName))
+    {
+        sStats.hits++;
+        sStats.loadTime += GetTime() - startTime;
+        return LUA_OK;
+    }
+
+    const auto res = luaL_loadbuffer(L, source, size, chunkName);
+
+    /* precompiled sources are loaded as-is */
+    if (res == LUA_OK && size > 0 && source[0] != LUA_SIGNATURE[0])
+    {
+        Store(L, cacheName.Str(), sourceHash);
+    }
+
+    sStats.misses++;
+    sStats.loadTime += GetTime() - startTime;
+    return res;
+}
+
+void CScriptCache::InstallSearcher(lua_State* L)
+{
+    lua_getglobal(L, LUA_LOADLIBNAME);
+    lua_getfield(L, -1, "searchers");
+    lua_pushcfunction(L, neon_searcher_Lua);
+    lua_rawseti(L, -2, 2);
+    lua_pop(L, 2);
+}
+
+void CScriptCache::ResetStats()
+{
+    ZeroMemory(&sStats, sizeof(SCRIPTCACHESTATS));
+}
+
+auto CScriptCache::LoadCached(lua_State* L, LPCSTR cacheName, UINT64 sourceHash, LPCSTR chunkName) -> bool
+{
+    const auto fd = FILESYSTEM->GetResource(cacheName);
+
+    if (fd.data == nullptr)
+    {
+        return FALSE;
+    }
+
+    const auto* const header = static_cast<SCRIPTCACHEHEADER*>(fd.data);
+    auto ok = fd.size >= sizeof(SCRIPTCACHEHEADER)
+        && header->magic == SCRIPTCACHE_MAGIC
+        && header->version == NEON_SCRIPT_VERSION
+        && header->sourceHash == sourceHash
+        && header->size == fd.size - sizeof(SCRIPTCACHEHEADER);
+
+    if (ok)
+    {
+        const auto* const code = reinterpret_cast<LPCSTR>(header + 1);
+        ok = luaL_loadbufferx(L, code, static_cast<size_t>(header->size), chunkName, "b") == LUA_OK;
+
+        if (!ok)
+        {
+            lua_pop(L, 1);
+        }
+    }
+
+    FILESYSTEM->FreeResource(fd.data);
+    return ok;
+}
+
+void CScriptCache::Store(lua_State* L, LPCSTR cacheName, UINT64 sourceHash)
+{
+    CreateDirectoryA(FILESYSTEM->ResourcePath(SCRIPTCACHE_DIR), nullptr);
+    const CString path = FILESYSTEM->ResourcePath(cacheName);
+
+    FILE* fp = nullptr;
+    fopen_s(&fp, path.Str(), "wb");
+
+    if (fp == nullptr)
+    {
+        return;
+    }
+
+    /* size stays zero until the dump succeeds, so a torn write is never loaded */
+    SCRIPTCACHEHEADER header = {SCRIPTCACHE_MAGIC, NEON_SCRIPT_VERSION, sourceHash, 0};
+
+    if (fwrite(&header, sizeof(SCRIPTCACHEHEADER), 1, fp) != 1 || lua_dump(L, neon_scriptwriter, fp, 0) != 0)
+    {
+        fclose(fp);
+        DeleteFileA(path.Str());
+        return;
+    }
+
+    header.size = static_cast<UINT64>(ftell(fp)) - sizeof(SCRIPTCACHEHEADER);
+    fseek(fp, 0, SEEK_SET);
+
+    const auto ok = fwrite(&header, sizeof(SCRIPTCACHEHEADER), 1, fp) == 1;
+    fclose(fp);
+
+    if (!ok)
+    {
+        DeleteFileA(path.Str());
+    }
+}
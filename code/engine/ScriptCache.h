@@ -0,0 +1,37 @@
+#pragma once
+
+#include "system.h"
+
+/// Bump whenever the bindings change in a way that invalidates compiled scripts
+#define NEON_SCRIPT_VERSION 1
+
+#define SCRIPTCACHE_DIR ".luacache"
+
+struct lua_State;
+
+struct SCRIPTCACHESTATS
+{
+    unsigned int hits;
+    unsigned int misses;
+    float loadTime;
+};
+
+class ENGINE_API CScriptCache
+{
+public:
+    static auto LoadBuffer(lua_State* L, LPCSTR source, size_t size, LPCSTR chunkName) -> int;
+    static void InstallSearcher(lua_State* L);
+
+    static void SetEnabled(bool state) { sEnabled = state; }
+    static auto IsEnabled() -> bool { return sEnabled; }
+    static auto GetStats() -> SCRIPTCACHESTATS { return sStats; }
+    static void ResetStats();
+
+private:
+    static bool sEnabled;
+    static SCRIPTCACHESTATS sStats;
+
+    static auto Hash(LPCVOID data, size_t size, UINT64 seed) -> UINT64;
+    static auto LoadCached(lua_State* L, LPCSTR cacheName, UINT64 sourceHash, LPCSTR chunkName) -> bool;
+    static void Store(lua_State* L, LPCSTR cacheName, UINT64 sourceHash);
+};
@@ -0,0 +1,448 @@
+#include "StdAfx.h"
+
+#include "Serializer.h"
+
+#include <lua/lua.hpp>
+
+#include <cstring>
+
+CSerializer::CSerializer()
+{
+    mBuffer.reserve(SERIALIZER_RESERVE);
+    mReadPos = nullptr;
+    mReadEnd = nullptr;
+    mWithFunctions = FALSE;
+    mNumTables = 0;
+}
+
+void CSerializer::Release()
+{
+    mBuffer.clear();
+    mBuffer.shrink_to_fit();
+}
+
+auto CSerializer::IsEncoded(const char* data, size_t size) -> bool
+{
+    return size > SERIALIZER_MAGIC_LEN && memcmp(data, SERIALIZER_MAGIC, SERIALIZER_MAGIC_LEN) == 0;
+}
+
+auto CSerializer::Encode(lua_State* L, int idx, bool withFunctions) -> bool
+{
+    idx = lua_absindex(L, idx);
+    mBuffer.clear();
+    mWithFunctions = withFunctions;
+    mNumTables = 0;
+
+    WriteBytes(SERIALIZER_MAGIC, SERIALIZER_MAGIC_LEN);
+    WriteByte(SERIALIZER_VERSION);
+
+    lua_pushcfunction(L, &CSerializer::EncodeValue);
+    lua_pushlightuserdata(L, this);
+    lua_pushvalue(L, idx);
+
+    if (lua_pcall(L, 2, 0, 0) != LUA_OK)
+    {
+        mBuffer.clear();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+auto CSerializer::Decode(lua_State* L, const char* data, size_t size, bool withFunctions) -> bool
+{
+    if (!IsEncoded(data, size))
+    {
+        lua_pushliteral(L, "not serialized data");
+        return FALSE;
+    }
+
+    if (data[SERIALIZER_MAGIC_LEN] != SERIALIZER_VERSION)
+    {
+        lua_pushfstring(L, "serialized data has version %d, expected %d", static_cast<int>(data[SERIALIZER_MAGIC_LEN]), SERIALIZER_VERSION);
+        return FALSE;
+    }
+
+    mReadPos = data + SERIALIZER_MAGIC_LEN + 1;
+    mReadEnd = data + size;
+    mWithFunctions = withFunctions;
+
+    lua_pushcfunction(L, &CSerializer::DecodeValue);
+    lua_pushlightuserdata(L, this);
+    return lua_pcall(L, 1, 1, 0) == LUA_OK;
+}
+
+/* Runs protected, args: serializer, value */
+auto CSerializer::EncodeValue(lua_State* L) -> int
+{
+    auto* const serializer = static_cast<CSerializer*>(lua_touserdata(L, 1));
+
+    // tables written so far and their index
+    lua_newtable(L);
+    serializer->WriteValue(L, 2, 3, 0);
+    return 0;
+}
+
+/* Runs protected, args: serializer */
+auto CSerializer::DecodeValue(lua_State* L) -> int
+{
+    auto* const serializer = static_cast<CSerializer*>(lua_touserdata(L, 1));
+
+    // tables read so far by index
+    lua_newtable(L);
+
+    if (!serializer->ReadValue(L, 2, 0))
+        return luaL_error(L, "corrupt serialized data");
+
+    if (serializer->mReadPos != serializer->mReadEnd)
+        return luaL_error(L, "serialized data has trailing bytes");
+
+    return 1;
+}
+
+auto CSerializer::IsStorable(lua_State* L, int idx, bool withFunctions) -> bool
+{
+    switch (lua_type(L, idx))
+    {
+    case LUA_TBOOLEAN:
+    case LUA_TNUMBER:
+    case LUA_TSTRING:
+    case LUA_TTABLE:
+        return TRUE;
+    case LUA_TFUNCTION:
+        return withFunctions && !lua_iscfunction(L, idx);
+    default:
+        return FALSE;
+    }
+}
+
+void CSerializer::WriteByte(UCHAR value)
+{
+    mBuffer.push_back(static_cast<char>(value));
+}
+
+void CSerializer::WriteVarint(UINT64 value)
+{
+    while (value >= 0x80)
+    {
+        WriteByte(static_cast<UCHAR>(value | 0x80));
+        value >>= 7;
+    }
+
+    WriteByte(static_cast<UCHAR>(value));
+}
+
+void CSerializer::WriteBytes(const void* data, size_t size)
+{
+    const auto* const bytes = static_cast<const char*>(data);
+    mBuffer.insert(mBuffer.end(), bytes, bytes + size);
+}
+
+/* Values that can't be stored are written as nil */
+void CSerializer::WriteValue(lua_State* L, int idx, int seen, int depth)
+{
+    if (!IsStorable(L, idx, mWithFunctions))
+    {
+        WriteByte(SERIALTAG_NIL);
+        return;
+    }
+
+    switch (lua_type(L, idx))
+    {
+    case LUA_TBOOLEAN:
+        WriteByte(lua_toboolean(L, idx) ? SERIALTAG_TRUE : SERIALTAG_FALSE);
+        break;
+
+    case LUA_TNUMBER:
+        if (lua_isinteger(L, idx))
+        {
+            const auto value = static_cast<INT64>(lua_tointeger(L, idx));
+
+            // zigzag, small negative numbers stay short
+            WriteByte(SERIALTAG_INTEGER);
+            WriteVarint(static_cast<UINT64>(value) << 1 ^ static_cast<UINT64>(value >> 63));
+        }
+        else
+        {
+            const auto value = static_cast<double>(lua_tonumber(L, idx));
+            WriteByte(SERIALTAG_NUMBER);
+            WriteBytes(&value, sizeof(value));
+        }
+        break;
+
+    case LUA_TSTRING:
+    {
+        size_t len;
+        const auto* const str = lua_tolstring(L, idx, &len);
+        WriteByte(SERIALTAG_STRING);
+        WriteVarint(len);
+        WriteBytes(str, len);
+        break;
+    }
+
+    case LUA_TTABLE:
+        WriteTable(L, idx, seen, depth);
+        break;
+
+    case LUA_TFUNCTION:
+    {
+        // the size goes in front of the bytecode and is only known once it's dumped
+        WriteByte(SERIALTAG_FUNCTION);
+        const auto start = mBuffer.size();
+        WriteBytes("\0\0\0\0", sizeof(uint32_t));
+
+        lua_pushvalue(L, idx);
+        lua_dump(L, &CSerializer::Writer, this, 1);
+        lua_pop(L, 1);
+
+        const auto size = static_cast<uint32_t>(mBuffer.size() - start - sizeof(uint32_t));
+        memcpy(&mBuffer[start], &size, sizeof(size));
+        break;
+    }
+    }
+}
+
+/*
+ * Layout: the number of values in 1..n and the number of other key and value
+ * pairs, followed by both. Knowing both up front lets the reader create the
+ * table at its final size. A table seen before is written as a reference to
+ * its index instead.
+ */
+void CSerializer::WriteTable(lua_State* L, int idx, int seen, int depth)
+{
+    if (depth >= SERIALIZER_MAX_DEPTH)
+    {
+        luaL_error(L, "tables nested too deep to serialize");
+        return;
+    }
+
+    luaL_checkstack(L, 4, nullptr);
+
+    lua_pushvalue(L, idx);
+
+    if (lua_rawget(L, seen) != LUA_TNIL)
+    {
+        WriteByte(SERIALTAG_REF);
+        WriteVarint(static_cast<UINT64>(lua_tointeger(L, -1)));
+        lua_pop(L, 1);
+        return;
+    }
+
+    lua_pop(L, 1);
+
+    lua_pushvalue(L, idx);
+    lua_pushinteger(L, static_cast<lua_Integer>(++mNumTables));
+    lua_rawset(L, seen);
+
+    lua_Integer count = 0;
+
+    while (lua_rawgeti(L, idx, count + 1) != LUA_TNIL)
+    {
+        lua_pop(L, 1);
+        count++;
+    }
+
+    lua_pop(L, 1);
+
+    const auto isPair = [&](int key) -> bool
+    {
+        const auto isListed = lua_isinteger(L, key) && lua_tointeger(L, key) >= 1 && lua_tointeger(L, key) <= count;
+        return !isListed && IsStorable(L, key, mWithFunctions) && IsStorable(L, key + 1, mWithFunctions);
+    };
+
+    UINT64 numPairs = 0;
+    lua_pushnil(L);
+
+    while (lua_next(L, idx))
+    {
+        numPairs += isPair(lua_gettop(L) - 1);
+        lua_pop(L, 1);
+    }
+
+    WriteByte(SERIALTAG_TABLE);
+    WriteVarint(static_cast<UINT64>(count));
+    WriteVarint(numPairs);
+
+    for (lua_Integer i = 1; i <= count; i++)
+    {
+        lua_rawgeti(L, idx, i);
+        WriteValue(L, lua_gettop(L), seen, depth + 1);
+        lua_pop(L, 1);
+    }
+
+    lua_pushnil(L);
+
+    while (lua_next(L, idx))
+    {
+        const auto key = lua_gettop(L) - 1;
+
+        if (isPair(key))
+        {
+            WriteValue(L, key, seen, depth + 1);
+            WriteValue(L, key + 1, seen, depth + 1);
+        }
+
+        lua_pop(L, 1);
+    }
+}
+
+auto CSerializer::ReadByte(UCHAR* value) -> bool
+{
+    if (mReadPos >= mReadEnd)
+        return FALSE;
+
+    *value = static_cast<UCHAR>(*mReadPos++);
+    return TRUE;
+}
+
+auto CSerializer::ReadVarint(UINT64* value) -> bool
+{
+    UCHAR byte;
+    *value = 0;
+
+    for (auto shift = 0; shift < 64; shift += 7)
+    {
+        if (!ReadByte(&byte))
+            return FALSE;
+
+        *value |= static_cast<UINT64>(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* Pushes the next value, refs holds the tables read so far */
+auto CSerializer::ReadValue(lua_State* L, int refs, int depth) -> bool
+{
+    UCHAR tag;
+    UINT64 value;
+
+    luaL_checkstack(L, 3, nullptr);
+
+    if (!ReadByte(&tag))
+        return FALSE;
+
+    switch (tag)
+    {
+    case SERIALTAG_NIL:
+        lua_pushnil(L);
+        return TRUE;
+
+    case SERIALTAG_FALSE:
+    case SERIALTAG_TRUE:
+        lua_pushboolean(L, tag == SERIALTAG_TRUE);
+        return TRUE;
+
+    case SERIALTAG_INTEGER:
+        if (!ReadVarint(&value))
+            return FALSE;
+
+        lua_pushinteger(L, static_cast<lua_Integer>(value >> 1 ^ (~(value & 1) + 1)));
+        return TRUE;
+
+    case SERIALTAG_NUMBER:
+    {
+        double number;
+
+        if (static_cast<size_t>(mReadEnd - mReadPos) < sizeof(number))
+            return FALSE;
+
+        memcpy(&number, mReadPos, sizeof(number));
+        mReadPos += sizeof(number);
+        lua_pushnumber(L, static_cast<lua_Number>(number));
+        return TRUE;
+    }
+
+    case SERIALTAG_STRING:
+        if (!ReadVarint(&value) || value > static_cast<UINT64>(mReadEnd - mReadPos))
+            return FALSE;
+
+        lua_pushlstring(L, mReadPos, static_cast<size_t>(value));
+        mReadPos += value;
+        return TRUE;
+
+    case SERIALTAG_REF:
+        if (!ReadVarint(&value) || value == 0 || value > lua_rawlen(L, refs))
+            return FALSE;
+
+        lua_rawgeti(L, refs, static_cast<lua_Integer>(value));
+        return TRUE;
+
+    case SERIALTAG_FUNCTION:
+    {
+        uint32_t size;
+
+        if (static_cast<size_t>(mReadEnd - mReadPos) < sizeof(size))
+            return FALSE;
+
+        memcpy(&size, mReadPos, sizeof(size));
+        mReadPos += sizeof(size);
+
+        if (size > static_cast<size_t>(mReadEnd - mReadPos))
+            return FALSE;
+
+        const auto* const code = mReadPos;
+        mReadPos += size;
+
+        // skipped unless asked for, bytecode isn't checked by Lua
+        if (!mWithFunctions)
+        {
+            lua_pushnil(L);
+            return TRUE;
+        }
+
+        return luaL_loadbufferx(L, code, size, "=serialized", "b") == LUA_OK;
+    }
+
+    case SERIALTAG_TABLE:
+        break;
+
+    default:
+        return FALSE;
+    }
+
+    UINT64 numPairs;
+
+    if (depth >= SERIALIZER_MAX_DEPTH || !ReadVarint(&value) || !ReadVarint(&numPairs))
+        return FALSE;
+
+    // every value takes at least a byte, which bounds the preallocation
+    const auto remaining = static_cast<UINT64>(mReadEnd - mReadPos);
+
+    if (value > remaining || numPairs > remaining / 2 || value + numPairs * 2 > remaining)
+        return FALSE;
+
+    const auto count = static_cast<lua_Integer>(value);
+    lua_createtable(L, static_cast<int>(count), static_cast<int>(numPairs));
+    const auto tbl = lua_gettop(L);
+
+    lua_pushvalue(L, tbl);
+    lua_rawseti(L, refs, static_cast<lua_Integer>(lua_rawlen(L, refs)) + 1);
+
+    for (lua_Integer i = 1; i <= count; i++)
+    {
+        if (!ReadValue(L, refs, depth + 1))
+            return FALSE;
+
+        lua_rawseti(L, tbl, i);
+    }
+
+    for (UINT64 i = 0; i < numPairs; i++)
+    {
+        if (!ReadValue(L, refs, depth + 1) || lua_isnil(L, -1) || !ReadValue(L, refs, depth + 1))
+            return FALSE;
+
+        lua_rawset(L, tbl);
+    }
+
+    return TRUE;
+}
+
+auto CSerializer::Writer(lua_State* L, const void* p, size_t size, void* ud) -> int
+{
+    static_cast<CSerializer*>(ud)->WriteBytes(p, size);
+    return 0;
+}
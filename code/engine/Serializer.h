@@ -0,0 +1,78 @@
+#pragma once
+
+#include "system.h"
+
+#include <vector>
+
+struct lua_State;
+
+// every encoded value starts with these bytes followed by the version
+#define SERIALIZER_MAGIC "NSLV"
+#define SERIALIZER_MAGIC_LEN 4
+#define SERIALIZER_VERSION 1
+// the output buffer starts out this large and keeps its capacity between calls
+#define SERIALIZER_RESERVE (64 * 1024)
+// deepest table nesting either direction accepts
+#define SERIALIZER_MAX_DEPTH 200
+
+enum SERIALTAG
+{
+    SERIALTAG_NIL,
+    SERIALTAG_FALSE,
+    SERIALTAG_TRUE,
+    SERIALTAG_INTEGER,
+    SERIALTAG_NUMBER,
+    SERIALTAG_STRING,
+    SERIALTAG_TABLE,
+    SERIALTAG_REF,
+    SERIALTAG_FUNCTION,
+};
+
+/*
+ * Compact binary encoding of plain Lua values, used for config and save data
+ * in place of Lua source. Integers and lengths are stored as varints, numbers
+ * as raw doubles. A table is written once, later occurrences refer back to it
+ * by index, so shared tables and cycles come back as they were. Functions are
+ * stored as stripped bytecode when asked for and lose their upvalues. Values
+ * that can't be stored, such as userdata and threads, are left out of their
+ * tables. Metatables aren't kept.
+ */
+class CSerializer
+{
+public:
+    CSerializer(void);
+    void Release(void);
+
+    /* Encodes the value at idx into the buffer, on failure the error message is left on the stack */
+    auto Encode(lua_State* L, int idx, bool withFunctions) -> bool;
+
+    /* Pushes the decoded value, or the error message on failure */
+    auto Decode(lua_State* L, const char* data, size_t size, bool withFunctions) -> bool;
+
+    auto GetData() const -> const char* { return mBuffer.data(); }
+    auto GetSize() const -> size_t { return mBuffer.size(); }
+
+    static auto IsEncoded(const char* data, size_t size) -> bool;
+
+private:
+    std::vector<char> mBuffer;
+    const char* mReadPos;
+    const char* mReadEnd;
+    bool mWithFunctions;
+    INT64 mNumTables;           // tables written so far, their index for references
+
+    void WriteByte(UCHAR value);
+    void WriteVarint(UINT64 value);
+    void WriteBytes(const void* data, size_t size);
+    void WriteValue(lua_State* L, int idx, int seen, int depth);
+    void WriteTable(lua_State* L, int idx, int seen, int depth);
+
+    auto ReadByte(UCHAR* value) -> bool;
+    auto ReadVarint(UINT64* value) -> bool;
+    auto ReadValue(lua_State* L, int refs, int depth) -> bool;
+
+    static auto IsStorable(lua_State* L, int idx, bool withFunctions) -> bool;
+    static auto EncodeValue(lua_State* L) -> int;
+    static auto DecodeValue(lua_State* L) -> int;
+    static auto Writer(lua_State* L, const void* p, size_t size, void* ud) -> int;
+};
@@ -0,0 +1,416 @@
+#include "StdAfx.h"
+
+#include "Snapshot.h"
+
+#include "Engine.h"
+#include "ResourceCache.h"
+#include "Scene.h"
+#include "Node.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "FaceGroup.h"
+#include "Effect.h"
+#include "RenderTarget.h"
+#include "Light.h"
+#include "Font.h"
+#include "Sound.h"
+#include "Music.h"
+#include "CollisionWorld.h"
+#include "EntityWorld.h"
+#include "TweenLayer.h"
+
+#include <lua/lua.hpp>
+extern "C" {
+#include <lua/eris.h>
+}
+
+#include "LuaWrapper.h"
+
+#include <string>
+
+/* Tables and functions are named up to this many levels below _G and the registry */
+#define SNAPSHOT_PERM_DEPTH 2
+
+struct SNAPSHOTTYPE
+{
+    LuaClass cls;
+    void (*addRef)(LPVOID);
+    void (*release)(LPVOID);
+};
+
+template <typename T>
+static void SnapshotAddRef(LPVOID data)
+{
+    static_cast<T*>(data)->AddRef();
+}
+
+template <typename T>
+static void SnapshotRelease(LPVOID data)
+{
+    static_cast<T*>(data)->Release();
+}
+
+#define SNAPSHOT_TYPE(TAG, CLASS) {TAG, &SnapshotAddRef<CLASS>, &SnapshotRelease<CLASS>}
+
+/// Boxed engine objects, see LUAP
+static const SNAPSHOTTYPE sTypes[] = {
+    SNAPSHOT_TYPE(LC_SCENE, CScene),
+    SNAPSHOT_TYPE(LC_NODE, CNode),
+    SNAPSHOT_TYPE(LC_MESH, CMesh),
+    SNAPSHOT_TYPE(LC_MATERIAL, CMaterial),
+    SNAPSHOT_TYPE(LC_FACEGROUP, CFaceGroup),
+    SNAPSHOT_TYPE(LC_EFFECT, CEffect),
+    SNAPSHOT_TYPE(LC_RENDERTARGET, CRenderTarget),
+    SNAPSHOT_TYPE(LC_LIGHT, CLight),
+    SNAPSHOT_TYPE(LC_FONT, CFont),
+    SNAPSHOT_TYPE(LC_SOUND, CSound),
+    SNAPSHOT_TYPE(LC_MUSIC, CMusic),
+    SNAPSHOT_TYPE(LC_COLLISIONMESH, CCollisionMesh),
+    SNAPSHOT_TYPE(LC_COLLISIONWORLD, CCollisionWorld),
+};
+
+#define SNAPSHOT_TYPE_COUNT (sizeof(sTypes) / sizeof(sTypes[0]))
+
+struct SNAPSHOTREADER
+{
+    const char* data;
+    size_t size;
+};
+
+int CSnapshot::sPersistKey = 0;
+int CSnapshot::sUnpersistKey = 0;
+
+CSnapshot::CSnapshot()
+{
+    mIsState = FALSE;
+    mSaveTime = 0.0F;
+    mLoadTime = 0.0F;
+}
+
+void CSnapshot::Release()
+{
+    Clear();
+}
+
+void CSnapshot::Clear()
+{
+    ReleaseObjects(mObjects);
+    mData.clear();
+    mData.shrink_to_fit();
+    mCaptured.clear();
+    mIsState = FALSE;
+}
+
+static void AddPermanentFields(lua_State* L, int persist, int unpersist, int tbl, const std::string& prefix, int depth);
+
+static void AddPermanent(lua_State* L, int persist, int unpersist, const std::string& name, int depth)
+{
+    const auto type = lua_type(L, -1);
+
+    if (type != LUA_TTABLE && type != LUA_TUSERDATA && type != LUA_TTHREAD && !lua_iscfunction(L, -1))
+    {
+        return;
+    }
+
+    if (type == LUA_TTABLE)
+    {
+        /* globals are part of the state we want to persist */
+        lua_pushglobaltable(L);
+        const auto isGlobals = lua_rawequal(L, -1, -2);
+        lua_pop(L, 1);
+
+        if (isGlobals)
+        {
+            return;
+        }
+    }
+
+    lua_pushstring(L, name.c_str());
+    lua_pushvalue(L, -2);
+    lua_rawset(L, unpersist);
+
+    lua_pushvalue(L, -1);
+    lua_rawget(L, persist);
+    const auto known = !lua_isnil(L, -1);
+    lua_pop(L, 1);
+
+    if (!known)
+    {
+        lua_pushvalue(L, -1);
+        lua_pushstring(L, name.c_str());
+        lua_rawset(L, persist);
+    }
+
+    if (type == LUA_TTABLE && depth > 0)
+    {
+        AddPermanentFields(L, persist, unpersist, lua_gettop(L), name, depth - 1);
+    }
+}
+
+static void AddPermanentFields(lua_State* L, int persist, int unpersist, int tbl, const std::string& prefix, int depth)
+{
+    luaL_checkstack(L, 6, nullptr);
+    lua_pushnil(L);
+
+    while (lua_next(L, tbl) != 0)
+    {
+        if (lua_type(L, -2) == LUA_TSTRING)
+        {
+            AddPermanent(L, persist, unpersist, prefix + "." + lua_tostring(L, -2), depth);
+        }
+
+        lua_pop(L, 1);
+    }
+}
+
+/*
+ * Registers everything the bindings and standard libraries put into the state
+ * as a permanent, so that only what scripts created afterwards gets written.
+ * Must run before any script does. Values reachable under several names get
+ * all of them registered for restoring, since the traversal order differs
+ * between states.
+ *
+ * Classes with a __persist metamethod return a closure over their restore
+ * function, which Eris calls when unpersisting. Such a function is written by
+ * name too, so it has to be reachable from here, the classes list it in their
+ * metatable as __restore.
+ */
+void CSnapshot::BuildPermanents(lua_State* L)
+{
+    lua_newtable(L);
+    const auto persist = lua_gettop(L);
+    lua_newtable(L);
+    const auto unpersist = lua_gettop(L);
+
+    lua_pushglobaltable(L);
+    AddPermanentFields(L, persist, unpersist, lua_gettop(L), "_G", SNAPSHOT_PERM_DEPTH);
+    lua_pop(L, 1);
+
+    AddPermanentFields(L, persist, unpersist, LUA_REGISTRYINDEX, "reg", SNAPSHOT_PERM_DEPTH);
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+    AddPermanent(L, persist, unpersist, "mainthread", 0);
+    lua_pop(L, 1);
+
+    lua_pushliteral(L, "");
+    if (lua_getmetatable(L, -1) != 0)
+    {
+        AddPermanent(L, persist, unpersist, "strmt", SNAPSHOT_PERM_DEPTH);
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &sUnpersistKey);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &sPersistKey);
+}
+
+auto CSnapshot::IsPermanent(lua_State* L, int idx) -> bool
+{
+    idx = lua_absindex(L, idx);
+
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, &sPersistKey) != LUA_TTABLE)
+    {
+        lua_pop(L, 1);
+        return FALSE;
+    }
+
+    lua_pushvalue(L, idx);
+    const auto known = lua_rawget(L, -2) != LUA_TNIL;
+    lua_pop(L, 2);
+    return known;
+}
+
+/*
+ * Persists the value at idx. On failure the previous snapshot is kept and the
+ * error message is left on top of the stack.
+ */
+auto CSnapshot::Save(lua_State* L, int idx, bool isState) -> bool
+{
+    idx = lua_absindex(L, idx);
+    const auto startTime = GetTime();
+
+    auto oldData = std::move(mData);
+    auto oldObjects = std::move(mObjects);
+    mData.clear();
+    mObjects.clear();
+    mCaptured.clear();
+
+    lua_pushcfunction(L, &CSnapshot::Dump);
+    lua_pushlightuserdata(L, this);
+    PushPermanents(L, this, FALSE);
+    lua_pushvalue(L, idx);
+
+    const auto r = lua_pcall(L, 3, 0, 0);
+    mCaptured.clear();
+
+    if (r != LUA_OK)
+    {
+        ReleaseObjects(mObjects);
+        mData = std::move(oldData);
+        mObjects = std::move(oldObjects);
+        return FALSE;
+    }
+
+    ReleaseObjects(oldObjects);
+    mIsState = isState;
+    mSaveTime = (GetTime() - startTime) * 1000.0F;
+    return TRUE;
+}
+
+/*
+ * Pushes the restored value, or the error message on failure.
+ */
+auto CSnapshot::Load(lua_State* L) -> bool
+{
+    if (mData.empty())
+    {
+        lua_pushliteral(L, "no snapshot was taken");
+        return FALSE;
+    }
+
+    const auto startTime = GetTime();
+
+    lua_pushcfunction(L, &CSnapshot::Undump);
+    lua_pushlightuserdata(L, this);
+    PushPermanents(L, this, TRUE);
+
+    const auto r = lua_pcall(L, 2, 1, 0);
+    mLoadTime = (GetTime() - startTime) * 1000.0F;
+    return r == LUA_OK;
+}
+
+auto CSnapshot::Capture(UCHAR type, LPVOID data) -> unsigned int
+{
+    const auto key = std::make_pair(data, type);
+    const auto it = mCaptured.find(key);
+
+    if (it != mCaptured.end())
+    {
+        return it->second;
+    }
+
+    sTypes[type].addRef(data);
+    mObjects.push_back({type, data});
+
+    const auto id = static_cast<unsigned int>(mObjects.size());
+    mCaptured.emplace(key, id);
+    return id;
+}
+
+void CSnapshot::ReleaseObjects(std::vector<SNAPSHOTOBJECT>& objects)
+{
+    for (const auto& obj : objects)
+    {
+        sTypes[obj.type].release(obj.data);
+    }
+
+    objects.clear();
+}
+
+void CSnapshot::PushPermanents(lua_State* L, CSnapshot* snapshot, bool forUnpersist)
+{
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, forUnpersist ? &sUnpersistKey : &sPersistKey) != LUA_TTABLE)
+    {
+        lua_pop(L, 1);
+        lua_newtable(L);
+    }
+
+    /* engine objects are looked up through __index since they aren't known up front */
+    lua_createtable(L, 0, 1);
+    lua_pushlightuserdata(L, snapshot);
+    lua_pushcclosure(L, forUnpersist ? &CSnapshot::UnpersistIndex : &CSnapshot::PersistIndex, 1);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, -2);
+}
+
+auto CSnapshot::Dump(lua_State* L) -> int
+{
+    auto* const snapshot = static_cast<CSnapshot*>(lua_touserdata(L, 1));
+    lua_remove(L, 1);
+    eris_dump(L, &CSnapshot::Writer, snapshot);
+    return 0;
+}
+
+auto CSnapshot::Undump(lua_State* L) -> int
+{
+    auto* const snapshot = static_cast<CSnapshot*>(lua_touserdata(L, 1));
+    lua_remove(L, 1);
+
+    SNAPSHOTREADER reader = {snapshot->mData.data(), snapshot->mData.size()};
+    eris_undump(L, &CSnapshot::Reader, &reader);
+    return 1;
+}
+
+auto CSnapshot::PersistIndex(lua_State* L) -> int
+{
+    auto* const snapshot = static_cast<CSnapshot*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+    if (lua_type(L, 2) != LUA_TUSERDATA)
+    {
+        return 0;
+    }
+
+    for (UCHAR i = 0; i < SNAPSHOT_TYPE_COUNT; i++)
+    {
+        if (luaH_testudata(L, 2, sTypes[i].cls))
+        {
+            const auto data = *static_cast<LPVOID*>(lua_touserdata(L, 2));
+            lua_pushinteger(L, snapshot->Capture(i, data));
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+auto CSnapshot::UnpersistIndex(lua_State* L) -> int
+{
+    const auto* const snapshot = static_cast<CSnapshot*>(lua_touserdata(L, lua_upvalueindex(1)));
+
+    if (!lua_isinteger(L, 2))
+    {
+        return 0;
+    }
+
+    const auto id = lua_tointeger(L, 2);
+
+    if (id < 1 || id > static_cast<lua_Integer>(snapshot->mObjects.size()))
+    {
+        return 0;
+    }
+
+    const auto& obj = snapshot->mObjects[id - 1];
+
+    /* objects still bound in this state keep their proxy */
+    if (!luaH_findproxy(L, sTypes[obj.type].cls, obj.data))
+    {
+        sTypes[obj.type].addRef(obj.data);
+        luaH_newproxy(L, sTypes[obj.type].cls, obj.data);
+    }
+
+    /* the restored session owns these now */
+    RESOURCES->MarkClaimed(obj.data);
+    return 1;
+}
+
+auto CSnapshot::Writer(lua_State* L, const void* p, size_t size, void* ud) -> int
+{
+    auto* const snapshot = static_cast<CSnapshot*>(ud);
+    const auto* const data = static_cast<const char*>(p);
+    snapshot->mData.insert(snapshot->mData.end(), data, data + size);
+    return 0;
+}
+
+auto CSnapshot::Reader(lua_State* L, void* ud, size_t* size) -> const char*
+{
+    auto* const reader = static_cast<SNAPSHOTREADER*>(ud);
+
+    if (reader->size == 0)
+    {
+        return nullptr;
+    }
+
+    *size = reader->size;
+    reader->size = 0;
+    return reader->data;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "system.h"
+
+#include <map>
+#include <vector>
+
+struct lua_State;
+
+struct SNAPSHOTOBJECT
+{
+    UCHAR type;
+    LPVOID data;
+};
+
+/*
+ * Persists a Lua value, or the whole state, into a binary blob using Eris and
+ * restores it into another state later on. Library and binding functions are
+ * written by name through a permanents table built right after the bindings
+ * are registered. Engine userdata is not serialized: each boxed object is
+ * recorded by identity in the snapshot's object list and kept alive until the
+ * snapshot is cleared, so restoring hands out the very same instances. That
+ * also means a snapshot is only valid within the running process, which is
+ * why it is kept in memory.
+ */
+class CSnapshot
+{
+public:
+    CSnapshot(void);
+    void Release(void);
+    void Clear(void);
+
+    static void BuildPermanents(lua_State* L);
+    static auto IsPermanent(lua_State* L, int idx) -> bool;
+
+    auto Save(lua_State* L, int idx, bool isState) -> bool;
+    auto Load(lua_State* L) -> bool;
+
+    auto IsEmpty() const -> bool { return mData.empty(); }
+    auto IsState() const -> bool { return mIsState; }
+    auto GetSize() const -> size_t { return mData.size(); }
+    auto GetObjectCount() const -> unsigned int { return static_cast<unsigned int>(mObjects.size()); }
+    auto GetSaveTime() const -> float { return mSaveTime; }
+    auto GetLoadTime() const -> float { return mLoadTime; }
+
+private:
+    std::vector<char> mData;
+    std::vector<SNAPSHOTOBJECT> mObjects;
+    std::map<std::pair<LPVOID, UCHAR>, unsigned int> mCaptured;
+    bool mIsState;
+    float mSaveTime;
+    float mLoadTime;
+
+    static int sPersistKey;
+    static int sUnpersistKey;
+
+    auto Capture(UCHAR type, LPVOID data) -> unsigned int;
+    static void ReleaseObjects(std::vector<SNAPSHOTOBJECT>& objects);
+    static void PushPermanents(lua_State* L, CSnapshot* snapshot, bool forUnpersist);
+
+    static auto Dump(lua_State* L) -> int;
+    static auto Undump(lua_State* L) -> int;
+    static auto PersistIndex(lua_State* L) -> int;
+    static auto UnpersistIndex(lua_State* L) -> int;
+    static auto Writer(lua_State* L, const void* p, size_t size, void* ud) -> int;
+    static auto Reader(lua_State* L, void* ud, size_t* size) -> const char*;
+};
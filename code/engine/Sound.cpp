@@ -28,6 +28,16 @@ CSound::CSound(LPSTR wavPath): CAllocable()
     }
 }
 
+CSound::CSound(LPSTR oggPath, const DECODEDSOUND& decoded): CAllocable()
+{
+    mBuffer = nullptr;
+    mIsLooping = FALSE;
+    mData = nullptr;
+    mDataSize = 0;
+
+    CSoundLoader::LoadOGG(oggPath, decoded, &mBuffer, &mData, &mDataSize, &mWaveInfo);
+}
+
 void CSound::Release()
 {
     if (DelRef())
@@ -87,6 +97,13 @@ bool CSound::IsLooping()
     return mIsLooping;
 }
 
+void CSound::Reset()
+{
+    CSoundBase::Reset();
+    mBuffer->SetFrequency(DSBFREQUENCY_ORIGINAL);
+    mIsLooping = FALSE;
+}
+
 UCHAR* CSound::GetData(ULONG* sizeOut)
 {
     *sizeOut = mDataSize;
@@ -5,10 +5,14 @@
 #include "ReferenceManager.h"
 #include "SoundBase.h"
 
+struct DECODEDSOUND;
+
 class CSound : public CReferenceCounter, CAllocable<CSound>, public CSoundBase
 {
 public:
     CSound(LPSTR wavPath);
+    /* Takes over an OGG file decoded beforehand */
+    CSound(LPSTR oggPath, const DECODEDSOUND& decoded);
     void Release();
 
     void Play() override;
@@ -18,6 +22,7 @@ public:
     auto GetFrequency() -> DWORD;
     void SetLoop(bool state);
     auto IsLooping() -> bool;
+    void Reset() override;
 
     auto GetData(ULONG* sizeOut) -> UCHAR*;
 protected:
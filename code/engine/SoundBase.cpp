@@ -71,3 +71,10 @@ DWORD CSoundBase::GetTotalSize()
     mBuffer->GetCaps(&caps);
     return caps.dwBufferBytes;
 }
+
+void CSoundBase::Reset()
+{
+    Stop();
+    mBuffer->SetVolume(DSBVOLUME_MAX);
+    mBuffer->SetPan(DSBPAN_CENTER);
+}
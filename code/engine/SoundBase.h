@@ -18,6 +18,9 @@ public:
     virtual auto IsPlaying() -> bool;
     virtual auto GetTotalSize() -> DWORD;
 
+    /* Stops playback and restores the settings the buffer was created with */
+    virtual void Reset();
+
 protected:
     IDirectSoundBuffer8* mBuffer;
     WAVEFORMATEX mWaveInfo;
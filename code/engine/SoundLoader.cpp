@@ -193,23 +193,35 @@ void CSoundLoader::LoadWAV(LPSTR wavPath, IDirectSoundBuffer8** sndBuffer, UCHAR
     }
 }
 
+void CSoundLoader::DecodeOGGFile(LPCSTR fullPath, DECODEDSOUND* decoded)
+{
+    decoded->samples = nullptr;
+    decoded->count = stb_vorbis_decode_filename(fullPath, &decoded->channels, &decoded->sampleRate, &decoded->samples);
+}
+
 void CSoundLoader::LoadOGG(LPSTR oggPath, IDirectSoundBuffer8** sndBuffer, UCHAR** dataPtr, ULONG* dataSize,
                            LPVOID waveInfo)
 {
-    size_t count;
+    DECODEDSOUND decoded;
+    DecodeOGGFile(ENGINE->GetFileSystem()->ResourcePath(oggPath), &decoded);
+    LoadOGG(oggPath, decoded, sndBuffer, dataPtr, dataSize, waveInfo);
+}
+
+void CSoundLoader::LoadOGG(LPSTR oggPath, const DECODEDSOUND& decoded, IDirectSoundBuffer8** sndBuffer, UCHAR** dataPtr,
+                           ULONG* dataSize, LPVOID waveInfo)
+{
     WAVEFORMATEX waveFormat;
     DSBUFFERDESC bufferDesc;
     HRESULT result;
     IDirectSoundBuffer* tempBuffer;
     UCHAR* bufferPtr;
     ULONG bufferSize;
-    CFileSystem* fs = ENGINE->GetFileSystem();
     CVirtualMachine* vm = ENGINE->GetVM();
 
-    int channels;
-    int sample_rate;
-    short* output;
-    count = stb_vorbis_decode_filename(fs->ResourcePath(oggPath), &channels, &sample_rate, &output);
+    const auto count = decoded.count;
+    const auto channels = decoded.channels;
+    const auto sample_rate = decoded.sampleRate;
+    short* output = decoded.samples;
 
     if (count == -1)
     {
@@ -5,10 +5,24 @@
 struct IDirectSoundBuffer8;
 struct stb_vorbis;
 
+/* Interleaved 16-bit samples of a fully decoded sound, the buffer comes from stb_vorbis */
+struct DECODEDSOUND
+{
+    int count;          // samples per channel, -1 when decoding failed
+    int channels;
+    int sampleRate;
+    short* samples;
+};
+
 class CSoundLoader
 {
 public:
     static void LoadOGG(LPSTR path, IDirectSoundBuffer8** sndBuffer, UCHAR** dataPtr, ULONG* dataSize, LPVOID waveInfo);
+    static void LoadOGG(LPSTR path, const DECODEDSOUND& decoded, IDirectSoundBuffer8** sndBuffer, UCHAR** dataPtr,
+                        ULONG* dataSize, LPVOID waveInfo);
+
+    /* Only decodes, safe off the main thread */
+    static void DecodeOGGFile(LPCSTR fullPath, DECODEDSOUND* decoded);
     static void LoadWAV(LPSTR path, IDirectSoundBuffer8** sndBuffer, UCHAR** dataPtr, ULONG* dataSize, LPVOID waveInfo);
     static void LoadWAV3D(LPSTR path, IDirectSoundBuffer8** sndBuffer, UCHAR** dataPtr, ULONG* dataSize,
                           LPVOID waveInfo);
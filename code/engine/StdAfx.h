@@ -8,4 +8,6 @@
 #include <d3d9/include/d3dx9math.h>
 #include <d3d9/include/d3dx9effect.h>
 
+#include "NMath.h"
+
 #include <cassert>
@@ -0,0 +1,411 @@
+#include "StdAfx.h"
+
+#include "TaskScheduler.h"
+
+#include "Engine.h"
+#include "VM.h"
+
+#include <lua/lua.hpp>
+#include <algorithm>
+
+int CTaskScheduler::sYieldKey = 0;
+
+static auto TimerCompare(const TASKTIMER& a, const TASKTIMER& b) -> bool
+{
+    return a.at > b.at;
+}
+
+CTaskScheduler::CTaskScheduler(lua_State* L)
+{
+    mLuaVM = L;
+    mNextId = 1;
+    mFrame = 0;
+    mRunTime = 0.0F;
+    mEventWaits = 0;
+    mFrameResumes = 0;
+    mFrameResumeTime = 0.0F;
+}
+
+void CTaskScheduler::Release()
+{
+    for (const auto& it : mTasks)
+    {
+        luaL_unref(mLuaVM, LUA_REGISTRYINDEX, it.second.ref);
+    }
+
+    mTasks.clear();
+    mThreads.clear();
+    mEvents.clear();
+    mTimers.clear();
+    mFrameTimers.clear();
+    mEventWaits = 0;
+}
+
+/*
+ * Expects the task function followed by nargs arguments on top of L. The task
+ * starts running right away and is parked once it waits for something.
+ */
+auto CTaskScheduler::Spawn(lua_State* L, int nargs) -> unsigned int
+{
+    luaL_checktype(L, -(nargs + 1), LUA_TFUNCTION);
+
+    TASK task = {};
+
+    lua_Debug ar;
+    lua_pushvalue(L, -(nargs + 1));
+    lua_getinfo(L, ">S", &ar);
+    task.name = CString::Format("%s:%d", ar.short_src, ar.linedefined).Str();
+
+    task.thread = lua_newthread(L);
+    task.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_xmove(L, task.thread, nargs + 1);
+
+    const auto id = mNextId++;
+    mThreads[task.thread] = id;
+    mTasks.emplace(id, task);
+
+    Resume(id, L, nargs);
+    return id;
+}
+
+void CTaskScheduler::Cancel(unsigned int id)
+{
+    const auto it = mTasks.find(id);
+
+    if (it == mTasks.end())
+    {
+        return;
+    }
+
+    /* a running task can't be torn down under itself, drop it once it yields */
+    if (it->second.running)
+    {
+        it->second.cancelled = TRUE;
+        return;
+    }
+
+    Remove(id);
+}
+
+auto CTaskScheduler::IsAlive(unsigned int id) const -> bool
+{
+    const auto it = mTasks.find(id);
+    return it != mTasks.end() && !it->second.cancelled;
+}
+
+auto CTaskScheduler::IsTask(lua_State* L) const -> bool
+{
+    return mThreads.find(L) != mThreads.end();
+}
+
+/*
+ * Wakes every task waiting on the given event, handing each of them the nargs
+ * values on top of L. Returns the number of tasks woken.
+ */
+auto CTaskScheduler::Signal(lua_State* L, LPCSTR name, int nargs) -> unsigned int
+{
+    const auto it = mEvents.find(name);
+
+    if (it == mEvents.end())
+    {
+        return 0;
+    }
+
+    const auto waiting = std::move(it->second);
+    mEvents.erase(it);
+
+    const auto base = lua_gettop(L) - nargs;
+    unsigned int woken = 0;
+
+    for (const auto id : waiting)
+    {
+        const auto task = mTasks.find(id);
+
+        if (task == mTasks.end() || task->second.wait != TASKWAIT_EVENT)
+        {
+            continue;
+        }
+
+        mEventWaits--;
+
+        for (auto i = 1; i <= nargs; i++)
+        {
+            lua_pushvalue(L, base + i);
+        }
+
+        lua_xmove(L, task->second.thread, nargs);
+        Resume(id, L, nargs);
+        woken++;
+    }
+
+    return woken;
+}
+
+void CTaskScheduler::Update(float runTime)
+{
+    mRunTime = runTime;
+    mFrameResumes = 0;
+    mFrameResumeTime = 0.0F;
+
+    mDue.clear();
+    PopDue(mTimers, runTime, mDue);
+    PopDue(mFrameTimers, static_cast<double>(mFrame), mDue);
+
+    for (const auto id : mDue)
+    {
+        const auto it = mTasks.find(id);
+
+        if (it == mTasks.end() || (it->second.wait != TASKWAIT_TIME && it->second.wait != TASKWAIT_FRAMES))
+        {
+            continue;
+        }
+
+        Resume(id, mLuaVM, 0);
+    }
+
+    mFrame++;
+}
+
+/*
+ * Pushes an array describing every parked task: its thread, what it waits for
+ * and how long it still has to wait. Used by VM snapshots, see LoadTasks.
+ */
+void CTaskScheduler::SaveTasks(lua_State* L) const
+{
+    lua_createtable(L, static_cast<int>(mTasks.size()), 0);
+    auto n = 0;
+
+    for (const auto& it : mTasks)
+    {
+        const auto& task = it.second;
+
+        if (task.cancelled)
+        {
+            continue;
+        }
+
+        lua_createtable(L, 0, 5);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, task.ref);
+        lua_setfield(L, -2, "thread");
+        lua_pushinteger(L, task.wait);
+        lua_setfield(L, -2, "wait");
+        lua_pushstring(L, task.name.c_str());
+        lua_setfield(L, -2, "name");
+
+        switch (task.wait)
+        {
+        case TASKWAIT_TIME:
+            lua_pushnumber(L, FindTimer(mTimers, it.first) - static_cast<double>(VM->GetRunTime()));
+            lua_setfield(L, -2, "remaining");
+            break;
+
+        case TASKWAIT_FRAMES:
+            lua_pushnumber(L, FindTimer(mFrameTimers, it.first) - static_cast<double>(mFrame));
+            lua_setfield(L, -2, "remaining");
+            break;
+
+        case TASKWAIT_EVENT:
+            lua_pushstring(L, task.event.c_str());
+            lua_setfield(L, -2, "event");
+            break;
+        }
+
+        lua_rawseti(L, -2, ++n);
+    }
+}
+
+/*
+ * Re-parks the tasks saved by SaveTasks in a freshly restored state. Waits are
+ * continued relative to the current run time and frame.
+ */
+void CTaskScheduler::LoadTasks(lua_State* L, int idx)
+{
+    idx = lua_absindex(L, idx);
+    const auto count = static_cast<int>(luaL_len(L, idx));
+
+    for (auto i = 1; i <= count; i++)
+    {
+        lua_rawgeti(L, idx, i);
+        lua_getfield(L, -1, "thread");
+
+        if (!lua_isthread(L, -1))
+        {
+            lua_pop(L, 2);
+            continue;
+        }
+
+        TASK task = {};
+        task.thread = lua_tothread(L, -1);
+        task.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+        lua_getfield(L, -1, "wait");
+        task.wait = static_cast<UCHAR>(lua_tointeger(L, -1));
+        lua_getfield(L, -2, "name");
+        task.name = luaL_optstring(L, -1, "?");
+        lua_getfield(L, -3, "remaining");
+        const auto remaining = lua_tonumber(L, -1);
+        lua_getfield(L, -4, "event");
+
+        const auto id = mNextId++;
+
+        switch (task.wait)
+        {
+        case TASKWAIT_TIME:
+            PushTimer(mTimers, static_cast<double>(VM->GetRunTime()) + remaining, id);
+            break;
+
+        case TASKWAIT_FRAMES:
+            PushTimer(mFrameTimers, static_cast<double>(mFrame) + remaining, id);
+            break;
+
+        case TASKWAIT_EVENT:
+            task.event = luaL_optstring(L, -1, "");
+            mEvents[task.event].push_back(id);
+            mEventWaits++;
+            break;
+
+        default:
+            task.wait = TASKWAIT_FRAMES;
+            PushTimer(mFrameTimers, static_cast<double>(mFrame + 1), id);
+            break;
+        }
+
+        mThreads[task.thread] = id;
+        mTasks.emplace(id, task);
+        lua_pop(L, 5);
+    }
+}
+
+void CTaskScheduler::Resume(unsigned int id, lua_State* from, int nargs)
+{
+    const auto it = mTasks.find(id);
+
+    if (it == mTasks.end())
+    {
+        return;
+    }
+
+    auto& task = it->second;
+    task.wait = TASKWAIT_NONE;
+    task.running = TRUE;
+
+    const auto startTime = GetTime();
+    auto nres = 0;
+    const auto status = lua_resume(task.thread, from, nargs, &nres);
+    const auto elapsed = GetTime() - startTime;
+
+    task.running = FALSE;
+    task.resumes++;
+    task.lastResumeTime = elapsed;
+    task.resumeTime += elapsed;
+    mFrameResumes++;
+    mFrameResumeTime += elapsed;
+
+    if (status == LUA_YIELD && !task.cancelled)
+    {
+        Schedule(task, id, nres);
+        lua_pop(task.thread, nres);
+        return;
+    }
+
+    if (status != LUA_YIELD && status != LUA_OK)
+    {
+        luaL_traceback(task.thread, task.thread, lua_tostring(task.thread, -1), 0);
+        VM->PostError(CString::Format("Task %s failed: %s", task.name.c_str(), lua_tostring(task.thread, -1)));
+    }
+
+    Remove(id);
+}
+
+void CTaskScheduler::Schedule(TASK& task, unsigned int id, int nres)
+{
+    auto* const co = task.thread;
+
+    if (nres == 3 && lua_touserdata(co, -3) == &sYieldKey)
+    {
+        task.wait = static_cast<UCHAR>(lua_tointeger(co, -2));
+
+        switch (task.wait)
+        {
+        case TASKWAIT_TIME:
+            PushTimer(mTimers, static_cast<double>(VM->GetRunTime()) + lua_tonumber(co, -1), id);
+            return;
+
+        case TASKWAIT_FRAMES:
+            {
+                const auto frames = lua_tointeger(co, -1);
+                PushTimer(mFrameTimers, static_cast<double>(mFrame + (frames > 1 ? frames : 1)), id);
+            }
+            return;
+
+        case TASKWAIT_EVENT:
+            task.event = lua_tostring(co, -1);
+            mEvents[task.event].push_back(id);
+            mEventWaits++;
+            return;
+        }
+    }
+
+    /* plain coroutine.yield, resume on the next frame */
+    task.wait = TASKWAIT_FRAMES;
+    PushTimer(mFrameTimers, static_cast<double>(mFrame + 1), id);
+}
+
+void CTaskScheduler::Remove(unsigned int id)
+{
+    const auto it = mTasks.find(id);
+
+    if (it == mTasks.end())
+    {
+        return;
+    }
+
+    auto& task = it->second;
+
+    if (task.wait == TASKWAIT_EVENT)
+    {
+        auto& waiting = mEvents[task.event];
+        waiting.erase(std::remove(waiting.begin(), waiting.end(), id), waiting.end());
+        mEventWaits--;
+    }
+    else if (task.wait == TASKWAIT_TIME || task.wait == TASKWAIT_FRAMES)
+    {
+        auto& heap = task.wait == TASKWAIT_TIME ? mTimers : mFrameTimers;
+        heap.erase(std::remove_if(heap.begin(), heap.end(), [id](const TASKTIMER& t) { return t.id == id; }),
+                   heap.end());
+        std::make_heap(heap.begin(), heap.end(), TimerCompare);
+    }
+
+    luaL_unref(mLuaVM, LUA_REGISTRYINDEX, task.ref);
+    mThreads.erase(task.thread);
+    mTasks.erase(it);
+}
+
+void CTaskScheduler::PushTimer(std::vector<TASKTIMER>& heap, double at, unsigned int id)
+{
+    heap.push_back({at, id});
+    std::push_heap(heap.begin(), heap.end(), TimerCompare);
+}
+
+auto CTaskScheduler::FindTimer(const std::vector<TASKTIMER>& heap, unsigned int id) -> double
+{
+    for (const auto& t : heap)
+    {
+        if (t.id == id)
+        {
+            return t.at;
+        }
+    }
+
+    return 0.0;
+}
+
+void CTaskScheduler::PopDue(std::vector<TASKTIMER>& heap, double now, std::vector<unsigned int>& due)
+{
+    while (!heap.empty() && heap.front().at <= now)
+    {
+        std::pop_heap(heap.begin(), heap.end(), TimerCompare);
+        due.push_back(heap.back().id);
+        heap.pop_back();
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "system.h"
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+
+struct lua_State;
+
+enum TASKWAIT
+{
+    TASKWAIT_NONE,
+    TASKWAIT_TIME,
+    TASKWAIT_FRAMES,
+    TASKWAIT_EVENT,
+};
+
+struct TASK
+{
+    lua_State* thread;
+    int ref;
+    UCHAR wait;
+    bool running;
+    bool cancelled;
+    std::string name;
+    std::string event;
+    unsigned int resumes;
+    float resumeTime;
+    float lastResumeTime;
+};
+
+struct TASKTIMER
+{
+    double at;
+    unsigned int id;
+};
+
+/*
+ * Runs Lua coroutines spawned by scripts and wakes them up on timers, frame
+ * counts or named events. Sleeping tasks sit in min-heaps ordered by their
+ * wake-up time, so only the tasks that are due get touched each tick.
+ */
+class CTaskScheduler
+{
+public:
+    CTaskScheduler(lua_State* L);
+    void Release(void);
+
+    auto Spawn(lua_State* L, int nargs) -> unsigned int;
+    void Cancel(unsigned int id);
+    auto IsAlive(unsigned int id) const -> bool;
+    auto IsTask(lua_State* L) const -> bool;
+    auto Signal(lua_State* L, LPCSTR name, int nargs) -> unsigned int;
+    void Update(float runTime);
+    void SaveTasks(lua_State* L) const;
+    void LoadTasks(lua_State* L, int idx);
+
+    auto GetTasks() const -> const std::unordered_map<unsigned int, TASK>& { return mTasks; }
+    auto GetSleepingCount() const -> unsigned int { return static_cast<unsigned int>(mTimers.size()); }
+    auto GetFrameWaitCount() const -> unsigned int { return static_cast<unsigned int>(mFrameTimers.size()); }
+    auto GetEventWaitCount() const -> unsigned int { return mEventWaits; }
+    auto GetFrameResumes() const -> unsigned int { return mFrameResumes; }
+    auto GetFrameResumeTime() const -> float { return mFrameResumeTime; }
+
+    /// Marks values yielded by wait, waitFrames and waitEvent
+    static int sYieldKey;
+
+private:
+    lua_State* mLuaVM;
+    unsigned int mNextId;
+    UINT64 mFrame;
+    float mRunTime;
+    unsigned int mEventWaits;
+    unsigned int mFrameResumes;
+    float mFrameResumeTime;
+
+    std::unordered_map<unsigned int, TASK> mTasks;
+    std::unordered_map<lua_State*, unsigned int> mThreads;
+    std::unordered_map<std::string, std::vector<unsigned int>> mEvents;
+    std::vector<TASKTIMER> mTimers;
+    std::vector<TASKTIMER> mFrameTimers;
+    std::vector<unsigned int> mDue;
+
+    void Resume(unsigned int id, lua_State* from, int nargs);
+    void Schedule(TASK& task, unsigned int id, int nres);
+    void Remove(unsigned int id);
+    static void PushTimer(std::vector<TASKTIMER>& heap, double at, unsigned int id);
+    static void PopDue(std::vector<TASKTIMER>& heap, double now, std::vector<unsigned int>& due);
+    static auto FindTimer(const std::vector<TASKTIMER>& heap, unsigned int id) -> double;
+};
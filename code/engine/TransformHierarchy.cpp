@@ -0,0 +1,271 @@
+#include "StdAfx.h"
+
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+
+CTransformHierarchy::CTransformHierarchy()
+{
+    mNumDead = 0;
+    mNeedsSort = FALSE;
+    mAnyDirty = FALSE;
+}
+
+void CTransformHierarchy::Release()
+{
+    delete this;
+}
+
+auto CTransformHierarchy::Add(const D3DXMATRIX& local) -> unsigned int
+{
+    unsigned int handle;
+
+    if (!mFreeHandles.empty())
+    {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<unsigned int>(mIndex.size());
+        mIndex.push_back(TRANSFORM_NONE);
+    }
+
+    mIndex[handle] = static_cast<unsigned int>(mLocal.size());
+    mLocal.push_back(local);
+    mWorld.push_back(local);
+    mParent.push_back(-1);
+    mHandle.push_back(handle);
+    mDirty.push_back(TRUE);
+
+    return handle;
+}
+
+/*
+ * The slot stays in place until the next Update compacts the arrays. The
+ * children become roots right away, GetWorld treats them as dirty until then.
+ */
+void CTransformHierarchy::Remove(unsigned int handle)
+{
+    const auto index = mIndex[handle];
+
+    mHandle[index] = TRANSFORM_NONE;
+    mIndex[handle] = TRANSFORM_NONE;
+    mFreeHandles.push_back(handle);
+    mNumDead++;
+    mAnyDirty = TRUE;
+}
+
+auto CTransformHierarchy::SetParent(unsigned int handle, unsigned int parent) -> bool
+{
+    const auto index = static_cast<int>(mIndex[handle]);
+    const auto parentIndex = parent == TRANSFORM_NONE ? -1 : static_cast<int>(mIndex[parent]);
+
+    for (auto i = parentIndex; i >= 0; i = GetParentIndex(i))
+    {
+        if (i == index)
+        {
+            return FALSE;
+        }
+    }
+
+    mParent[index] = parentIndex;
+    mDirty[index] = TRUE;
+    mAnyDirty = TRUE;
+
+    if (parentIndex > index)
+    {
+        mNeedsSort = TRUE;
+    }
+
+    return TRUE;
+}
+
+void CTransformHierarchy::SetLocal(unsigned int handle, const D3DXMATRIX& local)
+{
+    const auto index = mIndex[handle];
+
+    mLocal[index] = local;
+    mDirty[index] = TRUE;
+    mAnyDirty = TRUE;
+}
+
+/*
+ * Dirty flags only get pushed down to the children by Update, so a transform
+ * is out of date when any of its ancestors is flagged or lost its parent to
+ * Remove. Those are recomputed from the topmost such one down, the flags stay
+ * for Update to handle the other descendants.
+ */
+auto CTransformHierarchy::GetWorld(unsigned int handle) -> const D3DXMATRIX&
+{
+    const auto index = static_cast<int>(mIndex[handle]);
+    auto top = -1;
+
+    if (!mAnyDirty)
+    {
+        return mWorld[index];
+    }
+
+    mChain.clear();
+
+    for (auto i = index; i >= 0; i = GetParentIndex(i))
+    {
+        if (mDirty[i] || IsOrphan(i))
+        {
+            top = static_cast<int>(mChain.size());
+        }
+
+        mChain.push_back(i);
+    }
+
+    for (auto k = top; k >= 0; k--)
+    {
+        const auto i = mChain[k];
+        const auto parent = GetParentIndex(i);
+
+        if (parent >= 0)
+        {
+            NMatrixMultiply(&mWorld[i], &mLocal[i], &mWorld[parent]);
+        }
+        else
+        {
+            mWorld[i] = mLocal[i];
+        }
+    }
+
+    return mWorld[index];
+}
+
+void CTransformHierarchy::Update()
+{
+    if (mNumDead > 0 || mNeedsSort)
+    {
+        Rebuild();
+    }
+
+    const auto count = mLocal.size();
+
+    // parents come first, so their flag is final by the time the children are reached
+    for (size_t i = 0; i < count; i++)
+    {
+        const auto parent = mParent[i];
+
+        if (parent < 0)
+        {
+            if (mDirty[i])
+            {
+                mWorld[i] = mLocal[i];
+            }
+
+            continue;
+        }
+
+        mDirty[i] |= mDirty[parent];
+
+        if (mDirty[i])
+        {
+            NMatrixMultiply(&mWorld[i], &mLocal[i], &mWorld[parent]);
+        }
+    }
+
+    std::fill(mDirty.begin(), mDirty.end(), static_cast<UCHAR>(FALSE));
+    mAnyDirty = FALSE;
+}
+
+/* Removed transforms don't take part, their children become roots */
+auto CTransformHierarchy::GetParentIndex(int index) const -> int
+{
+    const auto parent = mParent[index];
+    return parent >= 0 && mHandle[parent] != TRANSFORM_NONE ? parent : -1;
+}
+
+/* Had a parent that was removed since the last Update */
+auto CTransformHierarchy::IsOrphan(int index) const -> bool
+{
+    const auto parent = mParent[index];
+    return parent >= 0 && mHandle[parent] == TRANSFORM_NONE;
+}
+
+/*
+ * Drops removed transforms and, when a parent ended up behind one of its
+ * children, sorts the transforms by depth. Both keep the relative order of
+ * the rest, so only reparenting ever moves a subtree.
+ */
+void CTransformHierarchy::Rebuild()
+{
+    const auto count = mLocal.size();
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> depth;
+
+    order.reserve(count - mNumDead);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (mHandle[i] != TRANSFORM_NONE)
+        {
+            order.push_back(static_cast<unsigned int>(i));
+        }
+    }
+
+    if (mNeedsSort)
+    {
+        depth.assign(count, TRANSFORM_NONE);
+
+        for (const auto i : order)
+        {
+            // walk up to the first ancestor with a known depth, then fill the path back in
+            mChain.clear();
+            auto j = static_cast<int>(i);
+
+            while (j >= 0 && depth[j] == TRANSFORM_NONE)
+            {
+                mChain.push_back(j);
+                j = GetParentIndex(j);
+            }
+
+            auto d = j >= 0 ? depth[j] + 1 : 0;
+
+            for (auto k = mChain.size(); k-- > 0; d++)
+            {
+                depth[mChain[k]] = d;
+            }
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&depth](unsigned int a, unsigned int b) { return depth[a] < depth[b]; });
+    }
+
+    std::vector<int> newIndex(count, -1);
+
+    for (size_t k = 0; k < order.size(); k++)
+    {
+        newIndex[order[k]] = static_cast<int>(k);
+    }
+
+    std::vector<D3DXMATRIX> local(order.size());
+    std::vector<D3DXMATRIX> world(order.size());
+    std::vector<int> parent(order.size());
+    std::vector<unsigned int> handle(order.size());
+    std::vector<UCHAR> dirty(order.size());
+
+    for (size_t k = 0; k < order.size(); k++)
+    {
+        const auto i = order[k];
+        const auto p = GetParentIndex(i);
+
+        local[k] = mLocal[i];
+        world[k] = mWorld[i];
+        parent[k] = p >= 0 ? newIndex[p] : -1;
+        handle[k] = mHandle[i];
+        dirty[k] = mDirty[i] || IsOrphan(i);
+        mIndex[handle[k]] = static_cast<unsigned int>(k);
+    }
+
+    mLocal.swap(local);
+    mWorld.swap(world);
+    mParent.swap(parent);
+    mHandle.swap(handle);
+    mDirty.swap(dirty);
+
+    mNumDead = 0;
+    mNeedsSort = FALSE;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "system.h"
+
+#include <d3dx9.h>
+
+#include <vector>
+
+#define TRANSFORMS CEngine::the()->GetTransforms()
+
+#define TRANSFORM_NONE 0xFFFFFFFF
+
+/*
+ * Local and world matrices of every scene node, kept in contiguous arrays
+ * ordered so that parents come before their children. Nodes refer to their
+ * transform through a handle that stays valid while the arrays get reordered.
+ * Setting a local matrix only flags it as dirty; Update recomputes the world
+ * matrices of flagged transforms and their descendants in a single linear
+ * pass once per frame. World matrices read in between are computed along the
+ * parent chain without touching the rest of the hierarchy.
+ */
+class CTransformHierarchy
+{
+public:
+    CTransformHierarchy(void);
+    void Release(void);
+
+    auto Add(const D3DXMATRIX& local) -> unsigned int;
+    void Remove(unsigned int handle);
+
+    /* Refuses to create a cycle, returns FALSE then */
+    auto SetParent(unsigned int handle, unsigned int parent) -> bool;
+
+    /* The references point into the arrays, they're only valid until the next Add or Update */
+    void SetLocal(unsigned int handle, const D3DXMATRIX& local);
+    auto GetLocal(unsigned int handle) const -> const D3DXMATRIX& { return mLocal[mIndex[handle]]; }
+    auto GetWorld(unsigned int handle) -> const D3DXMATRIX&;
+
+    void Update(void);
+
+    auto GetCount() const -> unsigned int { return static_cast<unsigned int>(mLocal.size()) - mNumDead; }
+
+private:
+    // indexed by position, parents first
+    std::vector<D3DXMATRIX> mLocal;
+    std::vector<D3DXMATRIX> mWorld;
+    std::vector<int> mParent;               // -1 for roots
+    std::vector<unsigned int> mHandle;      // TRANSFORM_NONE once removed
+    std::vector<UCHAR> mDirty;
+
+    // indexed by handle
+    std::vector<unsigned int> mIndex;
+    std::vector<unsigned int> mFreeHandles;
+
+    std::vector<int> mChain;
+    unsigned int mNumDead;
+    bool mNeedsSort;                        // a parent ended up after its child
+    bool mAnyDirty;                         // something changed since the last Update
+
+    auto GetParentIndex(int index) const -> int;
+    auto IsOrphan(int index) const -> bool;
+    void Rebuild(void);
+};
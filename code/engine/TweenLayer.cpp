@@ -0,0 +1,242 @@
+#include "stdafx.h"
+
+#include "TweenLayer.h"
+
+#include <algorithm>
+#include <cstring>
+
+/* Values of components without a keyframe yet */
+static const float sDefaultValues[TWEENCOMP_MAX][16] = {
+    {0, 0, 0, 0},
+    {0, 0, 0, 0},
+    {1, 1, 1, 0},
+    {0},
+    {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1},
+};
+
+CTweenLayer::CTweenLayer()
+{
+    Clear();
+}
+
+CTweenLayer::~CTweenLayer()
+{
+    Release();
+}
+
+void CTweenLayer::Release()
+{
+    if (DelRef())
+    {
+        delete this;
+    }
+}
+
+auto CTweenLayer::GetStride(TWEENCOMP comp) -> unsigned int
+{
+    switch (comp)
+    {
+    case TWEENCOMP_PROP:
+        return 1;
+    case TWEENCOMP_MAT:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+void CTweenLayer::Clear()
+{
+    for (auto& track : mTracks)
+    {
+        track.times.clear();
+        track.values.clear();
+        track.cursor = -1;
+    }
+
+    Step(0.0f);
+}
+
+void CTweenLayer::AddKey(TWEENCOMP comp, float time, const float* values)
+{
+    auto& track = mTracks[comp];
+    const auto stride = GetStride(comp);
+    const auto pos = std::upper_bound(track.times.begin(), track.times.end(), time) - track.times.begin();
+
+    track.times.insert(track.times.begin() + pos, time);
+    track.values.insert(track.values.begin() + pos * stride, values, values + stride);
+    track.cursor = -1;
+}
+
+auto CTweenLayer::GetMaxTime() const -> float
+{
+    auto maxTime = -1.0f;
+
+    for (const auto& track : mTracks)
+    {
+        if (!track.times.empty())
+            maxTime = std::max(maxTime, track.times.back());
+    }
+
+    return maxTime;
+}
+
+/*
+ * Index of the last keyframe at or before time, or -1. Tries the keyframe the
+ * previous step found and the one after it before searching the whole track.
+ */
+auto CTweenLayer::Seek(TWEENTRACK& track, float time) -> int
+{
+    const auto count = static_cast<int>(track.times.size());
+    auto cur = track.cursor;
+
+    const auto fits = [&](int i) -> bool
+    {
+        return (i < 0 || track.times[i] <= time) && (i + 1 >= count || track.times[i + 1] > time);
+    };
+
+    if (!fits(cur))
+    {
+        if (cur + 1 < count && fits(cur + 1))
+            cur++;
+        else
+            cur = static_cast<int>(std::upper_bound(track.times.begin(), track.times.end(), time) - track.times.begin()) - 1;
+    }
+
+    track.cursor = cur;
+    return cur;
+}
+
+void CTweenLayer::Evaluate(TWEENCOMP comp, float time, float* out)
+{
+    auto& track = mTracks[comp];
+    const auto stride = GetStride(comp);
+    const auto base = Seek(track, time);
+    const auto goal = base + 1;
+
+    if (base < 0)
+    {
+        memcpy(out, sDefaultValues[comp], stride * sizeof(float));
+        return;
+    }
+
+    const auto* const from = &track.values[base * stride];
+
+    if (goal >= static_cast<int>(track.times.size()))
+    {
+        memcpy(out, from, stride * sizeof(float));
+        return;
+    }
+
+    const auto* const to = &track.values[goal * stride];
+
+    // baked matrices jump to the next keyframe
+    if (comp == TWEENCOMP_MAT)
+    {
+        memcpy(out, to, stride * sizeof(float));
+        return;
+    }
+
+    const auto t = (time - track.times[base]) / (track.times[goal] - track.times[base]);
+
+    for (unsigned int i = 0; i < stride; i++)
+        out[i] = from[i] + (to[i] - from[i]) * t;
+}
+
+void CTweenLayer::Step(float time)
+{
+    Evaluate(TWEENCOMP_POS, time, mPose.pos);
+    Evaluate(TWEENCOMP_ROT, time, mPose.rot);
+    Evaluate(TWEENCOMP_SCALE, time, mPose.scale);
+    Evaluate(TWEENCOMP_PROP, time, &mPose.prop);
+    Evaluate(TWEENCOMP_MAT, time, mPose.mat);
+
+    D3DXMATRIX rot;
+    NMatrixScaling(&mPose.world, mPose.scale.x, mPose.scale.y, mPose.scale.z);
+    NMatrixRotationYawPitchRoll(&rot, mPose.rot.x, mPose.rot.y, mPose.rot.z);
+    NMatrixMultiply(&mPose.world, &mPose.world, &rot);
+    mPose.world._41 += mPose.pos.x;
+    mPose.world._42 += mPose.pos.y;
+    mPose.world._43 += mPose.pos.z;
+}
+
+/*
+ * Layout: version, then per component the number of keyframes followed by
+ * their times and values. Cursors aren't kept, the first step seeks.
+ */
+void CTweenLayer::Save(std::string* out) const
+{
+    const auto write = [out](const void* data, size_t size)
+    {
+        if (size)
+            out->append(static_cast<const char*>(data), size);
+    };
+
+    const int version = TWEENLAYER_VERSION;
+    out->clear();
+    write(&version, sizeof(version));
+
+    for (const auto& track : mTracks)
+    {
+        const auto count = static_cast<int>(track.times.size());
+        write(&count, sizeof(count));
+        write(track.times.data(), track.times.size() * sizeof(float));
+        write(track.values.data(), track.values.size() * sizeof(float));
+    }
+}
+
+auto CTweenLayer::Load(const char* data, size_t size) -> bool
+{
+    size_t pos = 0;
+    int version;
+
+    const auto read = [&](void* value, size_t count) -> bool
+    {
+        if (size - pos < count)
+            return FALSE;
+
+        if (count)
+            memcpy(value, data + pos, count);
+
+        pos += count;
+        return TRUE;
+    };
+
+    Clear();
+
+    if (!read(&version, sizeof(version)) || version != TWEENLAYER_VERSION)
+        return FALSE;
+
+    for (auto comp = 0; comp < TWEENCOMP_MAX; comp++)
+    {
+        auto& track = mTracks[comp];
+        const auto stride = GetStride(static_cast<TWEENCOMP>(comp));
+        int count;
+
+        if (!read(&count, sizeof(count)) || count < 0 || static_cast<size_t>(count) > (size - pos) / sizeof(float))
+        {
+            Clear();
+            return FALSE;
+        }
+
+        track.times.resize(count);
+        track.values.resize(count * stride);
+
+        if (!read(track.times.data(), count * sizeof(float))
+            || !read(track.values.data(), count * stride * sizeof(float))
+            || !std::is_sorted(track.times.begin(), track.times.end()))
+        {
+            Clear();
+            return FALSE;
+        }
+    }
+
+    if (pos != size)
+    {
+        Clear();
+        return FALSE;
+    }
+
+    Step(0.0f);
+    return TRUE;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "system.h"
+#include "ReferenceManager.h"
+
+#include <string>
+#include <vector>
+
+// first value written by Save
+#define TWEENLAYER_VERSION 1
+
+enum TWEENCOMP
+{
+    TWEENCOMP_POS,
+    TWEENCOMP_ROT,
+    TWEENCOMP_SCALE,
+    TWEENCOMP_PROP,
+    TWEENCOMP_MAT,
+    TWEENCOMP_MAX
+};
+
+/* Keyframes of a single pose component, sorted by time */
+struct TWEENTRACK
+{
+    std::vector<float> times;
+    std::vector<float> values;  // GetStride(comp) floats per keyframe
+    int cursor;                 // last keyframe at or before the previous step, -1 before the first
+};
+
+struct TWEENPOSE
+{
+    D3DXVECTOR4 pos;
+    D3DXVECTOR4 rot;            // yaw, pitch and roll
+    D3DXVECTOR4 scale;
+    float prop;
+    D3DXMATRIX mat;             // baked matrix, taken over as is
+    D3DXMATRIX world;           // scale * rotation * translation
+};
+
+/*
+ * Keyframed pose backing a layer of libs/tween. Every component has its own
+ * track, a keyframe only adds to the tracks of the components it sets. Step
+ * interpolates each track between the last keyframe at or before the time and
+ * the next one and writes the pose it owns. The tracks remember where the
+ * previous step ended up, so playing forward finds the keyframes in constant
+ * time and only jumps fall back to a binary search.
+ */
+class CTweenLayer : public CReferenceCounter, CAllocable<CTweenLayer>, NoCopyAssign
+{
+public:
+    CTweenLayer();
+    ~CTweenLayer();
+
+    void Release();
+
+    /* values holds GetStride(comp) floats, keyframes at the same time keep the order they were added in */
+    void AddKey(TWEENCOMP comp, float time, const float* values);
+    void Clear();
+
+    void Step(float time);
+    auto GetPose() const -> const TWEENPOSE& { return mPose; }
+
+    auto GetNumKeys(TWEENCOMP comp) const -> unsigned int { return static_cast<unsigned int>(mTracks[comp].times.size()); }
+    auto GetMaxTime() const -> float;
+
+    static auto GetStride(TWEENCOMP comp) -> unsigned int;
+
+    /* Flattens the tracks into a byte string, Load restores them */
+    void Save(std::string* out) const;
+    auto Load(const char* data, size_t size) -> bool;
+
+private:
+    TWEENTRACK mTracks[TWEENCOMP_MAX];
+    TWEENPOSE mPose;
+
+    static auto Seek(TWEENTRACK& track, float time) -> int;
+    void Evaluate(TWEENCOMP comp, float time, float* out);
+};
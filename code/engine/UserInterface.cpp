@@ -12,6 +12,8 @@
 #include "VM.h"
 #include "ReferenceManager.h"
 #include "ProfileManager.h"
+#include "LuaAllocator.h"
+#include "TaskScheduler.h"
 
 constexpr SSIZE_T sFramerateMaxSamples = 30;
 
@@ -180,6 +182,81 @@ public:
 
             ImGui::Text("Min Time: %f ms", GetMinMS());
             ImGui::Text("Max Time: %f ms", GetMaxMS());
+
+            const auto allocator = VM->GetAllocator();
+
+            if (allocator && ImGui::CollapsingHeader("Lua heap"))
+            {
+                ImGui::Columns(4, "luaheap");
+                ImGui::Text("Class");
+                ImGui::NextColumn();
+                ImGui::Text("Used");
+                ImGui::NextColumn();
+                ImGui::Text("Peak");
+                ImGui::NextColumn();
+                ImGui::Text("Pages");
+                ImGui::NextColumn();
+                ImGui::Separator();
+
+                for (unsigned int i = 0; i < LUAALLOC_NUM_CLASSES; i++)
+                {
+                    const auto stats = allocator->GetClassStats(i);
+                    ImGui::Text("%zu B", stats.blockSize);
+                    ImGui::NextColumn();
+                    ImGui::Text("%zu", stats.used);
+                    ImGui::NextColumn();
+                    ImGui::Text("%zu", stats.peak);
+                    ImGui::NextColumn();
+                    ImGui::Text("%zu", stats.pages);
+                    ImGui::NextColumn();
+                }
+
+                const auto large = allocator->GetLargeStats();
+                ImGui::Text("Large");
+                ImGui::NextColumn();
+                ImGui::Text("%zu", large.used);
+                ImGui::NextColumn();
+                ImGui::Text("%zu", large.peak);
+                ImGui::NextColumn();
+                ImGui::Text("%llu KB", large.bytes / 1024);
+                ImGui::NextColumn();
+
+                ImGui::Columns(1);
+            }
+
+            const auto scheduler = VM->GetScheduler();
+
+            if (scheduler && ImGui::CollapsingHeader("Tasks"))
+            {
+                ImGui::Text("Tasks: %zu (sleeping %u, frames %u, events %u)", scheduler->GetTasks().size(),
+                            scheduler->GetSleepingCount(), scheduler->GetFrameWaitCount(),
+                            scheduler->GetEventWaitCount());
+                ImGui::Text("Resumed: %u (%f ms)", scheduler->GetFrameResumes(),
+                            scheduler->GetFrameResumeTime() * 1000.0f);
+
+                ImGui::Columns(3, "tasks");
+                ImGui::Text("Task");
+                ImGui::NextColumn();
+                ImGui::Text("Resumes");
+                ImGui::NextColumn();
+                ImGui::Text("Last / Avg");
+                ImGui::NextColumn();
+                ImGui::Separator();
+
+                for (const auto& it : scheduler->GetTasks())
+                {
+                    const auto& task = it.second;
+                    ImGui::Text("%s", task.name.c_str());
+                    ImGui::NextColumn();
+                    ImGui::Text("%u", task.resumes);
+                    ImGui::NextColumn();
+                    ImGui::Text("%.3f / %.3f ms", task.lastResumeTime * 1000.0f,
+                                task.resumes ? task.resumeTime * 1000.0f / task.resumes : 0.0f);
+                    ImGui::NextColumn();
+                }
+
+                ImGui::Columns(1);
+            }
         }
         ImGui::End();
     }
@@ -423,6 +500,12 @@ void CUserInterface::DebugPanel(void) const
         if (ImGui::Button("Restart VM"))
             VM->Restart();
 
+        if (ImGui::Button("Snapshot"))
+            VM->SaveSnapshot();
+
+        if (ImGui::Button("Resume Snapshot"))
+            VM->ResumeSnapshot();
+
         if (ImGui::Button("Pause VM"))
             VM->Pause();
 
@@ -432,6 +515,13 @@ void CUserInterface::DebugPanel(void) const
         ImGui::Separator();
         ImGui::Text("LUA: %s", FormatBytes(gMemUsedLua).Str());
         ImGui::Separator();
+        {
+            static LPCSTR gcKinds[] = {"AUTO", "INC", "GEN"};
+            const auto gc = VM->GetGCStats();
+            ImGui::Text("GC %s: %.3f ms (%u steps, -%s)", gcKinds[gc.kind], gc.pauseTime, gc.steps,
+                        FormatBytes(gc.bytesFreed).Str());
+        }
+        ImGui::Separator();
         ImGui::Text("TOTAL: %s", FormatBytes(static_cast<INT64>(gMemUsed) + gMemUsedLua).Str());
         ImGui::Separator();
         ImGui::Text("PEAK: %s", FormatBytes(gMemPeak).Str());
@@ -9,6 +9,13 @@
 #include "Renderer.h"
 
 #include "LuaBindings.h"
+#include "ScriptCache.h"
+#include "LuaAllocator.h"
+#include "ResourceCache.h"
+#include "TaskScheduler.h"
+#include "Snapshot.h"
+#include "Serializer.h"
+#include "CallbackMonitor.h"
 
 #include "ReferenceManager.h"
 
@@ -16,13 +23,31 @@
 #include <lua/lstate.h>
 #include <cstdio>
 
+#define GC_DEFAULT_BUDGET   2.0F    /* ms per frame */
+#define GC_DEFAULT_STEPSIZE 16      /* KB per step */
+
 CVirtualMachine::CVirtualMachine()
 {
     mPlayKind = PLAYKIND_STOPPED;
     mMainScript = nullptr;
     mLuaVM = nullptr;
+    mAllocator = nullptr;
+    mScheduler = nullptr;
+    mSnapshot = nullptr;
+    mSerializer = nullptr;
+    mMonitor = nullptr;
+    mResumeSnapshot = FALSE;
     mScheduledTermination = FALSE;
     mRunTime = 0.0F;
+
+    mGCKind = GCKIND_INCREMENTAL;
+    mGCBudget = GC_DEFAULT_BUDGET;
+    mGCStepSize = GC_DEFAULT_STEPSIZE;
+    mGCLastLive = 0;
+    ZeroMemory(&mGCStats, sizeof(GCSTATS));
+    mGCStarted = FALSE;
+    mGCCatchUp = FALSE;
+    mGCMinorTime = mGCCycleTime = mGCLastCycleTime = 0.0F;
 }
 
 void CVirtualMachine::Release()
@@ -30,6 +55,25 @@ void CVirtualMachine::Release()
     FILESYSTEM->FreeResource(mMainScript);
     mMainScript = nullptr;
     DestroyVM();
+
+    // Snapshots survive restarts only
+    if (mScheduledTermination < 2 && mSnapshot != nullptr)
+    {
+        mSnapshot->Release();
+        SAFE_DELETE(mSnapshot);
+    }
+
+    if (mSerializer != nullptr)
+    {
+        mSerializer->Release();
+        SAFE_DELETE(mSerializer);
+    }
+
+    if (mMonitor != nullptr)
+    {
+        mMonitor->Release();
+        SAFE_DELETE(mMonitor);
+    }
 }
 
 /// States
@@ -70,9 +114,17 @@ void CVirtualMachine::Play()
     mMainScript = static_cast<UCHAR*>(f.data);
 
     mPlayKind = PLAYKIND_PLAYING;
+    const auto resume = mResumeSnapshot;
     InitVM();
 
-    Init();
+    if (!resume)
+    {
+        Init();
+    }
+
+    // loading is over, from now on garbage is collected in idle time
+    mGCStarted = TRUE;
+    ApplyGCMode();
 }
 
 void CVirtualMachine::Pause()
@@ -109,6 +161,21 @@ void CVirtualMachine::Restart()
     mScheduledTermination = 2;
 }
 
+/*
+ * Restarts the VM from the last whole-state snapshot instead of running the
+ * main script and _init again.
+ */
+void CVirtualMachine::ResumeSnapshot()
+{
+    if (mSnapshot == nullptr || mSnapshot->IsEmpty() || !mSnapshot->IsState())
+    {
+        return;
+    }
+
+    Restart();
+    mScheduledTermination = 3;
+}
+
 /// Events
 void CVirtualMachine::Init()
 {
@@ -131,7 +198,7 @@ void CVirtualMachine::Init()
         return;
     }
 
-    const auto r = lua_pcall(mLuaVM, 0, 0, 0);
+    const auto r = Call("_init", 0, FALSE);
     CheckVMErrors(r);
 }
 
@@ -149,7 +216,7 @@ void CVirtualMachine::Destroy()
         return;
     }
 
-    const auto r = lua_pcall(mLuaVM, 0, 0, 0);
+    const auto r = Call("_destroy", 0, FALSE);
     CheckVMErrors(r);
 }
 
@@ -163,9 +230,10 @@ void CVirtualMachine::Update(float dt)
 
         mScheduledTermination = FALSE;
 
-        if (term == 2)
+        if (term >= 2)
         {
             /* Restart was requested */
+            mResumeSnapshot = term == 3;
             Play();
         }
 
@@ -186,7 +254,7 @@ void CVirtualMachine::Update(float dt)
 
     lua_pushnumber(mLuaVM, dt);
 
-    const auto r = lua_pcall(mLuaVM, 1, 0, 0);
+    const auto r = Call("_update", 1);
     CheckVMErrors(r);
 
     PassTime(dt);
@@ -206,7 +274,7 @@ void CVirtualMachine::Render()
         return;
     }
 
-    const auto r = lua_pcall(mLuaVM, 0, 0, 0);
+    const auto r = Call("_render", 0);
     CheckVMErrors(r);
 }
 
@@ -224,7 +292,7 @@ void CVirtualMachine::Render2D()
         return;
     }
 
-    const auto r = lua_pcall(mLuaVM, 0, 0, 0);
+    const auto r = Call("_render2d", 0);
     CheckVMErrors(r);
 }
 
@@ -235,6 +303,11 @@ void CVirtualMachine::Resize(RECT res)
         return;
     }
 
+    lua_pushnumber(mLuaVM, res.right);
+    lua_pushnumber(mLuaVM, res.bottom);
+    mScheduler->Signal(mLuaVM, "resize", 2);
+    lua_pop(mLuaVM, 2);
+
     lua_getglobal(mLuaVM, "_resizeScreen");
 
     if (!lua_isfunction(mLuaVM, -1))
@@ -245,10 +318,22 @@ void CVirtualMachine::Resize(RECT res)
     lua_pushnumber(mLuaVM, res.right);
     lua_pushnumber(mLuaVM, res.bottom);
 
-    const auto r = lua_pcall(mLuaVM, 2, 0, 0);
+    const auto r = Call("_resizeScreen", 2);
     CheckVMErrors(r);
 }
 
+void CVirtualMachine::UpdateTasks()
+{
+    if ((mLuaVM == nullptr) || mPlayKind != PLAYKIND_PLAYING)
+    {
+        return;
+    }
+
+    BeginCallback("tasks");
+    mScheduler->Update(mRunTime);
+    EndCallback();
+}
+
 void CVirtualMachine::CharInput(DWORD key)
 {
     if ((mLuaVM == nullptr) || mPlayKind != PLAYKIND_PLAYING)
@@ -266,10 +351,22 @@ void CVirtualMachine::CharInput(DWORD key)
     CHAR buf[2] = {static_cast<CHAR>(key), 0};
     lua_pushstring(mLuaVM, buf);
 
-    const auto r = lua_pcall(mLuaVM, 1, 0, 0);
+    const auto r = Call("_charInput", 1);
     CheckVMErrors(r);
 }
 
+/*
+ * Runs the function below its nargs arguments on the stack as the named
+ * callback, timed and, unless told otherwise, held to the callback budget.
+ */
+auto CVirtualMachine::Call(LPCSTR name, int nargs, bool budgeted) -> int
+{
+    BeginCallback(name, budgeted);
+    const auto r = lua_pcall(mLuaVM, nargs, 0, 0);
+    EndCallback();
+    return r;
+}
+
 static const luaL_Reg loadedlibs[] = {
     {"_G", luaopen_base},
     {LUA_LOADLIBNAME, luaopen_package},
@@ -313,13 +410,32 @@ static auto neon_luapanic(lua_State* L) -> int
 
 void CVirtualMachine::InitVM()
 {
-    mLuaVM = luaL_newstate();
-    if (mLuaVM == nullptr)
+    mAllocator = new CLuaAllocator();
+    mLuaVM = lua_newstate(&CLuaAllocator::Alloc, mAllocator);
+    if (mLuaVM != nullptr)
     {
         lua_atpanic(mLuaVM, &neon_luapanic);
     }
 
+    mGCLastLive = 0;
+    mGCStarted = FALSE;
+    mGCCatchUp = FALSE;
+    mGCMinorTime = mGCCycleTime = mGCLastCycleTime = 0.0F;
+    ApplyGCMode();
+
+    if (mMonitor == nullptr)
+    {
+        mMonitor = new CCallbackMonitor();
+    }
+
+    // the budget outlives restarts, the hook has to be set on each new state
+    mMonitor->InstallHook(mLuaVM);
+
+    mScheduler = new CTaskScheduler(mLuaVM);
+
     _lua_openlibs(mLuaVM);
+    CScriptCache::InstallSearcher(mLuaVM);
+    CScriptCache::ResetStats();
 
     /// Bindings
     CLuaBindings::BindBase(mLuaVM);
@@ -327,9 +443,18 @@ void CVirtualMachine::InitVM()
     CLuaBindings::BindRenderer(mLuaVM);
     CLuaBindings::BindInput(mLuaVM);
     CLuaBindings::BindAudio(mLuaVM);
+    CSnapshot::BuildPermanents(mLuaVM);
+
+    if (mResumeSnapshot)
+    {
+        mResumeSnapshot = FALSE;
+        RestoreState();
+        return;
+    }
 
     // Load script
-    auto result = luaL_loadstring(mLuaVM, (const char*)mMainScript);
+    const auto* const script = reinterpret_cast<LPCSTR>(mMainScript);
+    auto result = CScriptCache::LoadBuffer(mLuaVM, script, strlen(script), "@" RESOURCE_SCRIPT);
     CheckVMErrors(result, TRUE);
 
     result = lua_pcall(mLuaVM, 0, 0, 0);
@@ -337,6 +462,10 @@ void CVirtualMachine::InitVM()
     {
         return;
     }
+
+    const auto stats = CScriptCache::GetStats();
+    PushLog(CString::Format("Script cache: %u hits, %u misses, %f ms spent loading\n",
+                            stats.hits, stats.misses, stats.loadTime * 1000.0F).Str());
 }
 
 void CVirtualMachine::DestroyVM()
@@ -346,8 +475,375 @@ void CVirtualMachine::DestroyVM()
         return;
     }
 
+    mScheduler->Release();
+    SAFE_DELETE(mScheduler);
+
     lua_close(mLuaVM);
     mLuaVM = nullptr;
+    SAFE_DELETE(mAllocator);
+
+    // Keep loaded assets around if we're only restarting
+    RESOURCES->EndSession(mScheduledTermination >= 2);
+}
+
+/// Snapshots
+void CVirtualMachine::SaveSnapshot()
+{
+    if (mLuaVM == nullptr)
+    {
+        return;
+    }
+
+    if (!SaveSnapshot(mLuaVM, 0))
+    {
+        PostError(CString::Format("Snapshot failed: %s", lua_tostring(mLuaVM, -1)));
+        lua_pop(mLuaVM, 1);
+    }
+}
+
+/*
+ * Persists the value at idx, or the whole state when idx is 0. On failure the
+ * error message is left on top of the stack.
+ */
+auto CVirtualMachine::SaveSnapshot(lua_State* L, int idx) -> bool
+{
+    if (mSnapshot == nullptr)
+    {
+        mSnapshot = new CSnapshot();
+    }
+
+    const auto isState = idx == 0;
+
+    if (isState)
+    {
+        PushState(L);
+        idx = lua_gettop(L);
+    }
+
+    const auto ok = mSnapshot->Save(L, idx, isState);
+
+    if (isState)
+    {
+        lua_remove(L, idx);
+    }
+
+    if (ok)
+    {
+        PushLog(CString::Format("Snapshot: %u bytes, %u engine objects, %f ms\n", static_cast<unsigned int>(mSnapshot->GetSize()),
+                                mSnapshot->GetObjectCount(), mSnapshot->GetSaveTime()).Str());
+    }
+
+    return ok;
+}
+
+/*
+ * Pushes the value stored by a non-state snapshot, or the error message.
+ */
+auto CVirtualMachine::LoadSnapshot(lua_State* L) -> bool
+{
+    if (mSnapshot == nullptr)
+    {
+        lua_pushliteral(L, "no snapshot was taken");
+        return FALSE;
+    }
+
+    return mSnapshot->Load(L);
+}
+
+/*
+ * Shared by Serialize and Deserialize, created on first use. Its buffer keeps
+ * its capacity from one call to the next.
+ */
+auto CVirtualMachine::GetSerializer() -> CSerializer*
+{
+    if (mSerializer == nullptr)
+    {
+        mSerializer = new CSerializer();
+    }
+
+    return mSerializer;
+}
+
+/// Callback budgets
+void CVirtualMachine::SetCallbackBudget(float ms, float abortMs, UINT64 instructions)
+{
+    if (mMonitor != nullptr)
+    {
+        mMonitor->SetBudget(mLuaVM, ms, abortMs, instructions);
+    }
+}
+
+/*
+ * Native code that runs on behalf of scripts, such as plugin updates, can
+ * time itself through these as well. Calls nest, only the outermost one is
+ * held to the budget.
+ */
+void CVirtualMachine::BeginCallback(LPCSTR name, bool budgeted)
+{
+    if (mMonitor != nullptr)
+    {
+        mMonitor->Begin(name, budgeted);
+    }
+}
+
+void CVirtualMachine::EndCallback()
+{
+    if (mMonitor != nullptr)
+    {
+        mMonitor->End();
+    }
+}
+
+/*
+ * Builds the root persisted for whole-state snapshots: the globals, modules
+ * loaded by scripts, parked tasks and the run time. Everything the libraries
+ * and bindings set up is left out, the new state already has it.
+ */
+void CVirtualMachine::PushState(lua_State* L) const
+{
+    lua_createtable(L, 0, 4);
+    const auto root = lua_gettop(L);
+
+    lua_pushglobaltable(L);
+    lua_setfield(L, root, "globals");
+
+    lua_newtable(L);
+    luaL_getsubtable(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+    lua_pushnil(L);
+
+    while (lua_next(L, root + 2) != 0)
+    {
+        if (lua_type(L, -2) == LUA_TSTRING && strcmp(lua_tostring(L, -2), LUA_GNAME) != 0 &&
+            !CSnapshot::IsPermanent(L, -1))
+        {
+            lua_pushvalue(L, -2);
+            lua_insert(L, -2);
+            lua_rawset(L, root + 1);
+            continue;
+        }
+
+        lua_pop(L, 1);
+    }
+
+    lua_pop(L, 1);
+    lua_setfield(L, root, "loaded");
+
+    mScheduler->SaveTasks(L);
+    lua_setfield(L, root, "tasks");
+
+    lua_pushnumber(L, mRunTime);
+    lua_setfield(L, root, "runTime");
+}
+
+void CVirtualMachine::RestoreState()
+{
+    if (!mSnapshot->Load(mLuaVM))
+    {
+        PrintVMError();
+        lua_pop(mLuaVM, 1);
+        return;
+    }
+
+    const auto root = lua_gettop(mLuaVM);
+
+    lua_getfield(mLuaVM, root, "globals");
+    lua_rawseti(mLuaVM, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+
+    luaL_getsubtable(mLuaVM, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+    lua_pushglobaltable(mLuaVM);
+    lua_setfield(mLuaVM, root + 1, LUA_GNAME);
+
+    lua_getfield(mLuaVM, root, "loaded");
+    lua_pushnil(mLuaVM);
+
+    while (lua_next(mLuaVM, root + 2) != 0)
+    {
+        lua_pushvalue(mLuaVM, -2);
+        lua_insert(mLuaVM, -2);
+        lua_rawset(mLuaVM, root + 1);
+    }
+
+    lua_settop(mLuaVM, root);
+
+    lua_getfield(mLuaVM, root, "runTime");
+    mRunTime = static_cast<float>(lua_tonumber(mLuaVM, -1));
+    lua_pop(mLuaVM, 1);
+
+    lua_getfield(mLuaVM, root, "tasks");
+    mScheduler->LoadTasks(mLuaVM, -1);
+    lua_settop(mLuaVM, root - 1);
+
+    PushLog(CString::Format("Snapshot resumed in %f ms\n", mSnapshot->GetLoadTime()).Str());
+}
+
+/// Garbage collection
+void CVirtualMachine::SetGCMode(UCHAR kind)
+{
+    if (kind > GCKIND_GENERATIONAL)
+    {
+        return;
+    }
+
+    mGCKind = kind;
+    mGCCatchUp = FALSE;
+    ApplyGCMode();
+}
+
+void CVirtualMachine::SetGCBudget(float ms, int stepSize)
+{
+    mGCBudget = fmaxf(ms, 0.0F);
+
+    if (stepSize > 0)
+    {
+        mGCStepSize = stepSize;
+    }
+}
+
+void CVirtualMachine::ApplyGCMode() const
+{
+    if (mLuaVM == nullptr)
+    {
+        return;
+    }
+
+    switch (mGCKind)
+    {
+    case GCKIND_AUTO:
+        lua_gc(mLuaVM, LUA_GCINC, 0, 0, 0);
+        lua_gc(mLuaVM, LUA_GCRESTART);
+        break;
+
+    case GCKIND_INCREMENTAL:
+        lua_gc(mLuaVM, LUA_GCINC, 0, 0, 0);
+        lua_gc(mLuaVM, mGCStarted ? LUA_GCSTOP : LUA_GCRESTART);
+        break;
+
+    case GCKIND_GENERATIONAL:
+        lua_gc(mLuaVM, LUA_GCGEN, 0, 0);
+        lua_gc(mLuaVM, mGCStarted ? LUA_GCSTOP : LUA_GCRESTART);
+        break;
+    }
+}
+
+/*
+ * Incremental steps until the budget is used up or the cycle finishes, which
+ * is reported by returning TRUE. A collector that fell behind gets at least
+ * one step even without any idle time.
+ */
+auto CVirtualMachine::StepGC(float budget, bool behind) -> bool
+{
+    const auto startTime = GetTime();
+
+    while (GetTime() - startTime < budget || (behind && mGCStats.steps == 0))
+    {
+        mGCStats.steps++;
+
+        if (lua_gc(mLuaVM, LUA_GCSTEP, mGCStepSize) != 0)
+        {
+            mGCStats.cycles++;
+            mGCLastLive = gettotalbytes(mLuaVM->l_G);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/*
+ * Runs the collector in the time left over after the frame was rendered.
+ * Automatic collection is stopped in both modes once the game is initialized,
+ * so this is the only place garbage gets reclaimed, and no step is started
+ * once the idle time or the per-frame budget ran out.
+ *
+ * Once the heap grows past twice the size of the last finished cycle the
+ * collector is behind; it then spends the whole per-frame budget even when
+ * the frame left no idle time, so the cycle still finishes within a few
+ * frames without a full stop-the-world collection.
+ *
+ * The generational mode runs one minor collection per frame when the last
+ * one fit into the budget. Minor collections never free old objects, so when
+ * the heap doubles it finishes an incremental cycle instead of a major
+ * collection and goes back to generational mode in a frame whose budget
+ * covers the time that cycle took, as re-entering marks the whole heap.
+ */
+void CVirtualMachine::CollectGarbage(float idleTime)
+{
+    mGCStats.kind = mGCKind;
+    mGCStats.pauseTime = 0.0F;
+    mGCStats.bytesFreed = 0;
+    mGCStats.steps = 0;
+    mGCStats.cycles = 0;
+
+    if (mLuaVM == nullptr)
+    {
+        mGCStats.liveBytes = 0;
+        return;
+    }
+
+    const auto g = mLuaVM->l_G;
+    const UINT64 before = gettotalbytes(g);
+
+    if (mGCKind != GCKIND_AUTO)
+    {
+        const auto behind = mGCLastLive > 0 && before > mGCLastLive * 2;
+        const auto budget = behind ? mGCBudget / 1000.0F : fminf(fmaxf(idleTime, 0.0F), mGCBudget / 1000.0F);
+        const auto startTime = GetTime();
+
+        if (mGCKind == GCKIND_GENERATIONAL && !mGCCatchUp && behind)
+        {
+            lua_gc(mLuaVM, LUA_GCINC, 0, 0, 0);
+            mGCCatchUp = TRUE;
+            mGCCycleTime = mGCLastCycleTime = 0.0F;
+        }
+        else if (mGCCatchUp && !behind && mGCLastCycleTime > 0.0F && mGCLastCycleTime <= budget)
+        {
+            /* re-entering marks the whole heap, that's all for this frame */
+            lua_gc(mLuaVM, LUA_GCGEN, 0, 0);
+            mGCCatchUp = FALSE;
+            mGCMinorTime = 0.0F;
+        }
+
+        if (mGCKind == GCKIND_GENERATIONAL && !mGCCatchUp)
+        {
+            if (mGCStats.steps == 0 && mGCMinorTime <= budget && GetTime() - startTime < budget)
+            {
+                /* each step performs a full minor collection */
+                mGCStats.steps++;
+                lua_gc(mLuaVM, LUA_GCSTEP, 0);
+                mGCMinorTime = GetTime() - startTime;
+            }
+            else
+            {
+                // a slow minor collection shouldn't keep the following ones out for good
+                mGCMinorTime *= 0.5F;
+            }
+        }
+        else
+        {
+            const auto finished = StepGC(budget, behind);
+
+            if (mGCCatchUp)
+            {
+                mGCCycleTime += GetTime() - startTime;
+
+                if (finished)
+                {
+                    mGCLastCycleTime = mGCCycleTime;
+                    mGCCycleTime = 0.0F;
+                }
+            }
+        }
+
+        mGCStats.pauseTime = (GetTime() - startTime) * 1000.0F;
+
+        if (mGCLastLive == 0)
+        {
+            mGCLastLive = gettotalbytes(g);
+        }
+    }
+
+    mGCStats.liveBytes = gettotalbytes(g);
+    mGCStats.bytesFreed = before > mGCStats.liveBytes ? static_cast<INT64>(before - mGCStats.liveBytes) : 0;
 }
 
 void CVirtualMachine::PrintVMError() const
@@ -364,8 +860,6 @@ void CVirtualMachine::PrintVMError() const
 
 auto CVirtualMachine::CheckVMErrors(int result, bool canFail) -> bool
 {
-    gMemUsedLua = mLuaVM->l_G->totalbytes;
-
     if (result != LUA_OK)
     {
         PrintVMError();
@@ -11,7 +11,29 @@ enum PLAYKIND
     PLAYKIND_PAUSED,
 };
 
+enum GCKIND
+{
+    GCKIND_AUTO,
+    GCKIND_INCREMENTAL,
+    GCKIND_GENERATIONAL,
+};
+
+struct GCSTATS
+{
+    UCHAR kind;
+    float pauseTime;
+    INT64 bytesFreed;
+    UINT64 liveBytes;
+    unsigned int steps;
+    unsigned int cycles;
+};
+
 struct lua_State;
+class CLuaAllocator;
+class CTaskScheduler;
+class CSnapshot;
+class CSerializer;
+class CCallbackMonitor;
 
 class ENGINE_API CVirtualMachine
 {
@@ -24,6 +46,7 @@ public:
     void Pause(void);
     void Stop(void);
     void Restart(void);
+    void ResumeSnapshot(void);
 
     /// Events
     void Init(void);
@@ -33,6 +56,7 @@ public:
     void Render2D(void);
     void CharInput(DWORD key);
     void Resize(RECT res);
+    void UpdateTasks(void);
 
     inline auto CheckVMErrors(int, bool canFail = FALSE) -> bool;
     inline void PostError(LPCSTR err);
@@ -40,14 +64,61 @@ public:
     auto GetRunTime() const -> float { return mRunTime; }
     void PassTime(float dt) { mRunTime += dt; }
     auto GetStatus() const -> UCHAR { return mPlayKind; }
+
+    /// Garbage collection
+    void SetGCMode(UCHAR kind);
+    void SetGCBudget(float ms, int stepSize = 0);
+    void CollectGarbage(float idleTime);
+    auto GetGCMode() const -> UCHAR { return mGCKind; }
+    auto GetGCBudget() const -> float { return mGCBudget; }
+    auto GetGCStats() const -> GCSTATS { return mGCStats; }
+    auto GetAllocator() const -> const CLuaAllocator* { return mAllocator; }
+    auto GetScheduler() const -> CTaskScheduler* { return mScheduler; }
+
+    /// Snapshots
+    void SaveSnapshot(void);
+    auto SaveSnapshot(lua_State* L, int idx) -> bool;
+    auto LoadSnapshot(lua_State* L) -> bool;
+    auto GetSnapshot() const -> const CSnapshot* { return mSnapshot; }
+
+    /// Save data
+    auto GetSerializer() -> CSerializer*;
+
+    /// Callback budgets
+    void SetCallbackBudget(float ms, float abortMs = 0.0F, UINT64 instructions = 0);
+    void BeginCallback(LPCSTR name, bool budgeted = TRUE);
+    void EndCallback(void);
+    auto GetCallbackMonitor() const -> CCallbackMonitor* { return mMonitor; }
 private:
     UCHAR mPlayKind;
     UCHAR mScheduledTermination;
     UCHAR* mMainScript;
     lua_State* mLuaVM;
+    CLuaAllocator* mAllocator;
+    CTaskScheduler* mScheduler;
+    CSnapshot* mSnapshot;
+    CSerializer* mSerializer;
+    CCallbackMonitor* mMonitor;
+    bool mResumeSnapshot;
     float mRunTime;
 
+    UCHAR mGCKind;
+    float mGCBudget;
+    int mGCStepSize;
+    UINT64 mGCLastLive;
+    GCSTATS mGCStats;
+    bool mGCStarted;        // collector stays automatic until _init returned
+    bool mGCCatchUp;        // generational mode is finishing an incremental cycle, see CollectGarbage
+    float mGCMinorTime;     // seconds the last minor collection took
+    float mGCCycleTime;     // seconds spent on the current catch-up cycle
+    float mGCLastCycleTime; // seconds the last finished catch-up cycle took
+
     void InitVM(void);
+    auto StepGC(float budget, bool behind) -> bool;
+    auto Call(LPCSTR name, int nargs, bool budgeted = TRUE) -> int;
+    void ApplyGCMode(void) const;
     void DestroyVM(void);
+    void PushState(lua_State* L) const;
+    void RestoreState(void);
     inline void PrintVMError() const;
 };
@@ -22,18 +22,11 @@ auto b64_encoded_size(size_t inlen) -> size_t
     return ret;
 }
 
-auto b64_encode(const unsigned char* in, size_t len) -> char*
+auto b64_encodeto(const unsigned char* in, size_t len, char* out) -> void
 {
     size_t i;
     size_t j;
 
-    if (in == nullptr || len == 0)
-        return nullptr;
-
-    size_t elen = b64_encoded_size(len);
-    char* out = static_cast<char*>(neon_malloc(elen + 1));
-    out[elen] = '\0';
-
     for (i = 0, j = 0; i < len; i += 3, j += 4)
     {
         size_t v = in[i];
@@ -59,11 +52,21 @@ auto b64_encode(const unsigned char* in, size_t len) -> char*
             out[j + 3] = '=';
         }
     }
+}
 
+auto b64_encode(const unsigned char* in, size_t len) -> char*
+{
+    if (in == nullptr || len == 0)
+        return nullptr;
+
+    size_t elen = b64_encoded_size(len);
+    char* out = static_cast<char*>(neon_malloc(elen + 1));
+    out[elen] = '\0';
+
+    b64_encodeto(in, len, out);
     return out;
 }
 
-
 auto b64_decoded_size(const char* in) -> size_t
 {
     if (in == nullptr)
@@ -118,6 +121,12 @@ auto b64_decode(const char* in, unsigned char* out, size_t outlen) -> int
         {
             return 0;
         }
+
+        // padding only ends the string
+        if (in[i] == '=' && (i + 2 < len || in[len - 1] != '='))
+        {
+            return 0;
+        }
     }
 
     for (i = 0, j = 0; i < len; i += 4, j += 3)
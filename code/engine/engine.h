@@ -6,7 +6,11 @@ class CFileSystem;
 class CVirtualMachine;
 class CUserInterface;
 class CAudioSystem;
+class CResourceCache;
 class CProfiler;
+class CJobPool;
+class CTransformHierarchy;
+class CNameTable;
 
 #define ENGINE CEngine::the()
 
@@ -32,6 +36,10 @@ public:
     CVirtualMachine* GetVM() const { return mVirtualMachine; }
     CUserInterface* GetUI() const { return mDebugUI; }
     CAudioSystem* GetAudioSystem() const { return mAudioSystem; }
+    CResourceCache* GetResourceCache() const { return mResourceCache; }
+    CJobPool* GetJobPool() const { return mJobPool; }
+    CTransformHierarchy* GetTransforms() const { return mTransforms; }
+    CNameTable* GetNames() const { return mNames; }
 
     bool IsRunning() const { return mIsRunning; }
 
@@ -57,6 +65,8 @@ public:
             mRenderProfiler = nullptr;
             mRender2DProfiler = nullptr;
             mWindowProfiler = nullptr;
+            mGCProfiler = nullptr;
+            mTaskProfiler = nullptr;
         }
 
         void UpdateProfilers(float dt);
@@ -84,6 +94,8 @@ public:
         CProfiler* mRenderProfiler;
         CProfiler* mRender2DProfiler;
         CProfiler* mWindowProfiler;
+        CProfiler* mGCProfiler;
+        CProfiler* mTaskProfiler;
     } DefaultProfiling;
 
 protected:
@@ -93,6 +105,10 @@ protected:
     CVirtualMachine* mVirtualMachine;
     CUserInterface* mDebugUI;
     CAudioSystem* mAudioSystem;
+    CResourceCache* mResourceCache;
+    CJobPool* mJobPool;
+    CTransformHierarchy* mTransforms;
+    CNameTable* mNames;
 
     void Update(float deltaTime) const;
     void Render() const;
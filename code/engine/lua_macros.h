@@ -26,26 +26,23 @@
 	lua_pushcfunction(L, FUNC); \
 	lua_setfield(L, -2, NAME);
 
-#define LUAS(CLASS, L_CLASS, NAME, FIELD) \
+#define LUAS(CLASS, LC_CLASS, NAME, FIELD) \
 static int NAME(lua_State* L) {\
-	CLASS* x = (CLASS*)luaL_checkudata(L, 1, L_CLASS); \
+	CLASS* x = (CLASS*)luaH_checkudata(L, 1, LC_CLASS); \
 	if (lua_gettop(L) == 2) x->FIELD = (float)luaL_checknumber(L, 2); \
 	lua_pushnumber(L, x->FIELD); \
 	return 1; }
 
 #define LUAP(L, M, T, O) \
 	do { \
-		T** wptr = (T**)lua_newuserdata(L, sizeof(T*)); \
-		*wptr = O; \
-		(*wptr)->AddRef(); \
-		luaL_setmetatable(L, M); \
+		luaH_pushproxy<T>(L, M, O); \
 	} while (0);
 
 #define LUAPT(L, M, T, O) \
 	do { \
 		T* wptr = (T*)lua_newuserdata(L, sizeof(T)); \
 		*wptr = *O; \
-		luaL_setmetatable(L, M); \
+		luaH_setclass(L, M); \
 	} while (0);
 
 #define L_MATRIX "Matrix"
@@ -62,6 +59,37 @@ static int NAME(lua_State* L) {\
 #define L_FONT "Font"
 #define L_SOUND "Sound"
 #define L_MUSIC "Music"
+#define L_BUFFER "Buffer"
+#define L_COLLISIONMESH "CollisionMesh"
+#define L_COLLISIONWORLD "CollisionWorld"
+#define L_ENTITYWORLD "EntityWorld"
+#define L_TWEENLAYER "TweenLayer"
+
+/* Type tags of the classes above, their metatables are cached per tag so the
+ * userdata checks compare pointers instead of looking names up in the registry */
+enum LuaClass
+{
+	LC_MATRIX,
+	LC_VECTOR,
+	LC_VERTEX,
+	LC_MATERIAL,
+	LC_FACEGROUP,
+	LC_MESH,
+	LC_SCENE,
+	LC_NODE,
+	LC_EFFECT,
+	LC_RENDERTARGET,
+	LC_LIGHT,
+	LC_FONT,
+	LC_SOUND,
+	LC_MUSIC,
+	LC_BUFFER,
+	LC_COLLISIONMESH,
+	LC_COLLISIONWORLD,
+	LC_ENTITYWORLD,
+	LC_TWEENLAYER,
+	LC_MAX
+};
 
 #define ENDF {0,0}
 
@@ -69,9 +97,9 @@ struct lua_State;
 struct D3DXVECTOR4;
 
 ENGINE_API extern auto vector4_ctor(lua_State* L) -> D3DXVECTOR4*;
-ENGINE_API extern auto luaH_getcomps(lua_State* L, unsigned int offset = 0) -> D3DXVECTOR4;
-ENGINE_API extern auto luaH_getcolor(lua_State* L) -> DWORD;
-ENGINE_API extern auto luaH_getcolorlinear(lua_State* L, unsigned int offset = 0) -> struct _D3DCOLORVALUE;
+ENGINE_API extern auto luaH_getcomps(lua_State* L, int idx = 2, int* next = nullptr) -> D3DXVECTOR4;
+ENGINE_API extern auto luaH_getcolor(lua_State* L, int idx = 1, int* next = nullptr) -> DWORD;
+ENGINE_API extern auto luaH_getcolorlinear(lua_State* L, int idx = 1) -> struct _D3DCOLORVALUE;
 
 ENGINE_API extern auto matrix_new(lua_State* L) -> int;
 ENGINE_API extern auto effect_new(lua_State* L) -> int;
@@ -86,3 +114,7 @@ ENGINE_API extern auto rtt_new(lua_State* L) -> int;
 ENGINE_API extern auto scene_new(lua_State* L) -> int;
 ENGINE_API extern auto vector4_new(lua_State* L) -> int;
 ENGINE_API extern auto vertex_new(lua_State* L) -> int;
+ENGINE_API extern auto collisionmesh_new(lua_State* L) -> int;
+ENGINE_API extern auto collisionworld_new(lua_State* L) -> int;
+ENGINE_API extern auto entityworld_new(lua_State* L) -> int;
+ENGINE_API extern auto tweenlayer_new(lua_State* L) -> int;
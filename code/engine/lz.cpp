@@ -0,0 +1,165 @@
+#include "StdAfx.h"
+#include "system.h"
+
+#include <cstring>
+
+/*
+ * Small LZ77 block codec in the spirit of LZ4. A block is a run of sequences,
+ * each a token byte holding the literal count in the high and the match length
+ * in the low nibble, the literals, a 16-bit offset back into the output and
+ * the match. Counts of 15 go on in extra bytes of up to 255 each. The last
+ * sequence only has literals. Nothing here allocates, so it's safe to use off
+ * the main thread.
+ */
+#define LZ_HASH_BITS 14
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 0xFFFF
+
+static auto lz_hash(const unsigned char* p) -> unsigned int
+{
+    unsigned int seq;
+    memcpy(&seq, p, sizeof(seq));
+    return (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static auto lz_putcount(unsigned char* out, size_t op, size_t count) -> size_t
+{
+    while (count >= 255)
+    {
+        out[op++] = 255;
+        count -= 255;
+    }
+
+    out[op++] = static_cast<unsigned char>(count);
+    return op;
+}
+
+static auto lz_getcount(const unsigned char* in, size_t len, size_t* ip, size_t limit, size_t* count) -> int
+{
+    unsigned char b;
+
+    do
+    {
+        if (*ip >= len)
+            return 0;
+
+        b = in[(*ip)++];
+        *count += b;
+
+        if (*count > limit)
+            return 0;
+    } while (b == 255);
+
+    return 1;
+}
+
+static auto lz_putsequence(unsigned char* out, size_t op, const unsigned char* lits, size_t numLits, size_t offset, size_t matchLen) -> size_t
+{
+    const auto extra = matchLen ? matchLen - LZ_MIN_MATCH : 0;
+    out[op++] = static_cast<unsigned char>((numLits < 15 ? numLits : 15) << 4 | (extra < 15 ? extra : 15));
+
+    if (numLits >= 15)
+        op = lz_putcount(out, op, numLits - 15);
+
+    memcpy(out + op, lits, numLits);
+    op += numLits;
+
+    if (!matchLen)
+        return op;
+
+    out[op++] = static_cast<unsigned char>(offset & 0xFF);
+    out[op++] = static_cast<unsigned char>(offset >> 8);
+
+    if (extra >= 15)
+        op = lz_putcount(out, op, extra - 15);
+
+    return op;
+}
+
+auto lz_compressbound(size_t len) -> size_t
+{
+    return len + len / 255 + 16;
+}
+
+auto lz_compress(const unsigned char* in, size_t len, unsigned char* out) -> size_t
+{
+    unsigned int table[1 << LZ_HASH_BITS] = {};
+    size_t ip = 0;
+    size_t anchor = 0;
+    size_t op = 0;
+
+    while (ip + LZ_MIN_MATCH <= len)
+    {
+        const auto h = lz_hash(in + ip);
+        const size_t cand = table[h];
+        table[h] = static_cast<unsigned int>(ip);
+
+        if (cand >= ip || ip - cand > LZ_MAX_OFFSET || memcmp(in + cand, in + ip, LZ_MIN_MATCH) != 0)
+        {
+            ip++;
+            continue;
+        }
+
+        size_t matchLen = LZ_MIN_MATCH;
+
+        while (ip + matchLen < len && in[cand + matchLen] == in[ip + matchLen])
+            matchLen++;
+
+        op = lz_putsequence(out, op, in + anchor, ip - anchor, ip - cand, matchLen);
+        ip += matchLen;
+        anchor = ip;
+    }
+
+    return lz_putsequence(out, op, in + anchor, len - anchor, 0, 0);
+}
+
+auto lz_decompress(const unsigned char* in, size_t len, unsigned char* out, size_t outlen) -> int
+{
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < len)
+    {
+        const auto token = in[ip++];
+        size_t numLits = token >> 4;
+
+        if (numLits == 15 && !lz_getcount(in, len, &ip, outlen, &numLits))
+            return 0;
+
+        if (numLits > len - ip || numLits > outlen - op)
+            return 0;
+
+        memcpy(out + op, in + ip, numLits);
+        ip += numLits;
+        op += numLits;
+
+        // the last sequence ends with its literals
+        if (ip == len)
+            break;
+
+        if (len - ip < 2)
+            return 0;
+
+        const size_t offset = in[ip] | in[ip + 1] << 8;
+        ip += 2;
+
+        if (offset == 0 || offset > op)
+            return 0;
+
+        size_t matchLen = token & 15;
+
+        if (matchLen == 15 && !lz_getcount(in, len, &ip, outlen, &matchLen))
+            return 0;
+
+        matchLen += LZ_MIN_MATCH;
+
+        if (matchLen > outlen - op)
+            return 0;
+
+        // byte by byte, matches may overlap what they produce
+        for (size_t i = 0; i < matchLen; i++, op++)
+            out[op] = out[op - offset];
+    }
+
+    return op == outlen;
+}
@@ -41,6 +41,14 @@ extern void PushLog(LPCSTR msg, bool noHist = FALSE);
 
 extern auto b64_decode(const char* in, unsigned char* out, size_t outlen) -> int;
 extern auto b64_encode(const unsigned char* in, size_t len) -> char*;
+extern auto b64_decoded_size(const char* in) -> size_t;
+extern auto b64_encoded_size(size_t inlen) -> size_t;
+/* writes the b64_encoded_size(len) characters of in to out without a terminator, safe off the main thread */
+extern auto b64_encodeto(const unsigned char* in, size_t len, char* out) -> void;
+
+extern auto lz_compressbound(size_t len) -> size_t;
+extern auto lz_compress(const unsigned char* in, size_t len, unsigned char* out) -> size_t;
+extern auto lz_decompress(const unsigned char* in, size_t len, unsigned char* out, size_t outlen) -> int;
 
 /// zpl
 #include "zpl_macros.h"
@@ -151,6 +159,27 @@ public:
 
     void Clear() { mCount = 0; }
 
+    /* grows the storage in one go, new elements are left uninitialized */
+    auto Resize(unsigned int count) -> HRESULT
+    {
+        if (!mData || count > mCapacity)
+        {
+            const auto capacity = count > mCapacity ? count : mCapacity;
+            auto* const data = static_cast<T*>(neon_realloc(mData, capacity * sizeof(T)));
+
+            if (!data)
+            {
+                return E_OUTOFMEMORY;
+            }
+
+            mData = data;
+            mCapacity = capacity;
+        }
+
+        mCount = count;
+        return ERROR_SUCCESS;
+    }
+
     auto GetCount() const -> unsigned int { return mCount; }
     auto GetCapacity() const -> unsigned int { return mCapacity; }
 
@@ -647,8 +647,10 @@ ne_srv_cleanup:
 }
 
 static INT ne_update(lua_State* L) {
+    VM->BeginCallback("network");
     if (server) ne_server_update(L);
     if (client) ne_client_update(L);
+    VM->EndCallback();
     lua_pushnumber(L, 1);
     return 1;
 }
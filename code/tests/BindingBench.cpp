@@ -0,0 +1,159 @@
+/*
+ * Times Lua calls into C++ bindings taking six arguments, read once the way
+ * LuaGet used to, pulling each argument off the bottom of the stack with
+ * lua_remove, and once by index through LuaArgs. A few of the engine's own
+ * math bindings are timed as well. Links against the engine and Lua DLLs, so
+ * build the solution first and run it from the output directory:
+ *
+ *   cl /std:c++17 /O2 /EHsc /I..\engine /I..\deps BindingBench.cpp
+ *      /link /LIBPATH:..\..\Build\Release engine.lib lua.lib
+ */
+
+#include "StdAfx.h"
+
+#include "RenderData.h"
+#include "LuaBindings.h"
+
+#include <lua/lua.hpp>
+
+class CMaterial;
+class CFaceGroup;
+class CMesh;
+class CScene;
+class CNode;
+class CEffect;
+class CRenderTarget;
+class CLight;
+class CFont;
+class CSound;
+class CMusic;
+class CCollisionMesh;
+class CCollisionWorld;
+class CEntityWorld;
+class CTweenLayer;
+
+#include "LuaWrapper.h"
+
+#include <chrono>
+#include <cstdio>
+
+#define BENCH_CALLS 2000000
+#define BENCH_RUNS 5
+
+/* What LuaGet did: read the first argument, then shift the rest down */
+template <typename T>
+static auto ShiftGet(lua_State* L) -> T
+{
+    T val;
+
+    if constexpr (std::is_same_v<T, float>)
+        val = static_cast<float>(luaL_checknumber(L, 1));
+    else if constexpr (std::is_same_v<T, DWORD>)
+        val = static_cast<DWORD>(luaL_checkinteger(L, 1));
+    else
+        val = lua_toboolean(L, 1) != 0;
+
+    lua_remove(L, 1);
+    return val;
+}
+
+/* Same arguments as DrawQuad */
+static auto quad_shift(lua_State* L) -> int
+{
+    const auto x1 = ShiftGet<float>(L);
+    const auto x2 = ShiftGet<float>(L);
+    const auto y1 = ShiftGet<float>(L);
+    const auto y2 = ShiftGet<float>(L);
+    const auto color = ShiftGet<DWORD>(L);
+    const auto flip = ShiftGet<bool>(L);
+
+    lua_pushnumber(L, x1 + x2 + y1 + y2 + color + flip);
+    return 1;
+}
+
+static auto quad_args(lua_State* L) -> int
+{
+    const auto [x1, x2, y1, y2, color, flip] = LuaArgs<float, float, float, float, DWORD, bool>(L).Read();
+
+    lua_pushnumber(L, x1 + x2 + y1 + y2 + color + flip);
+    return 1;
+}
+
+static auto noop(lua_State* L) -> int
+{
+    (void)L;
+    return 0;
+}
+
+/* Each loop calls a binding BENCH_CALLS times, the argument setup is part of the cost */
+static const char* const gScript = R"lua(
+local calls = ...
+local a, b, out = Vector3(1, 2, 3), Vector3(4, 5, 6), Vector()
+local m = Matrix():translate(1, 2, 3)
+assert(quad_shift(1, 2, 3, 4, 0xFF00FF, true) == quad_args(1, 2, 3, 4, 0xFF00FF, true))
+return {
+    {"noop(6 args)", function() for i = 1, calls do noop(1.0, 2.0, 3.0, 4.0, 0xFF00FF, true) end end},
+    {"lua_remove reader", function() for i = 1, calls do quad_shift(1.0, 2.0, 3.0, 4.0, 0xFF00FF, true) end end},
+    {"LuaArgs reader", function() for i = 1, calls do quad_args(1.0, 2.0, 3.0, 4.0, 0xFF00FF, true) end end},
+    {"Color(r, g, b, a)", function() for i = 1, calls do Color(255, 128, 0, 255) end end},
+    {"Vector.add(out, a, b)", function() for i = 1, calls do Vector.add(out, a, b) end end},
+    {"Vector.transform(out, a, m)", function() for i = 1, calls do Vector.transform(out, a, m) end end},
+    {"v:x()", function() for i = 1, calls do a:x() end end},
+}
+)lua";
+
+int main()
+{
+    auto* const L = luaL_newstate();
+    luaL_openlibs(L);
+    CLuaBindings::BindMath(L);
+    lua_register(L, "quad_shift", quad_shift);
+    lua_register(L, "quad_args", quad_args);
+    lua_register(L, "noop", noop);
+
+    if (luaL_loadstring(L, gScript) != LUA_OK)
+    {
+        printf("%s\n", lua_tostring(L, -1));
+        return 1;
+    }
+
+    lua_pushinteger(L, BENCH_CALLS);
+
+    if (lua_pcall(L, 1, 1, 0) != LUA_OK)
+    {
+        printf("%s\n", lua_tostring(L, -1));
+        return 1;
+    }
+
+    const auto count = static_cast<int>(luaL_len(L, -1));
+
+    for (auto i = 1; i <= count; i++)
+    {
+        lua_rawgeti(L, -1, i);
+        lua_rawgeti(L, -1, 1);
+        const auto* const name = lua_tostring(L, -1);
+        auto best = 1e9;
+
+        for (auto run = 0; run < BENCH_RUNS; run++)
+        {
+            lua_rawgeti(L, -2, 2);
+            const auto start = std::chrono::steady_clock::now();
+
+            if (lua_pcall(L, 0, 0, 0) != LUA_OK)
+            {
+                printf("%s\n", lua_tostring(L, -1));
+                return 1;
+            }
+
+            const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            const auto ns = elapsed.count() / BENCH_CALLS;
+            best = ns < best ? ns : best;
+        }
+
+        printf("%-28s %8.1f ns/call\n", name, best);
+        lua_pop(L, 2);
+    }
+
+    lua_close(L);
+    return 0;
+}
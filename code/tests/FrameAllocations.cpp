@@ -0,0 +1,167 @@
+/*
+ * Counts the Lua allocations one frame of the local player makes, running the
+ * real data/tank.lua, data/player.lua and libs/collisions against the engine's
+ * Vector, Matrix and collision bindings. Models, sounds, lights, materials and
+ * the draw calls are stubbed out in Lua, so the counts only cover what the
+ * scripts and bindings allocate. Links against the engine and Lua DLLs, so
+ * build the solution first and run it from the output directory with the
+ * repository root as argument:
+ *
+ *   cl /std:c++17 /O2 /EHsc /I..\engine /I..\deps FrameAllocations.cpp
+ *      /link /LIBPATH:..\..\Build\Release engine.lib lua.lib
+ *   FrameAllocations.exe ..\..
+ */
+
+#include "StdAfx.h"
+
+#include "LuaBindings.h"
+
+#include <lua/lua.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+
+#define COUNT_FRAMES 120
+
+static UINT64 gAllocations = 0;
+
+/* The stock allocator, counting every new block */
+static auto CountingAlloc(void* ud, void* ptr, size_t osize, size_t nsize) -> void*
+{
+    (void)ud;
+    (void)osize;
+
+    if (nsize == 0)
+    {
+        free(ptr);
+        return nullptr;
+    }
+
+    if (ptr == nullptr)
+    {
+        gAllocations++;
+    }
+
+    return realloc(ptr, nsize);
+}
+
+static auto GetAllocations(lua_State* L) -> int
+{
+    lua_pushinteger(L, static_cast<lua_Integer>(gAllocations));
+    return 1;
+}
+
+static const char* const gScript = R"(
+local root, frames = ...
+package.path = root .. "/data/?.lua;" .. root .. "/libs/?/init.lua;" .. root .. "/libs/?/?.lua;" .. package.path
+
+-- engine objects the scripts only configure or draw with
+local function stub()
+    return setmetatable({}, {__index = function() return function(self) return self end end})
+end
+
+Model, Sound, Light, Material = stub, stub, stub, stub
+function playSFX() end
+function BindTexture() end
+function ToggleWireframe() end
+function CullMode() end
+function AmbientColor() end
+function DrawPolygon() end
+function LogString() end
+function getTime() return 0 end
+function GetCursorMode() return 0 end
+function GetMouseDelta() return {0, 0} end
+function GetMouse() return false end
+function GetKey(key) return key == "w" or key == "a" end
+CURSORMODE_CENTERED, MOUSE_RIGHT_BUTTON, KEY_SHIFT = 1, 2, 16
+
+hh = require "helpers".global()
+cols = require "collisions"
+WORLD_SIZE, WORLD_TILES = 256, {4, 4}
+state = {is = function() return true end}
+nativedll = {send = function() end}
+time = 0
+tanks = {}
+
+-- a few sloped triangles the tank keeps running into
+math.randomseed(3)
+local tris = {}
+for i = 1, 40 do
+    local c = Vector3(math.random() * 600, math.random() * 10, math.random() * 600)
+    table.insert(tris, {c, c + Vector3(80, 0, 0), c + Vector3(0, 20, 80)})
+end
+
+local mesh = cols.newTriangleMesh(tris)
+world = {colsys = cols.newWorld()}
+for i = 1, 4 do
+    world.colsys:addInstance(mesh, Matrix():translate(Vector3(i, 0, 0)))
+end
+
+Tank = require "tank"
+Player = require "player"
+
+local player = Player()
+local dt = 1 / 60
+
+local function frame(draw)
+    time = time + dt
+    player:update(dt)
+    player.tank:update(dt)
+    if draw then
+        player:draw()
+    end
+end
+
+local function count(n, fn)
+    local start = allocs()
+    for i = 1, n do
+        fn()
+    end
+    return (allocs() - start) / n
+end
+
+-- fill the trail first, it only grows for the first frames
+for i = 1, 200 do
+    frame(true)
+end
+
+collectgarbage("stop")
+local update = count(frames, function() frame(false) end)
+local withDraw = count(frames, function() frame(true) end)
+
+local pos, move = Vector3(100, 5, 100), Vector3(0.1, 0, 0)
+local hits = #mesh:testSphere(pos, 50, move, function() return 1 end)
+local testSphere = count(frames, function() mesh:testSphere(pos, 50, move, function() end) end)
+collectgarbage("restart")
+
+print(string.format("update          %8.1f allocations/frame", update))
+print(string.format("update and draw %8.1f allocations/frame", withDraw))
+print(string.format("testSphere      %8.1f allocations/call, %d contacts", testSphere, hits))
+)";
+
+int main(int argc, char** argv)
+{
+    auto* const L = lua_newstate(&CountingAlloc, nullptr);
+    luaL_openlibs(L);
+    CLuaBindings::BindMath(L);
+    CLuaBindings::BindRenderer(L);
+    lua_register(L, "allocs", &GetAllocations);
+
+    if (luaL_loadstring(L, gScript) != LUA_OK)
+    {
+        printf("%s\n", lua_tostring(L, -1));
+        return 1;
+    }
+
+    lua_pushstring(L, argc > 1 ? argv[1] : ".");
+    lua_pushinteger(L, COUNT_FRAMES);
+
+    if (lua_pcall(L, 2, 0, 0) != LUA_OK)
+    {
+        printf("%s\n", lua_tostring(L, -1));
+        return 1;
+    }
+
+    lua_close(L);
+    return 0;
+}
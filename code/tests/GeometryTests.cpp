@@ -0,0 +1,180 @@
+/*
+ * Checks the copy on write between cloned face groups: every editing call
+ * gives the clone its own geometry and leaves the source's untouched, while
+ * reads, including the GetVertexData node:getVertices uses, and building
+ * already built geometry keep sharing it. Links against the engine and Lua
+ * DLLs, so build the solution first and run it from the output directory:
+ *
+ *   cl /std:c++17 /O2 /EHsc /MD /I..\engine /I..\deps /I..\deps\d3d9\include GeometryTests.cpp
+ *      ..\engine\NameTable.cpp ..\engine\TransformHierarchy.cpp /link /LIBPATH:..\..\Build\Release
+ *      /LIBPATH:..\deps\d3d9 engine.lib lua.lib d3d9.lib d3dx9.lib user32.lib
+ *
+ * The Build checks need a D3D9 device and are skipped without one.
+ */
+
+#include "TestEngine.h"
+
+#include "FaceGroup.h"
+
+static auto MakeTriangle() -> CFaceGroup*
+{
+    auto* const fg = new CFaceGroup();
+    VERTEX v;
+
+    ZeroMemory(&v, sizeof(VERTEX));
+    v.color = 0xFFFFFFFF;
+
+    for (auto i = 0; i < 3; i++)
+    {
+        v.x = static_cast<float>(i);
+        v.y = static_cast<float>(i * 2);
+        fg->AddVertex(v);
+        fg->AddIndex(static_cast<short>(i));
+    }
+
+    return fg;
+}
+
+/* Still holds the triangle MakeTriangle made */
+static auto IsTriangle(const CFaceGroup* fg) -> bool
+{
+    if (fg->GetNumVertices() != 3 || fg->GetNumIndices() != 3)
+    {
+        return FALSE;
+    }
+
+    for (auto i = 0; i < 3; i++)
+    {
+        if (fg->GetVertexData()[i].x != static_cast<float>(i) || fg->GetIndexData()[i] != i)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void TestShare(CFaceGroup* src)
+{
+    auto* const clone = src->Clone();
+
+    CHECK(src->IsShared());
+    CHECK(clone->IsShared());
+    CHECK(clone->GetVertexData() == src->GetVertexData());
+    CHECK(clone->GetIndexData() == src->GetIndexData());
+
+    // reading doesn't copy
+    CHECK(clone->GetNumVertices() == 3);
+    CHECK(clone->GetVertexData()[2].y == 4.0F);
+    CHECK(clone->IsShared());
+
+    clone->Release();
+    CHECK(!src->IsShared());
+}
+
+/* Runs one editing call on a fresh clone, the clone must end up with a copy and the source unchanged */
+template <typename F>
+static void TestDetach(CFaceGroup* src, const char* name, F edit)
+{
+    auto* const clone = src->Clone();
+    edit(clone);
+
+    // CHECK would only give the line in here
+    if (clone->IsShared() || src->IsShared() || clone->GetVertexData() == src->GetVertexData() || !IsTriangle(src))
+    {
+        printf("%s: the clone still shares the geometry or the source changed\n", name);
+        gFailures++;
+    }
+
+    clone->Release();
+}
+
+static void TestWrites(CFaceGroup* src)
+{
+    VERTEX v;
+    ZeroMemory(&v, sizeof(VERTEX));
+    v.x = 9.0F;
+
+    TestDetach(src, "AddVertex", [&](CFaceGroup* fg) { fg->AddVertex(v); });
+    TestDetach(src, "AddIndex", [](CFaceGroup* fg) { fg->AddIndex(1); });
+    TestDetach(src, "SetNumVertices", [](CFaceGroup* fg) { fg->SetNumVertices(1); });
+    TestDetach(src, "SetNumIndices", [](CFaceGroup* fg) { fg->SetNumIndices(0); });
+    TestDetach(src, "MarkDirty", [](CFaceGroup* fg) { fg->MarkDirty(); });
+    TestDetach(src, "GetVertices", [](CFaceGroup* fg) { fg->GetVertices()[0].x = 9.0F; });
+    TestDetach(src, "GetIndices", [](CFaceGroup* fg) { fg->GetIndices()[0] = 2; });
+
+    // the copy starts out with the source's data
+    auto* const clone = src->Clone();
+    clone->GetVertices()[1].x = 9.0F;
+
+    CHECK(clone->GetNumVertices() == 3 && clone->GetNumIndices() == 3);
+    CHECK(clone->GetVertexData()[0].x == 0.0F && clone->GetVertexData()[1].x == 9.0F);
+    CHECK(clone->GetIndexData()[2] == 2);
+    CHECK(IsTriangle(src));
+
+    clone->Release();
+}
+
+/* The clone outlives the face group it came from */
+static void TestOrphan()
+{
+    auto* const src = MakeTriangle();
+    auto* const clone = src->Clone();
+
+    src->Release();
+
+    CHECK(!clone->IsShared());
+    CHECK(IsTriangle(clone));
+
+    clone->Release();
+}
+
+/* Building the clone of a built face group picks up the mesh instead of building another */
+static void TestBuild(CFaceGroup* src)
+{
+    src->Build();
+
+    auto* const clone = src->Clone();
+    clone->Build();
+
+    CHECK(clone->IsShared());
+    CHECK(clone->GetVertexData() == src->GetVertexData());
+    CHECK(IsTriangle(src));
+    CHECK(memcmp(clone->GetBounds(), src->GetBounds(), sizeof(D3DXVECTOR4) * 2) == 0);
+
+    // the source rebuilding after the clone detached doesn't touch the clone's copy
+    clone->MarkDirty();
+    clone->GetVertices()[0].x = -5.0F;
+    clone->Build();
+    src->Build();
+
+    CHECK(!src->IsShared());
+    CHECK(IsTriangle(src));
+    CHECK(clone->GetVertexData()[0].x == -5.0F);
+    CHECK(clone->GetBounds()[0].x == -5.0F);
+    CHECK(src->GetBounds()[0].x == 0.0F);
+
+    clone->Release();
+}
+
+int main()
+{
+    auto* const engine = new CTestEngine();
+    auto* const src = MakeTriangle();
+
+    TestShare(src);
+    TestWrites(src);
+    TestOrphan();
+
+    if (engine->CreateRenderer())
+    {
+        TestBuild(src);
+    }
+    else
+    {
+        printf("no device, skipped the Build checks\n");
+    }
+
+    src->Release();
+    return Report();
+}
@@ -0,0 +1,248 @@
+/*
+ * Moves a tenth of a 10k node hierarchy every frame and then reads every world
+ * matrix, the way a frame updates and draws the scene. Runs once with the
+ * per node transform caching CNode had before CTransformHierarchy and once
+ * with the hierarchy, on a random tree with 100 roots and on 100 chains that
+ * are 100 nodes deep. Builds against TransformHierarchy.cpp directly:
+ *
+ *   cl /std:c++17 /O2 /EHsc /I..\engine /I..\deps /I..\deps\d3d9\include HierarchyBench.cpp
+ *      ..\engine\TransformHierarchy.cpp /link /LIBPATH:..\deps\d3d9 d3dx9.lib
+ */
+
+#include "StdAfx.h"
+
+#include "TransformHierarchy.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#define BENCH_NODES 10000
+#define BENCH_ROOTS 100
+#define BENCH_FRAMES 200
+// nodes moved per frame
+#define BENCH_MOVES (BENCH_NODES / 10)
+
+/*
+ * What CNode did: every node keeps its own matrices on the heap, a move
+ * invalidates the whole subtree and a read recomputes along the parent chain.
+ */
+class COldNode
+{
+public:
+    COldNode(const D3DXMATRIX& local)
+    {
+        mParent = nullptr;
+        mTransform = new D3DXMATRIX(local);
+        mCachedTransform = new D3DXMATRIX();
+        mIsTransformDirty = TRUE;
+    }
+
+    ~COldNode()
+    {
+        delete mTransform;
+        delete mCachedTransform;
+    }
+
+    void AddNode(COldNode* node)
+    {
+        node->mParent = this;
+        mNodes.push_back(node);
+    }
+
+    void SetTransform(const D3DXMATRIX& transform)
+    {
+        *mTransform = transform;
+        InvalidateTransformRecursively();
+    }
+
+    auto GetFinalTransform() -> D3DXMATRIX
+    {
+        if (!mIsTransformDirty)
+            return *mCachedTransform;
+
+        if (mParent == nullptr)
+            return *mTransform;
+
+        *mCachedTransform = *mTransform * mParent->GetFinalTransform();
+        mIsTransformDirty = FALSE;
+        return *mCachedTransform;
+    }
+
+private:
+    std::vector<COldNode*> mNodes;
+    COldNode* mParent;
+    D3DXMATRIX* mTransform;
+    D3DXMATRIX* mCachedTransform;
+    bool mIsTransformDirty;
+
+    void InvalidateTransformRecursively()
+    {
+        mIsTransformDirty = TRUE;
+
+        for (auto* node : mNodes)
+            node->InvalidateTransformRecursively();
+    }
+};
+
+struct BENCHSCENE
+{
+    std::vector<int> parents;                   // -1 for roots
+    std::vector<D3DXMATRIX> locals;
+    std::vector<std::vector<int>> moves;        // nodes moved in each frame
+    std::vector<std::vector<D3DXMATRIX>> moveTo;
+};
+
+/* A small rotation and an offset, so long chains stay in range */
+static auto RandomLocal(std::mt19937& rng) -> D3DXMATRIX
+{
+    std::uniform_real_distribution<float> dist(-1.0F, 1.0F);
+    D3DXMATRIX m;
+
+    D3DXMatrixRotationYawPitchRoll(&m, dist(rng) * 0.1F, dist(rng) * 0.1F, dist(rng) * 0.1F);
+    m._41 = dist(rng);
+    m._42 = dist(rng);
+    m._43 = dist(rng);
+    return m;
+}
+
+static void MakeMoves(BENCHSCENE* scene, std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> pick(0, BENCH_NODES - 1);
+
+    scene->locals.resize(BENCH_NODES);
+    scene->moves.resize(BENCH_FRAMES);
+    scene->moveTo.resize(BENCH_FRAMES);
+
+    for (auto& local : scene->locals)
+        local = RandomLocal(rng);
+
+    for (auto frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        for (auto i = 0; i < BENCH_MOVES; i++)
+        {
+            scene->moves[frame].push_back(pick(rng));
+            scene->moveTo[frame].push_back(RandomLocal(rng));
+        }
+    }
+}
+
+/* Every node past the roots hangs off a random earlier node */
+static auto MakeRandomTree() -> BENCHSCENE
+{
+    BENCHSCENE scene;
+    std::mt19937 rng(1);
+
+    for (auto i = 0; i < BENCH_NODES; i++)
+        scene.parents.push_back(i < BENCH_ROOTS ? -1 : std::uniform_int_distribution<int>(0, i - 1)(rng));
+
+    MakeMoves(&scene, rng);
+    return scene;
+}
+
+/* Node i hangs off node i - BENCH_ROOTS, a move near the top dirties a long chain */
+static auto MakeChains() -> BENCHSCENE
+{
+    BENCHSCENE scene;
+    std::mt19937 rng(2);
+
+    for (auto i = 0; i < BENCH_NODES; i++)
+        scene.parents.push_back(i < BENCH_ROOTS ? -1 : i - BENCH_ROOTS);
+
+    MakeMoves(&scene, rng);
+    return scene;
+}
+
+/* Milliseconds per frame, sum receives the translations read so both runs can be compared */
+static auto RunOld(const BENCHSCENE& scene, double* sum) -> double
+{
+    std::vector<COldNode*> nodes;
+
+    for (const auto& local : scene.locals)
+        nodes.push_back(new COldNode(local));
+
+    for (auto i = 0; i < BENCH_NODES; i++)
+    {
+        if (scene.parents[i] >= 0)
+            nodes[scene.parents[i]]->AddNode(nodes[i]);
+    }
+
+    *sum = 0.0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (auto frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        for (auto i = 0; i < BENCH_MOVES; i++)
+            nodes[scene.moves[frame][i]]->SetTransform(scene.moveTo[frame][i]);
+
+        for (auto* node : nodes)
+            *sum += node->GetFinalTransform()._41;
+    }
+
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (auto* node : nodes)
+        delete node;
+
+    return elapsed.count() / BENCH_FRAMES;
+}
+
+static auto RunHierarchy(const BENCHSCENE& scene, double* sum) -> double
+{
+    auto* const hierarchy = new CTransformHierarchy();
+    std::vector<unsigned int> handles(BENCH_NODES);
+
+    // added backwards so parents start out behind their children and need the sort
+    for (auto i = BENCH_NODES - 1; i >= 0; i--)
+        handles[i] = hierarchy->Add(scene.locals[i]);
+
+    for (auto i = 0; i < BENCH_NODES; i++)
+    {
+        if (scene.parents[i] >= 0)
+            hierarchy->SetParent(handles[i], handles[scene.parents[i]]);
+    }
+
+    *sum = 0.0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (auto frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        for (auto i = 0; i < BENCH_MOVES; i++)
+            hierarchy->SetLocal(handles[scene.moves[frame][i]], scene.moveTo[frame][i]);
+
+        hierarchy->Update();
+
+        for (const auto handle : handles)
+            *sum += hierarchy->GetWorld(handle)._41;
+    }
+
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    hierarchy->Release();
+    return elapsed.count() / BENCH_FRAMES;
+}
+
+static auto Bench(const char* name, const BENCHSCENE& scene) -> bool
+{
+    double oldSum, newSum;
+    const auto oldTime = RunOld(scene, &oldSum);
+    const auto newTime = RunHierarchy(scene, &newSum);
+
+    printf("%-14s old %7.3f ms/frame  hierarchy %7.3f ms/frame\n", name, oldTime, newTime);
+
+    if (std::fabs(oldSum - newSum) > 1e-4 * std::fabs(oldSum) + 1e-3)
+    {
+        printf("  world matrices differ: %f vs %f\n", oldSum, newSum);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+int main()
+{
+    auto ok = Bench("random tree", MakeRandomTree());
+    ok = Bench("chains", MakeChains()) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/*
+ * Checks that node metadata keeps the type it was loaded with, the way
+ * node:getMeta hands it to Lua, and that clones keep reading the store of
+ * their source after it's gone. Links against the engine and Lua DLLs, so
+ * build the solution first and run it from the output directory:
+ *
+ *   cl /std:c++17 /O2 /EHsc /MD /I..\engine /I..\deps /I..\deps\d3d9\include MetadataTests.cpp
+ *      ..\engine\NameTable.cpp ..\engine\TransformHierarchy.cpp ..\engine\MetadataStore.cpp
+ *      /link /LIBPATH:..\..\Build\Release /LIBPATH:..\deps\d3d9 engine.lib lua.lib d3d9.lib d3dx9.lib
+ *      user32.lib
+ */
+
+#include "TestEngine.h"
+
+#include "Node.h"
+#include "MetadataStore.h"
+
+/* Adds what the loader would for one node */
+static void Attach(CNode* node, CMetadataStore* store, unsigned int first)
+{
+    node->SetMetadata(store, first, store->Begin() - first);
+}
+
+static void TestTyped(CNode* a, CNode* b, CNode* c)
+{
+    const auto* e = a->GetMetadata("visible");
+    CHECK(e != nullptr && e->kind == METAKIND_BOOL && e->b);
+
+    e = a->GetMetadata("count");
+    CHECK(e != nullptr && e->kind == METAKIND_INT && e->i == -7);
+
+    e = a->GetMetadata("tag");
+    CHECK(e != nullptr && e->kind == METAKIND_STRING);
+    CHECK(e != nullptr && strcmp(a->GetMetadataStore()->GetString(e), "hello") == 0);
+
+    e = c->GetMetadata("mass");
+    CHECK(e != nullptr && e->kind == METAKIND_DOUBLE && e->d == 2.5);
+
+    e = c->GetMetadata("offset");
+    CHECK(e != nullptr && e->kind == METAKIND_VEC3);
+    CHECK(e != nullptr && e->v[0] == 1.0F && e->v[1] == 2.0F && e->v[2] == 3.0F);
+
+    // a node without metadata holds no store at all
+    CHECK(b->GetMetadataStore() == nullptr);
+    CHECK(b->GetMetadata("tag") == nullptr);
+}
+
+static void TestMismatch(CNode* a, CNode* c)
+{
+    // the same key is a string on one node and a number on the other
+    const auto* const tagA = a->GetMetadata("tag");
+    const auto* const tagC = c->GetMetadata("tag");
+
+    CHECK(tagA != nullptr && tagA->kind == METAKIND_STRING);
+    CHECK(tagC != nullptr && tagC->kind == METAKIND_INT && tagC->i == 42);
+
+    // ints aren't squeezed through a double
+    const auto* const big = c->GetMetadata("id");
+    CHECK(big != nullptr && big->kind == METAKIND_INT && big->i == 9007199254740993LL);
+
+    // keys of other nodes and keys nobody has don't match
+    CHECK(a->GetMetadata("mass") == nullptr);
+    CHECK(a->GetMetadata("never") == nullptr);
+    CHECK(c->GetMetadata("visible") == nullptr);
+}
+
+static void TestClone(CNode* c)
+{
+    auto* const store = c->GetMetadataStore();
+    auto* const clone = c->Clone();
+
+    CHECK(clone->GetMetadataStore() == store);
+
+    // the clone holds its own reference
+    c->Release();
+
+    const auto* const e = clone->GetMetadata("offset");
+    CHECK(e != nullptr && e->kind == METAKIND_VEC3 && e->v[1] == 2.0F);
+
+    const auto* const tag = clone->GetMetadata("tag");
+    CHECK(tag != nullptr && tag->kind == METAKIND_INT && tag->i == 42);
+
+    clone->Release();
+}
+
+int main()
+{
+    new CTestEngine();
+
+    D3DXMATRIX id;
+    D3DXMatrixIdentity(&id);
+
+    auto* const a = new CNode(id, "a");
+    auto* const b = new CNode(id, "b");
+    auto* const c = new CNode(id, "c");
+    auto* const store = new CMetadataStore();
+
+    auto first = store->Begin();
+    store->AddBool("visible", TRUE);
+    store->AddInt("count", -7);
+    store->AddString("tag", "hello");
+    Attach(a, store, first);
+
+    Attach(b, store, store->Begin());
+
+    first = store->Begin();
+    store->AddDouble("mass", 2.5);
+    store->AddVec3("offset", 1.0F, 2.0F, 3.0F);
+    store->AddInt("tag", 42);
+    store->AddInt("id", 9007199254740993LL);
+    Attach(c, store, first);
+
+    // the nodes hold the store now, like after loading a scene
+    store->Compact();
+    store->Release();
+
+    TestTyped(a, b, c);
+    TestMismatch(a, c);
+    TestClone(c);
+
+    a->Release();
+    b->Release();
+
+    return Report();
+}
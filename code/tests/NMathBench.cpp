@@ -0,0 +1,142 @@
+/*
+ * Times the NMath paths the engine leans on: matrix products for the transform
+ * hierarchy and draws, inverses for the camera and picking, and the batch
+ * transform and bounds used when building geometry and collision meshes.
+ * Build it with and without NMATH_SCALAR to compare the SIMD paths against
+ * plain C++, and with -mavx for the AVX matrix batches:
+ *
+ *   g++ -std=c++17 -O2 -I../engine NMathBench.cpp
+ *   g++ -std=c++17 -O2 -mavx -I../engine NMathBench.cpp
+ *   g++ -std=c++17 -O2 -I../engine -DNMATH_SCALAR NMathBench.cpp
+ */
+
+#include "NMath.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#define BENCH_MATRICES 4096
+#define BENCH_POINTS 65536
+#define BENCH_PASSES 200
+
+/* Same size as VERTEX, the position comes first */
+struct BENCHVERTEX
+{
+    NVECTOR3 pos;
+    float rest[14];
+};
+
+static volatile float gSink;
+
+template <typename F>
+static void Bench(const char* name, unsigned int opsPerPass, F fn)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    for (auto pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        fn();
+    }
+
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    const auto ns = elapsed.count() / (static_cast<double>(opsPerPass) * BENCH_PASSES);
+
+    printf("%-28s %8.2f ns/op %10.1f Mops/s\n", name, ns, 1000.0 / ns);
+}
+
+static auto RandomFloat() -> float
+{
+    return static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * 2.0F - 1.0F;
+}
+
+int main()
+{
+    auto* a = new NMATRIX[BENCH_MATRICES];
+    auto* b = new NMATRIX[BENCH_MATRICES];
+    auto* out = new NMATRIX[BENCH_MATRICES];
+    auto* verts = new BENCHVERTEX[BENCH_POINTS];
+    auto* points = new NVECTOR3[BENCH_POINTS];
+    auto* vecs = new NVECTOR4[BENCH_POINTS];
+
+    srand(1);
+
+    for (auto i = 0; i < BENCH_MATRICES; i++)
+    {
+        NMatrixRotationYawPitchRoll(a + i, RandomFloat(), RandomFloat(), RandomFloat());
+        NMatrixTranslation(b + i, RandomFloat(), RandomFloat(), RandomFloat());
+        NMatrixMultiply(b + i, a + i, b + i);
+    }
+
+    for (auto i = 0; i < BENCH_POINTS; i++)
+    {
+        verts[i].pos = NVECTOR3(RandomFloat(), RandomFloat(), RandomFloat());
+        vecs[i] = NVECTOR4(RandomFloat(), RandomFloat(), RandomFloat(), 1.0F);
+    }
+
+#if defined(NMATH_AVX)
+    printf("NMath AVX\n");
+#elif defined(NMATH_SSE2)
+    printf("NMath SSE2\n");
+#elif defined(NMATH_NEON)
+    printf("NMath NEON\n");
+#else
+    printf("NMath scalar\n");
+#endif
+
+    Bench("NMatrixMultiply", BENCH_MATRICES, [&] {
+        for (auto i = 0; i < BENCH_MATRICES; i++)
+            NMatrixMultiply(out + i, a + i, b + i);
+    });
+
+    Bench("NMatrixMultiplyArray", BENCH_MATRICES, [&] {
+        NMatrixMultiplyArray(out, a, b, BENCH_MATRICES);
+    });
+
+    Bench("NMatrixInverse", BENCH_MATRICES, [&] {
+        for (auto i = 0; i < BENCH_MATRICES; i++)
+            NMatrixInverse(out + i, nullptr, b + i);
+    });
+
+    Bench("NMatrixTranspose", BENCH_MATRICES, [&] {
+        for (auto i = 0; i < BENCH_MATRICES; i++)
+            NMatrixTranspose(out + i, b + i);
+    });
+
+    Bench("NVec4Transform", BENCH_POINTS, [&] {
+        for (auto i = 0; i < BENCH_POINTS; i++)
+            NVec4Transform(vecs + i, vecs + i, b);
+    });
+
+    Bench("NVec3TransformCoord", BENCH_POINTS, [&] {
+        for (auto i = 0; i < BENCH_POINTS; i++)
+            NVec3TransformCoord(points + i, &verts[i].pos, b);
+    });
+
+    Bench("NVec3TransformCoordArray", BENCH_POINTS, [&] {
+        NVec3TransformCoordArray(points, sizeof(NVECTOR3), &verts->pos, sizeof(BENCHVERTEX), b, BENCH_POINTS);
+    });
+
+    Bench("NComputeBoundingSphere", BENCH_POINTS, [&] {
+        NVECTOR3 center;
+        float radius;
+        NComputeBoundingSphere(&verts->pos, BENCH_POINTS, sizeof(BENCHVERTEX), &center, &radius);
+        gSink = radius;
+    });
+
+    Bench("NComputeBoundingBox", BENCH_POINTS, [&] {
+        NVECTOR3 min, max;
+        NComputeBoundingBox(&verts->pos, BENCH_POINTS, sizeof(BENCHVERTEX), &min, &max);
+        gSink = max.x;
+    });
+
+    gSink = out[BENCH_MATRICES - 1]._11 + points[BENCH_POINTS - 1].x + vecs[BENCH_POINTS - 1].x;
+
+    delete[] a;
+    delete[] b;
+    delete[] out;
+    delete[] verts;
+    delete[] points;
+    delete[] vecs;
+    return 0;
+}
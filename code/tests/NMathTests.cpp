@@ -0,0 +1,856 @@
+/*
+ * Checks NMath.h against the same math done in double precision. NMath has no
+ * Windows dependencies, so this builds on its own, once per code path:
+ *
+ *   g++ -std=c++17 -O2 -I../engine NMathTests.cpp                  (SSE2/NEON)
+ *   g++ -std=c++17 -O2 -I../engine -mavx NMathTests.cpp            (AVX batches)
+ *   g++ -std=c++17 -O2 -I../engine -DNMATH_SCALAR NMathTests.cpp   (plain C++)
+ *
+ * Prints the worst error of every check and exits non-zero when one is over
+ * its tolerance.
+ */
+
+#include "NMath.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define TEST_ROUNDS 10000
+
+struct DMATRIX
+{
+    double m[4][4];
+};
+
+static int gFailures = 0;
+
+static auto RandomFloat(float lo, float hi) -> float
+{
+    return lo + (hi - lo) * (static_cast<float>(rand()) / static_cast<float>(RAND_MAX));
+}
+
+static void RandomMatrix(NMATRIX* out)
+{
+    for (auto i = 0; i < 4; i++)
+    {
+        for (auto j = 0; j < 4; j++)
+        {
+            out->m[i][j] = RandomFloat(-1.0F, 1.0F);
+        }
+    }
+}
+
+static auto RandomVector(float range) -> NVECTOR3
+{
+    return NVECTOR3(RandomFloat(-range, range), RandomFloat(-range, range), RandomFloat(-range, range));
+}
+
+/* A unit quaternion, picked uniformly over the rotations */
+static auto RandomQuaternion() -> NQUATERNION
+{
+    for (;;)
+    {
+        const NQUATERNION q = {RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1)};
+        const auto len = sqrt(q.x * static_cast<double>(q.x) + q.y * q.y + q.z * q.z + q.w * q.w);
+
+        if (len > 0.1 && len <= 1.0)
+            return {static_cast<float>(q.x / len), static_cast<float>(q.y / len), static_cast<float>(q.z / len), static_cast<float>(q.w / len)};
+    }
+}
+
+static auto ToDouble(const NMATRIX& m) -> DMATRIX
+{
+    DMATRIX r;
+
+    for (auto i = 0; i < 4; i++)
+    {
+        for (auto j = 0; j < 4; j++)
+        {
+            r.m[i][j] = m.m[i][j];
+        }
+    }
+
+    return r;
+}
+
+static auto Multiply(const DMATRIX& a, const DMATRIX& b) -> DMATRIX
+{
+    DMATRIX r;
+
+    for (auto i = 0; i < 4; i++)
+    {
+        for (auto j = 0; j < 4; j++)
+        {
+            r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+        }
+    }
+
+    return r;
+}
+
+static auto RotationX(double a) -> DMATRIX
+{
+    return {{{1, 0, 0, 0}, {0, cos(a), sin(a), 0}, {0, -sin(a), cos(a), 0}, {0, 0, 0, 1}}};
+}
+
+static auto RotationY(double a) -> DMATRIX
+{
+    return {{{cos(a), 0, -sin(a), 0}, {0, 1, 0, 0}, {sin(a), 0, cos(a), 0}, {0, 0, 0, 1}}};
+}
+
+static auto RotationZ(double a) -> DMATRIX
+{
+    return {{{cos(a), sin(a), 0, 0}, {-sin(a), cos(a), 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+}
+
+/* Rotation by angle around the unit axis n, for row vectors */
+static auto RotationAxis(const double* n, double a) -> DMATRIX
+{
+    const auto c = cos(a), s = sin(a), t = 1.0 - c;
+
+    return {{{c + t * n[0] * n[0], t * n[0] * n[1] + s * n[2], t * n[0] * n[2] - s * n[1], 0},
+             {t * n[1] * n[0] - s * n[2], c + t * n[1] * n[1], t * n[1] * n[2] + s * n[0], 0},
+             {t * n[2] * n[0] + s * n[1], t * n[2] * n[1] - s * n[0], c + t * n[2] * n[2], 0},
+             {0, 0, 0, 1}}};
+}
+
+/* The rotation of a unit quaternion, derived from its axis and angle */
+static auto QuaternionMatrix(const NQUATERNION& q) -> DMATRIX
+{
+    const auto s = sqrt(q.x * static_cast<double>(q.x) + q.y * static_cast<double>(q.y) + q.z * static_cast<double>(q.z));
+
+    if (s < 1e-9)
+        return {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+
+    const double n[3] = {q.x / s, q.y / s, q.z / s};
+    return RotationAxis(n, 2.0 * atan2(s, static_cast<double>(q.w)));
+}
+
+static void Normalize3(double* v)
+{
+    const auto len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+    for (auto j = 0; j < 3; j++)
+    {
+        v[j] /= len;
+    }
+}
+
+static void Cross3(double* out, const double* a, const double* b)
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static auto MaxError(const NMATRIX& m, const DMATRIX& ref) -> double
+{
+    auto err = 0.0;
+
+    for (auto i = 0; i < 4; i++)
+    {
+        for (auto j = 0; j < 4; j++)
+        {
+            err = fmax(err, fabs(m.m[i][j] - ref.m[i][j]));
+        }
+    }
+
+    return err;
+}
+
+/* (x, y, z, 1) * m divided by w, in double */
+static void TransformCoord(double* out, const NVECTOR3& v, const NMATRIX& m)
+{
+    double r[4];
+
+    for (auto j = 0; j < 4; j++)
+    {
+        r[j] = v.x * static_cast<double>(m.m[0][j]) + v.y * static_cast<double>(m.m[1][j])
+            + v.z * static_cast<double>(m.m[2][j]) + m.m[3][j];
+    }
+
+    for (auto j = 0; j < 3; j++)
+    {
+        out[j] = r[j] / r[3];
+    }
+}
+
+static auto Error3(const NVECTOR3& v, const double* ref) -> double
+{
+    return fmax(fabs(v.x - ref[0]), fmax(fabs(v.y - ref[1]), fabs(v.z - ref[2])));
+}
+
+static auto Error4(const NVECTOR4& v, const double* ref) -> double
+{
+    return fmax(fmax(fabs(v.x - ref[0]), fabs(v.y - ref[1])), fmax(fabs(v.z - ref[2]), fabs(v.w - ref[3])));
+}
+
+static void Report(const char* name, double err, double tolerance)
+{
+    const auto ok = err <= tolerance;
+
+    printf("%-36s %12.3g %s\n", name, err, ok ? "ok" : "FAILED");
+
+    if (!ok)
+        gFailures++;
+}
+
+static void TestMultiply()
+{
+    auto err = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        NMATRIX a, b, r;
+        RandomMatrix(&a);
+        RandomMatrix(&b);
+
+        const auto ref = Multiply(ToDouble(a), ToDouble(b));
+        NMatrixMultiply(&r, &a, &b);
+        err = fmax(err, MaxError(r, ref));
+
+        // the result may alias either operand
+        NMatrixMultiply(&a, &a, &b);
+        err = fmax(err, MaxError(a, ref));
+    }
+
+    Report("NMatrixMultiply", err, 1e-5);
+}
+
+/* Every product against double precision, the matrix after the last one must stay untouched */
+static void TestMultiplyArray()
+{
+    const auto count = 33;
+    auto* a = new NMATRIX[count];
+    auto* b = new NMATRIX[count];
+    auto* out = new NMATRIX[count + 1];
+    auto err = 0.0;
+    auto overrun = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS / 100; n++)
+    {
+        for (auto i = 0; i < count; i++)
+        {
+            RandomMatrix(a + i);
+            RandomMatrix(b + i);
+        }
+
+        memset(out + count, 0, sizeof(NMATRIX));
+        NMatrixMultiplyArray(out, a, b, count);
+
+        for (auto i = 0; i < count; i++)
+        {
+            err = fmax(err, MaxError(out[i], Multiply(ToDouble(a[i]), ToDouble(b[i]))));
+        }
+
+        overrun = fmax(overrun, MaxError(out[count], {}));
+    }
+
+    Report("NMatrixMultiplyArray", err, 1e-5);
+    Report("  writes past the end", overrun, 0.0);
+
+    delete[] a;
+    delete[] b;
+    delete[] out;
+}
+
+static void TestBasicMatrices()
+{
+    auto err = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        const auto v = RandomVector(100.0F);
+        NMATRIX r;
+
+        NMatrixIdentity(&r);
+        err = fmax(err, MaxError(r, {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}}));
+        NMatrixTranslation(&r, v.x, v.y, v.z);
+        err = fmax(err, MaxError(r, {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {v.x, v.y, v.z, 1}}}));
+        NMatrixScaling(&r, v.x, v.y, v.z);
+        err = fmax(err, MaxError(r, {{{v.x, 0, 0, 0}, {0, v.y, 0, 0}, {0, 0, v.z, 0}, {0, 0, 0, 1}}}));
+    }
+
+    Report("NMatrixIdentity/Translation/Scaling", err, 0.0);
+}
+
+static void TestTranspose()
+{
+    auto err = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        NMATRIX a, r;
+        RandomMatrix(&a);
+        NMatrixTranspose(&r, &a);
+
+        for (auto i = 0; i < 4; i++)
+        {
+            for (auto j = 0; j < 4; j++)
+            {
+                err = fmax(err, fabs(r.m[i][j] - a.m[j][i]));
+            }
+        }
+    }
+
+    Report("NMatrixTranspose", err, 0.0);
+}
+
+/* inverse * m has to come back as the identity, nearly singular matrices are skipped */
+static void TestInverse()
+{
+    const DMATRIX identity = {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+    auto err = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        NMATRIX a, inv, r;
+        float det;
+        RandomMatrix(&a);
+
+        if (NMatrixInverse(&inv, &det, &a) == nullptr || fabsf(det) < 0.05F)
+            continue;
+
+        NMatrixMultiply(&r, &inv, &a);
+        err = fmax(err, MaxError(r, identity));
+    }
+
+    Report("NMatrixInverse", err, 1e-3);
+}
+
+static void TestRotation()
+{
+    auto err = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        const auto yaw = RandomFloat(-NMATH_PI, NMATH_PI);
+        const auto pitch = RandomFloat(-NMATH_PI, NMATH_PI);
+        const auto roll = RandomFloat(-NMATH_PI, NMATH_PI);
+        NMATRIX r;
+
+        // roll around z, then pitch around x, then yaw around y
+        NMatrixRotationYawPitchRoll(&r, yaw, pitch, roll);
+        err = fmax(err, MaxError(r, Multiply(Multiply(RotationZ(roll), RotationX(pitch)), RotationY(yaw))));
+
+        NMatrixRotationX(&r, pitch);
+        err = fmax(err, MaxError(r, RotationX(pitch)));
+        NMatrixRotationY(&r, yaw);
+        err = fmax(err, MaxError(r, RotationY(yaw)));
+        NMatrixRotationZ(&r, roll);
+        err = fmax(err, MaxError(r, RotationZ(roll)));
+    }
+
+    Report("NMatrixRotation*", err, 1e-5);
+}
+
+static void TestLookAt()
+{
+    auto err = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        const auto eye = RandomVector(100.0F);
+        const auto at = RandomVector(100.0F);
+        const auto up = RandomVector(1.0F);
+        const double e[3] = {eye.x, eye.y, eye.z};
+
+        for (auto rightHanded = 0; rightHanded < 2; rightHanded++)
+        {
+            double z[3] = {at.x - static_cast<double>(eye.x), at.y - static_cast<double>(eye.y), at.z - static_cast<double>(eye.z)};
+            double x[3], y[3];
+            const double u[3] = {up.x, up.y, up.z};
+
+            if (rightHanded)
+            {
+                for (auto j = 0; j < 3; j++)
+                {
+                    z[j] = -z[j];
+                }
+            }
+
+            Normalize3(z);
+            Cross3(x, u, z);
+
+            // up nearly along the view direction leaves x to rounding
+            if (sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]) < 0.1)
+                continue;
+
+            Normalize3(x);
+            Cross3(y, z, x);
+
+            const DMATRIX ref = {{{x[0], y[0], z[0], 0}, {x[1], y[1], z[1], 0}, {x[2], y[2], z[2], 0},
+                                  {-(x[0] * e[0] + x[1] * e[1] + x[2] * e[2]), -(y[0] * e[0] + y[1] * e[1] + y[2] * e[2]),
+                                   -(z[0] * e[0] + z[1] * e[1] + z[2] * e[2]), 1}}};
+            NMATRIX r;
+
+            if (rightHanded)
+                NMatrixLookAtRH(&r, &eye, &at, &up);
+            else
+                NMatrixLookAtLH(&r, &eye, &at, &up);
+
+            // the translation row scales with the eye distance
+            err = fmax(err, MaxError(r, ref) / 100.0);
+        }
+    }
+
+    Report("NMatrixLookAtLH/RH", err, 1e-5);
+}
+
+static void TestProjection()
+{
+    auto err = 0.0;
+    auto errRH = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        const auto fov = RandomFloat(0.2F, 2.5F);
+        const auto aspect = RandomFloat(0.5F, 2.5F);
+        const auto zn = RandomFloat(0.01F, 1.0F);
+        const auto zf = RandomFloat(10.0F, 1000.0F);
+        const auto yScale = 1.0 / tan(fov / 2.0);
+        const auto q = zf / (static_cast<double>(zf) - zn);
+        const DMATRIX ref = {{{yScale / aspect, 0, 0, 0}, {0, yScale, 0, 0}, {0, 0, q, 1}, {0, 0, -zn * q, 0}}};
+        NMATRIX r;
+
+        NMatrixPerspectiveFovLH(&r, fov, aspect, zn, zf);
+        err = fmax(err, MaxError(r, ref) / fmax(1.0, yScale / aspect));
+
+        const auto qRH = zf / (static_cast<double>(zn) - zf);
+        const DMATRIX refRH = {{{yScale / aspect, 0, 0, 0}, {0, yScale, 0, 0}, {0, 0, qRH, -1}, {0, 0, zn * qRH, 0}}};
+
+        NMatrixPerspectiveFovRH(&r, fov, aspect, zn, zf);
+        errRH = fmax(errRH, MaxError(r, refRH) / fmax(1.0, yScale / aspect));
+    }
+
+    Report("NMatrixPerspectiveFovLH", err, 1e-5);
+    Report("NMatrixPerspectiveFovRH", errRH, 1e-5);
+}
+
+/* Maps the box onto x, y in -1..1 and z in 0..1, the RH versions look down -z */
+static void TestOrtho()
+{
+    auto err = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        const auto l = RandomFloat(-100.0F, 0.0F), r = RandomFloat(1.0F, 100.0F);
+        const auto b = RandomFloat(-100.0F, 0.0F), t = RandomFloat(1.0F, 100.0F);
+        const auto zn = RandomFloat(0.0F, 10.0F), zf = RandomFloat(20.0F, 1000.0F);
+        const double dl = l, dr = r, db = b, dt = t, dn = zn, df = zf;
+
+        for (auto rightHanded = 0; rightHanded < 2; rightHanded++)
+        {
+            const auto zs = rightHanded ? 1.0 / (dn - df) : 1.0 / (df - dn);
+            const DMATRIX ref = {{{2.0 / (dr - dl), 0, 0, 0}, {0, 2.0 / (dt - db), 0, 0}, {0, 0, zs, 0},
+                                  {(dl + dr) / (dl - dr), (dt + db) / (db - dt), dn / (dn - df), 1}}};
+            const DMATRIX centered = {{{2.0 / (dr - dl), 0, 0, 0}, {0, 2.0 / (dt - db), 0, 0}, {0, 0, zs, 0},
+                                       {0, 0, dn / (dn - df), 1}}};
+            NMATRIX m;
+
+            if (rightHanded)
+                NMatrixOrthoOffCenterRH(&m, l, r, b, t, zn, zf);
+            else
+                NMatrixOrthoOffCenterLH(&m, l, r, b, t, zn, zf);
+
+            err = fmax(err, MaxError(m, ref));
+
+            // the centered versions take the width and height of the box
+            if (rightHanded)
+                NMatrixOrthoRH(&m, r - l, t - b, zn, zf);
+            else
+                NMatrixOrthoLH(&m, r - l, t - b, zn, zf);
+
+            err = fmax(err, MaxError(m, centered));
+        }
+    }
+
+    Report("NMatrixOrtho*", err, 1e-5);
+}
+
+/*
+ * Checked on points rather than on the matrices: a reflected point ends up as
+ * far behind the plane as it was in front, a shadow is where the line from the
+ * light through the point meets the plane.
+ */
+static void TestReflectShadow()
+{
+    auto errReflect = 0.0;
+    auto errShadow = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        const NPLANE plane(RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-10, 10));
+        const auto len = sqrt(plane.x * static_cast<double>(plane.x) + plane.y * static_cast<double>(plane.y) + plane.z * static_cast<double>(plane.z));
+
+        if (len < 0.1)
+            continue;
+
+        const double p[4] = {plane.x / len, plane.y / len, plane.z / len, plane.w / len};
+        const auto v = RandomVector(10.0F);
+        const auto dist = p[0] * v.x + p[1] * v.y + p[2] * v.z + p[3];
+        const double reflected[3] = {v.x - 2.0 * dist * p[0], v.y - 2.0 * dist * p[1], v.z - 2.0 * dist * p[2]};
+        NMATRIX m;
+        NVECTOR3 r;
+
+        NMatrixReflect(&m, &plane);
+        NVec3TransformCoord(&r, &v, &m);
+        errReflect = fmax(errReflect, Error3(r, reflected));
+
+        // a point light half the time, a directional one otherwise
+        const NVECTOR4 light(RandomFloat(-10, 10), RandomFloat(-10, 10), RandomFloat(-10, 10), static_cast<float>(n & 1));
+        const double l[4] = {light.x, light.y, light.z, light.w};
+        const auto dotLight = p[0] * l[0] + p[1] * l[1] + p[2] * l[2] + p[3] * l[3];
+        double shadow[4];
+
+        for (auto j = 0; j < 4; j++)
+        {
+            shadow[j] = dotLight * (j < 3 ? (&v.x)[j] : 1.0) - dist * l[j];
+        }
+
+        // lights close to the plane throw their shadows towards infinity
+        if (fabs(shadow[3]) < 0.5)
+            continue;
+
+        for (auto j = 0; j < 3; j++)
+        {
+            shadow[j] /= shadow[3];
+        }
+
+        NMatrixShadow(&m, &light, &plane);
+        NVec3TransformCoord(&r, &v, &m);
+        errShadow = fmax(errShadow, Error3(r, shadow) / fmax(1.0, fabs(shadow[0]) + fabs(shadow[1]) + fabs(shadow[2])));
+    }
+
+    Report("NMatrixReflect", errReflect, 1e-4);
+    Report("NMatrixShadow", errShadow, 1e-4);
+}
+
+static void TestVec4Transform()
+{
+    auto err = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        NMATRIX m;
+        NVECTOR4 r;
+        const NVECTOR4 v(RandomFloat(-10, 10), RandomFloat(-10, 10), RandomFloat(-10, 10), RandomFloat(-10, 10));
+        RandomMatrix(&m);
+        NVec4Transform(&r, &v, &m);
+
+        const float* out = &r.x;
+
+        for (auto j = 0; j < 4; j++)
+        {
+            const auto ref = v.x * static_cast<double>(m.m[0][j]) + v.y * static_cast<double>(m.m[1][j])
+                + v.z * static_cast<double>(m.m[2][j]) + v.w * static_cast<double>(m.m[3][j]);
+            err = fmax(err, fabs(out[j] - ref));
+        }
+    }
+
+    Report("NVec4Transform", err, 1e-4);
+}
+
+static void TestVec3()
+{
+    auto errCross = 0.0, errLerp = 0.0, errMinMax = 0.0, errNormalize = 0.0, errNormal = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        const auto a = RandomVector(10.0F);
+        const auto b = RandomVector(10.0F);
+        const auto s = RandomFloat(-1.0F, 2.0F);
+        const double da[3] = {a.x, a.y, a.z}, db[3] = {b.x, b.y, b.z};
+        double ref[3], lerp[3], lo[3], hi[3], unit[3] = {a.x, a.y, a.z};
+        NVECTOR3 r;
+
+        Cross3(ref, da, db);
+        NVec3Cross(&r, &a, &b);
+        errCross = fmax(errCross, Error3(r, ref));
+
+        for (auto j = 0; j < 3; j++)
+        {
+            lerp[j] = da[j] + (db[j] - da[j]) * s;
+            lo[j] = fmin(da[j], db[j]);
+            hi[j] = fmax(da[j], db[j]);
+        }
+
+        NVec3Lerp(&r, &a, &b, s);
+        errLerp = fmax(errLerp, Error3(r, lerp));
+        NVec3Minimize(&r, &a, &b);
+        errMinMax = fmax(errMinMax, Error3(r, lo));
+        NVec3Maximize(&r, &a, &b);
+        errMinMax = fmax(errMinMax, Error3(r, hi));
+
+        Normalize3(unit);
+        NVec3Normalize(&r, &a);
+        errNormalize = fmax(errNormalize, Error3(r, unit));
+
+        NMATRIX m;
+        RandomMatrix(&m);
+
+        for (auto j = 0; j < 3; j++)
+        {
+            ref[j] = da[0] * m.m[0][j] + da[1] * m.m[1][j] + da[2] * m.m[2][j];
+        }
+
+        NVec3TransformNormal(&r, &a, &m);
+        errNormal = fmax(errNormal, Error3(r, ref));
+    }
+
+    // a zero vector has no direction and stays zero
+    const NVECTOR3 zero(0.0F, 0.0F, 0.0F);
+    const double zeroRef[3] = {};
+    NVECTOR3 r;
+    NVec3Normalize(&r, &zero);
+    errNormalize = fmax(errNormalize, Error3(r, zeroRef));
+
+    Report("NVec3Cross", errCross, 1e-4);
+    Report("NVec3Lerp", errLerp, 1e-5);
+    Report("NVec3Minimize/Maximize", errMinMax, 0.0);
+    Report("NVec3Normalize", errNormalize, 1e-6);
+    Report("NVec3TransformNormal", errNormal, 1e-5);
+}
+
+static void TestVec4()
+{
+    auto errAdd = 0.0, errLerp = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        const NVECTOR4 a(RandomFloat(-10, 10), RandomFloat(-10, 10), RandomFloat(-10, 10), RandomFloat(-10, 10));
+        const NVECTOR4 b(RandomFloat(-10, 10), RandomFloat(-10, 10), RandomFloat(-10, 10), RandomFloat(-10, 10));
+        const auto s = RandomFloat(-1.0F, 2.0F);
+        const float* fa = &a.x;
+        const float* fb = &b.x;
+        double sum[4], diff[4], lerp[4];
+        NVECTOR4 r;
+
+        for (auto j = 0; j < 4; j++)
+        {
+            sum[j] = static_cast<double>(fa[j]) + fb[j];
+            diff[j] = static_cast<double>(fa[j]) - fb[j];
+            lerp[j] = fa[j] + (static_cast<double>(fb[j]) - fa[j]) * s;
+        }
+
+        NVec4Add(&r, &a, &b);
+        errAdd = fmax(errAdd, Error4(r, sum));
+        NVec4Subtract(&r, &a, &b);
+        errAdd = fmax(errAdd, Error4(r, diff));
+        NVec4Lerp(&r, &a, &b, s);
+        errLerp = fmax(errLerp, Error4(r, lerp));
+    }
+
+    Report("NVec4Add/Subtract", errAdd, 1e-5);
+    Report("NVec4Lerp", errLerp, 1e-5);
+}
+
+/* Quaternions are compared through the matrices of their rotations, q and -q are the same rotation */
+static void TestQuaternion()
+{
+    auto errIdentity = 0.0, errYawPitchRoll = 0.0, errAxis = 0.0, errMultiply = 0.0, errNormalize = 0.0, errSlerp = 0.0;
+    NQUATERNION q;
+    NMATRIX r;
+
+    NQuaternionIdentity(&q);
+    NMatrixRotationQuaternion(&r, &q);
+    errIdentity = fmax(fmax(fabs(q.x) + fabs(q.y) + fabs(q.z), fabs(q.w - 1.0)), MaxError(r, {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}}));
+
+    for (auto n = 0; n < TEST_ROUNDS; n++)
+    {
+        const auto yaw = RandomFloat(-NMATH_PI, NMATH_PI);
+        const auto pitch = RandomFloat(-NMATH_PI, NMATH_PI);
+        const auto roll = RandomFloat(-NMATH_PI, NMATH_PI);
+
+        NQuaternionRotationYawPitchRoll(&q, yaw, pitch, roll);
+        NMatrixRotationQuaternion(&r, &q);
+        errYawPitchRoll = fmax(errYawPitchRoll, MaxError(r, Multiply(Multiply(RotationZ(roll), RotationX(pitch)), RotationY(yaw))));
+
+        const auto axis = RandomVector(1.0F);
+        const auto axisLen = sqrt(axis.x * static_cast<double>(axis.x) + axis.y * static_cast<double>(axis.y) + axis.z * static_cast<double>(axis.z));
+
+        if (axisLen > 0.1)
+        {
+            const double unit[3] = {axis.x / axisLen, axis.y / axisLen, axis.z / axisLen};
+
+            NQuaternionRotationAxis(&q, &axis, yaw);
+            NMatrixRotationQuaternion(&r, &q);
+            errAxis = fmax(errAxis, MaxError(r, RotationAxis(unit, yaw)));
+        }
+
+        const auto a = RandomQuaternion();
+        const auto b = RandomQuaternion();
+
+        // rotating by a then by b, the same order as the matrix product
+        NQuaternionMultiply(&q, &a, &b);
+        NMatrixRotationQuaternion(&r, &q);
+        errMultiply = fmax(errMultiply, MaxError(r, Multiply(QuaternionMatrix(a), QuaternionMatrix(b))));
+
+        const auto scale = RandomFloat(0.1F, 10.0F);
+        const NQUATERNION scaled = {a.x * scale, a.y * scale, a.z * scale, a.w * scale};
+        NQuaternionNormalize(&q, &scaled);
+        errNormalize = fmax(errNormalize, fmax(fmax(fabs(q.x - a.x), fabs(q.y - a.y)), fmax(fabs(q.z - a.z), fabs(q.w - a.w))));
+
+        // the rotation of the slerp turns by t times the angle between a and b, around the same axis
+        const auto t = RandomFloat(0.0F, 1.0F);
+        const auto dot = a.x * static_cast<double>(b.x) + a.y * static_cast<double>(b.y) + a.z * static_cast<double>(b.z) + a.w * static_cast<double>(b.w);
+        const auto sign = dot < 0.0 ? -1.0 : 1.0;
+        const auto omega = acos(fmin(1.0, fabs(dot)));
+        auto s0 = 1.0 - t, s1 = static_cast<double>(t);
+
+        if (omega > 1e-6)
+        {
+            s0 = sin((1.0 - t) * omega) / sin(omega);
+            s1 = sin(t * omega) / sin(omega);
+        }
+
+        const NQUATERNION ref = {static_cast<float>(s0 * a.x + sign * s1 * b.x), static_cast<float>(s0 * a.y + sign * s1 * b.y),
+                                 static_cast<float>(s0 * a.z + sign * s1 * b.z), static_cast<float>(s0 * a.w + sign * s1 * b.w)};
+        NQuaternionSlerp(&q, &a, &b, t);
+        NMatrixRotationQuaternion(&r, &q);
+        errSlerp = fmax(errSlerp, MaxError(r, QuaternionMatrix(ref)));
+    }
+
+    const NQUATERNION zero = {0.0F, 0.0F, 0.0F, 0.0F};
+    NQuaternionNormalize(&q, &zero);
+    errNormalize = fmax(errNormalize, fabs(q.x) + fabs(q.y) + fabs(q.z) + fabs(q.w - 1.0));
+
+    Report("NQuaternionIdentity", errIdentity, 0.0);
+    Report("NQuaternionRotationYawPitchRoll", errYawPitchRoll, 1e-5);
+    Report("NQuaternionRotationAxis", errAxis, 1e-5);
+    Report("NQuaternionMultiply", errMultiply, 1e-5);
+    Report("NQuaternionNormalize", errNormalize, 1e-6);
+    Report("NQuaternionSlerp", errSlerp, 1e-4);
+}
+
+/*
+ * Reads the positions out of a vertex-sized stride into a packed array, the
+ * way CCollisionMesh::AddFaceGroup does, and checks nothing past the last
+ * point got written.
+ */
+static void TestTransformCoordArray()
+{
+    struct POINT
+    {
+        NVECTOR3 pos;
+        float rest[14];
+    };
+
+    const auto count = 257;
+    auto* points = new POINT[count];
+    auto* out = new NVECTOR3[count + 1];
+    auto err = 0.0;
+    auto overrun = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS / 100; n++)
+    {
+        NMATRIX m;
+        RandomMatrix(&m);
+        m._14 = m._24 = m._34 = 0.0F;
+        m._44 = RandomFloat(0.5F, 2.0F);
+
+        for (auto i = 0; i < count; i++)
+        {
+            points[i].pos = NVECTOR3(RandomFloat(-10, 10), RandomFloat(-10, 10), RandomFloat(-10, 10));
+        }
+
+        out[count] = NVECTOR3(1234.0F, 1234.0F, 1234.0F);
+        NVec3TransformCoordArray(out, sizeof(NVECTOR3), &points->pos, sizeof(POINT), &m, count);
+
+        for (auto i = 0; i < count; i++)
+        {
+            double ref[3];
+            NVECTOR3 single;
+            TransformCoord(ref, points[i].pos, m);
+            NVec3TransformCoord(&single, &points[i].pos, &m);
+
+            err = fmax(err, fabs(out[i].x - ref[0]) + fabs(out[i].y - ref[1]) + fabs(out[i].z - ref[2]));
+            err = fmax(err, fabs(single.x - ref[0]) + fabs(single.y - ref[1]) + fabs(single.z - ref[2]));
+        }
+
+        overrun = fmax(overrun, fabs(out[count].x - 1234.0F) + fabs(out[count].y - 1234.0F) + fabs(out[count].z - 1234.0F));
+    }
+
+    Report("NVec3TransformCoordArray", err, 1e-3);
+    Report("  writes past the end", overrun, 0.0);
+
+    delete[] points;
+    delete[] out;
+}
+
+static void TestBounds()
+{
+    const auto count = 1000;
+    auto* points = new NVECTOR3[count];
+    auto err = 0.0;
+
+    for (auto n = 0; n < TEST_ROUNDS / 100; n++)
+    {
+        double sum[3] = {};
+        double lo[3] = {1e30, 1e30, 1e30}, hi[3] = {-1e30, -1e30, -1e30};
+
+        for (auto i = 0; i < count; i++)
+        {
+            points[i] = NVECTOR3(RandomFloat(-100, 100), RandomFloat(-50, 50), RandomFloat(0, 10));
+            const float* p = &points[i].x;
+
+            for (auto j = 0; j < 3; j++)
+            {
+                sum[j] += p[j];
+                lo[j] = fmin(lo[j], p[j]);
+                hi[j] = fmax(hi[j], p[j]);
+            }
+        }
+
+        double center[3], radius = 0.0;
+
+        for (auto j = 0; j < 3; j++)
+        {
+            center[j] = sum[j] / count;
+        }
+
+        for (auto i = 0; i < count; i++)
+        {
+            const auto dx = points[i].x - center[0], dy = points[i].y - center[1], dz = points[i].z - center[2];
+            radius = fmax(radius, sqrt(dx * dx + dy * dy + dz * dz));
+        }
+
+        NVECTOR3 c, min, max;
+        float r;
+        NComputeBoundingSphere(points, count, sizeof(NVECTOR3), &c, &r);
+        NComputeBoundingBox(points, count, sizeof(NVECTOR3), &min, &max);
+
+        err = fmax(err, fabs(c.x - center[0]) + fabs(c.y - center[1]) + fabs(c.z - center[2]) + fabs(r - radius));
+        err = fmax(err, fabs(min.x - lo[0]) + fabs(min.y - lo[1]) + fabs(min.z - lo[2]));
+        err = fmax(err, fabs(max.x - hi[0]) + fabs(max.y - hi[1]) + fabs(max.z - hi[2]));
+    }
+
+    Report("NComputeBounding*", err, 1e-3);
+    delete[] points;
+}
+
+int main()
+{
+    srand(1);
+
+    TestMultiply();
+    TestMultiplyArray();
+    TestBasicMatrices();
+    TestTranspose();
+    TestInverse();
+    TestRotation();
+    TestLookAt();
+    TestProjection();
+    TestOrtho();
+    TestReflectShadow();
+    TestVec3();
+    TestVec4();
+    TestVec4Transform();
+    TestQuaternion();
+    TestTransformCoordArray();
+    TestBounds();
+
+    printf("%d failed\n", gFailures);
+    return gFailures > 0 ? 1 : 0;
+}
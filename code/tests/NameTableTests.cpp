@@ -0,0 +1,103 @@
+/*
+ * Checks interning in CNameTable and that CNode::FindNode sees renames, the
+ * rename bumps the table's generation and the node index is rebuilt on the
+ * next lookup. Links against the engine and Lua DLLs, so build the solution
+ * first and run it from the output directory:
+ *
+ *   cl /std:c++17 /O2 /EHsc /MD /I..\engine /I..\deps /I..\deps\d3d9\include NameTableTests.cpp
+ *      ..\engine\NameTable.cpp ..\engine\TransformHierarchy.cpp /link /LIBPATH:..\..\Build\Release
+ *      /LIBPATH:..\deps\d3d9 engine.lib lua.lib d3d9.lib d3dx9.lib user32.lib
+ */
+
+#include "TestEngine.h"
+
+#include "Node.h"
+
+static void TestIntern()
+{
+    const auto hull = NAMES->Intern("hull");
+    const auto lamp = NAMES->Intern("lamp");
+
+    CHECK(hull != NAME_NONE);
+    CHECK(hull != lamp);
+    CHECK(NAMES->Intern("hull") == hull);
+    CHECK(strcmp(NAMES->GetString(hull), "hull") == 0);
+    CHECK(strcmp(NAMES->GetString(lamp), "lamp") == 0);
+
+    // the strings stay put while the table grows
+    const auto* const str = NAMES->GetString(hull);
+
+    for (auto i = 0; i < 10000; i++)
+    {
+        CHAR name[16];
+        sprintf_s(name, "name%d", i);
+        NAMES->Intern(name);
+    }
+
+    CHECK(NAMES->GetString(hull) == str);
+    CHECK(NAMES->Find("hull") == hull);
+    CHECK(NAMES->Find("name9999") != NAME_NONE);
+
+    // Find doesn't intern what it's asked for
+    CHECK(NAMES->Find("nobody") == NAME_NONE);
+    CHECK(NAMES->Find("nobody") == NAME_NONE);
+    CHECK(NAMES->Find("hull/child", 4) == hull);
+}
+
+static void TestRename()
+{
+    D3DXMATRIX id;
+    D3DXMatrixIdentity(&id);
+
+    auto* const scene = new CNode(id, "scene");
+    auto* const backdrop = new CNode(id, "backdrop");
+    auto* const bd = new CNode(id, "bd");
+    auto* const child = new CNode(id, "child");
+    auto* const dup = new CNode(id, "child");
+
+    scene->AddNode(backdrop);
+    backdrop->SetParent(scene);
+    backdrop->AddNode(bd);
+    bd->SetParent(backdrop);
+    bd->AddNode(child);
+    child->SetParent(bd);
+    bd->AddNode(dup);
+    dup->SetParent(bd);
+
+    // indexes bd under the old name
+    CHECK(scene->FindNode("backdrop/bd/child") == child);   // the first one wins
+
+    const auto generation = NAMES->GetGeneration();
+    child->SetName("renamed");
+
+    CHECK(NAMES->GetGeneration() != generation);
+    CHECK(scene->FindNode("backdrop/bd/renamed") == child);
+    CHECK(scene->FindNode("backdrop/bd/child") == dup);
+    CHECK(bd->FindNode("renamed") == child);
+
+    auto* const late = new CNode(id, "late");
+    bd->AddNode(late);
+    late->SetParent(bd);
+
+    CHECK(scene->FindNode("backdrop/bd/late") == late);
+
+    // nothing has indexed a node without an owner yet
+    auto* const loose = new CNode(id, "loose");
+    const auto before = NAMES->GetGeneration();
+    loose->SetName("still loose");
+
+    CHECK(NAMES->GetGeneration() == before);
+
+    loose->Release();
+    scene->Release();
+}
+
+int main()
+{
+    new CTestEngine();
+
+    TestIntern();
+    TestRename();
+
+    return Report();
+}
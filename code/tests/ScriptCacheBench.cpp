@@ -0,0 +1,148 @@
+/*
+ * Times compiling every script of a game directory the way a launch or a
+ * RestartGame does, once straight from source with the bytecode cache turned
+ * off (cold) and once from a populated cache (warm). Links against the engine
+ * and Lua DLLs, so build the solution first and run it from the output
+ * directory:
+ *
+ *   cl /std:c++17 /O2 /EHsc /I..\engine /I..\deps ScriptCacheBench.cpp
+ *      /link /LIBPATH:..\..\Build\Release engine.lib lua.lib
+ *   ScriptCacheBench.exe ..\..\data
+ *
+ * The warm passes write to the game's .luacache directory like the engine does.
+ */
+
+#include "StdAfx.h"
+
+#include "engine.h"
+#include "FileSystem.h"
+#include "ScriptCache.h"
+
+#include <lua/lua.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define BENCH_PASSES 20
+
+/* Just the file system, scripts are only compiled and never run */
+class CBenchEngine : public CEngine
+{
+public:
+    CBenchEngine()
+    {
+        mFileSystem = new CFileSystem();
+    }
+};
+
+static void FindScripts(const std::string& dir, std::vector<std::string>& scripts)
+{
+    WIN32_FIND_DATAA fd;
+    const auto search = dir.empty() ? std::string("*") : dir + "\\*";
+    auto* const handle = FindFirstFileA(FILESYSTEM->ResourcePath(search.c_str()), &fd);
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    do
+    {
+        const std::string name = fd.cFileName;
+        const auto path = dir.empty() ? name : dir + "\\" + name;
+
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            if (name != "." && name != ".." && name != SCRIPTCACHE_DIR)
+            {
+                FindScripts(path, scripts);
+            }
+        }
+        else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".lua") == 0)
+        {
+            scripts.push_back(path);
+        }
+    } while (FindNextFileA(handle, &fd));
+
+    FindClose(handle);
+}
+
+/* Compiles every script into a fresh state, returns the milliseconds it took */
+static auto LoadAll(const std::vector<std::string>& scripts) -> double
+{
+    auto* const L = luaL_newstate();
+    luaL_openlibs(L);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto& name : scripts)
+    {
+        const auto fd = FILESYSTEM->GetResource(name.c_str());
+
+        if (fd.data == nullptr)
+        {
+            continue;
+        }
+
+        const auto chunkName = "@" + name;
+
+        if (CScriptCache::LoadBuffer(L, static_cast<LPCSTR>(fd.data), fd.size, chunkName.c_str()) != LUA_OK)
+        {
+            printf("%s\n", lua_tostring(L, -1));
+        }
+
+        lua_pop(L, 1);
+        FILESYSTEM->FreeResource(fd.data);
+    }
+
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    lua_close(L);
+    return elapsed.count();
+}
+
+static void Bench(const char* name, const std::vector<std::string>& scripts)
+{
+    auto best = 1e9;
+    auto total = 0.0;
+
+    CScriptCache::ResetStats();
+
+    for (auto pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        const auto ms = LoadAll(scripts);
+        best = ms < best ? ms : best;
+        total += ms;
+    }
+
+    const auto stats = CScriptCache::GetStats();
+    printf("%-6s %8.3f ms avg %8.3f ms best  hits %u misses %u\n", name, total / BENCH_PASSES, best, stats.hits,
+           stats.misses);
+}
+
+int main(int argc, char** argv)
+{
+    CHAR defaultPath[] = "data";
+    new CBenchEngine();
+
+    if (!FILESYSTEM->LoadGame(argc > 1 ? argv[1] : defaultPath))
+    {
+        printf("no game directory\n");
+        return 1;
+    }
+
+    std::vector<std::string> scripts;
+    FindScripts("", scripts);
+    printf("%zu scripts in %s\n", scripts.size(), FILESYSTEM->GetGamePath());
+
+    CScriptCache::SetEnabled(FALSE);
+    Bench("cold", scripts);
+
+    // the first pass compiles and stores every chunk, the timed ones only load
+    CScriptCache::SetEnabled(TRUE);
+    LoadAll(scripts);
+    Bench("warm", scripts);
+
+    return 0;
+}
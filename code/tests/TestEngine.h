@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ * Shared by the tests that drive engine classes without starting the engine.
+ * They link against the engine and Lua DLLs like the benchmarks, classes the
+ * engine doesn't export are compiled in from ..\engine with the test. Every
+ * failed CHECK prints its line, Report prints the total and gives the exit
+ * code.
+ */
+
+#include "StdAfx.h"
+
+#include "engine.h"
+#include "Renderer.h"
+#include "NameTable.h"
+#include "TransformHierarchy.h"
+
+#include <cstdio>
+
+/* Just the name table and the transform hierarchy nodes need */
+class CTestEngine : public CEngine
+{
+public:
+    CTestEngine()
+    {
+        mTransforms = new CTransformHierarchy();
+        mNames = new CNameTable();
+    }
+
+    /* A device on a hidden window for building geometry, FALSE when none can be created */
+    auto CreateRenderer() -> bool
+    {
+        RECT res = {0, 0, 64, 64};
+        auto* const window = CreateWindowA("STATIC", "tests", WS_OVERLAPPEDWINDOW, 0, 0, res.right, res.bottom, nullptr,
+                                           nullptr, GetModuleHandleA(nullptr), nullptr);
+
+        if (window == nullptr)
+        {
+            return FALSE;
+        }
+
+        mRenderer = new CRenderer();
+
+        if (mRenderer->CreateDevice(window, res) != ERROR_SUCCESS || mRenderer->GetDevice() == nullptr)
+        {
+            mRenderer = nullptr;
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+};
+
+static int gFailures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); gFailures++; } } while (0)
+
+static auto Report() -> int
+{
+    printf("%d failed\n", gFailures);
+    return gFailures > 0 ? 1 : 0;
+}
@@ -16,6 +16,22 @@ config = {
     },
 }
 
+-- Startup assets, decoded in parallel and picked up by the constructors below
+Preload{
+    {"model", "assets/terrain.fbx"},
+    {"model", "assets/backdrop.fbx"},
+    {"model", "assets/sphere.fbx", false},
+    {"material", "assets/tile_base.png"},
+    {"material", "assets/bounds.png"},
+    {"material", "assets/gradient.png"},
+    {"effect", "fx/terrain.fx"},
+    {"effect", "fx/fxaa.fx"},
+    {"sound", "assets/sounds/engine.wav"},
+    {"sound", "assets/sounds/death.wav"},
+    {"sound", "assets/sounds/kill.wav"},
+    {"sound", "assets/sounds/wallhit.wav"},
+}
+
 -- Modules
 nativedll = require "slayernative"
 music = require "music"
@@ -2,6 +2,16 @@ SPEED = 1
 
 local class = require "class"
 
+-- Scratch values reused every frame, see Vector.add and friends
+local CAM_OFFSET = Vector3(0,-40,100)
+local MENU_EYE = Vector3(0,800,0)
+local UP = Vector3(0,1,0)
+local ZERO = Vector()
+local tmpVec = Vector()
+local rotMat = Matrix()
+local fwd = Vector()
+local rhs = Vector()
+
 class "Player" {
     __init__ = function (self)
         self.pos = Vector3()
@@ -36,57 +46,56 @@ class "Player" {
             self.angles[2] = self.angles[2] - (mouseDelta[2] * dt * 0.15)
         end
 
-        self.pos = self.pos:lerp(self.tank.pos:neg(), 0.233589)
+        self.pos:lerpInPlace(Vector.neg(tmpVec, self.tank.pos), 0.233589)
 
         self.angles[2] = hh.clamp(-1.15, self.angles[2], 0.15)
 
-        self.cam = Matrix()
-            :translate(self.pos+self.tank.vel)
+        self.cam:identity()
+            :translate(Vector.add(tmpVec, self.pos, self.tank.vel))
             :rotate(-self.angles[1],0,0)
             :rotate(0,self.angles[2],0)
-            :translate(Vector3(0,-40,100))
+            :translate(CAM_OFFSET)
 
-        local rotMat = Matrix()
-        :rotate(-self.heading,0,0)
+        rotMat:identity():rotate(-self.heading,0,0)
 
-        local fwd = rotMat:col(3)
-        local rhs = rotMat:col(1)
+        Matrix.col(fwd, rotMat, 3)
+        Matrix.col(rhs, rotMat, 1)
 
-        self.tank.movedir = Vector()
-        self.tank.movedir = self.tank.movedir + fwd*SPEED*dt*0.5
+        local movedir = self.tank.movedir
+        Vector.scale(movedir, fwd, SPEED*dt*0.5)
 
         if not state:is("game") then
             self.heading = self.heading + 1.65 * dt
-            self.tank.movedir = self.tank.movedir + fwd*SPEED*dt*0.5
-            self.tank.rot = Matrix():rotate(self.heading+math.rad(90),0,0)
+            Vector.madd(movedir, movedir, fwd, SPEED*dt*0.5)
+            self.tank.rot:identity():rotate(self.heading+math.rad(90),0,0)
 
-            self.cam = Matrix():lookAt(
-                Vector3(0,800,0),
-                Vector3((WORLD_SIZE*WORLD_TILES[1])/2, 0, (WORLD_SIZE*WORLD_TILES[2])/2),
-                Vector3(0,1,0)
+            self.cam:identity():lookAt(
+                MENU_EYE,
+                tmpVec:set((WORLD_SIZE*WORLD_TILES[1])/2, 0, (WORLD_SIZE*WORLD_TILES[2])/2),
+                UP
             )
         else
             if not GetMouse(MOUSE_RIGHT_BUTTON) then
                 self.heading = hh.lerp(self.heading, self.angles[1], 0.1238772)
             end
 
-            self.tank.rot = Matrix():rotate(self.heading+math.rad(90),0,0)
+            self.tank.rot:identity():rotate(self.heading+math.rad(90),0,0)
 
             if GetKey("w") then
-                self.tank.movedir = self.tank.movedir + fwd*SPEED*dt*0.5
+                Vector.madd(movedir, movedir, fwd, SPEED*dt*0.5)
             end
             if GetKey("s") then
-                self.tank.movedir = self.tank.movedir - fwd*SPEED*dt
+                Vector.madd(movedir, movedir, fwd, -SPEED*dt)
             end
             if GetKey("a") then
-                self.tank.movedir = self.tank.movedir - rhs*SPEED*dt
+                Vector.madd(movedir, movedir, rhs, -SPEED*dt)
             end
             if GetKey("d") then
-                self.tank.movedir = self.tank.movedir + rhs*SPEED*dt
+                Vector.madd(movedir, movedir, rhs, SPEED*dt)
             end
 
             if GetKey(KEY_SHIFT) then
-                self.tank.vel = self.tank.vel:lerp(Vector3(0,--[[ self.tank.vel:y() ]] 0, 0), 0.04221)
+                self.tank.vel:lerpInPlace(ZERO, 0.04221)
             end
 
             self.soundEngine:setFrequency(44100 + math.floor(self.tank.vel:mag() * 4500))
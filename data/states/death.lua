@@ -5,7 +5,13 @@ local AbstractState = require("states/abstract")
 return class "DeathState" (AbstractState) {
     enter = function(self)
         state:setCursor(false)
-        self.entertime = getTime() + 5
+        self.respawnTask = spawn(function()
+            wait(5)
+            state:switch("game")
+
+            tanks[-1].alive = true
+            tanks[-1].tails = {}
+        end)
 
         tanks[-1].alive = false
         tanks[-1].pos = Vector3(
@@ -16,13 +22,8 @@ return class "DeathState" (AbstractState) {
         tanks[-1].vel = Vector3()
     end,
 
-    update = function(self, dt)
-        if self.entertime < getTime() then
-            state:switch("game")
-
-            tanks[-1].alive = true
-            tanks[-1].tails = {}
-        end
+    leave = function(self)
+        cancel(self.respawnTask)
     end,
 
     draw2d = function(self)
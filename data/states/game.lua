@@ -6,10 +6,14 @@ return class "GameState" (AbstractState) {
     enter = function(self)
         state:setCursor(false)
         localPlayer:soundPlay()
+
+        -- gameplay churns through short-lived vectors and matrices
+        SetGCMode(GCKIND_GENERATIONAL)
     end,
 
     leave = function(self)
         localPlayer:soundStop()
+        SetGCMode(GCKIND_INCREMENTAL, 4)
     end,
 
     update = function(self)
@@ -5,6 +5,16 @@ SPHERE_BOUNCE_RADIUS = 60
 
 local tankModel = Model("assets/sphere.fbx", false)
 
+-- Scratch values reused every frame, see Vector.add and friends
+local IDENTITY = Matrix()
+local LIGHT_OFFSET = Vector3(0, 5, 0)
+local MODEL_OFFSET = Vector3(0, 15, 0)
+local tmpMove = Vector()
+local tmpNorm = Vector()
+local tmpPush = Vector()
+local tmpDrawPos = Vector()
+local tmpModelMat = Matrix()
+
 -- Sounds
 local borderHitSound = Sound("assets/sounds/wallhit.wav")
 borderHitSound:setVolume(80)
@@ -105,17 +115,16 @@ class "Tank" {
                 self.vel:y(5.0)
             end
 
-            world.colsys:forEach(function (shape)
-                shape:testSphere(self.pos, 5, self.vel+self.movedir-shape.pos:row(4), function (norm)
-                    norm = norm:normalize()
-                    p = norm * ((self.vel * norm) / (norm * norm))
-                    self.vel = (self.vel - p)
-                end)
+            Vector.add(tmpMove, self.vel, self.movedir)
+            world.colsys:testSphere(self.pos, 5, tmpMove, function (norm)
+                Vector.normalize(tmpNorm, norm)
+                Vector.scale(tmpPush, tmpNorm, (self.vel * tmpNorm) / (tmpNorm * tmpNorm))
+                self.vel:subInPlace(tmpPush)
             end)
             local hoverFactor = 2
-            self.vel = self.vel:lerp(self.movedir*1000, 0.01323)
-            self.hover = Vector3(0,math.sin(time*4) * (hoverFactor - math.min(self.vel:magSq(), hoverFactor) / hoverFactor),0)
-            self.pos = self.pos + self.vel
+            self.vel:lerpInPlace(Vector.scale(tmpMove, self.movedir, 1000), 0.01323)
+            self.hover:set(0,math.sin(time*4) * (hoverFactor - math.min(self.vel:magSq(), hoverFactor) / hoverFactor),0)
+            self.pos:addInPlace(self.vel)
             self.crotm = self.rot
 
             if self.pos:x() <= 0 then
@@ -161,11 +170,11 @@ class "Tank" {
 
     draw = function (self)
         if self.alive then
-            self.light:setPosition(self.pos+Vector3(0,5,0))
+            self.light:setPosition(Vector.add(tmpDrawPos, self.pos, LIGHT_OFFSET))
             self.light:enable(true, self.id+2)
-            Matrix():bind(WORLD)
+            IDENTITY:bind(WORLD)
             BindTexture(0, self.material)
-            tankModel:draw(Matrix():scale(20.0,20.0,20.0):translate(self.pos+Vector3(0, 15, 0)))
+            tankModel:draw(tmpModelMat:setTRS(Vector.add(tmpDrawPos, self.pos, MODEL_OFFSET), nil, 20.0))
             BindTexture(0)
             self:drawTrails(self.tails, 20)
             ToggleWireframe(true)
@@ -191,7 +200,7 @@ class "Tank" {
                 end
 
                 BindTexture(0, self.tailMaterial)
-                Matrix():bind(WORLD)
+                IDENTITY:bind(WORLD)
                 CullMode(CULLKIND_NONE)
                 AmbientColor(255, 255, 255)
                 DrawPolygon(
@@ -4,16 +4,7 @@ WORLD_TILES = {5,5}
 local ACTIVE_TILE_TEX_SLOT = 42
 
 local function addTile(colsys, col, pos)
-    local b = col.bounds
-
-    local terrainMesh = setmetatable({
-        tris = col.tris,
-        mat = col.mat,
-        bounds = cols.newBox({b.min-pos, b.max-pos})
-    }, col.__index)
-    terrainMesh.pos = Matrix():translate(pos)
-
-    colsys:addCollision(terrainMesh)
+    colsys:addInstance(col, Matrix():translate(pos))
 end
 
 local class = require "class"
@@ -1,5 +1,34 @@
 local _ = {}
 
+-- Scratch values for the per-triangle math, see Vector.add and friends
+local ZERO = Vector()
+local tmpSpherePos = Vector()
+local tmpBoxPos = Vector()
+local tmpMeshPos = Vector()
+local tmpWorldPos = Vector()
+local tmpDelta = Vector()
+
+local function axisDistSq(v, min, max)
+  local d = 0
+  if v < min then
+    d = d + squared(min - v)
+  end
+  if v > max then
+    d = d + squared(v - max)
+  end
+  return d
+end
+
+local function boxHitsSphere(box, pos, radius)
+  local min = box.min
+  local max = box.max
+  local sqDist = axisDistSq(pos:x(), min:x(), max:x()) +
+                 axisDistSq(pos:y(), min:y(), max:y()) +
+                 axisDistSq(pos:z(), min:z(), max:z())
+
+  return sqDist <= squared(radius)
+end
+
 -- Sphere API
 
 local Sphere = {}
@@ -10,12 +39,13 @@ function Sphere.clone(self)
 end
 
 function Sphere.testSphere(self, pos, radius, move, fn)
-  pos = pos + move
-  local d = (self.pos - pos):magSq()
+  pos = Vector.add(tmpSpherePos, pos, move)
+  local delta = Vector.sub(tmpDelta, self.pos, pos)
+  local d = delta:magSq()
   local r = (self.radius + radius)
 
   if d <= r then
-    return {fn((self.pos - pos):normalize(), (r-d))}
+    return {fn(Vector.normalize(Vector(), delta), (r-d))}
   end
   if d == 0 then
     return {fn(Vector3(1,0,0), self.radius)}
@@ -36,56 +66,43 @@ function Sphere.testBox(self, bounds, move, fn)
 end
 
 -- TriangleMesh API
+-- The triangles live in a native CollisionMesh (self.tris) with a BVH over them.
 
 local TriangleMesh = {}
 TriangleMesh.__index = TriangleMesh
 
 function TriangleMesh.clone(self)
-  return _.newTriangleMesh(self.tris, self.mat)
+  local copy = setmetatable({}, TriangleMesh)
+  copy.tris = self.tris
+  copy.bounds = self.bounds:clone()
+  copy.mat = self.mat
+  return copy
 end
 
 function TriangleMesh.testSphere(self, pos, radius, move, fn)
-  pos = pos + move
-  
-  local aabbContacts = self.bounds:testSphere(pos, radius, move, function ()
-    return true
-  end)
+  -- CollisionMesh.testSphere reads pos before calling fn, the scratch value can be shared
+  pos = Vector.add(tmpMeshPos, pos, move)
 
-  if #aabbContacts < 1 then
+  if not boxHitsSphere(self.bounds, Vector.add(tmpBoxPos, pos, move), radius) then
     return {}
   end
 
-  local contacts = {}
-
-  for _, tr in pairs(self.tris) do
-    local v1 = tr[1]
-    local v2 = tr[2]
-    local v3 = tr[3]
-
-    local u = v2 - v1
-    local v = v3 - v1
-    local n = u:cross(v)
-    local w = pos - v1
-
-    local n2 = squared(n)
-    local a = (u:cross(w) * n) / n2
-    local b = (w:cross(v) * n) / n2
-    local c = 1 - a - b
+  return self.tris:testSphere(pos, radius, fn)
+end
 
-    if (0 <= c) and (c <= 1) and
-      (0 <= b) and (b <= 1) and
-      (0 <= a) and (a <= 1) then
-        local pp = (v1 * c) + (v2 * b) + (v3 * a)
+function TriangleMesh.testPoint(self, pos, move, fn)
+  return self:testSphere(pos, 0, move, fn)
+end
 
-        local d = (pp - pos):magSq()
-        if d <= (radius*radius) and (pp - pos) * n:normalize() < 0 then
-          local pd = d - radius
-          table.insert(contacts, {fn(n, pd, tr, pp)})
-        end
-    end
-  end
+-- fn receives the index of each triangle overlapping the box
+function TriangleMesh.testBox(self, box, move, fn)
+  move = move or ZERO
+  return self.tris:testBox(box.min + move, box.max + move, fn)
+end
 
-  return contacts
+-- returns distance, normal, point and triangle index of the closest hit, or nil
+function TriangleMesh.testRay(self, origin, dir, maxDist)
+  return self.tris:testRay(origin, dir, maxDist)
 end
 
 -- Box API
@@ -102,28 +119,9 @@ function Box.clone(self)
 end
 
 function Box.testSphere(self, pos, radius, move, fn)
-  if move == nil then
-    move = Vector()
-  end
-  pos = pos + move
-  local sqDist = 0.0
-  local p = pos:get()
-  local min = self.min:get()
-  local max = self.max:get()
-
-  for i=1,3 do
-    local v = p[i]
-    if v < min[i] then
-      sqDist = sqDist + squared(min[i] - v)
-    end
-    if v > max[i] then
-      sqDist = sqDist + squared(v - max[i])
-    end
-  end
-
-  local delta = sqDist - squared(radius)
+  pos = Vector.add(tmpBoxPos, pos, move or ZERO)
 
-  if delta <= 0 then
+  if boxHitsSphere(self, pos, radius) then
     local cp = (self.max - self.min) / 2
     local n = (cp - pos)
     return {fn(n:normalize(), (radius - n:magSq()))}
@@ -157,6 +155,12 @@ function Box.testBox(self, box, move, fn)
   end
 end
 
+-- Instance API
+-- One placement of a shared TriangleMesh, see World.addInstance
+
+local Instance = {}
+Instance.__index = Instance
+
 -- World API
 
 local World = {}
@@ -168,7 +172,39 @@ function World.addCollision(self, shape)
 end
 
 function World.delCollision(self, idx)
-  table.remove(self.shapes, idx)
+  local shape = table.remove(self.shapes, idx)
+  if shape ~= nil and getmetatable(shape) == Instance then
+    self.instances:removeInstance(shape.id)
+  end
+end
+
+-- Places mesh with the transform mat, all instances of a mesh share its triangles
+function World.addInstance(self, mesh, mat)
+  local shape = setmetatable({}, Instance)
+  shape.mesh = mesh
+  shape.pos = mat
+  shape.id = self.instances:addInstance(mesh.tris, mat)
+  shape.bounds = _.newBox({self.instances:getBounds(shape.id)})
+  return self:addCollision(shape)
+end
+
+-- Tests the instances near the sphere in world space, calls fn(norm, depth, instance, point, triangle)
+function World.testSphere(self, pos, radius, move, fn)
+  return self.instances:testSphere(Vector.add(tmpWorldPos, pos, move or ZERO), radius, fn)
+end
+
+-- returns distance, normal, point, instance and triangle of the closest hit, or nil
+function World.testRay(self, origin, dir, maxDist)
+  return self.instances:testRay(origin, dir, maxDist)
+end
+
+-- Batch queries over Float32Buffers run in parallel, see CollisionWorld.testSpheres and testRays
+function World.testSpheres(self, spheres, radius)
+  return self.instances:testSpheres(spheres, radius)
+end
+
+function World.testRays(self, origins, dirs, maxDist)
+  return self.instances:testRays(origins, dirs, maxDist)
 end
 
 function World.forEach(self, fn)
@@ -179,15 +215,19 @@ end
 
 -- Public API
 
+local function newTriangleMeshFromCollisionMesh(tris, mat)
+  local self = setmetatable({}, TriangleMesh)
+  self.tris = tris:build()
+  self.bounds = _.newBox({tris:getBounds()})
+  self.mat = mat
+  return self
+end
+
 function _.newTriangleMesh(tris, mat)
   if mat == nil then
     mat = Matrix()
   end
-  local self = setmetatable({}, TriangleMesh)
-  self.tris = transformTriangles(tris, mat)
-  self.bounds = _.newBox(calculateTrisMinMax(self.tris))
-  self.mat = mat
-  return self
+  return newTriangleMeshFromCollisionMesh(CollisionMesh():addTriangles(tris, mat), mat)
 end
 
 function _.newTriangleMeshFromVertexData(data, mat)
@@ -196,7 +236,10 @@ function _.newTriangleMeshFromVertexData(data, mat)
 end
 
 function _.newTriangleMeshFromPart(part, mat)
-  return _.newTriangleMeshFromVertexData({part:getVertices(), part:getIndices()}, mat)
+  if mat == nil then
+    mat = Matrix()
+  end
+  return newTriangleMeshFromCollisionMesh(CollisionMesh():addPart(part, mat), mat)
 end
 
 function _.newBox(data)
@@ -214,7 +257,7 @@ function _.newBoxFromVertexData(data, mat)
 end
 
 function _.newBoxFromPart(part, mat)
-  return _.newBoxFromVertexData({part:getVertices(), part:getIndices()}, mat)
+  return _.newBox({CollisionMesh():addPart(part, mat):getBounds()})
 end
 
 function _.newSphere(pos, radius)
@@ -227,6 +270,7 @@ end
 function _.newWorld()
   local self = setmetatable({}, World)
   self.shapes = {}
+  self.instances = CollisionWorld()
   return self
 end
 
@@ -0,0 +1,66 @@
+-- Runs 5 systems over 10k entities, once as a plain table and once in a
+-- world, and logs the time per frame of both: dofile("libs/ecs/bench.lua")
+
+local ecs = require "ecs"
+
+local N = 10000
+local FRAMES = 100
+
+local function populate(add)
+  for i=1,N do
+    local e = ecs.ent()
+    e:add(ecs.cmp("pos", {x=i, y=0}))
+    if i % 2 == 0 then e:add(ecs.cmp("vel", {x=1, y=1})) end
+    if i % 3 == 0 then e:add(ecs.cmp("health", {hp=100})) end
+    if i % 5 == 0 then e:add(ecs.cmp("ai", {state=0})) end
+    if i % 7 ~= 0 then e:add(ecs.cmp("sprite", {frame=0})) end
+    add(e)
+  end
+end
+
+local move = ecs.sys({"pos", "vel"}, function (e, dt)
+  e.pos.x = e.pos.x + e.vel.x * dt
+  e.pos.y = e.pos.y + e.vel.y * dt
+end)
+
+local regen = ecs.sys({"health"}, function (e)
+  e.health.hp = math.min(e.health.hp + 1, 100)
+end)
+
+local think = ecs.sys({"ai", "pos"}, function (e)
+  e.ai.state = e.pos.x > 0 and 1 or 0
+end)
+
+local animate = ecs.sys({"sprite"}, function (e)
+  e.sprite.frame = (e.sprite.frame + 1) % 8
+end)
+
+local visible = ecs.sys({"pos", "sprite", "health"}, function (e)
+  return e
+end)
+
+local function run(ents)
+  local start = os.clock()
+  local shown = 0
+  for _=1,FRAMES do
+    move(ents, 0.016)
+    regen(ents)
+    think(ents)
+    animate(ents)
+    shown = #visible(ents)
+  end
+  local count = ecs.cnt(ents, {"pos", "vel"})
+  return (os.clock() - start) / FRAMES * 1000, shown, count
+end
+
+local plain = {}
+populate(function (e) plain[#plain+1] = e end)
+
+local world = ecs.world()
+populate(function (e) world:ent(e) end)
+
+local plainTime, plainShown, plainCount = run(plain)
+local worldTime, worldShown, worldCount = run(world)
+
+LogString(string.format("ecs: %d entities, table %.2f ms/frame (%d, %d), world %.2f ms/frame (%d, %d)",
+  N, plainTime, plainShown, plainCount, worldTime, worldShown, worldCount))
@@ -1,13 +1,23 @@
 -- adapted from https://www.lexaloffle.com/bbs/?tid=39021
+--
+-- Entities can also live in a world(), backed by a native EntityWorld that
+-- keeps them in archetypes and caches the entities each system matches.
+-- Components of world entities have to go through add and rem.
 
 local m={
   add=function (self, cmp)
     assert(cmp._name)
     self[cmp._name]=cmp
+    if self._world then
+      self._world.native:set(self._id, self._world:cid(cmp._name), cmp)
+    end
     return self
   end,
   rem=function (self, name)
     self[name]=nil
+    if self._world then
+      self._world.native:remove(self._id, self._world:cid(name))
+    end
     return self
   end,
 }
@@ -25,8 +35,90 @@ local function cmp(name, t)
   return t
 end
 
+-- World API
+
+local World={}
+World.__index=World
+
+-- component ids of the native world, handed out by name
+function World.cid(self, name)
+  local id=self.ids[name]
+  if not id then
+    id=#self.names+1
+    self.names[id]=name
+    self.ids[name]=id
+  end
+  return id
+end
+
+-- makes t an entity of the world, along with the components it already has
+function World.ent(self, t)
+  t=ent(t)
+  t._world=self
+  t._id=self.native:create(t)
+  for name, c in pairs(t) do
+    if type(c)=="table" and c._name==name then
+      self.native:set(t._id, self:cid(name), c)
+    end
+  end
+  return t
+end
+
+function World.del(self, e)
+  self.native:destroy(e._id)
+  e._world=nil
+  e._id=nil
+end
+
+-- native query for a list of component names, cached per list
+function World.query(self, names)
+  local q=self.queries[names]
+  if not q then
+    local ids={}
+    for i, name in ipairs(names) do
+      ids[i]=self:cid(name)
+    end
+    q=self.native:query(ids)
+    self.queries[names]=q
+  end
+  return q
+end
+
+local function world()
+  local self=setmetatable({}, World)
+  self.native=EntityWorld()
+  self.ids={}
+  self.names={}
+  self.queries=setmetatable({}, {__mode="k"})
+  return self
+end
+
+-- Systems run over a table of entities or over a world. On a world they see
+-- the entities matched when the run starts. Every run returns a table of its
+-- own, the entity lists are recycled per world and a run nested in f takes
+-- another one.
 local function sys(names, f)
+  local pools=setmetatable({}, {__mode="k"})
   return function (ents, ...)
+    if getmetatable(ents)==World then
+      local pool=pools[ents]
+      if not pool then
+        pool={}
+        pools[ents]=pool
+      end
+      local list=table.remove(pool) or {}
+      local res={}
+      local n=0
+      for i=1,ents.native:entities(ents:query(names), list) do
+        local r=f(list[i], ...)
+        if r then
+          n=n+1
+          res[n]=r
+        end
+      end
+      pool[#pool+1]=list
+      return res
+    end
     local res={}
     for _, e in pairs(ents) do
       for _, name in pairs(names) do
@@ -40,6 +132,9 @@ local function sys(names, f)
 end
 
 local function cnt(ents, cmps)
+  if getmetatable(ents)==World then
+    return ents.native:count(ents:query(cmps))
+  end
   return #sys(cmps, function () return 1 end)(ents)
 end
 
@@ -48,4 +143,5 @@ return {
   cmp=cmp,
   sys=sys,
   cnt=cnt,
+  world=world,
 }
@@ -122,18 +122,35 @@ local function serializeTable(val, name, skipnewlines, depth, skipfuncs)
   return tmp
 end
 
+-- Config and save data go through the native binary serializer, functions
+-- are kept as bytecode unless skipfuncs is set.
 local function encode(table, skipfuncs)
-  skipfuncs = skipfuncs or false
-	return "return"..serializeTable(table, nil, nil, nil, skipfuncs)
+  return Serialize(table, not skipfuncs)
 end
 
-local function decode(str)
-  local f = load(str)()
+-- Functions are only restored with withfuncs set, which is unsafe on data
+-- that could have been tampered with, like save files.
+local function decode(str, withfuncs)
+  local value, err = Deserialize(str, withfuncs == true)
+  if err == nil then
+    return value
+  end
+
+  -- saved before the binary format, the data is the source serializeTable made,
+  -- it gets no globals to reach
+  local chunk = load(str, "=state", "t", {})
+  if chunk == nil then
+    return nil
+  end
+
+  local f = chunk()
   local fndump = "fn:"
 
-  for k, v in pairs(f) do
-    if type(v) == "string" and v:sub(1, #fndump) == fndump then
-      f[k] = load(v:sub(#fndump+1, #v))
+  if withfuncs then
+    for k, v in pairs(f) do
+      if type(v) == "string" and v:sub(1, #fndump) == fndump then
+        f[k] = load(v:sub(#fndump+1, #v))
+      end
     end
   end
 	return f
@@ -1,5 +1,4 @@
 local class = require "class"
-local helpers = require "helpers"
 
 class "FramePose" {
   __init__ = function (self)
@@ -78,42 +77,39 @@ class "Keyframe" {
   end
 }
 
+-- Keyframes are evaluated by a native TweenLayer, which writes the pose into
+-- the Vectors and Matrices of self.pose and self.mat on every step.
 class "Layer" {
   __init__ = function (self)
     self.keyframes = {}
     self.maxtime = -1.0
     self.pose = FramePose()
+    self.mat = Matrix()
+    self.native = TweenLayer()
+    self.native:bind(self.pose.comps, self.mat)
   end,
 
   step = function (self, time)
-     for i = 1, #self.pose.comps do
-      local base = self:findBase(time, i)
-      local goal = self:findGoal(time, i)
-
-      if base == nil or goal == nil then
-        if base ~= nil then
-          self.pose.comps[i] = base.pose.comps[i]
-        else
-          self.pose.comps[i] = FramePose.default(i)
-        end
-      elseif i == 5 then
-        -- Handle baked matrices
-        self.pose.comps[i] = goal.pose.comps[i]
-      else
-        -- TODO Implement other interpolation types
-        self.pose.comps[i] = helpers.lerp(base.pose.comps[i], goal.pose.comps[i], (time-base.time) / (goal.time-base.time))
-      end
-    end
-
-    self.mat = Matrix():scale(self.pose.comps[3]):rotate(self.pose.comps[2]):translate(self.pose.comps[1])
+    self.native:step(time)
   end,
 
   add = function (self, keyframe)
-    if keyframe.time > self.maxtime then
-      table.insert(self.keyframes, keyframe)
-      self.maxtime = keyframe.time
-      self:updateMaxTime()
+    local comps, uses = keyframe.pose.comps, keyframe.pose.uses
+    local i = #self.keyframes
+
+    while i > 0 and self.keyframes[i].time > keyframe.time do
+      i = i - 1
     end
+
+    table.insert(self.keyframes, i + 1, keyframe)
+    self.native:add(keyframe.time,
+      uses[1] and comps[1] or nil,
+      uses[2] and comps[2] or nil,
+      uses[3] and comps[3] or nil,
+      uses[4] and comps[4] or nil,
+      uses[5] and comps[5] or nil)
+    self.maxtime = self.native:maxTime()
+    self:updateMaxTime()
   end,
 
   setAction = function (self, action)
@@ -128,30 +124,6 @@ class "Layer" {
       end
     end
   end,
-
-  findBase = function (self, time, comp)
-    local keyframe = nil
-
-    for _, frame in pairs(self.keyframes) do
-      if frame.time <= time and frame.pose.uses[comp] then
-        keyframe = frame
-      else
-        break
-      end
-    end
-
-    return keyframe
-  end,
-
-  findGoal = function (self, time, comp)
-    for _, frame in pairs(self.keyframes) do
-      if frame.time > time and frame.pose.uses[comp] then
-        return frame
-      end
-    end
-
-    return nil
-  end,
 }
 
 class "Action" {
@@ -160,12 +132,11 @@ class "Action" {
     self.maxtime = -1
     self.loop = loop or false
     self.events = {}
+    self.natives = {}
   end,
 
   step = function (self, time)
-    for _, layer in pairs(self.layers) do
-      layer:step(time)
-    end
+    TweenLayer.step(self.natives, time)
 
     for _, event in pairs(self.events) do
       if not event.fired and event.time <= time then
@@ -180,6 +151,12 @@ class "Action" {
   add = function (self, name, layer)
     self.layers[name] = layer
     layer:setAction(self)
+
+    -- stepped all at once, see step
+    self.natives = {}
+    for _, l in pairs(self.layers) do
+      table.insert(self.natives, l.native)
+    end
   end,
 
   event = function (self, time, cb)